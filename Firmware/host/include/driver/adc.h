@@ -0,0 +1,145 @@
+/**
+ * @file adc.h
+ * @brief Host stand-in for the ESP-IDF ADC driver
+ * @author Jorge Minjares (https://github.com/JorgeMinjares)
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef SIM_DRIVER_ADC_H
+#define SIM_DRIVER_ADC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+/**
+ * @brief ADC1 channels
+ */
+typedef enum
+{
+    ADC1_CHANNEL_0 = 0, /*!< GPIO36 */
+    ADC1_CHANNEL_3 = 3, /*!< GPIO39 */
+    ADC1_CHANNEL_4 = 4, /*!< GPIO32 */
+    ADC1_CHANNEL_5 = 5, /*!< GPIO33 */
+    ADC1_CHANNEL_6 = 6, /*!< GPIO34 */
+    ADC1_CHANNEL_7 = 7, /*!< GPIO35 */
+    ADC1_CHANNEL_MAX,   /*!< Channel count */
+} adc1_channel_t;
+
+/**
+ * @brief Sample width
+ */
+typedef enum
+{
+    ADC_WIDTH_BIT_9,  /*!< 9 bits */
+    ADC_WIDTH_BIT_10, /*!< 10 bits */
+    ADC_WIDTH_BIT_11, /*!< 11 bits */
+    ADC_WIDTH_BIT_12, /*!< 12 bits */
+} adc_bits_width_t;
+
+/**
+ * @brief Input attenuation
+ */
+typedef enum
+{
+    ADC_ATTEN_DB_0,   /*!< 0 dB */
+    ADC_ATTEN_DB_2_5, /*!< 2.5 dB */
+    ADC_ATTEN_DB_6,   /*!< 6 dB */
+    ADC_ATTEN_DB_11,  /*!< 11 dB */
+} adc_atten_t;
+
+/**
+ * @brief ADC unit
+ */
+typedef enum
+{
+    ADC_UNIT_1 = 1, /*!< SAR ADC 1 */
+    ADC_UNIT_2 = 2, /*!< SAR ADC 2 */
+} adc_unit_t;
+
+/**
+ * @brief Continuous mode conversion mode
+ */
+typedef enum
+{
+    ADC_CONV_SINGLE_UNIT_1 = 1, /*!< ADC1 only */
+    ADC_CONV_SINGLE_UNIT_2 = 2, /*!< ADC2 only */
+} adc_digi_convert_mode_t;
+
+/**
+ * @brief Continuous mode output format
+ */
+typedef enum
+{
+    ADC_DIGI_OUTPUT_FORMAT_TYPE1, /*!< 12-bit data, 4-bit channel */
+    ADC_DIGI_OUTPUT_FORMAT_TYPE2, /*!< 11-bit data, 4-bit channel, 1-bit unit */
+} adc_digi_output_format_t;
+
+#define ADC_CONV_LIMIT_EN 1 /*!< ESP32 needs the conversion limit */
+
+/**
+ * @brief Continuous mode driver buffers
+ */
+typedef struct
+{
+    uint32_t max_store_buf_size; /*!< Ring buffer bytes, older frames are lost when full */
+    uint32_t conv_num_each_intr; /*!< Bytes per DMA frame */
+    uint32_t adc1_chan_mask;     /*!< ADC1 channels used */
+    uint32_t adc2_chan_mask;     /*!< ADC2 channels used */
+} adc_digi_init_config_t;
+
+/**
+ * @brief One entry of the conversion pattern
+ */
+typedef struct
+{
+    uint8_t atten;     /*!< adc_atten_t */
+    uint8_t channel;   /*!< Channel */
+    uint8_t unit;      /*!< 0 for ADC1 */
+    uint8_t bit_width; /*!< Sample width */
+} adc_digi_pattern_config_t;
+
+/**
+ * @brief Continuous mode controller
+ */
+typedef struct
+{
+    bool conv_limit_en;                     /*!< Enable the conversion limit */
+    uint32_t conv_limit_num;                /*!< Conversions per trigger */
+    uint32_t pattern_num;                   /*!< Pattern entries */
+    adc_digi_pattern_config_t *adc_pattern; /*!< Conversion pattern */
+    uint32_t sample_freq_hz;                /*!< Conversions per second */
+    adc_digi_convert_mode_t conv_mode;      /*!< Units converted */
+    adc_digi_output_format_t format;        /*!< Output format */
+} adc_digi_configuration_t;
+
+/**
+ * @brief One conversion result
+ */
+typedef struct
+{
+    union
+    {
+        struct
+        {
+            uint16_t data : 12;   /*!< Conversion */
+            uint16_t channel : 4; /*!< Channel */
+        } type1;                  /*!< ADC_DIGI_OUTPUT_FORMAT_TYPE1 */
+        uint16_t val;             /*!< Raw word */
+    };
+} adc_digi_output_data_t;
+
+esp_err_t adc1_config_width(adc_bits_width_t width_bit);
+esp_err_t adc1_config_channel_atten(adc1_channel_t channel, adc_atten_t atten);
+int adc1_get_raw(adc1_channel_t channel);
+esp_err_t adc_digi_initialize(const adc_digi_init_config_t *init_config);
+esp_err_t adc_digi_controller_configure(const adc_digi_configuration_t *config);
+esp_err_t adc_digi_start(void);
+esp_err_t adc_digi_stop(void);
+esp_err_t adc_digi_read_bytes(uint8_t *buf, uint32_t length_max, uint32_t *out_length, uint32_t timeout_ms);
+esp_err_t adc_digi_deinitialize(void);
+
+#endif
@@ -0,0 +1,66 @@
+/**
+ * @file dac.h
+ * @brief Host stand-in for the ESP-IDF DAC driver
+ * @author Jorge Minjares (https://github.com/JorgeMinjares)
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef SIM_DRIVER_DAC_H
+#define SIM_DRIVER_DAC_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+/**
+ * @brief DAC channels
+ */
+typedef enum
+{
+    DAC_CHANNEL_1 = 0, /*!< GPIO25 */
+    DAC_CHANNEL_2 = 1, /*!< GPIO26 */
+    DAC_CHANNEL_MAX,   /*!< Channel count */
+} dac_channel_t;
+
+/**
+ * @brief Cosine generator amplitude, full scale divided by 1, 2, 4 or 8
+ */
+typedef enum
+{
+    DAC_CW_SCALE_1 = 0x0, /*!< Full scale */
+    DAC_CW_SCALE_2 = 0x1, /*!< Half scale */
+    DAC_CW_SCALE_4 = 0x2, /*!< Quarter scale */
+    DAC_CW_SCALE_8 = 0x3, /*!< Eighth scale */
+} dac_cw_scale_t;
+
+/**
+ * @brief Cosine generator phase
+ */
+typedef enum
+{
+    DAC_CW_PHASE_0 = 0x2,   /*!< In phase */
+    DAC_CW_PHASE_180 = 0x3, /*!< Inverted */
+} dac_cw_phase_t;
+
+/**
+ * @brief Cosine generator settings of one channel
+ */
+typedef struct
+{
+    dac_channel_t en_ch;  /*!< Channel switched to the generator */
+    dac_cw_scale_t scale; /*!< Amplitude */
+    dac_cw_phase_t phase; /*!< Phase */
+    uint32_t freq;        /*!< Frequency, shared by both channels (Hz) */
+    int8_t offset;        /*!< DC offset */
+} dac_cw_config_t;
+
+esp_err_t dac_output_enable(dac_channel_t channel);
+esp_err_t dac_output_disable(dac_channel_t channel);
+esp_err_t dac_output_voltage(dac_channel_t channel, uint8_t dac_value);
+esp_err_t dac_cw_generator_enable(void);
+esp_err_t dac_cw_generator_disable(void);
+esp_err_t dac_cw_generator_config(dac_cw_config_t *cw);
+
+#endif
@@ -0,0 +1,74 @@
+/**
+ * @file gpio.h
+ * @brief Host stand-in for the ESP-IDF GPIO driver
+ * @author Jorge Minjares (https://github.com/JorgeMinjares)
+ * @brief Pin levels live in the simulated GPIO matrix (sim/sim_hw.c).
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef SIM_DRIVER_GPIO_H
+#define SIM_DRIVER_GPIO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#define GPIO_NUM_MAX 40 /*!< ESP32 pad count */
+#define GPIO_NUM_NC (-1) /*!< Not connected */
+
+typedef int gpio_num_t; /*!< GPIO number */
+
+/**
+ * @brief Pin direction
+ */
+typedef enum
+{
+    GPIO_MODE_DISABLE,      /*!< Disabled */
+    GPIO_MODE_INPUT,        /*!< Input */
+    GPIO_MODE_OUTPUT,       /*!< Output */
+    GPIO_MODE_INPUT_OUTPUT, /*!< Input and output */
+} gpio_mode_t;
+
+/**
+ * @brief Pull resistor configuration
+ */
+typedef enum
+{
+    GPIO_PULLUP_ONLY,     /*!< Pull-up */
+    GPIO_PULLDOWN_ONLY,   /*!< Pull-down */
+    GPIO_PULLUP_PULLDOWN, /*!< Both */
+    GPIO_FLOATING,        /*!< None */
+} gpio_pull_mode_t;
+
+/**
+ * @brief Interrupt trigger
+ */
+typedef enum
+{
+    GPIO_INTR_DISABLE,    /*!< Disabled */
+    GPIO_INTR_POSEDGE,    /*!< Rising edge */
+    GPIO_INTR_NEGEDGE,    /*!< Falling edge */
+    GPIO_INTR_ANYEDGE,    /*!< Both edges */
+    GPIO_INTR_LOW_LEVEL,  /*!< Low level */
+    GPIO_INTR_HIGH_LEVEL, /*!< High level */
+} gpio_int_type_t;
+
+typedef void (*gpio_isr_t)(void *arg); /*!< Per-pin ISR handler */
+
+void gpio_pad_select_gpio(gpio_num_t gpio_num);
+esp_err_t gpio_set_direction(gpio_num_t gpio_num, gpio_mode_t mode);
+esp_err_t gpio_set_pull_mode(gpio_num_t gpio_num, gpio_pull_mode_t pull);
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level);
+int gpio_get_level(gpio_num_t gpio_num);
+esp_err_t gpio_set_intr_type(gpio_num_t gpio_num, gpio_int_type_t intr_type);
+esp_err_t gpio_intr_enable(gpio_num_t gpio_num);
+esp_err_t gpio_intr_disable(gpio_num_t gpio_num);
+esp_err_t gpio_install_isr_service(int intr_alloc_flags);
+esp_err_t gpio_isr_handler_add(gpio_num_t gpio_num, gpio_isr_t isr_handler, void *args);
+esp_err_t gpio_isr_handler_remove(gpio_num_t gpio_num);
+esp_err_t gpio_wakeup_enable(gpio_num_t gpio_num, gpio_int_type_t intr_type);
+
+#endif
@@ -0,0 +1,96 @@
+/**
+ * @file uart.h
+ * @brief Host stand-in for the ESP-IDF UART driver
+ * @author Jorge Minjares (https://github.com/JorgeMinjares)
+ * @brief TX bytes are counted and handed to an optional capture hook. RX
+ *        bytes are injected by the simulation and block readers like the
+ *        driver's ring buffer does.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef SIM_DRIVER_UART_H
+#define SIM_DRIVER_UART_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "driver/gpio.h"
+
+#define UART_PIN_NO_CHANGE (-1) /*!< Keep current pin */
+
+typedef int uart_port_t; /*!< UART port number */
+
+#define UART_NUM_0 0   /*!< UART 0 */
+#define UART_NUM_1 1   /*!< UART 1 */
+#define UART_NUM_2 2   /*!< UART 2 */
+#define UART_NUM_MAX 3 /*!< Port count */
+
+/**
+ * @brief Word length
+ */
+typedef enum
+{
+    UART_DATA_5_BITS, /*!< 5 bits */
+    UART_DATA_6_BITS, /*!< 6 bits */
+    UART_DATA_7_BITS, /*!< 7 bits */
+    UART_DATA_8_BITS, /*!< 8 bits */
+} uart_word_length_t;
+
+/**
+ * @brief Parity
+ */
+typedef enum
+{
+    UART_PARITY_DISABLE, /*!< None */
+    UART_PARITY_EVEN,    /*!< Even */
+    UART_PARITY_ODD,     /*!< Odd */
+} uart_parity_t;
+
+/**
+ * @brief Stop bits
+ */
+typedef enum
+{
+    UART_STOP_BITS_1 = 1,   /*!< 1 stop bit */
+    UART_STOP_BITS_1_5 = 2, /*!< 1.5 stop bits */
+    UART_STOP_BITS_2 = 3,   /*!< 2 stop bits */
+} uart_stop_bits_t;
+
+/**
+ * @brief Hardware flow control
+ */
+typedef enum
+{
+    UART_HW_FLOWCTRL_DISABLE, /*!< Disabled */
+    UART_HW_FLOWCTRL_RTS,     /*!< RTS */
+    UART_HW_FLOWCTRL_CTS,     /*!< CTS */
+    UART_HW_FLOWCTRL_CTS_RTS, /*!< Both */
+} uart_hw_flowcontrol_t;
+
+/**
+ * @brief UART configuration
+ */
+typedef struct
+{
+    int baud_rate;                   /*!< Baud rate */
+    uart_word_length_t data_bits;    /*!< Word length */
+    uart_parity_t parity;            /*!< Parity */
+    uart_stop_bits_t stop_bits;      /*!< Stop bits */
+    uart_hw_flowcontrol_t flow_ctrl; /*!< Flow control */
+    uint8_t rx_flow_ctrl_thresh;     /*!< RTS threshold */
+} uart_config_t;
+
+esp_err_t uart_param_config(uart_port_t uart_num, const uart_config_t *uart_config);
+esp_err_t uart_set_pin(uart_port_t uart_num, int tx_io_num, int rx_io_num, int rts_io_num, int cts_io_num);
+esp_err_t uart_driver_install(uart_port_t uart_num, int rx_buffer_size, int tx_buffer_size,
+                              int queue_size, QueueHandle_t *uart_queue, int intr_alloc_flags);
+int uart_write_bytes(uart_port_t uart_num, const void *src, size_t size);
+int uart_read_bytes(uart_port_t uart_num, void *buf, uint32_t length, TickType_t ticks_to_wait);
+esp_err_t uart_set_wakeup_threshold(uart_port_t uart_num, int wakeup_threshold);
+
+#endif
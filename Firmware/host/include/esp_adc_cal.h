@@ -0,0 +1,47 @@
+/**
+ * @file esp_adc_cal.h
+ * @brief Host stand-in for the ESP-IDF ADC calibration API
+ * @author Jorge Minjares (https://github.com/JorgeMinjares)
+ * @brief Characterizes every chip with the same linear curve: 142 mV at raw
+ *        0 and 3151 mV at raw 4095, close to a typical ESP32 at 11 dB.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef SIM_ESP_ADC_CAL_H
+#define SIM_ESP_ADC_CAL_H
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "driver/adc.h"
+
+/**
+ * @brief Source of the calibration
+ */
+typedef enum
+{
+    ESP_ADC_CAL_VAL_EFUSE_VREF = 0, /*!< eFuse Vref */
+    ESP_ADC_CAL_VAL_EFUSE_TP = 1,   /*!< eFuse two point */
+    ESP_ADC_CAL_VAL_DEFAULT_VREF = 2, /*!< Default Vref */
+} esp_adc_cal_value_t;
+
+/**
+ * @brief Characteristics of one unit and attenuation
+ */
+typedef struct
+{
+    adc_unit_t adc_num;           /*!< Unit */
+    adc_atten_t atten;            /*!< Attenuation */
+    adc_bits_width_t bit_width;   /*!< Sample width */
+    uint32_t coeff_a;             /*!< Gain, mV per 65536 LSB */
+    uint32_t coeff_b;             /*!< Offset in mV */
+    uint32_t vref;                /*!< Reference in mV */
+} esp_adc_cal_characteristics_t;
+
+esp_adc_cal_value_t esp_adc_cal_characterize(adc_unit_t adc_num, adc_atten_t atten, adc_bits_width_t bit_width,
+                                             uint32_t default_vref, esp_adc_cal_characteristics_t *chars);
+uint32_t esp_adc_cal_raw_to_voltage(uint32_t adc_reading, const esp_adc_cal_characteristics_t *chars);
+
+#endif
@@ -0,0 +1,18 @@
+/**
+ * @file esp_attr.h
+ * @brief Host stand-in for ESP-IDF placement attributes
+ * @author Jorge Minjares (https://github.com/JorgeMinjares)
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef SIM_ESP_ATTR_H
+#define SIM_ESP_ATTR_H
+
+#define IRAM_ATTR        /*!< Code placed in IRAM on target */
+#define DRAM_ATTR        /*!< Data placed in DRAM on target */
+#define RTC_DATA_ATTR    /*!< Data kept in RTC memory on target */
+
+#endif
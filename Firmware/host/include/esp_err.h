@@ -0,0 +1,39 @@
+/**
+ * @file esp_err.h
+ * @brief Host stand-in for ESP-IDF error codes
+ * @author Jorge Minjares (https://github.com/JorgeMinjares)
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef SIM_ESP_ERR_H
+#define SIM_ESP_ERR_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef int esp_err_t; /*!< Error code */
+
+#define ESP_OK 0                    /*!< Success */
+#define ESP_FAIL -1                 /*!< Generic failure */
+#define ESP_ERR_NO_MEM 0x101        /*!< Out of memory */
+#define ESP_ERR_INVALID_ARG 0x102   /*!< Invalid argument */
+#define ESP_ERR_INVALID_STATE 0x103 /*!< Invalid state */
+#define ESP_ERR_TIMEOUT 0x107       /*!< Timeout */
+
+/*!< Abort on error, like the target build */
+#define ESP_ERROR_CHECK(x)                                                          \
+    do                                                                              \
+    {                                                                               \
+        esp_err_t err_rc_ = (x);                                                    \
+        if (err_rc_ != ESP_OK)                                                      \
+        {                                                                           \
+            fprintf(stderr, "ESP_ERROR_CHECK failed: 0x%x at %s:%d\n", err_rc_,      \
+                    __FILE__, __LINE__);                                            \
+            abort();                                                                \
+        }                                                                           \
+    } while (0)
+
+#endif
@@ -0,0 +1,38 @@
+/**
+ * @file esp_log.h
+ * @brief Host stand-in for the ESP-IDF logger
+ * @author Jorge Minjares (https://github.com/JorgeMinjares)
+ * @brief Messages are stamped with virtual time and dropped unless the
+ *        simulation enables logging.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef SIM_ESP_LOG_H
+#define SIM_ESP_LOG_H
+
+/**
+ * @brief Log levels
+ */
+typedef enum
+{
+    ESP_LOG_NONE,    /*!< No output */
+    ESP_LOG_ERROR,   /*!< Errors */
+    ESP_LOG_WARN,    /*!< Warnings */
+    ESP_LOG_INFO,    /*!< Information */
+    ESP_LOG_DEBUG,   /*!< Debug */
+    ESP_LOG_VERBOSE, /*!< Everything */
+} esp_log_level_t;
+
+void esp_log_level_set(const char *tag, esp_log_level_t level);
+void sim_log(esp_log_level_t level, const char *tag, const char *format, ...)
+    __attribute__((format(printf, 3, 4)));
+
+#define ESP_LOGE(tag, format, ...) sim_log(ESP_LOG_ERROR, tag, format, ##__VA_ARGS__) /*!< Error */
+#define ESP_LOGW(tag, format, ...) sim_log(ESP_LOG_WARN, tag, format, ##__VA_ARGS__)  /*!< Warning */
+#define ESP_LOGI(tag, format, ...) sim_log(ESP_LOG_INFO, tag, format, ##__VA_ARGS__)  /*!< Info */
+#define ESP_LOGD(tag, format, ...) sim_log(ESP_LOG_DEBUG, tag, format, ##__VA_ARGS__) /*!< Debug */
+
+#endif
@@ -0,0 +1,47 @@
+/**
+ * @file esp_pm.h
+ * @brief Host stand-in for the power management API
+ * @author Jorge Minjares (https://github.com/JorgeMinjares)
+ * @brief Frequencies are recorded and ignored. Light sleep is modeled by
+ *        the virtual-time scheduler: the chip sleeps through every idle gap
+ *        long enough for tickless idle while no lock is held.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef SIM_ESP_PM_H
+#define SIM_ESP_PM_H
+
+#include <stdbool.h>
+#include "esp_err.h"
+
+/**
+ * @brief Power management configuration
+ */
+typedef struct
+{
+    int max_freq_mhz;        /*!< CPU frequency while a lock is held */
+    int min_freq_mhz;        /*!< CPU frequency with no lock held */
+    bool light_sleep_enable; /*!< Enter light sleep when idle */
+} esp_pm_config_esp32_t;
+
+/**
+ * @brief Lock types, every one of them keeps the chip out of light sleep
+ */
+typedef enum
+{
+    ESP_PM_CPU_FREQ_MAX,   /*!< CPU at max_freq_mhz */
+    ESP_PM_APB_FREQ_MAX,   /*!< APB at 80 MHz */
+    ESP_PM_NO_LIGHT_SLEEP, /*!< No light sleep */
+} esp_pm_lock_type_t;
+
+typedef struct sim_pm_lock *esp_pm_lock_handle_t; /*!< Lock handle */
+
+esp_err_t esp_pm_configure(const void *config);
+esp_err_t esp_pm_lock_create(esp_pm_lock_type_t lock_type, int arg, const char *name, esp_pm_lock_handle_t *out_handle);
+esp_err_t esp_pm_lock_acquire(esp_pm_lock_handle_t handle);
+esp_err_t esp_pm_lock_release(esp_pm_lock_handle_t handle);
+
+#endif
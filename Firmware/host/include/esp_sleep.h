@@ -0,0 +1,21 @@
+/**
+ * @file esp_sleep.h
+ * @brief Host stand-in for the sleep wakeup sources
+ * @author Jorge Minjares (https://github.com/JorgeMinjares)
+ * @brief Any GPIO interrupt, timer or UART byte ends a simulated light
+ *        sleep, so enabling a source only checks its argument.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef SIM_ESP_SLEEP_H
+#define SIM_ESP_SLEEP_H
+
+#include "esp_err.h"
+
+esp_err_t esp_sleep_enable_gpio_wakeup(void);
+esp_err_t esp_sleep_enable_uart_wakeup(int uart_num);
+
+#endif
@@ -0,0 +1,52 @@
+/**
+ * @file esp_timer.h
+ * @brief Host stand-in for the esp_timer API
+ * @author Jorge Minjares (https://github.com/JorgeMinjares)
+ * @brief Timers fire in virtual time. Callbacks run to completion in the
+ *        scheduler context, like the esp_timer task on target.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef SIM_ESP_TIMER_H
+#define SIM_ESP_TIMER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+typedef struct sim_timer *esp_timer_handle_t; /*!< Timer handle */
+typedef void (*esp_timer_cb_t)(void *arg);     /*!< Timer callback */
+
+/**
+ * @brief Callback dispatch method
+ */
+typedef enum
+{
+    ESP_TIMER_TASK, /*!< Dispatch from the esp_timer task */
+    ESP_TIMER_ISR,  /*!< Dispatch from the timer ISR */
+} esp_timer_dispatch_t;
+
+/**
+ * @brief Timer configuration
+ */
+typedef struct
+{
+    esp_timer_cb_t callback;              /*!< Callback */
+    void *arg;                            /*!< Callback argument */
+    esp_timer_dispatch_t dispatch_method; /*!< Dispatch method */
+    const char *name;                     /*!< Timer name */
+    bool skip_unhandled_events;           /*!< Skip missed periodic events */
+} esp_timer_create_args_t;
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out_handle);
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us);
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period);
+esp_err_t esp_timer_stop(esp_timer_handle_t timer);
+esp_err_t esp_timer_delete(esp_timer_handle_t timer);
+bool esp_timer_is_active(esp_timer_handle_t timer);
+int64_t esp_timer_get_time(void);
+
+#endif
@@ -0,0 +1,68 @@
+/**
+ * @file FreeRTOS.h
+ * @brief Host stand-in for the ESP-IDF FreeRTOS port
+ * @author Jorge Minjares (https://github.com/JorgeMinjares)
+ * @brief Only the types and macros used by the firmware are provided. Every
+ *        call is backed by the virtual-time scheduler in sim/sim_rtos.c.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef SIM_FREERTOS_H
+#define SIM_FREERTOS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+typedef int32_t BaseType_t;   /*!< Signed base type */
+typedef uint32_t UBaseType_t; /*!< Unsigned base type */
+typedef uint32_t TickType_t;  /*!< Tick count type */
+
+#define pdFALSE ((BaseType_t)0) /*!< False */
+#define pdTRUE ((BaseType_t)1)  /*!< True */
+#define pdFAIL (pdFALSE)        /*!< Failure */
+#define pdPASS (pdTRUE)         /*!< Success */
+#define errQUEUE_FULL ((BaseType_t)0) /*!< Queue full */
+
+#define portMAX_DELAY ((TickType_t)0xffffffffUL) /*!< Block forever */
+
+/* Same tick rate as the default ESP-IDF sdkconfig */
+#define configTICK_RATE_HZ 100                                   /*!< Ticks per second */
+#define configMAX_PRIORITIES 25                                  /*!< Priority levels */
+#define portTICK_PERIOD_MS ((TickType_t)1000 / configTICK_RATE_HZ) /*!< Milliseconds per tick */
+#define portNUM_PROCESSORS 2                                     /*!< ESP32 core count */
+#define pdMS_TO_TICKS(ms) ((TickType_t)(((uint64_t)(ms) * configTICK_RATE_HZ) / 1000U)) /*!< ms to ticks */
+
+#define portYIELD_FROM_ISR(x) ((void)(x)) /*!< Scheduler runs the woken task on ISR return */
+
+/* Run time stats count host microseconds, tasks execute in zero virtual time */
+#define configGENERATE_RUN_TIME_STATS 1                              /*!< ulTaskGetRunTimeCounter() available */
+#define portGET_RUN_TIME_COUNTER_VALUE() sim_run_time_counter()      /*!< Host time spent simulating */
+uint32_t sim_run_time_counter(void);
+
+/**
+ * @brief Spinlock for critical sections
+ * @note Coroutines never run concurrently, so the host locks are no-ops
+ */
+typedef struct
+{
+    uint32_t owner; /*!< Owning core */
+    uint32_t count; /*!< Nesting depth */
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED {0, 0}        /*!< Unlocked spinlock */
+#define portENTER_CRITICAL(mux) ((void)(mux))      /*!< Enter critical section */
+#define portEXIT_CRITICAL(mux) ((void)(mux))       /*!< Exit critical section */
+#define portENTER_CRITICAL_ISR(mux) ((void)(mux))  /*!< Enter critical section from ISR */
+#define portEXIT_CRITICAL_ISR(mux) ((void)(mux))   /*!< Exit critical section from ISR */
+#define portENTER_CRITICAL_SAFE(mux) ((void)(mux)) /*!< Enter critical section from a task or an ISR */
+#define portEXIT_CRITICAL_SAFE(mux) ((void)(mux))  /*!< Exit critical section from a task or an ISR */
+#define portDISABLE_INTERRUPTS() ((void)0)         /*!< Mask interrupts on this core, tasks never preempt one another */
+#define portENABLE_INTERRUPTS() ((void)0)          /*!< Unmask interrupts on this core */
+
+BaseType_t xPortGetCoreID(void);
+
+#endif
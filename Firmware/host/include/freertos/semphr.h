@@ -0,0 +1,24 @@
+/**
+ * @file semphr.h
+ * @brief Host stand-in for the FreeRTOS semaphore API
+ * @author Jorge Minjares (https://github.com/JorgeMinjares)
+ * @brief Like FreeRTOS, a semaphore is a queue of zero-sized items.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef SIM_FREERTOS_SEMPHR_H
+#define SIM_FREERTOS_SEMPHR_H
+
+#include "freertos/queue.h"
+
+typedef QueueHandle_t SemaphoreHandle_t; /*!< Semaphore handle */
+
+#define xSemaphoreCreateBinary() xQueueCreate(1, 0)                         /*!< Binary semaphore */
+#define xSemaphoreGive(s) xQueueSendToBack((s), NULL, 0)                     /*!< Give */
+#define xSemaphoreGiveFromISR(s, woken) xQueueSendFromISR((s), NULL, (woken)) /*!< Give from ISR */
+#define xSemaphoreTake(s, ticks) xQueueReceive((s), NULL, (ticks))           /*!< Take */
+
+#endif
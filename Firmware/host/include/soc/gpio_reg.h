@@ -0,0 +1,25 @@
+/**
+ * @file gpio_reg.h
+ * @brief Host stand-in for the ESP32 GPIO register map
+ * @author Jorge Minjares (https://github.com/JorgeMinjares)
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef SIM_SOC_GPIO_REG_H
+#define SIM_SOC_GPIO_REG_H
+
+#include "soc/soc.h"
+
+#define GPIO_OUT_REG 0x3FF44004       /*!< GPIO0-31 output levels */
+#define GPIO_OUT_W1TS_REG 0x3FF44008  /*!< GPIO0-31 write 1 to set */
+#define GPIO_OUT_W1TC_REG 0x3FF4400C  /*!< GPIO0-31 write 1 to clear */
+#define GPIO_OUT1_REG 0x3FF44010      /*!< GPIO32-39 output levels */
+#define GPIO_OUT1_W1TS_REG 0x3FF44014 /*!< GPIO32-39 write 1 to set */
+#define GPIO_OUT1_W1TC_REG 0x3FF44018 /*!< GPIO32-39 write 1 to clear */
+#define GPIO_IN_REG 0x3FF4403C        /*!< GPIO0-31 input levels */
+#define GPIO_IN1_REG 0x3FF44040       /*!< GPIO32-39 input levels */
+
+#endif
@@ -0,0 +1,24 @@
+/**
+ * @file soc.h
+ * @brief Host stand-in for ESP32 register access macros
+ * @author Jorge Minjares (https://github.com/JorgeMinjares)
+ * @brief Register writes are routed to the simulated GPIO matrix.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef SIM_SOC_H
+#define SIM_SOC_H
+
+#include <stdint.h>
+
+void sim_reg_write(uint32_t reg, uint32_t value);
+uint32_t sim_reg_read(uint32_t reg);
+
+#define REG_WRITE(reg, val) sim_reg_write((uint32_t)(reg), (uint32_t)(val)) /*!< Write register */
+#define REG_READ(reg) sim_reg_read((uint32_t)(reg))                         /*!< Read register */
+#define BIT(nr) (1UL << (nr))                                               /*!< Bit mask */
+
+#endif
@@ -0,0 +1,102 @@
+/**
+ * @file sim.h
+ * @brief Host simulation control interface
+ * @author Jorge Minjares (https://github.com/JorgeMinjares)
+ * @brief Drives the firmware in virtual time. Tasks run as coroutines on one
+ *        host thread; time only advances when every task is blocked, so a
+ *        24 h run costs as much as the work the tasks actually do.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#define SIM_SECOND 1000000LL          /*!< One virtual second in microseconds */
+#define SIM_MINUTE (60 * SIM_SECOND)  /*!< One virtual minute */
+#define SIM_HOUR (60 * SIM_MINUTE)    /*!< One virtual hour */
+
+typedef void (*sim_event_fn)(void *arg); /*!< Scheduled stimulus callback */
+
+/**
+ * @brief Output pin change observer
+ */
+typedef void (*sim_gpio_hook_t)(int pin, int level, int64_t now);
+
+/**
+ * @brief Observer called after every bus write to the GPIO output registers
+ */
+typedef void (*sim_bus_hook_t)(int64_t now);
+
+/**
+ * @brief DAC tone observer, hz and amplitude 0 when the channel is silent
+ */
+typedef void (*sim_dac_hook_t)(int channel, uint32_t hz, uint8_t amplitude, int64_t now);
+
+/**
+ * @brief UART transmit observer
+ */
+typedef void (*sim_uart_hook_t)(const uint8_t *data, size_t size, int64_t now);
+
+/**
+ * @brief Scheduler and hardware counters
+ */
+typedef struct
+{
+    uint64_t context_switches; /*!< Switches between different tasks */
+    uint64_t task_wakeups;     /*!< Times a blocked task became ready */
+    uint64_t timer_callbacks;  /*!< esp_timer callbacks dispatched */
+    uint64_t idle_wakeups;     /*!< Times the CPU left idle */
+    uint64_t light_sleeps;     /*!< Times the chip entered automatic light sleep */
+    int64_t light_sleep_us;    /*!< Time spent in light sleep */
+    uint64_t gpio_writes;      /*!< GPIO output level writes */
+    uint64_t uart_tx_bytes;    /*!< Bytes written to UART */
+    int64_t uart_tx_wait_us;   /*!< Time tasks spent blocked on a full UART TX ring */
+    uint64_t log_lines;        /*!< ESP_LOGx calls at INFO or above */
+    uint64_t adc_samples;      /*!< Continuous mode conversions read */
+    uint64_t adc_lost;         /*!< Conversions lost to a full driver buffer */
+    uint32_t tasks;            /*!< Tasks created */
+    uint32_t stack_bytes;      /*!< Stack requested by the created tasks */
+    uint32_t queues;           /*!< Queues created */
+    uint32_t queue_bytes;      /*!< Item storage of the created queues */
+    uint32_t timers;           /*!< esp_timers created */
+} sim_stats_t;
+
+/* Scheduler */
+int64_t sim_now(void);
+void sim_run_until(int64_t t_us);
+void sim_schedule(int64_t at_us, sim_event_fn fn, void *arg);
+void sim_log_enable(bool enable);
+void sim_timer_set_jitter(int64_t max_us);
+const sim_stats_t *sim_stats(void);
+
+/* Hardware */
+void sim_gpio_input(int pin, int level);
+int sim_gpio_output(int pin);
+void sim_gpio_set_hook(sim_gpio_hook_t hook);
+void sim_gpio_set_bus_hook(sim_bus_hook_t hook);
+void sim_adc_set(int channel, int raw);
+void sim_adc_set_noise(int channel, int sigma, int spike_ppm);
+uint8_t sim_dac_level(int channel);
+void sim_dac_set_hook(sim_dac_hook_t hook);
+void sim_uart_set_hook(sim_uart_hook_t hook);
+void sim_uart_rx(const uint8_t *data, size_t size);
+void sim_uart_set_baud(int baud);
+
+/* Internal: shared between sim_rtos.c and sim_hw.c */
+void sim_stats_gpio_write(void);
+void sim_stats_uart_tx(size_t size);
+void sim_stats_uart_wait(int64_t us);
+void sim_stats_adc(uint64_t samples, uint64_t lost);
+bool sim_task_wait_until(int64_t at_us);
+void sim_pm_hold(bool hold);
+void sim_pm_wake(void);
+int64_t sim_uart_tx_idle_at(void);
+
+#endif
@@ -0,0 +1,866 @@
+/**
+ * @file sim_hw.c
+ * @brief Simulated GPIO, DAC, ADC and UART backend
+ * @author Jorge Minjares (https://github.com/JorgeMinjares)
+ * @brief Implements the ESP-IDF driver calls used by the BSP on top of plain
+ *        arrays so the simulation can inject inputs and observe outputs.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include "sim.h"
+
+#include "driver/gpio.h"
+#include "driver/dac.h"
+#include "driver/adc.h"
+#include "driver/uart.h"
+#include "esp_adc_cal.h"
+#include "soc/gpio_reg.h"
+
+#define SIM_UART_RX_SIZE 2048 /*!< RX ring size when the driver does not set one */
+#define SIM_UART_FIFO 128     /*!< Hardware TX FIFO bytes, behind the driver's TX ring */
+
+static uint8_t gpio_level[GPIO_NUM_MAX];               /*!< Pad levels */
+static gpio_mode_t gpio_mode[GPIO_NUM_MAX];            /*!< Pad directions */
+static sim_gpio_hook_t gpio_hook = NULL;               /*!< Output observer */
+static sim_bus_hook_t bus_hook = NULL;                 /*!< Bus write observer */
+static gpio_int_type_t gpio_intr_type[GPIO_NUM_MAX];   /*!< Interrupt triggers */
+static bool gpio_intr_on[GPIO_NUM_MAX];                /*!< Interrupt enables */
+static gpio_isr_t gpio_isr[GPIO_NUM_MAX];              /*!< Per-pin handlers */
+static void *gpio_isr_arg[GPIO_NUM_MAX];               /*!< Handler arguments */
+static bool gpio_isr_service = false;                  /*!< ISR service installed */
+static uint8_t dac_level[DAC_CHANNEL_MAX];             /*!< DAC outputs */
+static sim_dac_hook_t dac_hook = NULL;                 /*!< Tone observer */
+static uint16_t adc_raw[ADC1_CHANNEL_MAX];             /*!< ADC inputs */
+static uint16_t adc_sigma[ADC1_CHANNEL_MAX];           /*!< Noise standard deviation in LSB */
+static uint32_t adc_spike_ppm[ADC1_CHANNEL_MAX];       /*!< Impulse noise rate */
+static uint64_t adc_rng = 0x9e3779b97f4a7c15ULL;       /*!< Noise generator */
+
+/**
+ * @brief DAC cosine generator
+ * @note A channel sounds while its pad is powered, it is switched to the
+ *       generator and the generator runs
+ */
+static struct
+{
+    bool enabled;                       /*!< dac_cw_generator_enable() called */
+    uint32_t freq;                      /*!< Frequency of both channels (Hz) */
+    bool routed[DAC_CHANNEL_MAX];       /*!< Channel switched to the generator */
+    uint8_t scale[DAC_CHANNEL_MAX];     /*!< Amplitude, full scale >> scale */
+    bool powered[DAC_CHANNEL_MAX];      /*!< Pad powered */
+    uint32_t heard_hz[DAC_CHANNEL_MAX]; /*!< Tone last reported to the hook */
+    uint8_t heard_amp[DAC_CHANNEL_MAX]; /*!< Amplitude last reported to the hook */
+} dac_cw;
+
+/**
+ * @brief Continuous mode ADC
+ * @note Conversions are produced lazily when the firmware reads, at the
+ *       configured rate, from the channel value at read time
+ */
+static struct
+{
+    bool initialized;       /*!< adc_digi_initialize() called */
+    bool running;           /*!< Converting */
+    uint32_t buffer_bytes;  /*!< Driver ring buffer size */
+    uint32_t sample_hz;     /*!< Conversion rate */
+    uint8_t channel;        /*!< ADC1 channel converted */
+    int64_t start_us;       /*!< adc_digi_start() time */
+    uint64_t produced;      /*!< Conversions produced since start */
+} adc_digi;
+static sim_uart_hook_t uart_hook = NULL;               /*!< TX observer */
+static QueueHandle_t uart_rx[UART_NUM_MAX];            /*!< RX rings */
+
+/**
+ * @brief UART transmitter
+ * @note Bytes leave at the baud rate, 10 bits each. uart_write_bytes()
+ *       blocks the calling task while the TX ring and FIFO are full, as the
+ *       ESP-IDF driver does.
+ */
+static struct
+{
+    int baud;            /*!< Configured baud rate, 0 until uart_param_config() */
+    size_t buffer;       /*!< TX ring plus FIFO bytes */
+    int64_t idle_at;     /*!< Time the last queued byte is on the wire */
+} uart_tx[UART_NUM_MAX];
+static int uart_baud = 0;                              /*!< Baud rate override, 0 for the configured one */
+
+static bool gpio_valid(gpio_num_t gpio_num)
+{
+    return gpio_num >= 0 && gpio_num < GPIO_NUM_MAX;
+}
+
+/* ------------------------------------------------------------------ */
+/* Simulation side                                                    */
+/* ------------------------------------------------------------------ */
+
+static bool gpio_intr_fires(int pin, uint8_t level)
+{
+    switch (gpio_intr_type[pin])
+    {
+    case GPIO_INTR_POSEDGE:
+    case GPIO_INTR_HIGH_LEVEL:
+        return level == 1;
+    case GPIO_INTR_NEGEDGE:
+    case GPIO_INTR_LOW_LEVEL:
+        return level == 0;
+    case GPIO_INTR_ANYEDGE:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/**
+ * @brief Drive an input pad
+ *
+ * @param pin GPIO number
+ * @param level new level
+ * @note Runs the pin's ISR handler when the edge matches its trigger
+ */
+void sim_gpio_input(int pin, int level)
+{
+    if (!gpio_valid(pin))
+    {
+        return;
+    }
+    uint8_t value = level ? 1 : 0;
+    if (gpio_level[pin] == value)
+    {
+        return;
+    }
+    gpio_level[pin] = value;
+    if (gpio_isr_service && gpio_intr_on[pin] && gpio_isr[pin] != NULL && gpio_intr_fires(pin, value))
+    {
+        sim_pm_wake();
+        gpio_isr[pin](gpio_isr_arg[pin]);
+    }
+}
+
+/**
+ * @brief Read an output pad
+ *
+ * @param pin GPIO number
+ * @return int level
+ */
+int sim_gpio_output(int pin)
+{
+    return gpio_valid(pin) ? gpio_level[pin] : 0;
+}
+
+/**
+ * @brief Observe output level changes
+ *
+ * @param hook observer, NULL to remove
+ */
+void sim_gpio_set_hook(sim_gpio_hook_t hook)
+{
+    gpio_hook = hook;
+}
+
+/**
+ * @brief Observe every bus write to the outputs
+ *
+ * @param hook observer, NULL to remove
+ */
+void sim_gpio_set_bus_hook(sim_bus_hook_t hook)
+{
+    bus_hook = hook;
+}
+
+/**
+ * @brief Set the raw value an ADC channel will return
+ *
+ * @param channel ADC1 channel
+ * @param raw 12-bit value
+ */
+void sim_adc_set(int channel, int raw)
+{
+    if (channel >= 0 && channel < ADC1_CHANNEL_MAX)
+    {
+        adc_raw[channel] = (uint16_t)(raw < 0 ? 0 : raw > 4095 ? 4095 : raw);
+    }
+}
+
+/**
+ * @brief Add noise to every conversion of an ADC channel
+ *
+ * @param channel ADC1 channel
+ * @param sigma Gaussian noise standard deviation in LSB
+ * @param spike_ppm conversions per million replaced by a full-scale spike
+ */
+void sim_adc_set_noise(int channel, int sigma, int spike_ppm)
+{
+    if (channel >= 0 && channel < ADC1_CHANNEL_MAX)
+    {
+        adc_sigma[channel] = (uint16_t)(sigma < 0 ? 0 : sigma);
+        adc_spike_ppm[channel] = (uint32_t)(spike_ppm < 0 ? 0 : spike_ppm);
+    }
+}
+
+/**
+ * @brief Current DAC output
+ *
+ * @param channel DAC channel
+ * @return uint8_t level
+ */
+uint8_t sim_dac_level(int channel)
+{
+    return channel >= 0 && channel < DAC_CHANNEL_MAX ? dac_level[channel] : 0;
+}
+
+/**
+ * @brief Observe the tone of every DAC channel
+ *
+ * @param hook observer, called when a channel starts, stops or changes tone;
+ *             NULL to remove
+ */
+void sim_dac_set_hook(sim_dac_hook_t hook)
+{
+    dac_hook = hook;
+}
+
+/**
+ * @brief Observe UART transmit data
+ *
+ * @param hook observer, NULL to remove
+ */
+void sim_uart_set_hook(sim_uart_hook_t hook)
+{
+    uart_hook = hook;
+}
+
+/**
+ * @brief Run UART0 at another baud rate than the firmware configures
+ *
+ * @param baud bits per second, 0 for the configured rate
+ * @note A low rate lets the firmware's output back up in the TX ring
+ */
+void sim_uart_set_baud(int baud)
+{
+    uart_baud = baud > 0 ? baud : 0;
+}
+
+/**
+ * @brief Inject bytes into the UART0 receive ring
+ *
+ * @param data bytes
+ * @param size byte count
+ */
+void sim_uart_rx(const uint8_t *data, size_t size)
+{
+    if (uart_rx[UART_NUM_0] == NULL)
+    {
+        return;
+    }
+    /* The first byte wakes a sleeping chip, the simulator loses none of them */
+    sim_pm_wake();
+    for (size_t i = 0; i < size; i++)
+    {
+        xQueueSendFromISR(uart_rx[UART_NUM_0], &data[i], NULL);
+    }
+}
+
+/**
+ * @brief Time UART0 sends its last queued byte
+ *
+ * @return virtual time, in the past when the line is idle
+ * @note Light sleep waits for the TX FIFO to drain
+ */
+int64_t sim_uart_tx_idle_at(void)
+{
+    return uart_tx[UART_NUM_0].idle_at;
+}
+
+/* ------------------------------------------------------------------ */
+/* GPIO driver                                                        */
+/* ------------------------------------------------------------------ */
+
+void gpio_pad_select_gpio(gpio_num_t gpio_num)
+{
+    (void)gpio_num;
+}
+
+esp_err_t gpio_set_direction(gpio_num_t gpio_num, gpio_mode_t mode)
+{
+    if (!gpio_valid(gpio_num))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    gpio_mode[gpio_num] = mode;
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_pull_mode(gpio_num_t gpio_num, gpio_pull_mode_t pull)
+{
+    if (!gpio_valid(gpio_num))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    (void)pull;
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level)
+{
+    if (!gpio_valid(gpio_num))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    sim_stats_gpio_write();
+    uint8_t value = level ? 1 : 0;
+    if (gpio_level[gpio_num] != value)
+    {
+        gpio_level[gpio_num] = value;
+        if (gpio_hook != NULL)
+        {
+            gpio_hook(gpio_num, value, sim_now());
+        }
+    }
+    if (bus_hook != NULL)
+    {
+        bus_hook(sim_now());
+    }
+    return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t gpio_num)
+{
+    return gpio_valid(gpio_num) ? gpio_level[gpio_num] : 0;
+}
+
+esp_err_t gpio_set_intr_type(gpio_num_t gpio_num, gpio_int_type_t intr_type)
+{
+    if (!gpio_valid(gpio_num))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    gpio_intr_type[gpio_num] = intr_type;
+    return ESP_OK;
+}
+
+esp_err_t gpio_wakeup_enable(gpio_num_t gpio_num, gpio_int_type_t intr_type)
+{
+    /* Like the driver, the wakeup level is also the interrupt trigger */
+    if (intr_type != GPIO_INTR_LOW_LEVEL && intr_type != GPIO_INTR_HIGH_LEVEL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return gpio_set_intr_type(gpio_num, intr_type);
+}
+
+esp_err_t gpio_intr_enable(gpio_num_t gpio_num)
+{
+    if (!gpio_valid(gpio_num))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    gpio_intr_on[gpio_num] = true;
+    return ESP_OK;
+}
+
+esp_err_t gpio_intr_disable(gpio_num_t gpio_num)
+{
+    if (!gpio_valid(gpio_num))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    gpio_intr_on[gpio_num] = false;
+    return ESP_OK;
+}
+
+esp_err_t gpio_install_isr_service(int intr_alloc_flags)
+{
+    (void)intr_alloc_flags;
+    if (gpio_isr_service)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    gpio_isr_service = true;
+    return ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_add(gpio_num_t gpio_num, gpio_isr_t isr_handler, void *args)
+{
+    if (!gpio_valid(gpio_num))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!gpio_isr_service)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    gpio_isr[gpio_num] = isr_handler;
+    gpio_isr_arg[gpio_num] = args;
+    return ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_remove(gpio_num_t gpio_num)
+{
+    if (!gpio_valid(gpio_num))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    gpio_isr[gpio_num] = NULL;
+    return ESP_OK;
+}
+
+/* ------------------------------------------------------------------ */
+/* GPIO registers                                                     */
+/* ------------------------------------------------------------------ */
+
+static void reg_apply(int base, uint32_t mask, uint8_t value)
+{
+    for (int bit = 0; bit < 32 && base + bit < GPIO_NUM_MAX; bit++)
+    {
+        int pin = base + bit;
+        if ((mask & (1UL << bit)) && gpio_level[pin] != value)
+        {
+            gpio_level[pin] = value;
+            if (gpio_hook != NULL)
+            {
+                gpio_hook(pin, value, sim_now());
+            }
+        }
+    }
+}
+
+static uint32_t reg_levels(int base)
+{
+    uint32_t levels = 0;
+    for (int bit = 0; bit < 32 && base + bit < GPIO_NUM_MAX; bit++)
+    {
+        levels |= (uint32_t)gpio_level[base + bit] << bit;
+    }
+    return levels;
+}
+
+/**
+ * @brief Single bus write to a GPIO output register
+ *
+ * @param reg register address
+ * @param value register value
+ */
+void sim_reg_write(uint32_t reg, uint32_t value)
+{
+    switch (reg)
+    {
+    case GPIO_OUT_W1TS_REG:
+        reg_apply(0, value, 1);
+        break;
+    case GPIO_OUT_W1TC_REG:
+        reg_apply(0, value, 0);
+        break;
+    case GPIO_OUT1_W1TS_REG:
+        reg_apply(32, value, 1);
+        break;
+    case GPIO_OUT1_W1TC_REG:
+        reg_apply(32, value, 0);
+        break;
+    case GPIO_OUT_REG:
+        reg_apply(0, value, 1);
+        reg_apply(0, ~value, 0);
+        break;
+    case GPIO_OUT1_REG:
+        reg_apply(32, value, 1);
+        reg_apply(32, ~value, 0);
+        break;
+    default:
+        return;
+    }
+    sim_stats_gpio_write();
+    if (bus_hook != NULL)
+    {
+        bus_hook(sim_now());
+    }
+}
+
+/**
+ * @brief Read a GPIO register
+ *
+ * @param reg register address
+ * @return uint32_t register value
+ */
+uint32_t sim_reg_read(uint32_t reg)
+{
+    switch (reg)
+    {
+    case GPIO_OUT_REG:
+    case GPIO_IN_REG:
+        return reg_levels(0);
+    case GPIO_OUT1_REG:
+    case GPIO_IN1_REG:
+        return reg_levels(32);
+    default:
+        return 0;
+    }
+}
+
+/* ------------------------------------------------------------------ */
+/* DAC driver                                                         */
+/* ------------------------------------------------------------------ */
+
+/* Tell the hook when what a channel plays changes */
+static void dac_update(void)
+{
+    for (int c = 0; c < DAC_CHANNEL_MAX; c++)
+    {
+        bool sounds = dac_cw.enabled && dac_cw.routed[c] && dac_cw.powered[c];
+        uint32_t hz = sounds ? dac_cw.freq : 0;
+        uint8_t amp = sounds ? (uint8_t)(127 >> dac_cw.scale[c]) : 0;
+        if (hz != dac_cw.heard_hz[c] || amp != dac_cw.heard_amp[c])
+        {
+            dac_cw.heard_hz[c] = hz;
+            dac_cw.heard_amp[c] = amp;
+            if (dac_hook != NULL)
+            {
+                dac_hook(c, hz, amp, sim_now());
+            }
+        }
+    }
+}
+
+esp_err_t dac_output_enable(dac_channel_t channel)
+{
+    if (channel >= DAC_CHANNEL_MAX)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    dac_cw.powered[channel] = true;
+    dac_update();
+    return ESP_OK;
+}
+
+esp_err_t dac_output_disable(dac_channel_t channel)
+{
+    if (channel >= DAC_CHANNEL_MAX)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    dac_cw.powered[channel] = false;
+    dac_update();
+    return dac_output_voltage(channel, 0);
+}
+
+esp_err_t dac_cw_generator_enable(void)
+{
+    dac_cw.enabled = true;
+    dac_update();
+    return ESP_OK;
+}
+
+esp_err_t dac_cw_generator_disable(void)
+{
+    dac_cw.enabled = false;
+    dac_update();
+    return ESP_OK;
+}
+
+esp_err_t dac_cw_generator_config(dac_cw_config_t *cw)
+{
+    if (cw == NULL || cw->en_ch >= DAC_CHANNEL_MAX)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    dac_cw.freq = cw->freq;
+    dac_cw.routed[cw->en_ch] = true;
+    dac_cw.scale[cw->en_ch] = (uint8_t)cw->scale;
+    dac_update();
+    return ESP_OK;
+}
+
+esp_err_t dac_output_voltage(dac_channel_t channel, uint8_t dac_value)
+{
+    if (channel >= DAC_CHANNEL_MAX)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    dac_level[channel] = dac_value;
+    return ESP_OK;
+}
+
+/* ------------------------------------------------------------------ */
+/* ADC driver                                                         */
+/* ------------------------------------------------------------------ */
+
+esp_err_t adc1_config_width(adc_bits_width_t width_bit)
+{
+    (void)width_bit;
+    return ESP_OK;
+}
+
+esp_err_t adc1_config_channel_atten(adc1_channel_t channel, adc_atten_t atten)
+{
+    (void)atten;
+    return channel < ADC1_CHANNEL_MAX ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+static uint32_t adc_rng_next(void)
+{
+    adc_rng ^= adc_rng << 13;
+    adc_rng ^= adc_rng >> 7;
+    adc_rng ^= adc_rng << 17;
+    return (uint32_t)(adc_rng >> 32);
+}
+
+/* One conversion with noise: the sum of four uniforms approximates a Gaussian */
+static uint16_t adc_convert(int channel)
+{
+    int value = adc_raw[channel];
+    if (adc_spike_ppm[channel] && adc_rng_next() % 1000000 < adc_spike_ppm[channel])
+    {
+        return adc_rng_next() & 1 ? 4095 : 0;
+    }
+    if (adc_sigma[channel])
+    {
+        int32_t sum = 0;
+        for (int i = 0; i < 4; i++)
+        {
+            sum += (int32_t)(adc_rng_next() & 0xffff) - 0x8000;
+        }
+        /* Each uniform has sigma 0x8000/sqrt(3), four of them 0x8000*2/sqrt(3) */
+        value += (int)(((int64_t)sum * adc_sigma[channel] * 866) / (0x8000 * 1000));
+    }
+    return (uint16_t)(value < 0 ? 0 : value > 4095 ? 4095 : value);
+}
+
+int adc1_get_raw(adc1_channel_t channel)
+{
+    return channel < ADC1_CHANNEL_MAX ? adc_convert(channel) : -1;
+}
+
+esp_err_t adc_digi_initialize(const adc_digi_init_config_t *init_config)
+{
+    if (init_config == NULL || init_config->max_store_buf_size < sizeof(adc_digi_output_data_t))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    adc_digi.buffer_bytes = init_config->max_store_buf_size;
+    adc_digi.initialized = true;
+    return ESP_OK;
+}
+
+esp_err_t adc_digi_controller_configure(const adc_digi_configuration_t *config)
+{
+    if (!adc_digi.initialized || config == NULL || config->pattern_num != 1 || config->adc_pattern == NULL ||
+        config->adc_pattern[0].channel >= ADC1_CHANNEL_MAX || config->sample_freq_hz == 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    adc_digi.channel = config->adc_pattern[0].channel;
+    adc_digi.sample_hz = config->sample_freq_hz;
+    return ESP_OK;
+}
+
+esp_err_t adc_digi_start(void)
+{
+    if (!adc_digi.initialized || adc_digi.sample_hz == 0)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!adc_digi.running)
+    {
+        /* The driver keeps APB at its maximum while converting */
+        sim_pm_hold(true);
+    }
+    adc_digi.running = true;
+    adc_digi.start_us = sim_now();
+    adc_digi.produced = 0;
+    return ESP_OK;
+}
+
+esp_err_t adc_digi_stop(void)
+{
+    if (adc_digi.running)
+    {
+        sim_pm_hold(false);
+    }
+    adc_digi.running = false;
+    return ESP_OK;
+}
+
+esp_err_t adc_digi_read_bytes(uint8_t *buf, uint32_t length_max, uint32_t *out_length, uint32_t timeout_ms)
+{
+    (void)timeout_ms;
+    *out_length = 0;
+    if (!adc_digi.running)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    uint64_t due = (uint64_t)(sim_now() - adc_digi.start_us) * adc_digi.sample_hz / SIM_SECOND;
+    uint64_t available = due - adc_digi.produced;
+    uint64_t capacity = adc_digi.buffer_bytes / sizeof(adc_digi_output_data_t);
+    esp_err_t err = ESP_OK;
+    if (available > capacity)
+    {
+        /* The driver ring buffer filled up, the oldest conversions are gone */
+        sim_stats_adc(0, available - capacity);
+        adc_digi.produced += available - capacity;
+        available = capacity;
+        err = ESP_ERR_INVALID_STATE;
+    }
+    uint32_t count = length_max / sizeof(adc_digi_output_data_t);
+    count = available < count ? (uint32_t)available : count;
+    if (count == 0)
+    {
+        return ESP_ERR_TIMEOUT;
+    }
+    adc_digi_output_data_t *out = (adc_digi_output_data_t *)buf;
+    if (adc_sigma[adc_digi.channel] == 0 && adc_spike_ppm[adc_digi.channel] == 0)
+    {
+        /* A quiet input converts the same every time, long runs spend most of their time here */
+        adc_digi_output_data_t word = {0};
+        word.type1.data = adc_convert(adc_digi.channel);
+        word.type1.channel = adc_digi.channel;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            out[i] = word;
+        }
+    }
+    else
+    {
+        for (uint32_t i = 0; i < count; i++)
+        {
+            out[i].type1.data = adc_convert(adc_digi.channel);
+            out[i].type1.channel = adc_digi.channel;
+        }
+    }
+    adc_digi.produced += count;
+    sim_stats_adc(count, 0);
+    *out_length = count * sizeof(adc_digi_output_data_t);
+    return err;
+}
+
+esp_err_t adc_digi_deinitialize(void)
+{
+    adc_digi.running = false;
+    adc_digi.initialized = false;
+    return ESP_OK;
+}
+
+esp_adc_cal_value_t esp_adc_cal_characterize(adc_unit_t adc_num, adc_atten_t atten, adc_bits_width_t bit_width,
+                                             uint32_t default_vref, esp_adc_cal_characteristics_t *chars)
+{
+    chars->adc_num = adc_num;
+    chars->atten = atten;
+    chars->bit_width = bit_width;
+    chars->vref = default_vref;
+    chars->coeff_a = (uint32_t)((3009ULL * 65536) / 4095);
+    chars->coeff_b = 142;
+    return ESP_ADC_CAL_VAL_DEFAULT_VREF;
+}
+
+uint32_t esp_adc_cal_raw_to_voltage(uint32_t adc_reading, const esp_adc_cal_characteristics_t *chars)
+{
+    return (uint32_t)(((uint64_t)adc_reading * chars->coeff_a + 32768) >> 16) + chars->coeff_b;
+}
+
+/* ------------------------------------------------------------------ */
+/* UART driver                                                        */
+/* ------------------------------------------------------------------ */
+
+esp_err_t uart_param_config(uart_port_t uart_num, const uart_config_t *uart_config)
+{
+    if (uart_num >= UART_NUM_MAX || uart_config == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    uart_tx[uart_num].baud = uart_config->baud_rate;
+    return ESP_OK;
+}
+
+esp_err_t uart_set_pin(uart_port_t uart_num, int tx_io_num, int rx_io_num, int rts_io_num, int cts_io_num)
+{
+    (void)tx_io_num;
+    (void)rx_io_num;
+    (void)rts_io_num;
+    (void)cts_io_num;
+    return uart_num < UART_NUM_MAX ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t uart_set_wakeup_threshold(uart_port_t uart_num, int wakeup_threshold)
+{
+    return uart_num < UART_NUM_MAX && wakeup_threshold > 2 ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t uart_driver_install(uart_port_t uart_num, int rx_buffer_size, int tx_buffer_size,
+                              int queue_size, QueueHandle_t *uart_queue, int intr_alloc_flags)
+{
+    (void)queue_size;
+    (void)intr_alloc_flags;
+    if (uart_num >= UART_NUM_MAX)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (uart_rx[uart_num] == NULL)
+    {
+        uart_rx[uart_num] = xQueueCreate(rx_buffer_size > 0 ? rx_buffer_size : SIM_UART_RX_SIZE, 1);
+    }
+    uart_tx[uart_num].buffer = (tx_buffer_size > 0 ? (size_t)tx_buffer_size : 0) + SIM_UART_FIFO;
+    if (uart_queue != NULL)
+    {
+        *uart_queue = NULL;
+    }
+    return ESP_OK;
+}
+
+int uart_write_bytes(uart_port_t uart_num, const void *src, size_t size)
+{
+    if (uart_num >= UART_NUM_MAX)
+    {
+        return -1;
+    }
+    sim_stats_uart_tx(size);
+    if (uart_hook != NULL)
+    {
+        uart_hook((const uint8_t *)src, size, sim_now());
+    }
+    int baud = uart_baud ? uart_baud : uart_tx[uart_num].baud;
+    size_t buffer = uart_tx[uart_num].buffer ? uart_tx[uart_num].buffer : SIM_UART_FIFO;
+    if (baud <= 0)
+    {
+        return (int)size;
+    }
+    int64_t byte_us = (10 * 1000000LL + baud - 1) / baud;
+    size_t left = size;
+    int64_t start = sim_now();
+    while (left > 0)
+    {
+        int64_t now = sim_now();
+        int64_t *idle_at = &uart_tx[uart_num].idle_at;
+        *idle_at = *idle_at > now ? *idle_at : now;
+        size_t queued = (size_t)((*idle_at - now + byte_us - 1) / byte_us);
+        size_t room = queued < buffer ? buffer - queued : 0;
+        size_t want = left < buffer ? left : buffer;
+        if (room < want && sim_task_wait_until(*idle_at - (int64_t)(buffer - want) * byte_us))
+        {
+            continue;
+        }
+        /* Outside a task nothing can wait, the ring overfills instead */
+        *idle_at += (int64_t)want * byte_us;
+        left -= want;
+    }
+    sim_stats_uart_wait(sim_now() - start);
+    return (int)size;
+}
+
+int uart_read_bytes(uart_port_t uart_num, void *buf, uint32_t length, TickType_t ticks_to_wait)
+{
+    if (uart_num >= UART_NUM_MAX || uart_rx[uart_num] == NULL)
+    {
+        return -1;
+    }
+    uint8_t *out = buf;
+    uint32_t read = 0;
+    while (read < length)
+    {
+        /* Only the first byte waits, like a partially filled ring */
+        if (xQueueReceive(uart_rx[uart_num], &out[read], read == 0 ? ticks_to_wait : 0) != pdPASS)
+        {
+            break;
+        }
+        read++;
+    }
+    return (int)read;
+}
@@ -0,0 +1,1151 @@
+/**
+ * @file sim_rtos.c
+ * @brief Virtual-time FreeRTOS and esp_timer stand-in
+ * @author Jorge Minjares (https://github.com/JorgeMinjares)
+ * @brief Each FreeRTOS task is a ucontext coroutine. The scheduler always
+ *        resumes the highest priority ready task; when none is ready it
+ *        jumps virtual time to the next pending deadline (task timeout,
+ *        esp_timer expiry or stimulus event). Tasks therefore execute in
+ *        zero virtual time and block exactly as they would on target.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include "sim.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <ucontext.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_timer.h"
+#include "esp_pm.h"
+#include "esp_sleep.h"
+#include "driver/uart.h"
+#include "esp_log.h"
+
+#define SIM_MAX_TASKS 32                               /*!< Task table size */
+#define SIM_TASK_STACK (64 * 1024)                     /*!< Host stack per task */
+#define SIM_TICK_US (1000000LL / configTICK_RATE_HZ)   /*!< Microseconds per tick */
+#define SIM_STACK_PAINT 0xa5                           /*!< Fill of stack bytes never used */
+#define SIM_SLEEP_IDLE_US (3 * SIM_TICK_US)            /*!< Idle time before light sleep, CONFIG_FREERTOS_IDLE_TIME_BEFORE_SLEEP */
+
+/**
+ * @brief What a blocked task is waiting on
+ */
+typedef enum
+{
+    WAIT_NONE,   /*!< Not waiting on a queue */
+    WAIT_RECV,   /*!< Waiting for an item */
+    WAIT_SEND,   /*!< Waiting for space */
+} sim_wait_t;
+
+/**
+ * @brief Simulated task control block
+ */
+struct sim_task
+{
+    ucontext_t ctx;                /*!< Saved context */
+    uint8_t *stack;                /*!< Host stack, painted with SIM_STACK_PAINT */
+    uint32_t stack_depth;          /*!< Stack asked for, bytes */
+    uint64_t run_ns;               /*!< Host time spent running */
+    TaskFunction_t fn;             /*!< Entry point */
+    void *arg;                     /*!< Entry argument */
+    char name[16];                 /*!< Task name */
+    UBaseType_t priority;          /*!< Priority */
+    BaseType_t core;               /*!< Core affinity */
+    bool ready;                    /*!< Ready or running */
+    bool timed_out;                /*!< Last block ended by timeout */
+    bool waiting_notify;           /*!< Blocked on a notification */
+    bool notify_pending;           /*!< Notified since the last take or wait */
+    uint64_t ready_seq;            /*!< FIFO order among equal priorities */
+    uint32_t wait_gen;             /*!< Invalidates stale timeouts */
+    uint32_t notify;               /*!< Notification value */
+    struct sim_queue *wait_queue;  /*!< Queue blocked on */
+    sim_wait_t wait_kind;          /*!< Direction blocked on */
+};
+
+/**
+ * @brief Simulated queue
+ */
+struct sim_queue
+{
+    uint8_t *storage;      /*!< Item storage */
+    UBaseType_t length;    /*!< Capacity */
+    UBaseType_t item_size; /*!< Item size in bytes */
+    UBaseType_t count;     /*!< Items stored */
+    UBaseType_t head;      /*!< Next item to read */
+};
+
+/**
+ * @brief Simulated esp_timer
+ */
+struct sim_timer
+{
+    esp_timer_cb_t callback; /*!< Callback */
+    void *arg;               /*!< Callback argument */
+    const char *name;        /*!< Name */
+    uint64_t period;         /*!< Period, 0 for one-shot */
+    int64_t expiry;          /*!< Next expiry */
+    bool active;             /*!< Armed */
+    uint32_t gen;            /*!< Invalidates stale expiries */
+};
+
+/**
+ * @brief Pending event kinds
+ */
+typedef enum
+{
+    EV_TASK_TIMEOUT, /*!< Blocked task timeout */
+    EV_TIMER,        /*!< esp_timer expiry */
+    EV_CALLBACK,     /*!< Stimulus callback */
+} sim_ev_kind_t;
+
+/**
+ * @brief Power management lock
+ */
+struct sim_pm_lock
+{
+    uint32_t count; /*!< Acquisitions not released */
+};
+
+/**
+ * @brief Pending event
+ */
+typedef struct
+{
+    int64_t at;         /*!< Virtual time */
+    uint64_t seq;       /*!< Insertion order, breaks ties */
+    sim_ev_kind_t kind; /*!< Kind */
+    void *ptr;          /*!< Task, timer or callback */
+    void *arg;          /*!< Callback argument */
+    uint32_t gen;       /*!< Generation at insertion */
+} sim_ev_t;
+
+static struct sim_task *tasks[SIM_MAX_TASKS]; /*!< Task table */
+static int task_count = 0;                    /*!< Tasks created */
+static struct sim_task *current = NULL;       /*!< Running task, NULL in scheduler */
+static struct sim_task *last_run = NULL;      /*!< Last task resumed */
+static ucontext_t sched_ctx;                  /*!< Scheduler context */
+static int64_t now_us = 0;                    /*!< Virtual time */
+static uint64_t seq = 0;                      /*!< Global ordering counter */
+static bool log_enabled = false;              /*!< Print ESP_LOGx output */
+static sim_stats_t stats;                     /*!< Counters */
+static uint64_t run_ns = 0;                   /*!< Host time spent in finished sim_run_until() calls */
+static uint64_t run_start = 0;                /*!< Host time the running sim_run_until() began, 0 outside */
+static int64_t timer_jitter = 0;              /*!< Longest esp_timer dispatch delay */
+static struct
+{
+    bool light_sleep;   /*!< esp_pm_configure() enabled light sleep */
+    uint32_t locks;     /*!< Lock acquisitions not released, firmware and drivers */
+    bool asleep;        /*!< In light sleep */
+    int64_t since;      /*!< Time the current light sleep began */
+} pm;                                         /*!< Power management */
+static uint64_t jitter_rng = 0x2545f4914f6cdd1dULL; /*!< Dispatch delay generator */
+
+static sim_ev_t *heap = NULL; /*!< Min-heap of pending events */
+static size_t heap_len = 0;   /*!< Events stored */
+static size_t heap_cap = 0;   /*!< Heap capacity */
+
+/* Host monotonic time for the run time counters */
+static uint64_t sim_host_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/* ------------------------------------------------------------------ */
+/* Event heap                                                         */
+/* ------------------------------------------------------------------ */
+
+static bool ev_before(const sim_ev_t *a, const sim_ev_t *b)
+{
+    return a->at < b->at || (a->at == b->at && a->seq < b->seq);
+}
+
+static void heap_push(int64_t at, sim_ev_kind_t kind, void *ptr, void *arg, uint32_t gen)
+{
+    if (heap_len == heap_cap)
+    {
+        heap_cap = heap_cap ? heap_cap * 2 : 64;
+        heap = realloc(heap, heap_cap * sizeof(*heap));
+        if (heap == NULL)
+        {
+            abort();
+        }
+    }
+    size_t i = heap_len++;
+    sim_ev_t ev = {.at = at, .seq = ++seq, .kind = kind, .ptr = ptr, .arg = arg, .gen = gen};
+    while (i > 0)
+    {
+        size_t parent = (i - 1) / 2;
+        if (!ev_before(&ev, &heap[parent]))
+        {
+            break;
+        }
+        heap[i] = heap[parent];
+        i = parent;
+    }
+    heap[i] = ev;
+}
+
+static sim_ev_t heap_pop(void)
+{
+    sim_ev_t top = heap[0];
+    sim_ev_t last = heap[--heap_len];
+    size_t i = 0;
+    for (;;)
+    {
+        size_t child = 2 * i + 1;
+        if (child >= heap_len)
+        {
+            break;
+        }
+        if (child + 1 < heap_len && ev_before(&heap[child + 1], &heap[child]))
+        {
+            child++;
+        }
+        if (!ev_before(&heap[child], &last))
+        {
+            break;
+        }
+        heap[i] = heap[child];
+        i = child;
+    }
+    if (heap_len > 0)
+    {
+        heap[i] = last;
+    }
+    return top;
+}
+
+/* ------------------------------------------------------------------ */
+/* Scheduler core                                                     */
+/* ------------------------------------------------------------------ */
+
+static int64_t tick_deadline(TickType_t ticks)
+{
+    return (now_us / SIM_TICK_US + (int64_t)ticks) * SIM_TICK_US;
+}
+
+static void sim_make_ready(struct sim_task *t)
+{
+    if (t->ready)
+    {
+        return;
+    }
+    t->ready = true;
+    t->ready_seq = ++seq;
+    t->wait_gen++;
+    t->wait_queue = NULL;
+    t->wait_kind = WAIT_NONE;
+    stats.task_wakeups++;
+    sim_pm_wake();
+}
+
+static struct sim_task *sim_pick(void)
+{
+    struct sim_task *best = NULL;
+    for (int i = 0; i < task_count; i++)
+    {
+        struct sim_task *t = tasks[i];
+        if (!t->ready)
+        {
+            continue;
+        }
+        if (best == NULL || t->priority > best->priority ||
+            (t->priority == best->priority && t->ready_seq < best->ready_seq))
+        {
+            best = t;
+        }
+    }
+    return best;
+}
+
+static void sim_switch_out(void)
+{
+    struct sim_task *t = current;
+    swapcontext(&t->ctx, &sched_ctx);
+}
+
+/* Yield if a task woken by the running task outranks it */
+static void sim_preempt_check(void)
+{
+    if (current == NULL)
+    {
+        return;
+    }
+    struct sim_task *best = sim_pick();
+    if (best != NULL && best->priority > current->priority)
+    {
+        current->ready_seq = ++seq;
+        sim_switch_out();
+    }
+}
+
+/* Block the running task until woken or until deadline (<0 waits forever) */
+static bool sim_block_until(int64_t deadline)
+{
+    struct sim_task *t = current;
+    t->ready = false;
+    t->timed_out = false;
+    t->wait_gen++;
+    if (deadline >= 0)
+    {
+        heap_push(deadline, EV_TASK_TIMEOUT, t, NULL, t->wait_gen);
+    }
+    sim_switch_out();
+    return !t->timed_out;
+}
+
+static int64_t sim_deadline(TickType_t ticks)
+{
+    return ticks == portMAX_DELAY ? -1 : tick_deadline(ticks);
+}
+
+static void sim_task_entry(void)
+{
+    struct sim_task *t = current;
+    t->fn(t->arg);
+    /* FreeRTOS tasks must never return */
+    fprintf(stderr, "sim: task %s returned\n", t->name);
+    abort();
+}
+
+/* Dispatch delay of one esp_timer expiry, uniform in 0 - timer_jitter */
+static int64_t timer_latency(void)
+{
+    if (timer_jitter <= 0)
+    {
+        return 0;
+    }
+    jitter_rng ^= jitter_rng << 13;
+    jitter_rng ^= jitter_rng >> 7;
+    jitter_rng ^= jitter_rng << 17;
+    return (int64_t)(jitter_rng % (uint64_t)(timer_jitter + 1));
+}
+
+static void sim_dispatch(const sim_ev_t *ev)
+{
+    switch (ev->kind)
+    {
+    case EV_TASK_TIMEOUT:
+    {
+        struct sim_task *t = ev->ptr;
+        if (!t->ready && t->wait_gen == ev->gen)
+        {
+            t->timed_out = true;
+            sim_make_ready(t);
+        }
+        break;
+    }
+    case EV_TIMER:
+    {
+        struct sim_timer *timer = ev->ptr;
+        if (!timer->active || timer->gen != ev->gen)
+        {
+            break;
+        }
+        if (timer->period > 0)
+        {
+            timer->expiry += (int64_t)timer->period;
+            heap_push(timer->expiry + timer_latency(), EV_TIMER, timer, NULL, timer->gen);
+        }
+        else
+        {
+            timer->active = false;
+        }
+        stats.timer_callbacks++;
+        sim_pm_wake();
+        timer->callback(timer->arg);
+        break;
+    }
+    case EV_CALLBACK:
+        ((sim_event_fn)ev->ptr)(ev->arg);
+        break;
+    }
+}
+
+/*
+ * Tickless idle: with light sleep enabled and no lock held, an idle gap
+ * long enough puts the chip to sleep once the UART has sent its last byte.
+ * Stimulus events that wake nothing leave it asleep.
+ */
+static void sim_pm_idle(int64_t until)
+{
+    if (!pm.light_sleep || pm.asleep || pm.locks)
+    {
+        return;
+    }
+    int64_t from = sim_uart_tx_idle_at();
+    from = from > now_us ? from : now_us;
+    if (until - from >= SIM_SLEEP_IDLE_US)
+    {
+        pm.asleep = true;
+        pm.since = from;
+        stats.light_sleeps++;
+    }
+}
+
+/**
+ * @brief End a light sleep, the CPU has work
+ *
+ * @note Called for timer callbacks, tasks becoming ready, GPIO interrupts
+ *       and UART bytes; a no-op while awake
+ */
+void sim_pm_wake(void)
+{
+    if (pm.asleep)
+    {
+        pm.asleep = false;
+        stats.light_sleep_us += now_us - pm.since;
+    }
+}
+
+/**
+ * @brief Take or give back a lock held by a simulated driver
+ *
+ * @param hold true to take
+ */
+void sim_pm_hold(bool hold)
+{
+    if (hold)
+    {
+        pm.locks++;
+    }
+    else if (pm.locks)
+    {
+        pm.locks--;
+    }
+}
+
+/**
+ * @brief Run the simulation until virtual time reaches t_us
+ *
+ * @param t_us absolute virtual time in microseconds
+ */
+void sim_run_until(int64_t t_us)
+{
+    run_start = sim_host_ns();
+    for (;;)
+    {
+        struct sim_task *t = sim_pick();
+        if (t != NULL)
+        {
+            if (t != last_run)
+            {
+                stats.context_switches++;
+                last_run = t;
+            }
+            current = t;
+            uint64_t resumed = sim_host_ns();
+            swapcontext(&sched_ctx, &t->ctx);
+            t->run_ns += sim_host_ns() - resumed;
+            current = NULL;
+            continue;
+        }
+        if (heap_len == 0 || heap[0].at > t_us)
+        {
+            now_us = t_us;
+            run_ns += sim_host_ns() - run_start;
+            run_start = 0;
+            return;
+        }
+        sim_ev_t ev = heap_pop();
+        if (ev.at > now_us)
+        {
+            sim_pm_idle(ev.at);
+            now_us = ev.at;
+            stats.idle_wakeups++;
+        }
+        sim_dispatch(&ev);
+    }
+}
+
+/**
+ * @brief Current virtual time
+ *
+ * @return int64_t microseconds since start
+ */
+int64_t sim_now(void)
+{
+    return now_us;
+}
+
+/**
+ * @brief Schedule a stimulus callback
+ *
+ * @param at_us absolute virtual time
+ * @param fn callback, runs in interrupt context
+ * @param arg callback argument
+ */
+void sim_schedule(int64_t at_us, sim_event_fn fn, void *arg)
+{
+    heap_push(at_us < now_us ? now_us : at_us, EV_CALLBACK, (void *)fn, arg, 0);
+}
+
+/**
+ * @brief Delay every esp_timer callback by a random amount
+ *
+ * @param max_us longest delay, 0 for callbacks exactly on time
+ * @note Models the esp_timer task waiting behind other work. Each expiry is
+ *       delayed independently; periodic timers keep their nominal schedule.
+ */
+void sim_timer_set_jitter(int64_t max_us)
+{
+    timer_jitter = max_us < 0 ? 0 : max_us;
+}
+
+/**
+ * @brief Enable ESP_LOGx output
+ *
+ * @param enable true to print log lines
+ */
+void sim_log_enable(bool enable)
+{
+    log_enabled = enable;
+}
+
+/**
+ * @brief Scheduler and hardware counters
+ *
+ * @return const sim_stats_t* counters
+ */
+const sim_stats_t *sim_stats(void)
+{
+    if (pm.asleep)
+    {
+        /* Count the sleep in progress up to now */
+        stats.light_sleep_us += now_us - pm.since;
+        pm.since = now_us;
+    }
+    return &stats;
+}
+
+void sim_stats_gpio_write(void)
+{
+    stats.gpio_writes++;
+}
+
+void sim_stats_adc(uint64_t samples, uint64_t lost)
+{
+    stats.adc_samples += samples;
+    stats.adc_lost += lost;
+}
+
+void sim_stats_uart_tx(size_t size)
+{
+    stats.uart_tx_bytes += size;
+}
+
+/**
+ * @brief Block the running task until a time, for drivers that wait on hardware
+ *
+ * @param at_us virtual time to wake at
+ * @return false if no task is running, so nothing waited
+ */
+bool sim_task_wait_until(int64_t at_us)
+{
+    if (current == NULL)
+    {
+        return false;
+    }
+    if (at_us > now_us)
+    {
+        sim_block_until(at_us);
+    }
+    return true;
+}
+
+void sim_stats_uart_wait(int64_t us)
+{
+    stats.uart_tx_wait_us += us;
+}
+
+/* ------------------------------------------------------------------ */
+/* Tasks                                                              */
+/* ------------------------------------------------------------------ */
+
+/**
+ * @brief Core the caller runs on
+ *
+ * @return 1 for tasks pinned to core 1, 0 for everything else
+ */
+BaseType_t xPortGetCoreID(void)
+{
+    return current != NULL && current->core == 1 ? 1 : 0;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack_depth,
+                                   void *arg, UBaseType_t priority, TaskHandle_t *handle,
+                                   BaseType_t core)
+{
+    if (task_count == SIM_MAX_TASKS)
+    {
+        return pdFAIL;
+    }
+    struct sim_task *t = calloc(1, sizeof(*t));
+    t->stack = malloc(SIM_TASK_STACK);
+    if (t->stack == NULL)
+    {
+        abort();
+    }
+    memset(t->stack, SIM_STACK_PAINT, SIM_TASK_STACK);
+    t->stack_depth = stack_depth;
+    t->fn = fn;
+    t->arg = arg;
+    snprintf(t->name, sizeof(t->name), "%s", name);
+    t->priority = priority;
+    t->core = core;
+    getcontext(&t->ctx);
+    t->ctx.uc_stack.ss_sp = t->stack;
+    t->ctx.uc_stack.ss_size = SIM_TASK_STACK;
+    t->ctx.uc_link = NULL;
+    makecontext(&t->ctx, sim_task_entry, 0);
+    tasks[task_count++] = t;
+    stats.tasks++;
+    stats.stack_bytes += stack_depth;
+    sim_make_ready(t);
+    if (handle != NULL)
+    {
+        *handle = t;
+    }
+    sim_preempt_check();
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack_depth,
+                       void *arg, UBaseType_t priority, TaskHandle_t *handle)
+{
+    return xTaskCreatePinnedToCore(fn, name, stack_depth, arg, priority, handle, tskNO_AFFINITY);
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    if (current == NULL)
+    {
+        return;
+    }
+    if (ticks == 0)
+    {
+        current->ready_seq = ++seq;
+        sim_switch_out();
+        return;
+    }
+    sim_block_until(tick_deadline(ticks));
+}
+
+void vTaskDelayUntil(TickType_t *previous_wake, TickType_t increment)
+{
+    *previous_wake += increment;
+    int64_t deadline = (int64_t)*previous_wake * SIM_TICK_US;
+    if (current != NULL && deadline > now_us)
+    {
+        sim_block_until(deadline);
+    }
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)(now_us / SIM_TICK_US);
+}
+
+TickType_t xTaskGetTickCountFromISR(void)
+{
+    return xTaskGetTickCount();
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return current;
+}
+
+/**
+ * @brief Least stack left free since the task started
+ *
+ * @param task task, NULL for the caller
+ * @return bytes of the stack asked for that were never used, as on ESP-IDF
+ * @note Counts the host stack, whose frames are larger than on the ESP32
+ */
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task)
+{
+    struct sim_task *t = task != NULL ? task : current;
+    if (t == NULL)
+    {
+        return 0;
+    }
+    /* The stack grows down from the end of the buffer */
+    size_t untouched = 0;
+    while (untouched < SIM_TASK_STACK && t->stack[untouched] == SIM_STACK_PAINT)
+    {
+        untouched++;
+    }
+    size_t used = SIM_TASK_STACK - untouched;
+    return used < t->stack_depth ? (UBaseType_t)(t->stack_depth - used) : 0;
+}
+
+/**
+ * @brief Host time a task has run
+ *
+ * @param task task, NULL for the caller
+ * @return microseconds, on the clock of portGET_RUN_TIME_COUNTER_VALUE()
+ */
+uint32_t ulTaskGetRunTimeCounter(TaskHandle_t task)
+{
+    struct sim_task *t = task != NULL ? task : current;
+    return t != NULL ? (uint32_t)(t->run_ns / 1000) : 0;
+}
+
+/**
+ * @brief Host time spent simulating
+ *
+ * @return microseconds, inside sim_run_until() only
+ */
+uint32_t sim_run_time_counter(void)
+{
+    /* A task asking is inside sim_run_until(), which has not added its share yet */
+    uint64_t ns = run_ns + (run_start ? sim_host_ns() - run_start : 0);
+    return (uint32_t)(ns / 1000);
+}
+
+/* Update the notification value and wake the task if it is waiting */
+static BaseType_t sim_notify(struct sim_task *task, uint32_t value, eNotifyAction action, bool *woken)
+{
+    *woken = false;
+    switch (action)
+    {
+    case eSetBits:
+        task->notify |= value;
+        break;
+    case eIncrement:
+        task->notify++;
+        break;
+    case eSetValueWithoutOverwrite:
+        if (task->notify_pending)
+        {
+            return pdFAIL;
+        }
+        task->notify = value;
+        break;
+    case eSetValueWithOverwrite:
+        task->notify = value;
+        break;
+    default:
+        break;
+    }
+    task->notify_pending = true;
+    if (task->waiting_notify)
+    {
+        sim_make_ready(task);
+        *woken = true;
+    }
+    return pdPASS;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    return xTaskNotify(task, 0, eIncrement);
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *higher_priority_task_woken)
+{
+    xTaskNotifyFromISR(task, 0, eIncrement, higher_priority_task_woken);
+}
+
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action)
+{
+    bool woken;
+    BaseType_t ret = sim_notify(task, value, action, &woken);
+    if (woken)
+    {
+        sim_preempt_check();
+    }
+    return ret;
+}
+
+BaseType_t xTaskNotifyFromISR(TaskHandle_t task, uint32_t value, eNotifyAction action,
+                              BaseType_t *higher_priority_task_woken)
+{
+    bool woken;
+    BaseType_t ret = sim_notify(task, value, action, &woken);
+    if (woken && higher_priority_task_woken != NULL)
+    {
+        *higher_priority_task_woken = pdTRUE;
+    }
+    return ret;
+}
+
+BaseType_t xTaskNotifyWait(uint32_t clear_on_entry, uint32_t clear_on_exit,
+                           uint32_t *value, TickType_t ticks)
+{
+    struct sim_task *t = current;
+    if (!t->notify_pending)
+    {
+        t->notify &= ~clear_on_entry;
+        if (ticks != 0)
+        {
+            t->waiting_notify = true;
+            sim_block_until(sim_deadline(ticks));
+            t->waiting_notify = false;
+        }
+    }
+    if (value != NULL)
+    {
+        *value = t->notify;
+    }
+    if (!t->notify_pending)
+    {
+        return pdFALSE;
+    }
+    t->notify_pending = false;
+    t->notify &= ~clear_on_exit;
+    return pdTRUE;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks)
+{
+    struct sim_task *t = current;
+    if (t->notify == 0 && ticks != 0)
+    {
+        t->waiting_notify = true;
+        sim_block_until(sim_deadline(ticks));
+        t->waiting_notify = false;
+    }
+    uint32_t value = t->notify;
+    if (value != 0)
+    {
+        t->notify = clear_on_exit ? 0 : value - 1;
+    }
+    t->notify_pending = false;
+    return value;
+}
+
+/* ------------------------------------------------------------------ */
+/* Queues                                                             */
+/* ------------------------------------------------------------------ */
+
+/* Wake the highest priority task blocked on queue in the given direction */
+static bool queue_wake(struct sim_queue *q, sim_wait_t kind)
+{
+    struct sim_task *best = NULL;
+    for (int i = 0; i < task_count; i++)
+    {
+        struct sim_task *t = tasks[i];
+        if (!t->ready && t->wait_queue == q && t->wait_kind == kind &&
+            (best == NULL || t->priority > best->priority))
+        {
+            best = t;
+        }
+    }
+    if (best != NULL)
+    {
+        sim_make_ready(best);
+        return true;
+    }
+    return false;
+}
+
+static bool queue_put(struct sim_queue *q, const void *item, bool front)
+{
+    if (q->count == q->length)
+    {
+        return false;
+    }
+    UBaseType_t slot;
+    if (front)
+    {
+        q->head = (q->head + q->length - 1) % q->length;
+        slot = q->head;
+    }
+    else
+    {
+        slot = (q->head + q->count) % q->length;
+    }
+    if (q->item_size > 0)
+    {
+        memcpy(q->storage + (size_t)slot * q->item_size, item, q->item_size);
+    }
+    q->count++;
+    return true;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size)
+{
+    struct sim_queue *q = calloc(1, sizeof(*q));
+    q->length = length;
+    q->item_size = item_size;
+    q->storage = item_size > 0 ? calloc(length, item_size) : NULL;
+    stats.queues++;
+    stats.queue_bytes += length * item_size;
+    return q;
+}
+
+static BaseType_t queue_send(QueueHandle_t q, const void *item, TickType_t ticks, bool front)
+{
+    int64_t deadline = sim_deadline(ticks);
+    for (;;)
+    {
+        if (queue_put(q, item, front))
+        {
+            if (queue_wake(q, WAIT_RECV))
+            {
+                sim_preempt_check();
+            }
+            return pdPASS;
+        }
+        if (ticks == 0 || current == NULL)
+        {
+            return errQUEUE_FULL;
+        }
+        current->wait_queue = q;
+        current->wait_kind = WAIT_SEND;
+        if (!sim_block_until(deadline))
+        {
+            return errQUEUE_FULL;
+        }
+    }
+}
+
+BaseType_t xQueueSendToBack(QueueHandle_t queue, const void *item, TickType_t ticks)
+{
+    return queue_send(queue, item, ticks, false);
+}
+
+BaseType_t xQueueSendToFront(QueueHandle_t queue, const void *item, TickType_t ticks)
+{
+    return queue_send(queue, item, ticks, true);
+}
+
+static BaseType_t queue_send_isr(QueueHandle_t queue, const void *item, BaseType_t *higher_priority_task_woken,
+                                 bool front)
+{
+    if (!queue_put(queue, item, front))
+    {
+        return errQUEUE_FULL;
+    }
+    if (queue_wake(queue, WAIT_RECV) && higher_priority_task_woken != NULL)
+    {
+        *higher_priority_task_woken = pdTRUE;
+    }
+    return pdPASS;
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void *item, BaseType_t *higher_priority_task_woken)
+{
+    return queue_send_isr(queue, item, higher_priority_task_woken, false);
+}
+
+BaseType_t xQueueSendToFrontFromISR(QueueHandle_t queue, const void *item, BaseType_t *higher_priority_task_woken)
+{
+    return queue_send_isr(queue, item, higher_priority_task_woken, true);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t ticks)
+{
+    int64_t deadline = sim_deadline(ticks);
+    for (;;)
+    {
+        if (q->count > 0)
+        {
+            if (q->item_size > 0)
+            {
+                memcpy(item, q->storage + (size_t)q->head * q->item_size, q->item_size);
+            }
+            q->head = (q->head + 1) % q->length;
+            q->count--;
+            if (queue_wake(q, WAIT_SEND))
+            {
+                sim_preempt_check();
+            }
+            return pdPASS;
+        }
+        if (ticks == 0 || current == NULL)
+        {
+            return pdFAIL;
+        }
+        current->wait_queue = q;
+        current->wait_kind = WAIT_RECV;
+        if (!sim_block_until(deadline))
+        {
+            return pdFAIL;
+        }
+    }
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue)
+{
+    return queue->count;
+}
+
+/* ------------------------------------------------------------------ */
+/* esp_timer                                                          */
+/* ------------------------------------------------------------------ */
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out_handle)
+{
+    if (args == NULL || args->callback == NULL || out_handle == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    struct sim_timer *timer = calloc(1, sizeof(*timer));
+    timer->callback = args->callback;
+    timer->arg = args->arg;
+    timer->name = args->name;
+    stats.timers++;
+    *out_handle = timer;
+    return ESP_OK;
+}
+
+static esp_err_t timer_arm(esp_timer_handle_t timer, uint64_t timeout_us, uint64_t period)
+{
+    if (timer->active)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->active = true;
+    timer->period = period;
+    timer->expiry = now_us + (int64_t)timeout_us;
+    timer->gen++;
+    heap_push(timer->expiry + timer_latency(), EV_TIMER, timer, NULL, timer->gen);
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    return timer_arm(timer, timeout_us, 0);
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period)
+{
+    return timer_arm(timer, period, period);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    if (!timer->active)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->active = false;
+    timer->gen++;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+{
+    if (timer->active)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    /* Stale heap entries still point here; keep the block alive */
+    timer->gen++;
+    return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer)
+{
+    return timer->active;
+}
+
+int64_t esp_timer_get_time(void)
+{
+    return now_us;
+}
+
+/* ------------------------------------------------------------------ */
+/* Power management                                                   */
+/* ------------------------------------------------------------------ */
+
+esp_err_t esp_pm_configure(const void *config)
+{
+    if (config == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pm.light_sleep = ((const esp_pm_config_esp32_t *)config)->light_sleep_enable;
+    return ESP_OK;
+}
+
+esp_err_t esp_pm_lock_create(esp_pm_lock_type_t lock_type, int arg, const char *name, esp_pm_lock_handle_t *out_handle)
+{
+    (void)lock_type;
+    (void)arg;
+    (void)name;
+    struct sim_pm_lock *lock = calloc(1, sizeof(*lock));
+    if (lock == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    *out_handle = lock;
+    return ESP_OK;
+}
+
+esp_err_t esp_pm_lock_acquire(esp_pm_lock_handle_t handle)
+{
+    if (handle == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    handle->count++;
+    sim_pm_hold(true);
+    return ESP_OK;
+}
+
+esp_err_t esp_pm_lock_release(esp_pm_lock_handle_t handle)
+{
+    if (handle == NULL || handle->count == 0)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    handle->count--;
+    sim_pm_hold(false);
+    return ESP_OK;
+}
+
+esp_err_t esp_sleep_enable_gpio_wakeup(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_sleep_enable_uart_wakeup(int uart_num)
+{
+    return uart_num >= 0 && uart_num < UART_NUM_MAX ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+/* ------------------------------------------------------------------ */
+/* Logging                                                            */
+/* ------------------------------------------------------------------ */
+
+void esp_log_level_set(const char *tag, esp_log_level_t level)
+{
+    (void)tag;
+    log_enabled = level != ESP_LOG_NONE;
+}
+
+void sim_log(esp_log_level_t level, const char *tag, const char *format, ...)
+{
+    static const char letters[] = "NEWIDV";
+    /* A default build compiles out everything below INFO */
+    if (level <= ESP_LOG_INFO)
+    {
+        stats.log_lines++;
+    }
+    if (!log_enabled)
+    {
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    printf("%c (%lld) %s: ", letters[level], (long long)(now_us / 1000), tag);
+    vprintf(format, args);
+    printf("\n");
+    va_end(args);
+}
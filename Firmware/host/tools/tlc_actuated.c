@@ -0,0 +1,384 @@
+/**
+ * @file tlc_actuated.c
+ * @brief Fixed vs actuated timing benchmark
+ * @author Jorge Minjares (https://github.com/JorgeMinjares)
+ * @brief Runs the firmware once per timing plan against the same vehicle and
+ *        pedestrian arrivals and compares vehicle delay, throughput and
+ *        pedestrian wait. Vehicles queue on both approaches while the lights
+ *        are not green and leave at the saturation headway on green; the
+ *        queue length drives the traffic density ADC the firmware reads.
+ *        Each plan runs in its own process because the simulator keeps
+ *        global state.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "sim.h"
+#include "tlc_config.h"
+#include "tlc_phase.h"
+#include "driver/adc.h"
+
+#define APPROACHES 2       /*!< Approaches modelled */
+#define QUEUE_MAX 4096     /*!< Vehicles one approach can queue */
+#define PED_PENDING_MAX 64 /*!< Presses waiting for a walk */
+
+void app_main(void);
+extern const tlc_plan_t *timing_plan;
+
+/**
+ * @brief Benchmark options
+ */
+typedef struct
+{
+    double hours;         /*!< Virtual hours to run */
+    double veh_per_hour;  /*!< Mean vehicles per hour per approach at the daily peak */
+    double ped_per_hour;  /*!< Mean pedestrian presses per hour */
+    double headway_s;     /*!< Saturation headway on green */
+    uint64_t seed;        /*!< PRNG seed */
+} bench_options_t;
+
+/**
+ * @brief Result of one run
+ */
+typedef struct
+{
+    uint64_t arrived;     /*!< Vehicles arrived */
+    uint64_t departed;    /*!< Vehicles through the stop line */
+    double delay_sum_s;   /*!< Total stopped delay of departed vehicles */
+    double delay_max_s;   /*!< Longest stopped delay */
+    uint32_t queue_max;   /*!< Longest queue on one approach */
+    uint64_t cycles;      /*!< GREEN entries */
+    uint64_t ped_served;  /*!< Presses served by a walk */
+    double ped_wait_sum_s;/*!< Total press to walk time */
+    double ped_wait_max_s;/*!< Longest press to walk time */
+} bench_result_t;
+
+/**
+ * @brief Vehicle queue of one approach
+ */
+typedef struct
+{
+    int64_t arrival[QUEUE_MAX]; /*!< Arrival times, oldest first */
+    uint32_t head;              /*!< Oldest vehicle */
+    uint32_t count;             /*!< Vehicles queued */
+    int green_pin;              /*!< Green LED of the approach */
+    bool discharging;           /*!< A departure is scheduled */
+    uint32_t gen;               /*!< Invalidates departures scheduled before a red */
+} approach_t;
+
+/* Share of the peak rate in each hour of the day */
+static const double profile[24] = {
+    0.10, 0.05, 0.05, 0.05, 0.10, 0.25, 0.55, 0.90, 1.00, 0.75, 0.60, 0.60,
+    0.65, 0.60, 0.60, 0.70, 0.85, 1.00, 0.90, 0.65, 0.45, 0.35, 0.25, 0.15,
+};
+
+static const int buttons[] = {BUTTON_0, BUTTON_1, BUTTON_2, BUTTON_3};
+static bench_options_t opt = {.hours = 24.0, .veh_per_hour = 900.0, .ped_per_hour = 60.0, .headway_s = 2.0, .seed = 1};
+static bench_result_t result;
+static approach_t approach[APPROACHES];
+static int64_t ped_pending[PED_PENDING_MAX];
+static uint32_t ped_pending_count;
+static int64_t walk_fall;
+static uint64_t rng_state;
+
+static uint64_t rng_next(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static double rng_uniform(void)
+{
+    return (double)(rng_next() >> 11) / 9007199254740992.0;
+}
+
+static int64_t rng_exponential(double mean_us)
+{
+    double u = rng_uniform();
+    return (int64_t)(-mean_us * __builtin_log(1.0 - u)) + 1;
+}
+
+static bool is_green(const approach_t *a)
+{
+    return sim_gpio_output(a->green_pin) != 0;
+}
+
+/* Queue length drives the density input, the way a loop detector would */
+static void update_density(void)
+{
+    uint32_t cars = 0;
+    for (int i = 0; i < APPROACHES; i++)
+    {
+        cars += approach[i].count;
+    }
+    cars = cars > MAX_CARS ? MAX_CARS : cars;
+    int raw = (int)((cars * MAX_ADC_VAL + MAX_CARS - 1) / MAX_CARS);
+    sim_adc_set(ADC1_CHANNEL_6, raw > 4095 ? 4095 : raw);
+}
+
+static void depart(void *arg)
+{
+    intptr_t packed = (intptr_t)arg;
+    approach_t *a = &approach[packed & 0xff];
+    if ((uint32_t)(packed >> 8) != a->gen)
+    {
+        return;
+    }
+    if (!is_green(a) || a->count == 0)
+    {
+        a->discharging = false;
+        return;
+    }
+    double delay = (double)(sim_now() - a->arrival[a->head]) / SIM_SECOND;
+    a->head = (a->head + 1) % QUEUE_MAX;
+    a->count--;
+    result.departed++;
+    result.delay_sum_s += delay;
+    result.delay_max_s = delay > result.delay_max_s ? delay : result.delay_max_s;
+    update_density();
+    sim_schedule(sim_now() + (int64_t)(opt.headway_s * SIM_SECOND), depart, arg);
+}
+
+static void start_discharge(int index)
+{
+    approach_t *a = &approach[index];
+    if (!a->discharging && a->count > 0)
+    {
+        a->discharging = true;
+        sim_schedule(sim_now() + (int64_t)(opt.headway_s * SIM_SECOND), depart,
+                     (void *)(intptr_t)(index | ((intptr_t)a->gen << 8)));
+    }
+}
+
+static void arrive(void *arg)
+{
+    int index = (int)(intptr_t)arg;
+    approach_t *a = &approach[index];
+    result.arrived++;
+    if (is_green(a) && a->count == 0)
+    {
+        /* Rolls through without stopping */
+        result.departed++;
+    }
+    else if (a->count < QUEUE_MAX)
+    {
+        a->arrival[(a->head + a->count) % QUEUE_MAX] = sim_now();
+        a->count++;
+        result.queue_max = a->count > result.queue_max ? a->count : result.queue_max;
+        update_density();
+    }
+    int hour = (int)((sim_now() / SIM_HOUR) % 24);
+    double rate = opt.veh_per_hour * profile[hour];
+    rate = rate < 1.0 ? 1.0 : rate;
+    sim_schedule(sim_now() + rng_exponential(SIM_HOUR / rate), arrive, arg);
+}
+
+static void pedestrian_release(void *arg)
+{
+    sim_gpio_input((int)(intptr_t)arg, LOW);
+}
+
+static void pedestrian_press(void *arg)
+{
+    (void)arg;
+    int pin = buttons[rng_next() % 4];
+    sim_gpio_input(pin, HIGH);
+    sim_schedule(sim_now() + 300000, pedestrian_release, (void *)(intptr_t)pin);
+    if (sim_gpio_output(WALK_0) && sim_now() - walk_fall > SIM_SECOND)
+    {
+        /* Walk already showing, the firmware treats the press as served */
+        result.ped_served++;
+    }
+    else if (ped_pending_count < PED_PENDING_MAX)
+    {
+        ped_pending[ped_pending_count++] = sim_now();
+    }
+    /* Never overlap presses: both directions pressed together halts the lights */
+    sim_schedule(sim_now() + 300000 + rng_exponential(SIM_HOUR / opt.ped_per_hour), pedestrian_press, NULL);
+}
+
+static void observe_gpio(int pin, int level, int64_t now)
+{
+    if (pin == WALK_0 && !level)
+    {
+        walk_fall = now;
+        return;
+    }
+    /* A walk starts after a dark signal, not on a warning blink */
+    if (pin == WALK_0 && level && now - walk_fall > SIM_SECOND && ped_pending_count)
+    {
+        for (uint32_t i = 0; i < ped_pending_count; i++)
+        {
+            double wait = (double)(now - ped_pending[i]) / SIM_SECOND;
+            result.ped_wait_sum_s += wait;
+            result.ped_wait_max_s = wait > result.ped_wait_max_s ? wait : result.ped_wait_max_s;
+        }
+        result.ped_served += ped_pending_count;
+        ped_pending_count = 0;
+        return;
+    }
+    for (int i = 0; i < APPROACHES; i++)
+    {
+        approach_t *a = &approach[i];
+        if (pin != a->green_pin)
+        {
+            continue;
+        }
+        a->gen++;
+        a->discharging = false;
+        if (level)
+        {
+            result.cycles += i == 0;
+            start_discharge(i);
+        }
+    }
+}
+
+static bench_result_t run(const tlc_plan_t *plan)
+{
+    rng_state = opt.seed ? opt.seed : 1;
+    approach[0].green_pin = LED_0;
+    approach[1].green_pin = LED_3;
+    timing_plan = plan;
+    sim_gpio_set_hook(observe_gpio);
+    update_density();
+    app_main();
+    for (int i = 0; i < APPROACHES; i++)
+    {
+        sim_schedule(rng_exponential(SIM_HOUR / opt.veh_per_hour), arrive, (void *)(intptr_t)i);
+    }
+    sim_schedule(rng_exponential(SIM_HOUR / opt.ped_per_hour), pedestrian_press, NULL);
+    sim_run_until((int64_t)(opt.hours * SIM_HOUR));
+    return result;
+}
+
+/* Run one plan in a child process and collect its result through a pipe */
+static int run_isolated(const tlc_plan_t *plan, bench_result_t *out)
+{
+    int fd[2];
+    if (pipe(fd) != 0)
+    {
+        return -1;
+    }
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        return -1;
+    }
+    if (pid == 0)
+    {
+        close(fd[0]);
+        bench_result_t r = run(plan);
+        ssize_t n = write(fd[1], &r, sizeof(r));
+        _exit(n == (ssize_t)sizeof(r) ? 0 : 1);
+    }
+    close(fd[1]);
+    ssize_t n = read(fd[0], out, sizeof(*out));
+    close(fd[0]);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return n == (ssize_t)sizeof(*out) && WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : -1;
+}
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr,
+            "usage: %s [--hours H] [--veh-rate N] [--ped-rate N] [--headway S] [--seed S]\n"
+            "  --hours H     virtual hours to simulate (default 24)\n"
+            "  --veh-rate N  peak vehicles per hour per approach (default 900)\n"
+            "  --ped-rate N  mean pedestrian presses per hour (default 60)\n"
+            "  --headway S   saturation headway on green in seconds (default 2)\n"
+            "  --seed S      random seed (default 1)\n",
+            argv0);
+}
+
+static int parse_options(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (value == NULL)
+        {
+            usage(argv[0]);
+            return -1;
+        }
+        if (strcmp(arg, "--hours") == 0)
+        {
+            opt.hours = atof(value);
+        }
+        else if (strcmp(arg, "--veh-rate") == 0)
+        {
+            opt.veh_per_hour = atof(value);
+        }
+        else if (strcmp(arg, "--ped-rate") == 0)
+        {
+            opt.ped_per_hour = atof(value);
+        }
+        else if (strcmp(arg, "--headway") == 0)
+        {
+            opt.headway_s = atof(value);
+        }
+        else if (strcmp(arg, "--seed") == 0)
+        {
+            opt.seed = strtoull(value, NULL, 0);
+        }
+        else
+        {
+            usage(argv[0]);
+            return -1;
+        }
+        i++;
+    }
+    if (opt.hours <= 0 || opt.veh_per_hour <= 0 || opt.ped_per_hour <= 0 || opt.headway_s <= 0)
+    {
+        usage(argv[0]);
+        return -1;
+    }
+    return 0;
+}
+
+static void print_row(const char *name, const bench_result_t *r)
+{
+    double hours = opt.hours;
+    printf("  %-10s %9.2f %9.1f %10.0f %9u %8.0f %9.1f %9.1f\n", name,
+           r->departed ? r->delay_sum_s / r->departed : 0.0, r->delay_max_s, r->departed / hours,
+           (unsigned)r->queue_max, r->cycles / hours,
+           r->ped_served ? r->ped_wait_sum_s / r->ped_served : 0.0, r->ped_wait_max_s);
+}
+
+int main(int argc, char **argv)
+{
+    if (parse_options(argc, argv) != 0)
+    {
+        return 2;
+    }
+    bench_result_t fixed, actuated;
+    if (run_isolated(&tlc_plan_pedestrian, &fixed) != 0 || run_isolated(&tlc_plan_actuated, &actuated) != 0)
+    {
+        fprintf(stderr, "simulation run failed\n");
+        return 1;
+    }
+    printf("tlc_actuated: %.1f h, peak %.0f veh/h per approach, %.0f presses/h, %.1f s headway, seed %llu\n",
+           opt.hours, opt.veh_per_hour, opt.ped_per_hour, opt.headway_s, (unsigned long long)opt.seed);
+    printf("  %-10s %9s %9s %10s %9s %8s %9s %9s\n", "plan", "delay s", "max s", "veh/h", "max queue",
+           "cycles/h", "ped s", "ped max");
+    print_row(tlc_plan_pedestrian.name, &fixed);
+    print_row(tlc_plan_actuated.name, &actuated);
+    double d0 = fixed.departed ? fixed.delay_sum_s / fixed.departed : 0.0;
+    double d1 = actuated.departed ? actuated.delay_sum_s / actuated.departed : 0.0;
+    printf("  average vehicle delay %+.1f%%, throughput %+.2f%%\n", d0 > 0 ? 100.0 * (d1 - d0) / d0 : 0.0,
+           fixed.departed ? 100.0 * ((double)actuated.departed - fixed.departed) / fixed.departed : 0.0);
+    return 0;
+}
@@ -0,0 +1,268 @@
+/**
+ * @file tlc_adc.c
+ * @brief Traffic density sampling benchmark
+ * @author Jorge Minjares (https://github.com/JorgeMinjares)
+ * @brief Compares the old density reading, one adc1_get_raw() per second
+ *        through the linear map(), with the continuous ADC pipeline: the
+ *        simulated DMA stream read through tlc_bsp_adc_read() and filtered
+ *        by tlc_density. Reports noise at several levels, step latency,
+ *        lookup error against the calibrated curve and host CPU time per
+ *        sample and per published value. --burst samples like the low
+ *        power mode: one 32 ms burst of short blocks per second.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "sim.h"
+#include "tlc_config.h"
+#include "tlc_density.h"
+#include "bsp/tlc_bsp.h"
+#include "driver/adc.h"
+
+#define LEVELS 5        /*!< Steady input levels measured */
+#define HOLD_S 120      /*!< Seconds held at each level */
+#define SETTLE_S 3      /*!< Seconds ignored after a level change */
+
+/**
+ * @brief Benchmark options
+ */
+typedef struct
+{
+    int sigma;            /*!< Gaussian noise in LSB */
+    int spike_ppm;        /*!< Full scale spikes per million conversions */
+    bool burst;           /*!< Sample in low power bursts */
+} bench_options_t;
+
+/**
+ * @brief Running mean and variance
+ */
+typedef struct
+{
+    uint64_t n;           /*!< Values */
+    double mean;          /*!< Mean */
+    double m2;            /*!< Sum of squared deviations */
+} moments_t;
+
+static bench_options_t opt = {.sigma = 30, .spike_ppm = 500};
+static tlc_density_t filter;
+static uint16_t samples[TLC_DENSITY_BLOCK_SAMPLES];
+static double feed_ns;
+
+static void moments_add(moments_t *m, double x)
+{
+    double d = x - m->mean;
+    m->n++;
+    m->mean += d / m->n;
+    m->m2 += d * (x - m->mean);
+}
+
+static double moments_sd(const moments_t *m)
+{
+    return m->n > 1 ? sqrt(m->m2 / (m->n - 1)) : 0.0;
+}
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* The map() the firmware used before the calibrated lookup */
+static uint32_t legacy_map(uint32_t x)
+{
+    return (x - MIN_ADC_VAL) * (MAX_CARS - MIN_CARS) / (MAX_ADC_VAL - MIN_ADC_VAL) + MIN_CARS;
+}
+
+/* Calibrated cars for a raw value, in floating point */
+static double calibrated_cars(double raw)
+{
+    double mv = (double)tlc_bsp_adc_mv(0) + raw * (tlc_bsp_adc_mv(4095) - tlc_bsp_adc_mv(0)) / 4095.0;
+    double cars = (mv - MIN_DENSITY_MV) * MAX_CARS / (MAX_DENSITY_MV - MIN_DENSITY_MV);
+    return cars < 0 ? 0 : cars > MAX_CARS ? MAX_CARS : cars;
+}
+
+/* Advance one burst period and take one burst like the I/O task does */
+static bool burst(void)
+{
+    int64_t start = sim_now();
+    tlc_bsp_adc_start();
+    sim_run_until(start + (TLC_DENSITY_BURST_SAMPLES * SIM_SECOND + DENSITY_SAMPLE_HZ - 1) / DENSITY_SAMPLE_HZ);
+    bool published = false;
+    size_t left = TLC_DENSITY_BURST_SAMPLES;
+    size_t count;
+    while (left > 0 && (count = tlc_bsp_adc_read(samples, left)) > 0)
+    {
+        double t = now_ns();
+        published |= tlc_density_feed(&filter, samples, count);
+        feed_ns += now_ns() - t;
+        left -= count;
+    }
+    tlc_bsp_adc_stop();
+    sim_run_until(start + TLC_DENSITY_BURST_MS * 1000);
+    return published;
+}
+
+/* Advance one block and drain the DMA stream like the controller does */
+static bool block(void)
+{
+    if (opt.burst)
+    {
+        return burst();
+    }
+    sim_run_until(sim_now() + TLC_DENSITY_BLOCK_MS * 1000);
+    bool published = false;
+    size_t count;
+    while ((count = tlc_bsp_adc_read(samples, TLC_DENSITY_BLOCK_SAMPLES)) > 0)
+    {
+        double start = now_ns();
+        published |= tlc_density_feed(&filter, samples, count);
+        feed_ns += now_ns() - start;
+    }
+    return published;
+}
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr,
+            "usage: %s [--sigma LSB] [--spikes PPM] [--burst]\n"
+            "  --sigma N     Gaussian noise on every conversion (default 30 LSB)\n"
+            "  --spikes N    full scale spikes per million conversions (default 500)\n"
+            "  --burst       sample in low power bursts, one per second\n",
+            argv0);
+}
+
+static bool parse(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const char *a = argv[i];
+        const char *v = i + 1 < argc ? argv[i + 1] : NULL;
+        if (!strcmp(a, "--sigma") && v)
+        {
+            opt.sigma = atoi(v);
+            i++;
+        }
+        else if (!strcmp(a, "--spikes") && v)
+        {
+            opt.spike_ppm = atoi(v);
+            i++;
+        }
+        else if (!strcmp(a, "--burst"))
+        {
+            opt.burst = true;
+        }
+        else
+        {
+            usage(argv[0]);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    if (!parse(argc, argv))
+    {
+        return 2;
+    }
+    sim_log_enable(false);
+    if (tlc_bsp_adc_init(opt.burst) != ESP_OK)
+    {
+        fprintf(stderr, "tlc_adc: continuous ADC failed to start\n");
+        return 1;
+    }
+    tlc_density_init(&filter, tlc_bsp_adc_mv);
+    if (opt.burst)
+    {
+        filter.block_samples = TLC_DENSITY_BURST_BLOCK;
+    }
+    sim_adc_set_noise(ADC1_CHANNEL_6, opt.sigma, opt.spike_ppm);
+
+    printf("tlc_adc: %d Hz%s, sigma %d LSB, %d spikes/M, %d s per level\n",
+           DENSITY_SAMPLE_HZ, opt.burst ? " in bursts" : "", opt.sigma, opt.spike_ppm, HOLD_S);
+    printf("  level    cars   old sd  new sd  old bias  new bias  old raw sd  new raw sd\n");
+    static const int levels[LEVELS] = {200, 1000, 2048, 3000, 3900};
+    moments_t all_old = {0};
+    moments_t all_new = {0};
+    for (int l = 0; l < LEVELS; l++)
+    {
+        int raw = levels[l];
+        double truth = calibrated_cars(raw);
+        moments_t old_cars = {0};
+        moments_t new_cars = {0};
+        moments_t old_raw = {0};
+        moments_t new_raw = {0};
+        sim_adc_set(ADC1_CHANNEL_6, raw);
+        int64_t from = sim_now() + SETTLE_S * SIM_SECOND;
+        int64_t until = sim_now() + HOLD_S * SIM_SECOND;
+        while (sim_now() < until)
+        {
+            if (!block() || sim_now() < from)
+            {
+                continue;
+            }
+            /* Old path: one conversion per second, same instant */
+            int single = adc1_get_raw(ADC1_CHANNEL_6);
+            moments_add(&old_raw, single);
+            moments_add(&old_cars, legacy_map(single));
+            moments_add(&new_raw, filter.raw_q4 / 16.0);
+            moments_add(&new_cars, tlc_density_cars(&filter));
+            moments_add(&all_old, legacy_map(single) - truth);
+            moments_add(&all_new, tlc_density_cars(&filter) - truth);
+        }
+        printf("  %5d  %6.2f  %7.3f %7.3f  %+8.2f  %+8.2f  %10.2f  %10.2f\n",
+               raw, truth, moments_sd(&old_cars), moments_sd(&new_cars),
+               old_cars.mean - truth, new_cars.mean - truth,
+               moments_sd(&old_raw), moments_sd(&new_raw));
+    }
+    printf("  error against calibrated cars: old rms %.3f, new rms %.3f\n",
+           sqrt(all_old.m2 / all_old.n + all_old.mean * all_old.mean),
+           sqrt(all_new.m2 / all_new.n + all_new.mean * all_new.mean));
+
+    /* Step from light to heavy traffic, latency to within half a car */
+    sim_adc_set(ADC1_CHANNEL_6, 800);
+    for (int i = 0; i < 30 * 10; i++)
+    {
+        block();
+    }
+    sim_adc_set(ADC1_CHANNEL_6, 3200);
+    int64_t step_at = sim_now();
+    double target = calibrated_cars(3200);
+    int64_t latency = -1;
+    while (latency < 0 && sim_now() - step_at < 30 * SIM_SECOND)
+    {
+        if (block() && fabs(tlc_density_cars(&filter) - target) <= 0.5)
+        {
+            latency = sim_now() - step_at;
+        }
+    }
+    printf("  step 800 -> 3200: new value settled after %.1f s (old: next 1 s read)\n", latency / 1e6);
+
+    /* Fixed-point lookup against the calibrated curve, every raw value */
+    double lut_err = 0;
+    for (int raw = 0; raw < 4096; raw++)
+    {
+        double e = fabs(tlc_density_lookup(&filter, (uint16_t)(raw << 4)) / 256.0 - calibrated_cars(raw));
+        lut_err = e > lut_err ? e : lut_err;
+    }
+    printf("  lookup: %d entries, max error %.4f cars\n", TLC_DENSITY_LUT_SIZE, lut_err);
+
+    const sim_stats_t *stats = sim_stats();
+    const tlc_density_stats_t *d = &filter.stats;
+    printf("  samples %u, rejected %u (%.0f ppm), gate steps %u, lost %llu\n",
+           (unsigned)d->samples, (unsigned)d->rejected, 1e6 * d->rejected / d->samples,
+           (unsigned)d->steps, (unsigned long long)stats->adc_lost);
+    printf("  host cpu: %.2f ns per sample, %.1f us per published value (%u published)\n",
+           feed_ns / d->samples, feed_ns / 1e3 / d->published, (unsigned)d->published);
+    return 0;
+}
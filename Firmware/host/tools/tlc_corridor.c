@@ -0,0 +1,407 @@
+/**
+ * @file tlc_corridor.c
+ * @brief Green wave corridor benchmark
+ * @author Jorge Minjares (https://github.com/JorgeMinjares)
+ * @brief Runs a chain of intersections on tlc_plan_coordinated and drives
+ *        vehicles along it in one direction: each one stops behind a red or
+ *        a queue, leaves at the saturation headway once green, and drives
+ *        to the next stop line at the corridor speed. Compares stops per
+ *        vehicle and travel time for controllers that free run from their
+ *        own boot, controllers on a shared clock without offsets, and a
+ *        green wave with offsets of distance / speed. The shared clock
+ *        reaches the controllers through tlc_scheduler_clock(), as a UART
+ *        'C' message does on the board. Each mode runs in its own process
+ *        because the simulator keeps global state.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "sim.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "tlc_config.h"
+#include "tlc_controller.h"
+#include "tlc_density.h"
+#include "tlc_telemetry.h"
+
+#define CORRIDOR_MAX 32        /*!< Intersections in the chain */
+#define QUEUE_MAX 4096         /*!< Vehicles one stop line can queue */
+#define VEHICLES_MAX 65536     /*!< Vehicles on the corridor at once */
+#define POLL_US 100000         /*!< Queue head checks the light this often while red */
+#define WARMUP_US (10 * SIM_MINUTE) /*!< Vehicles entering before this are not counted */
+#define MASTER_SKEW_US 4242424 /*!< Master time at boot */
+
+/**
+ * @brief Coordination modes compared
+ */
+typedef enum
+{
+    MODE_FREE = 0,         /*!< Every controller cycles from its own boot */
+    MODE_SIMULTANEOUS = 1, /*!< Shared clock, every offset 0 */
+    MODE_GREEN_WAVE = 2,   /*!< Shared clock, offsets of distance / speed */
+} corridor_mode_t;
+
+static const char *const mode_names[] = {"free running", "shared clock", "green wave"};
+
+/**
+ * @brief Benchmark options
+ */
+typedef struct
+{
+    double hours;          /*!< Virtual hours per mode */
+    unsigned count;        /*!< Intersections */
+    double spacing_m;      /*!< Distance between stop lines */
+    double speed_kmh;      /*!< Corridor speed */
+    double veh_per_hour;   /*!< Vehicles entering per hour */
+    double headway_s;      /*!< Saturation headway on green */
+    uint64_t seed;         /*!< PRNG seed */
+} corridor_options_t;
+
+/**
+ * @brief Result of one mode
+ */
+typedef struct
+{
+    uint64_t vehicles;     /*!< Vehicles through the whole corridor */
+    uint64_t stops;        /*!< Stops of those vehicles */
+    uint64_t unstopped;    /*!< Vehicles that never stopped */
+    double travel_sum_s;   /*!< Total travel time */
+    double travel_max_s;   /*!< Longest travel time */
+    uint32_t queue_max;    /*!< Longest queue at one stop line */
+} corridor_result_t;
+
+/**
+ * @brief Stop line of one intersection
+ */
+typedef struct
+{
+    uint32_t queue[QUEUE_MAX]; /*!< Vehicles waiting, oldest first */
+    uint32_t head;             /*!< Oldest vehicle */
+    uint32_t count;            /*!< Vehicles waiting */
+    bool discharging;          /*!< A departure check is scheduled */
+} stop_line_t;
+
+/**
+ * @brief Vehicle on the corridor
+ */
+typedef struct
+{
+    int64_t entered;   /*!< Time at the first stop line */
+    uint16_t stops;    /*!< Stops so far */
+} vehicle_t;
+
+static corridor_options_t opt = {.hours = 24.0, .count = 8, .spacing_m = 400.0, .speed_kmh = 50.0,
+                                 .veh_per_hour = 600.0, .headway_s = 2.0, .seed = 1};
+static corridor_mode_t mode;
+static corridor_result_t result;
+static tlc_controller_t controllers[CORRIDOR_MAX];
+static tlc_t approaches[CORRIDOR_MAX][2];
+static tlc_scheduler_t scheduler;
+static stop_line_t lines[CORRIDOR_MAX];
+static vehicle_t vehicles[VEHICLES_MAX];
+static uint32_t next_vehicle;
+static bool clocked;
+static uint64_t rng_state;
+
+static uint64_t rng_next(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static int64_t rng_exponential(double mean_us)
+{
+    double u = (double)(rng_next() >> 11) / 9007199254740992.0;
+    return (int64_t)(-mean_us * __builtin_log(1.0 - u)) + 1;
+}
+
+static void discard(const uint8_t *data, size_t size)
+{
+    (void)data;
+    (void)size;
+}
+
+static int64_t link_us(void)
+{
+    return (int64_t)(opt.spacing_m / (opt.speed_kmh / 3.6) * SIM_SECOND);
+}
+
+static bool is_green(unsigned line)
+{
+    return tlc_phase_current(&controllers[line].engine)->light[0] == GREEN;
+}
+
+static void arrive(void *arg);
+
+/* Vehicle leaves a stop line: drive to the next one or off the corridor */
+static void leave(uint32_t id, unsigned line)
+{
+    if (line + 1 < opt.count)
+    {
+        sim_schedule(sim_now() + link_us(), arrive, (void *)(intptr_t)(id | (uint64_t)(line + 1) << 32));
+        return;
+    }
+    vehicle_t *v = &vehicles[id];
+    if (v->entered < WARMUP_US)
+    {
+        return;
+    }
+    double travel = (double)(sim_now() - v->entered) / SIM_SECOND;
+    result.vehicles++;
+    result.stops += v->stops;
+    result.unstopped += v->stops == 0;
+    result.travel_sum_s += travel;
+    result.travel_max_s = travel > result.travel_max_s ? travel : result.travel_max_s;
+}
+
+/* Queue head goes on green, one vehicle per headway */
+static void discharge(void *arg)
+{
+    unsigned line = (unsigned)(intptr_t)arg;
+    stop_line_t *s = &lines[line];
+    if (s->count == 0)
+    {
+        s->discharging = false;
+        return;
+    }
+    if (!is_green(line))
+    {
+        sim_schedule(sim_now() + POLL_US, discharge, arg);
+        return;
+    }
+    uint32_t id = s->queue[s->head];
+    s->head = (s->head + 1) % QUEUE_MAX;
+    s->count--;
+    leave(id, line);
+    sim_schedule(sim_now() + (int64_t)(opt.headway_s * SIM_SECOND), discharge, arg);
+}
+
+/* Vehicle reaches a stop line */
+static void arrive(void *arg)
+{
+    uint64_t packed = (uint64_t)(intptr_t)arg;
+    uint32_t id = (uint32_t)packed;
+    unsigned line = (unsigned)(packed >> 32);
+    stop_line_t *s = &lines[line];
+    if (is_green(line) && s->count == 0)
+    {
+        leave(id, line);
+        return;
+    }
+    if (s->count == QUEUE_MAX)
+    {
+        return;
+    }
+    vehicles[id].stops++;
+    s->queue[(s->head + s->count) % QUEUE_MAX] = id;
+    s->count++;
+    result.queue_max = s->count > result.queue_max ? s->count : result.queue_max;
+    if (!s->discharging)
+    {
+        s->discharging = true;
+        sim_schedule(sim_now() + POLL_US, discharge, (void *)(intptr_t)line);
+    }
+}
+
+/* Vehicles enter at the first stop line */
+static void enter(void *arg)
+{
+    uint32_t id = next_vehicle++ % VEHICLES_MAX;
+    vehicles[id] = (vehicle_t){.entered = sim_now()};
+    arrive((void *)(intptr_t)id);
+    sim_schedule(sim_now() + rng_exponential(SIM_HOUR / opt.veh_per_hour), enter, arg);
+}
+
+/* The master clock arrives once, a few seconds after boot */
+static void handler(tlc_scheduler_t *s, const tlc_event_t *event)
+{
+    if (event->type != TLC_EVENT_ADC || clocked || mode == MODE_FREE || event->timestamp < 3 * SIM_SECOND)
+    {
+        return;
+    }
+    clocked = true;
+    tlc_scheduler_clock(s, event->timestamp, event->timestamp + MASTER_SKEW_US);
+}
+
+static corridor_result_t run(corridor_mode_t m)
+{
+    rng_state = opt.seed ? opt.seed : 1;
+    mode = m;
+    tlc_telemetry_init(discard);
+    if (tlc_scheduler_init(&scheduler, controllers, (uint8_t)opt.count) != ESP_OK)
+    {
+        return result;
+    }
+    scheduler.tick_ms = TLC_DENSITY_BLOCK_MS;
+    scheduler.handler = handler;
+    int64_t cycle = (int64_t)tlc_plan_coordinated.cycle_ms * 1000;
+    for (unsigned i = 0; i < opt.count; i++)
+    {
+        for (int d = 0; d < 2; d++)
+        {
+            approaches[i][d] = (tlc_t){
+                .direction = d ? DIRECTION_1 : DIRECTION_0,
+                .led = {GPIO_NUM_NC, GPIO_NUM_NC, GPIO_NUM_NC},
+                .button = {GPIO_NUM_NC, GPIO_NUM_NC},
+                .buzzer = GPIO_NUM_NC,
+                .walkingSignal = GPIO_NUM_NC,
+            };
+        }
+        if (tlc_controller_init(&scheduler, (uint8_t)i, approaches[i], 2, &tlc_plan_coordinated) != ESP_OK)
+        {
+            return result;
+        }
+        int64_t offset = 0;
+        if (m == MODE_FREE)
+        {
+            /* Boards boot whenever they are powered, any point of the cycle */
+            offset = (int64_t)(rng_next() % (uint64_t)cycle);
+        }
+        else if (m == MODE_GREEN_WAVE)
+        {
+            offset = (i * link_us()) % cycle;
+        }
+        tlc_controller_offset(&controllers[i], offset);
+    }
+    xTaskCreate(&tlc_scheduler_task, "controller_task", 3072, &scheduler, 15, NULL);
+    sim_schedule(rng_exponential(SIM_HOUR / opt.veh_per_hour), enter, NULL);
+    sim_run_until((int64_t)(opt.hours * SIM_HOUR));
+    return result;
+}
+
+/* Run one mode in a child process and collect its result through a pipe */
+static int run_isolated(corridor_mode_t m, corridor_result_t *out)
+{
+    int fd[2];
+    if (pipe(fd) != 0)
+    {
+        return -1;
+    }
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        return -1;
+    }
+    if (pid == 0)
+    {
+        close(fd[0]);
+        corridor_result_t r = run(m);
+        ssize_t n = write(fd[1], &r, sizeof(r));
+        _exit(n == (ssize_t)sizeof(r) ? 0 : 1);
+    }
+    close(fd[1]);
+    ssize_t n = read(fd[0], out, sizeof(*out));
+    close(fd[0]);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return n == (ssize_t)sizeof(*out) && WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : -1;
+}
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr,
+            "usage: %s [--hours H] [--count N] [--spacing M] [--speed KMH] [--veh-rate N] [--headway S] [--seed S]\n"
+            "  --hours H     virtual hours per mode (default 24)\n"
+            "  --count N     intersections, 2 - %d (default 8)\n"
+            "  --spacing M   metres between stop lines (default 400)\n"
+            "  --speed KMH   corridor speed (default 50)\n"
+            "  --veh-rate N  vehicles entering per hour (default 600)\n"
+            "  --headway S   saturation headway on green in seconds (default 2)\n"
+            "  --seed S      random seed (default 1)\n",
+            argv0, CORRIDOR_MAX);
+}
+
+static int parse_options(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (value == NULL)
+        {
+            usage(argv[0]);
+            return -1;
+        }
+        if (strcmp(arg, "--hours") == 0)
+        {
+            opt.hours = atof(value);
+        }
+        else if (strcmp(arg, "--count") == 0)
+        {
+            opt.count = (unsigned)atoi(value);
+        }
+        else if (strcmp(arg, "--spacing") == 0)
+        {
+            opt.spacing_m = atof(value);
+        }
+        else if (strcmp(arg, "--speed") == 0)
+        {
+            opt.speed_kmh = atof(value);
+        }
+        else if (strcmp(arg, "--veh-rate") == 0)
+        {
+            opt.veh_per_hour = atof(value);
+        }
+        else if (strcmp(arg, "--headway") == 0)
+        {
+            opt.headway_s = atof(value);
+        }
+        else if (strcmp(arg, "--seed") == 0)
+        {
+            opt.seed = strtoull(value, NULL, 0);
+        }
+        else
+        {
+            usage(argv[0]);
+            return -1;
+        }
+        i++;
+    }
+    if (opt.hours * SIM_HOUR <= WARMUP_US || opt.count < 2 || opt.count > CORRIDOR_MAX || opt.spacing_m <= 0.0 ||
+        opt.speed_kmh <= 0.0 || opt.veh_per_hour <= 0.0 || opt.headway_s <= 0.0)
+    {
+        usage(argv[0]);
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (parse_options(argc, argv) != 0)
+    {
+        return 2;
+    }
+    double free_flow = (opt.count - 1) * (double)link_us() / SIM_SECOND;
+    printf("tlc_corridor: %u intersections %.0f m apart at %.0f km/h, %.0f veh/h, %u s cycle, %.1f h per mode\n",
+           opt.count, opt.spacing_m, opt.speed_kmh, opt.veh_per_hour,
+           (unsigned)(tlc_plan_coordinated.cycle_ms / 1000), opt.hours);
+    printf("  %-13s %9s %10s %9s %10s %10s %10s %9s\n", "mode", "vehicles", "stops/veh", "no stop", "travel s",
+           "delay s", "max s", "queue");
+    for (int m = MODE_FREE; m <= MODE_GREEN_WAVE; m++)
+    {
+        corridor_result_t r;
+        if (run_isolated((corridor_mode_t)m, &r) != 0 || r.vehicles == 0)
+        {
+            fprintf(stderr, "tlc_corridor: %s run failed\n", mode_names[m]);
+            return 1;
+        }
+        double travel = r.travel_sum_s / r.vehicles;
+        printf("  %-13s %9llu %10.2f %8.1f%% %10.1f %10.1f %10.1f %9u\n", mode_names[m],
+               (unsigned long long)r.vehicles, (double)r.stops / r.vehicles, 100.0 * r.unstopped / r.vehicles,
+               travel, travel - free_flow, r.travel_max_s, (unsigned)r.queue_max);
+    }
+    printf("  free flow travel %.1f s; delay is travel time above it\n", free_flow);
+    return 0;
+}
@@ -0,0 +1,338 @@
+/**
+ * @file tlc_history.c
+ * @brief Density history benchmark
+ * @author Jorge Minjares (https://github.com/JorgeMinjares)
+ * @brief Feeds tlc_history one density value per second for several days
+ *        and reports RAM, encoded bytes per bucket, what each rollup still
+ *        holds, host CPU per insert and per scanned bucket, and how long a
+ *        scan takes to send over UART0. The values come from a loop detector
+ *        over a signalized queue on the daily profile of tlc_traffic,
+ *        averaged per second like the density filter does. Every bucket
+ *        kept is decoded and checked against min, mean and max computed
+ *        from the raw values.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "tlc_config.h"
+#include "tlc_history.h"
+#include "tlc_telemetry.h"
+
+#define DAY_S 86400         /*!< Seconds per day */
+#define CYCLE_S 60          /*!< Signal cycle of the detected approach */
+#define GREEN_S 30          /*!< Green time per cycle */
+#define HEADWAY_S 2.0       /*!< Departures while green */
+#define BLOCKS 10           /*!< Detector readings per value, like TLC_DENSITY_WINDOW */
+#define SCANS 20            /*!< Repeats of each timed scan */
+#define SEEKS 100000        /*!< Timed range starts */
+#define RUNS 5              /*!< Timed inserts of the whole stream */
+#define LINE_RATE_BPS 11520 /*!< UART0 bytes per second, 115200 baud 8N1 */
+#define RECORD_OVERHEAD 5   /*!< Type, time delta and framing share per record */
+
+/**
+ * @brief Benchmark options
+ */
+typedef struct
+{
+    double days;          /*!< Days fed */
+    double peak;          /*!< Arrivals per second at the peak hour */
+    double sigma;         /*!< Extra Gaussian noise on each value, cars */
+    uint64_t seed;        /*!< PRNG seed */
+} history_options_t;
+
+/* Share of the peak rate in each hour of the day, as in tlc_traffic */
+static const double profile[24] = {
+    0.10, 0.05, 0.05, 0.05, 0.10, 0.25, 0.55, 0.90, 1.00, 0.75, 0.60, 0.60,
+    0.65, 0.60, 0.60, 0.70, 0.85, 1.00, 0.90, 0.65, 0.45, 0.35, 0.25, 0.15,
+};
+
+static const char *const level_names[] = {"second", "minute", "hour"};
+static history_options_t opt = {.days = 9.0, .peak = 0.45, .sigma = 0.0, .seed = 1};
+static tlc_history_t history;
+static uint64_t rng_state;
+static volatile uint64_t sink; /*!< Keeps the timed scans from being optimized out */
+
+static uint64_t rng_next(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static double rng_uniform(void)
+{
+    return (double)(rng_next() >> 11) / 9007199254740992.0;
+}
+
+static double rng_gauss(void)
+{
+    double u = rng_uniform();
+    double v = rng_uniform();
+    return sqrt(-2.0 * log(1.0 - u)) * cos(2.0 * M_PI * v);
+}
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* Density values, cars Q8, one per second */
+static uint16_t *generate(uint32_t count)
+{
+    uint16_t *values = malloc(count * sizeof(uint16_t));
+    if (values == NULL)
+    {
+        return NULL;
+    }
+    int queue = 0;
+    double leave = 0;
+    for (uint32_t s = 0; s < count; s++)
+    {
+        double rate = opt.peak * profile[(s % DAY_S) / 3600] / BLOCKS;
+        bool green = s % CYCLE_S < GREEN_S;
+        uint32_t sum = 0;
+        for (int b = 0; b < BLOCKS; b++)
+        {
+            queue += rng_uniform() < rate;
+            leave = green ? leave + 1.0 / (HEADWAY_S * BLOCKS) : 0;
+            if (leave >= 1.0 && queue > 0)
+            {
+                queue--;
+                leave -= 1.0;
+            }
+            queue = queue > MAX_CARS ? MAX_CARS : queue;
+            sum += (uint32_t)queue;
+        }
+        double cars = sum / (double)BLOCKS + opt.sigma * rng_gauss();
+        cars = cars < 0 ? 0 : cars > MAX_CARS ? MAX_CARS : cars;
+        values[s] = (uint16_t)lround(cars * 256);
+    }
+    return values;
+}
+
+static int float_order(const void *a, const void *b)
+{
+    float x = *(const float *)a;
+    float y = *(const float *)b;
+    return (x > y) - (x < y);
+}
+
+static double median(float *values, uint32_t count)
+{
+    if (count == 0)
+    {
+        return 0;
+    }
+    qsort(values, count, sizeof(float), float_order);
+    return values[count / 2];
+}
+
+/* min, mean and max of values [first, first + span), rounded the way the store does */
+static tlc_history_bucket_t reference(const uint16_t *values, uint32_t first, uint32_t span)
+{
+    uint32_t sum = 0;
+    uint16_t min = UINT16_MAX;
+    uint16_t max = 0;
+    for (uint32_t i = first; i < first + span; i++)
+    {
+        sum += values[i];
+        min = values[i] < min ? values[i] : min;
+        max = values[i] > max ? values[i] : max;
+    }
+    return (tlc_history_bucket_t){
+        .min = (uint16_t)((min + 8) >> 4),
+        .mean = (uint16_t)((sum + span * 8) / (span * 16)),
+        .max = (uint16_t)((max + 8) >> 4),
+    };
+}
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr,
+            "usage: %s [--days D] [--peak RATE] [--sigma CARS] [--seed N]\n"
+            "  --days D       days of values fed (default 9, past the 7 days kept)\n"
+            "  --peak RATE    arrivals per second at the peak hour (default 0.45)\n"
+            "  --sigma CARS   Gaussian noise added to every value (default 0)\n"
+            "  --seed N       PRNG seed (default 1)\n",
+            argv0);
+}
+
+static bool parse(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const char *a = argv[i];
+        const char *v = i + 1 < argc ? argv[i + 1] : NULL;
+        if (!strcmp(a, "--days") && v)
+        {
+            opt.days = atof(v);
+            i++;
+        }
+        else if (!strcmp(a, "--peak") && v)
+        {
+            opt.peak = atof(v);
+            i++;
+        }
+        else if (!strcmp(a, "--sigma") && v)
+        {
+            opt.sigma = atof(v);
+            i++;
+        }
+        else if (!strcmp(a, "--seed") && v)
+        {
+            opt.seed = strtoull(v, NULL, 0);
+            i++;
+        }
+        else
+        {
+            usage(argv[0]);
+            return false;
+        }
+    }
+    return opt.days > 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (!parse(argc, argv))
+    {
+        return 2;
+    }
+    rng_state = opt.seed ? opt.seed : 1;
+    uint32_t count = (uint32_t)(opt.days * DAY_S);
+    uint16_t *values = generate(count);
+    if (values == NULL)
+    {
+        fprintf(stderr, "tlc_history: out of memory\n");
+        return 1;
+    }
+    printf("tlc_history: %.1f days, peak %.2f arrivals/s, sigma %.2f cars, sizeof(tlc_history_t) %zu B\n", opt.days,
+           opt.peak, opt.sigma, sizeof(tlc_history_t));
+
+    /* Insert cost: the whole stream at once, fastest of a few runs, then each insert by the buckets it closes */
+    double insert_ns = 0;
+    double start;
+    for (int r = 0; r < RUNS; r++)
+    {
+        tlc_history_init(&history);
+        start = now_ns();
+        for (uint32_t s = 0; s < count; s++)
+        {
+            tlc_history_add(&history, (int64_t)s * 1000000, values[s]);
+        }
+        double took = (now_ns() - start) / count;
+        insert_ns = r == 0 || took < insert_ns ? took : insert_ns;
+    }
+    float *took[3];
+    uint32_t took_count[3] = {0};
+    for (int c = 0; c < 3; c++)
+    {
+        took[c] = malloc(count * sizeof(float));
+    }
+    tlc_history_init(&history);
+    for (uint32_t s = 0; s < count; s++)
+    {
+        start = now_ns();
+        tlc_history_add(&history, (int64_t)s * 1000000, values[s]);
+        double end = now_ns();
+        /* The same clock pair around nothing, so the median takes the reading cost out */
+        double empty = now_ns();
+        empty = now_ns() - empty;
+        int closes = (s + 1) % 3600 == 0 ? 2 : (s + 1) % 60 == 0 ? 1 : 0;
+        took[closes][took_count[closes]++] = (float)(end - start - empty);
+    }
+    printf("  insert: %.1f ns per value; median %.0f ns plain, %.0f ns closing a minute, %.0f ns closing an hour\n",
+           insert_ns, median(took[0], took_count[0]), median(took[1], took_count[1]), median(took[2], took_count[2]));
+    for (int c = 0; c < 3; c++)
+    {
+        free(took[c]);
+    }
+
+    printf("  level    kept      span   bytes of ring  B/bucket  mismatches  scan ns/bucket  seek ns\n");
+    static const uint32_t rings[TLC_HISTORY_LEVELS] = {sizeof(history.seconds), TLC_HISTORY_MINUTE_BYTES,
+                                                       TLC_HISTORY_HOUR_BYTES};
+    uint64_t mismatches = 0;
+    for (uint8_t level = 0; level < TLC_HISTORY_LEVELS; level++)
+    {
+        uint32_t span = tlc_history_span((tlc_history_level_t)level);
+        tlc_history_cursor_t scan;
+        tlc_history_bucket_t bucket;
+        uint32_t kept = 0;
+        uint64_t wrong = 0;
+        tlc_history_range(&history, &scan, (tlc_history_level_t)level, UINT32_MAX >> 1, 0);
+        while (tlc_history_next(&history, &scan, &bucket))
+        {
+            tlc_history_bucket_t want = reference(values, bucket.index * span, span);
+            wrong += want.min != bucket.min || want.mean != bucket.mean || want.max != bucket.max;
+            kept++;
+        }
+        start = now_ns();
+        for (int r = 0; r < SCANS; r++)
+        {
+            tlc_history_range(&history, &scan, (tlc_history_level_t)level, UINT32_MAX >> 1, 0);
+            while (tlc_history_next(&history, &scan, &bucket))
+            {
+                sink += bucket.mean;
+            }
+        }
+        double scan_ns = kept ? (now_ns() - start) / ((double)SCANS * kept) : 0;
+        /* Ranges starting anywhere in what is kept, each decodes up to a block to get there */
+        uint32_t reach = kept * span;
+        start = now_ns();
+        for (int r = 0; r < SEEKS; r++)
+        {
+            uint32_t from = (uint32_t)(rng_next() % (reach ? reach : 1));
+            sink += tlc_history_range(&history, &scan, (tlc_history_level_t)level, from, 0);
+        }
+        double seek_ns = (now_ns() - start) / SEEKS;
+        uint32_t bytes = tlc_history_bytes(&history, (tlc_history_level_t)level);
+        printf("  %-6s %6u %7.2f %s %7u of %5u %9.2f %11llu %15.1f %8.1f\n", level_names[level], (unsigned)kept,
+               span == 1 ? kept / 60.0 : span == 60 ? kept / 1440.0 : kept / 24.0,
+               span == 1 ? "min " : "days", (unsigned)bytes, (unsigned)rings[level],
+               kept ? (double)bytes / kept : 0.0, (unsigned long long)wrong, scan_ns, seek_ns);
+        mismatches += wrong;
+    }
+
+    /* What the console history command sends */
+    printf("  scan over UART0 at %d records per 100 ms:\n", TLC_HISTORY_RECORDS);
+    for (uint8_t level = TLC_HISTORY_MINUTE; level < TLC_HISTORY_LEVELS; level++)
+    {
+        tlc_history_cursor_t scan;
+        uint8_t data[TLC_TELEMETRY_DATA_MAX];
+        uint32_t records = 0;
+        uint32_t buckets = 0;
+        uint64_t bytes = 0;
+        tlc_history_range(&history, &scan, (tlc_history_level_t)level, 7 * DAY_S, 0);
+        start = now_ns();
+        size_t size;
+        do
+        {
+            size = tlc_history_encode(&history, &scan, data, sizeof(data));
+            records++;
+            buckets += data[1];
+            bytes += size + RECORD_OVERHEAD;
+        } while (data[1] != 0);
+        double encode_ns = now_ns() - start;
+        double paced_s = records / (double)TLC_HISTORY_RECORDS * 0.1;
+        double line_s = (double)bytes / LINE_RATE_BPS;
+        printf("    7 days of %-6s %6u buckets in %5u records, %7llu bytes, %5.1f s to send (%4.1f%% of the line), "
+               "%.0f ns per bucket to encode\n",
+               level_names[level], (unsigned)buckets, (unsigned)records, (unsigned long long)bytes,
+               paced_s > line_s ? paced_s : line_s, 100.0 * line_s / (paced_s > line_s ? paced_s : line_s),
+               buckets ? encode_ns / buckets : 0.0);
+    }
+    printf("  %s\n", mismatches ? "MISMATCH: decoded buckets differ from the raw values" : "every bucket kept matches the raw values");
+    free(values);
+    return mismatches ? 1 : 0;
+}
@@ -0,0 +1,330 @@
+/**
+ * @file tlc_multi.c
+ * @brief Multi-intersection scaling benchmark
+ * @author Jorge Minjares (https://github.com/JorgeMinjares)
+ * @brief Runs 1, 2, 4 ... N intersections on one scheduler task and reports
+ *        what each one costs: RAM for the controller, its approaches, timers
+ *        and queue slots, events and timer callbacks per intersection hour,
+ *        and host CPU per intersection hour as a proxy for MCU time. The
+ *        intersections run headless on GPIO_NUM_NC pins; pedestrians press
+ *        through tlc_button_inject() and one density value is broadcast to
+ *        all of them every second. Each size runs in its own process because
+ *        the simulator keeps global state.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "sim.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "tlc_config.h"
+#include "tlc_controller.h"
+#include "tlc_density.h"
+#include "tlc_telemetry.h"
+
+#define SIM_TCB_BYTES 352        /*!< Task control block, as in tlc_sim */
+#define SIM_QUEUE_BYTES 80       /*!< Queue control block, as in tlc_sim */
+#define SIM_ESP_TIMER_BYTES 40   /*!< esp_timer control block, as in tlc_sim */
+#define MULTI_MAX TLC_CONTROLLER_MAX /*!< Largest run */
+#define PRESS_US 300000          /*!< Press length */
+#define HOLD_US 3500000          /*!< Held press length, past the hold time */
+
+/**
+ * @brief Benchmark options
+ */
+typedef struct
+{
+    double hours;         /*!< Virtual hours per run */
+    unsigned max;         /*!< Largest number of intersections */
+    double ped_per_hour;  /*!< Mean presses per hour per intersection */
+    unsigned hold_pct;    /*!< Percent of presses held */
+    const tlc_plan_t *plan; /*!< Plan run by every intersection */
+    uint64_t seed;        /*!< PRNG seed */
+} multi_options_t;
+
+/**
+ * @brief Result of one run
+ */
+typedef struct
+{
+    unsigned count;           /*!< Intersections */
+    uint64_t events;          /*!< Scheduler events */
+    uint64_t timer_callbacks; /*!< esp_timer callbacks */
+    uint64_t task_wakeups;    /*!< Scheduler task wakeups */
+    uint64_t presses;         /*!< Presses injected */
+    uint64_t button_events;   /*!< Classified button events */
+    uint32_t dropped;         /*!< Timer events lost to a full queue */
+    uint32_t ram;             /*!< Controllers, approaches and RTOS objects */
+    double host_s;            /*!< Host CPU time of the run */
+} multi_result_t;
+
+static multi_options_t opt = {.hours = 24.0, .max = 64, .ped_per_hour = 30.0, .hold_pct = 10,
+                              .plan = &tlc_plan_pedestrian, .seed = 1};
+static tlc_controller_t controllers[MULTI_MAX];
+static tlc_t approaches[MULTI_MAX][2];
+static tlc_scheduler_t scheduler;
+static multi_result_t result;
+static uint32_t ticks;
+static uint64_t rng_state;
+
+static uint64_t rng_next(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static int64_t rng_exponential(double mean_us)
+{
+    double u = (double)(rng_next() >> 11) / 9007199254740992.0;
+    return (int64_t)(-mean_us * __builtin_log(1.0 - u)) + 1;
+}
+
+/* Telemetry is produced and framed as on the board, then discarded */
+static void discard(const uint8_t *data, size_t size)
+{
+    (void)data;
+    (void)size;
+}
+
+static void release(void *arg)
+{
+    intptr_t packed = (intptr_t)arg;
+    tlc_button_inject(&controllers[packed >> 8].buttons, (uint8_t)(packed & 0xff), 0);
+}
+
+/* Presses arrive independently at every intersection */
+static void press(void *arg)
+{
+    intptr_t id = (intptr_t)arg;
+    intptr_t button = (intptr_t)(rng_next() % 4);
+    int64_t length = rng_next() % 100 < opt.hold_pct ? HOLD_US : PRESS_US;
+    tlc_button_inject(&controllers[id].buttons, (uint8_t)button, 1);
+    sim_schedule(sim_now() + length, release, (void *)(button | id << 8));
+    result.presses++;
+    /* Never overlap presses: both directions pressed together halts the lights */
+    sim_schedule(sim_now() + length + rng_exponential(SIM_HOUR / opt.ped_per_hour), press, arg);
+}
+
+/* Stands in for the ADC block of main.c: one density value a second for all */
+static void handler(tlc_scheduler_t *s, const tlc_event_t *event)
+{
+    if (event->type != TLC_EVENT_ADC || ++ticks % (1000 / TLC_DENSITY_BLOCK_MS) != 0)
+    {
+        return;
+    }
+    uint16_t cars = (uint16_t)(rng_next() % (MAX_CARS + 1));
+    tlc_telemetry_density(event->timestamp, (uint16_t)(cars << 8), 0);
+    tlc_scheduler_density(s, event->timestamp, cars);
+    tlc_telemetry_flush();
+}
+
+static multi_result_t run(unsigned count)
+{
+    rng_state = opt.seed ? opt.seed : 1;
+    result.count = count;
+    tlc_telemetry_init(discard);
+    if (tlc_scheduler_init(&scheduler, controllers, (uint8_t)count) != ESP_OK)
+    {
+        return result;
+    }
+    scheduler.tick_ms = TLC_DENSITY_BLOCK_MS;
+    scheduler.handler = handler;
+    for (unsigned i = 0; i < count; i++)
+    {
+        for (int d = 0; d < 2; d++)
+        {
+            approaches[i][d] = (tlc_t){
+                .direction = d ? DIRECTION_1 : DIRECTION_0,
+                .led = {GPIO_NUM_NC, GPIO_NUM_NC, GPIO_NUM_NC},
+                .button = {GPIO_NUM_NC, GPIO_NUM_NC},
+                .buzzer = GPIO_NUM_NC,
+                .walkingSignal = GPIO_NUM_NC,
+            };
+        }
+        if (tlc_controller_init(&scheduler, (uint8_t)i, approaches[i], 2, opt.plan) != ESP_OK)
+        {
+            return result;
+        }
+        sim_schedule(rng_exponential(SIM_HOUR / opt.ped_per_hour), press, (void *)(intptr_t)i);
+    }
+    xTaskCreate(&tlc_scheduler_task, "controller_task", 3072, &scheduler, 15, NULL);
+    struct timespec start, end;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &start);
+    sim_run_until((int64_t)(opt.hours * SIM_HOUR));
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &end);
+    const sim_stats_t *s = sim_stats();
+    tlc_button_stats_t buttons;
+    tlc_button_get_stats(&buttons);
+    result.events = scheduler.events;
+    result.timer_callbacks = s->timer_callbacks;
+    result.task_wakeups = s->task_wakeups;
+    result.button_events = buttons.events;
+    result.dropped = scheduler.dropped;
+    result.ram = (uint32_t)(count * (sizeof(tlc_controller_t) + sizeof(approaches[0])) + s->stack_bytes +
+                            s->tasks * SIM_TCB_BYTES + s->queue_bytes + s->queues * SIM_QUEUE_BYTES +
+                            s->timers * SIM_ESP_TIMER_BYTES);
+    result.host_s = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+    return result;
+}
+
+/* Run one size in a child process and collect its result through a pipe */
+static int run_isolated(unsigned count, multi_result_t *out)
+{
+    int fd[2];
+    if (pipe(fd) != 0)
+    {
+        return -1;
+    }
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        return -1;
+    }
+    if (pid == 0)
+    {
+        close(fd[0]);
+        multi_result_t r = run(count);
+        ssize_t n = write(fd[1], &r, sizeof(r));
+        _exit(n == (ssize_t)sizeof(r) ? 0 : 1);
+    }
+    close(fd[1]);
+    ssize_t n = read(fd[0], out, sizeof(*out));
+    close(fd[0]);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return n == (ssize_t)sizeof(*out) && WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : -1;
+}
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr,
+            "usage: %s [--hours H] [--max N] [--ped-rate N] [--hold-pct P] [--plan NAME] [--seed S]\n"
+            "  --hours H     virtual hours per run (default 24)\n"
+            "  --max N       largest number of intersections, 1 - %d (default 64)\n"
+            "  --ped-rate N  mean presses per hour per intersection (default 30)\n"
+            "  --hold-pct P  percent of presses held 3 s (default 10)\n"
+            "  --plan NAME   pedestrian, actuated or four_way (default pedestrian)\n"
+            "  --seed S      random seed (default 1)\n",
+            argv0, MULTI_MAX);
+}
+
+static int parse_options(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (value == NULL)
+        {
+            usage(argv[0]);
+            return -1;
+        }
+        if (strcmp(arg, "--hours") == 0)
+        {
+            opt.hours = atof(value);
+        }
+        else if (strcmp(arg, "--max") == 0)
+        {
+            opt.max = (unsigned)atoi(value);
+        }
+        else if (strcmp(arg, "--ped-rate") == 0)
+        {
+            opt.ped_per_hour = atof(value);
+        }
+        else if (strcmp(arg, "--hold-pct") == 0)
+        {
+            opt.hold_pct = (unsigned)atoi(value);
+        }
+        else if (strcmp(arg, "--plan") == 0)
+        {
+            if (strcmp(value, "pedestrian") == 0)
+            {
+                opt.plan = &tlc_plan_pedestrian;
+            }
+            else if (strcmp(value, "actuated") == 0)
+            {
+                opt.plan = &tlc_plan_actuated;
+            }
+            else if (strcmp(value, "four_way") == 0)
+            {
+                opt.plan = &tlc_plan_four_way;
+            }
+            else
+            {
+                usage(argv[0]);
+                return -1;
+            }
+        }
+        else if (strcmp(arg, "--seed") == 0)
+        {
+            opt.seed = strtoull(value, NULL, 0);
+        }
+        else
+        {
+            usage(argv[0]);
+            return -1;
+        }
+        i++;
+    }
+    if (opt.hours <= 0.0 || opt.max < 1 || opt.max > MULTI_MAX || opt.ped_per_hour <= 0.0 || opt.hold_pct > 100)
+    {
+        usage(argv[0]);
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (parse_options(argc, argv) != 0)
+    {
+        return 2;
+    }
+    printf("tlc_multi: plan %s, %.1f h, %.0f presses/h per intersection, sizeof(tlc_controller_t) %zu B\n",
+           opt.plan->name, opt.hours, opt.ped_per_hour, sizeof(tlc_controller_t));
+    printf("%5s %9s %7s %11s %9s %9s %9s %9s %7s\n", "N", "RAM B", "B/N", "events", "ev/N/h", "cb/N/h",
+           "host ms", "ms/N", "dropped");
+    multi_result_t first = {0};
+    int failed = 0;
+    for (unsigned count = 1;; count = count * 2 < opt.max ? count * 2 : opt.max)
+    {
+        multi_result_t r;
+        if (run_isolated(count, &r) != 0 || r.events == 0)
+        {
+            fprintf(stderr, "tlc_multi: run with %u intersections failed\n", count);
+            failed = 1;
+            break;
+        }
+        if (count == 1)
+        {
+            first = r;
+        }
+        /* Per intersection past the first, so the shared ADC tick and task drop out */
+        double extra = count > 1 ? count - 1 : 1;
+        double base_events = count > 1 ? first.events : 0;
+        double base_callbacks = count > 1 ? first.timer_callbacks : 0;
+        double base_ms = count > 1 ? first.host_s * 1e3 : 0;
+        printf("%5u %9u %7u %11llu %9.1f %9.1f %9.1f %9.2f %7u\n", count, (unsigned)r.ram,
+               (unsigned)(count > 1 ? (r.ram - first.ram) / (count - 1) : r.ram), (unsigned long long)r.events,
+               (r.events - base_events) / extra / opt.hours, (r.timer_callbacks - base_callbacks) / extra / opt.hours,
+               r.host_s * 1e3, (r.host_s * 1e3 - base_ms) / extra, (unsigned)r.dropped);
+        if (count == opt.max)
+        {
+            break;
+        }
+    }
+    printf("Columns /N are per intersection past the first, constant columns mean linear cost\n");
+    return failed;
+}
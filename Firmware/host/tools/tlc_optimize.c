@@ -0,0 +1,790 @@
+/**
+ * @file tlc_optimize.c
+ * @brief Parallel timing plan optimizer
+ * @author Jorge Minjares (https://github.com/JorgeMinjares)
+ * @brief Sweeps the tunable times of tlc_timing.h over a grid, then searches
+ *        around the best timings at a finer step. Every timing runs the
+ *        firmware against the same set of demand profiles, and the tool
+ *        reports the Pareto front of vehicle delay against pedestrian wait.
+ *        --emit writes the recommended timing as a new tlc_timing.h.
+ * @brief The simulator keeps global state, so each simulation runs in a
+ *        process of its own. A pool of one worker process per core takes
+ *        the next simulation as soon as one finishes, and results come back
+ *        through shared memory.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include "sim.h"
+#include "tlc_config.h"
+#include "tlc_phase.h"
+#include "tlc_timing.h"
+#include "driver/adc.h"
+
+#define APPROACHES 2        /*!< Approaches modelled */
+#define QUEUE_MAX 4096      /*!< Vehicles one approach can queue */
+#define PED_PENDING_MAX 64  /*!< Presses waiting for a walk */
+#define PROFILES_MAX 32     /*!< Demand profiles */
+#define CANDIDATES_MAX 4096 /*!< Timings evaluated in one search */
+#define GREEN 0             /*!< GREEN row of the tuned plans */
+#define WALK 2              /*!< RED and WALK row of the tuned plans */
+
+void app_main(void);
+extern const tlc_plan_t *timing_plan;
+
+/**
+ * @brief Tunable times, the fields of tlc_timing.h
+ */
+typedef struct
+{
+    uint32_t green_min_ms; /*!< Shortest GREEN */
+    uint32_t call_ms;      /*!< GREEN still served after a press */
+    uint32_t walk_ms;      /*!< WALK, pedestrian plan */
+    uint32_t green_max_ms; /*!< Longest GREEN after a press, actuated plan */
+    uint32_t passage_ms;   /*!< GREEN per queued car, actuated plan */
+} timing_t;
+
+/**
+ * @brief Range and search step of one tunable time
+ */
+typedef struct
+{
+    const char *name;       /*!< Column name */
+    size_t offset;          /*!< Field in timing_t */
+    uint32_t grid[4];       /*!< Sweep values, 0 terminated */
+    uint32_t min_ms;        /*!< Smallest value searched */
+    uint32_t max_ms;        /*!< Largest value searched */
+    uint32_t step_ms;       /*!< First search step, halved every round */
+} parameter_t;
+
+/**
+ * @brief Constant demand of one simulation
+ */
+typedef struct
+{
+    double veh_per_hour; /*!< Vehicles per hour per approach */
+    double ped_per_hour; /*!< Pedestrian presses per hour */
+    uint64_t seed;       /*!< Arrival stream, shared by every timing */
+} profile_t;
+
+/**
+ * @brief Outcome of one simulation, written by the worker
+ */
+typedef struct
+{
+    double delay_sum_s;   /*!< Stopped delay of every vehicle, still queued ones to the end */
+    uint64_t vehicles;    /*!< Vehicles arrived */
+    double wait_sum_s;    /*!< Press to walk time, still waiting ones to the end */
+    uint64_t presses;     /*!< Presses */
+    bool done;            /*!< Simulation finished */
+} sim_result_t;
+
+/**
+ * @brief One timing and its score over every profile
+ */
+typedef struct
+{
+    timing_t timing; /*!< Times simulated */
+    double delay_s;  /*!< Mean vehicle delay over the profiles */
+    double wait_s;   /*!< Mean pedestrian wait over the profiles */
+    bool pareto;     /*!< Not dominated by another timing */
+} candidate_t;
+
+/**
+ * @brief Optimizer options
+ */
+typedef struct
+{
+    const tlc_plan_t *plan; /*!< Plan tuned */
+    double hours;           /*!< Virtual hours per simulation */
+    unsigned profiles;      /*!< Demand profiles */
+    unsigned rounds;        /*!< Search rounds after the sweep */
+    unsigned workers;       /*!< Worker processes */
+    double headway_s;       /*!< Saturation headway on green */
+    const char *emit;       /*!< Path of the tlc_timing.h to write, NULL for none */
+    uint64_t seed;          /*!< Seed of the demand profiles */
+} optimize_options_t;
+
+/**
+ * @brief Vehicle queue of one approach
+ */
+typedef struct
+{
+    int64_t arrival[QUEUE_MAX]; /*!< Arrival times, oldest first */
+    uint32_t head;              /*!< Oldest vehicle */
+    uint32_t count;             /*!< Vehicles queued */
+    int green_pin;              /*!< Green LED of the approach */
+    bool discharging;           /*!< A departure is scheduled */
+    uint32_t gen;               /*!< Invalidates departures scheduled before a red */
+} approach_t;
+
+#define FIELD(name) offsetof(timing_t, name)
+
+static const parameter_t pedestrian_parameters[] = {
+    {"green", FIELD(green_min_ms), {3000, 8000, 15000, 25000}, 1000, 60000, 2000},
+    {"call", FIELD(call_ms), {1000, 3000, 6000}, 500, 15000, 1000},
+    {"walk", FIELD(walk_ms), {2000, 4000, 7000}, 2000, 15000, 1000},
+};
+
+static const parameter_t actuated_parameters[] = {
+    {"green", FIELD(green_min_ms), {3000, 10000}, 1000, 60000, 2000},
+    {"max", FIELD(green_max_ms), {20000, 30000, 45000}, 10000, 90000, 5000},
+    {"call", FIELD(call_ms), {1000, 2000, 4000}, 500, 15000, 1000},
+    {"passage", FIELD(passage_ms), {500, 1000, 2000}, 100, 4000, 250},
+};
+
+static const int buttons[] = {BUTTON_0, BUTTON_1, BUTTON_2, BUTTON_3};
+static optimize_options_t opt = {.plan = &tlc_plan_pedestrian, .hours = 1.0, .profiles = 4, .rounds = 2,
+                                 .headway_s = 2.0, .seed = 1};
+static const parameter_t *parameters;
+static size_t parameter_count;
+static profile_t profiles[PROFILES_MAX];
+static candidate_t candidates[CANDIDATES_MAX];
+static size_t candidate_count;
+static size_t simulations;
+
+/* Simulation state, one copy per worker process */
+static const profile_t *profile;
+static sim_result_t result;
+static approach_t approach[APPROACHES];
+static int64_t ped_pending[PED_PENDING_MAX];
+static uint32_t ped_pending_count;
+static int64_t walk_fall;
+static uint64_t rng_state;
+
+static uint64_t rng_next(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static double rng_uniform(void)
+{
+    return (double)(rng_next() >> 11) / 9007199254740992.0;
+}
+
+static int64_t rng_exponential(double mean_us)
+{
+    double u = rng_uniform();
+    return (int64_t)(-mean_us * __builtin_log(1.0 - u)) + 1;
+}
+
+static uint32_t *timing_field(timing_t *timing, const parameter_t *parameter)
+{
+    return (uint32_t *)((char *)timing + parameter->offset);
+}
+
+/* Timing compiled into the firmware, the starting point of the search */
+static timing_t timing_current(const tlc_plan_t *plan)
+{
+    return (timing_t){
+        .green_min_ms = plan->phases[GREEN].min_ms,
+        .call_ms = plan->phases[GREEN].call_ms,
+        .walk_ms = plan->phases[WALK].min_ms,
+        .green_max_ms = plan->phases[GREEN].max_ms,
+        .passage_ms = plan->phases[GREEN].passage_ms,
+    };
+}
+
+/*
+ * Simulation, runs in a worker process
+ */
+
+static bool is_green(const approach_t *a)
+{
+    return sim_gpio_output(a->green_pin) != 0;
+}
+
+/* Queue length drives the density input, the way a loop detector would */
+static void update_density(void)
+{
+    uint32_t cars = 0;
+    for (int i = 0; i < APPROACHES; i++)
+    {
+        cars += approach[i].count;
+    }
+    cars = cars > MAX_CARS ? MAX_CARS : cars;
+    int raw = (int)((cars * MAX_ADC_VAL + MAX_CARS - 1) / MAX_CARS);
+    sim_adc_set(ADC1_CHANNEL_6, raw > 4095 ? 4095 : raw);
+}
+
+static void depart(void *arg)
+{
+    intptr_t packed = (intptr_t)arg;
+    approach_t *a = &approach[packed & 0xff];
+    if ((uint32_t)(packed >> 8) != a->gen)
+    {
+        return;
+    }
+    if (!is_green(a) || a->count == 0)
+    {
+        a->discharging = false;
+        return;
+    }
+    result.delay_sum_s += (double)(sim_now() - a->arrival[a->head]) / SIM_SECOND;
+    a->head = (a->head + 1) % QUEUE_MAX;
+    a->count--;
+    update_density();
+    sim_schedule(sim_now() + (int64_t)(opt.headway_s * SIM_SECOND), depart, arg);
+}
+
+static void start_discharge(int index)
+{
+    approach_t *a = &approach[index];
+    if (!a->discharging && a->count > 0)
+    {
+        a->discharging = true;
+        sim_schedule(sim_now() + (int64_t)(opt.headway_s * SIM_SECOND), depart,
+                     (void *)(intptr_t)(index | ((intptr_t)a->gen << 8)));
+    }
+}
+
+static void arrive(void *arg)
+{
+    int index = (int)(intptr_t)arg;
+    approach_t *a = &approach[index];
+    result.vehicles++;
+    if (!(is_green(a) && a->count == 0) && a->count < QUEUE_MAX)
+    {
+        a->arrival[(a->head + a->count) % QUEUE_MAX] = sim_now();
+        a->count++;
+        update_density();
+    }
+    sim_schedule(sim_now() + rng_exponential(SIM_HOUR / profile->veh_per_hour), arrive, arg);
+}
+
+static void pedestrian_release(void *arg)
+{
+    sim_gpio_input((int)(intptr_t)arg, LOW);
+}
+
+static void pedestrian_press(void *arg)
+{
+    (void)arg;
+    int pin = buttons[rng_next() % 4];
+    sim_gpio_input(pin, HIGH);
+    sim_schedule(sim_now() + 300000, pedestrian_release, (void *)(intptr_t)pin);
+    result.presses++;
+    /* A press during a steady walk is served at once */
+    if (!(sim_gpio_output(WALK_0) && sim_now() - walk_fall > SIM_SECOND) && ped_pending_count < PED_PENDING_MAX)
+    {
+        ped_pending[ped_pending_count++] = sim_now();
+    }
+    /* Never overlap presses: both directions pressed together halts the lights */
+    sim_schedule(sim_now() + 300000 + rng_exponential(SIM_HOUR / profile->ped_per_hour), pedestrian_press, NULL);
+}
+
+static void observe_gpio(int pin, int level, int64_t now)
+{
+    if (pin == WALK_0 && !level)
+    {
+        walk_fall = now;
+        return;
+    }
+    /* A walk starts after a dark signal, not on a warning blink */
+    if (pin == WALK_0 && level && now - walk_fall > SIM_SECOND)
+    {
+        for (uint32_t i = 0; i < ped_pending_count; i++)
+        {
+            result.wait_sum_s += (double)(now - ped_pending[i]) / SIM_SECOND;
+        }
+        ped_pending_count = 0;
+        return;
+    }
+    for (int i = 0; i < APPROACHES; i++)
+    {
+        approach_t *a = &approach[i];
+        if (pin == a->green_pin)
+        {
+            a->gen++;
+            a->discharging = false;
+            if (level)
+            {
+                start_discharge(i);
+            }
+        }
+    }
+}
+
+static void simulate(const timing_t *timing, const profile_t *demand)
+{
+    /* The tuned plan is the base plan with the timing patched in */
+    static tlc_phase_t phases[TLC_PLAN_MAX_PHASES];
+    static tlc_plan_t plan;
+    plan = *opt.plan;
+    memcpy(phases, plan.phases, plan.count * sizeof(phases[0]));
+    phases[GREEN].min_ms = timing->green_min_ms;
+    phases[GREEN].call_ms = timing->call_ms;
+    phases[WALK].min_ms = timing->walk_ms;
+    phases[GREEN].max_ms = timing->green_max_ms;
+    phases[GREEN].passage_ms = timing->passage_ms;
+    plan.phases = phases;
+    timing_plan = &plan;
+
+    profile = demand;
+    rng_state = demand->seed;
+    approach[0].green_pin = LED_0;
+    approach[1].green_pin = LED_3;
+    sim_gpio_set_hook(observe_gpio);
+    update_density();
+    app_main();
+    for (int i = 0; i < APPROACHES; i++)
+    {
+        sim_schedule(rng_exponential(SIM_HOUR / demand->veh_per_hour), arrive, (void *)(intptr_t)i);
+    }
+    sim_schedule(rng_exponential(SIM_HOUR / demand->ped_per_hour), pedestrian_press, NULL);
+    int64_t end = (int64_t)(opt.hours * SIM_HOUR);
+    sim_run_until(end);
+    /* Whoever is still waiting counts, so starving one side does not pay */
+    for (int i = 0; i < APPROACHES; i++)
+    {
+        for (uint32_t j = 0; j < approach[i].count; j++)
+        {
+            result.delay_sum_s += (double)(end - approach[i].arrival[(approach[i].head + j) % QUEUE_MAX]) / SIM_SECOND;
+        }
+    }
+    for (uint32_t i = 0; i < ped_pending_count; i++)
+    {
+        result.wait_sum_s += (double)(end - ped_pending[i]) / SIM_SECOND;
+    }
+    result.done = true;
+}
+
+/*
+ * Worker pool
+ */
+
+/* Run every timing against every profile, keeping one simulation per worker */
+static int evaluate(size_t first, size_t count)
+{
+    size_t jobs = count * opt.profiles;
+    sim_result_t *results = mmap(NULL, jobs * sizeof(*results), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS,
+                                 -1, 0);
+    if (results == MAP_FAILED)
+    {
+        return -1;
+    }
+    memset(results, 0, jobs * sizeof(*results));
+    fflush(stdout);
+    size_t next = 0;
+    unsigned running = 0;
+    while (next < jobs || running)
+    {
+        if (next < jobs && running < opt.workers)
+        {
+            pid_t pid = fork();
+            if (pid == 0)
+            {
+                simulate(&candidates[first + next / opt.profiles].timing, &profiles[next % opt.profiles]);
+                results[next] = result;
+                _exit(0);
+            }
+            if (pid > 0)
+            {
+                next++;
+                running++;
+                continue;
+            }
+            if (running == 0)
+            {
+                break;
+            }
+        }
+        int status;
+        if (wait(&status) > 0)
+        {
+            running--;
+        }
+    }
+    int err = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        candidate_t *c = &candidates[first + i];
+        double delay = 0, wait = 0;
+        for (unsigned p = 0; p < opt.profiles; p++)
+        {
+            const sim_result_t *r = &results[i * opt.profiles + p];
+            err |= !r->done;
+            delay += r->vehicles ? r->delay_sum_s / r->vehicles : 0.0;
+            wait += r->presses ? r->wait_sum_s / r->presses : 0.0;
+        }
+        c->delay_s = delay / opt.profiles;
+        c->wait_s = wait / opt.profiles;
+    }
+    simulations += jobs;
+    munmap(results, jobs * sizeof(*results));
+    return err ? -1 : 0;
+}
+
+/*
+ * Search
+ */
+
+static bool timing_equal(const timing_t *a, const timing_t *b)
+{
+    return memcmp(a, b, sizeof(*a)) == 0;
+}
+
+/* Queue a timing unless it was already evaluated or breaks the plan rules */
+static void candidate_add(const timing_t *timing)
+{
+    for (size_t i = 0; i < candidate_count; i++)
+    {
+        if (timing_equal(&candidates[i].timing, timing))
+        {
+            return;
+        }
+    }
+    if (opt.plan == &tlc_plan_actuated && timing->green_max_ms < timing->green_min_ms)
+    {
+        return;
+    }
+    if (candidate_count < CANDIDATES_MAX)
+    {
+        candidates[candidate_count++] = (candidate_t){.timing = *timing};
+    }
+}
+
+static void sweep(size_t parameter, timing_t *timing)
+{
+    if (parameter == parameter_count)
+    {
+        candidate_add(timing);
+        return;
+    }
+    for (int i = 0; i < 4 && parameters[parameter].grid[i]; i++)
+    {
+        *timing_field(timing, &parameters[parameter]) = parameters[parameter].grid[i];
+        sweep(parameter + 1, timing);
+    }
+}
+
+static void pareto_update(void)
+{
+    for (size_t i = 0; i < candidate_count; i++)
+    {
+        candidate_t *a = &candidates[i];
+        a->pareto = true;
+        for (size_t j = 0; j < candidate_count && a->pareto; j++)
+        {
+            const candidate_t *b = &candidates[j];
+            if (b->delay_s <= a->delay_s && b->wait_s <= a->wait_s && (b->delay_s < a->delay_s || b->wait_s < a->wait_s))
+            {
+                a->pareto = false;
+            }
+        }
+    }
+}
+
+/* Step every time of every front timing up and down, then evaluate the new ones */
+static int refine(unsigned round)
+{
+    size_t first = candidate_count;
+    size_t front = candidate_count;
+    for (size_t i = 0; i < front; i++)
+    {
+        if (!candidates[i].pareto)
+        {
+            continue;
+        }
+        for (size_t p = 0; p < parameter_count; p++)
+        {
+            const parameter_t *parameter = &parameters[p];
+            uint32_t step = parameter->step_ms >> round;
+            step = step ? step : 1;
+            for (int sign = -1; sign <= 1; sign += 2)
+            {
+                timing_t timing = candidates[i].timing;
+                uint32_t *field = timing_field(&timing, parameter);
+                int64_t value = (int64_t)*field + sign * (int64_t)step;
+                if (value >= parameter->min_ms && value <= parameter->max_ms)
+                {
+                    *field = (uint32_t)value;
+                    candidate_add(&timing);
+                }
+            }
+        }
+    }
+    return candidate_count > first ? evaluate(first, candidate_count - first) : 0;
+}
+
+static int candidate_order(const void *a, const void *b)
+{
+    const candidate_t *x = a, *y = b;
+    return x->delay_s < y->delay_s ? -1 : x->delay_s > y->delay_s ? 1 : (x->wait_s > y->wait_s) - (x->wait_s < y->wait_s);
+}
+
+/*
+ * Output
+ */
+
+/* Write a group of defines with their comments aligned, the way the header is laid out */
+static void emit_defines(FILE *file, const char *const *names, const uint32_t *values, const char *const *comments,
+                         size_t count)
+{
+    int width = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        int length = snprintf(NULL, 0, "#define %s %u", names[i], (unsigned)values[i]);
+        width = length > width ? length : width;
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        int length = fprintf(file, "#define %s %u", names[i], (unsigned)values[i]);
+        fprintf(file, "%*s /*!< %s */\n", width - length, "", comments[i]);
+    }
+}
+
+static int emit(const char *path, const timing_t *timing)
+{
+    /* The plan not tuned keeps the times compiled in */
+    timing_t ped = timing_current(&tlc_plan_pedestrian);
+    timing_t act = timing_current(&tlc_plan_actuated);
+    *(opt.plan == &tlc_plan_actuated ? &act : &ped) = *timing;
+    static const char *const ped_names[] = {"PED_GREEN_MIN_MS", "PED_CALL_MS", "PED_WALK_MS"};
+    static const char *const ped_comments[] = {"Shortest GREEN", "GREEN still served after a press",
+                                               "WALK, before any accessible extension"};
+    static const char *const act_names[] = {"ACT_GREEN_MIN_MS", "ACT_GREEN_MAX_MS", "ACT_CALL_MS", "ACT_PASSAGE_MS"};
+    static const char *const act_comments[] = {"Shortest GREEN", "Longest GREEN after a press",
+                                               "GREEN still served after a press, before the per car time",
+                                               "GREEN added per queued car after a press"};
+    const uint32_t ped_values[] = {ped.green_min_ms, ped.call_ms, ped.walk_ms};
+    const uint32_t act_values[] = {act.green_min_ms, act.green_max_ms, act.call_ms, act.passage_ms};
+    FILE *file = fopen(path, "w");
+    if (file == NULL)
+    {
+        perror(path);
+        return -1;
+    }
+    fputs("/**\n"
+          " * @file tlc_timing.h\n"
+          " * @brief Tunable times of the pedestrian and actuated plans\n"
+          " * @author Jorge Minjares (https://github.com/JorgeMinjares)\n"
+          " * @brief tlc_optimize --emit rewrites this file with the timing it picked.\n"
+          " *        Yellow and flashing don't walk are clearance times and stay fixed\n"
+          " *        in tlc_plan.c.\n"
+          " * @version 0.1\n"
+          " * @date 2026-10-17\n"
+          " *\n"
+          " * @copyright Copyright (c) 2022\n"
+          " *\n"
+          " */\n"
+          "#ifndef TLC_TIMING_H\n"
+          "#define TLC_TIMING_H\n"
+          "\n"
+          "/* Pedestrian plan, see tlc_plan_pedestrian */\n",
+          file);
+    emit_defines(file, ped_names, ped_values, ped_comments, 3);
+    fputs("\n/* Actuated plan, see tlc_plan_actuated */\n", file);
+    emit_defines(file, act_names, act_values, act_comments, 4);
+    fputs("\n#endif\n", file);
+    return fclose(file) == 0 ? 0 : -1;
+}
+
+static void print_candidate(const candidate_t *c, const char *mark)
+{
+    printf("  %-2s", mark);
+    for (size_t p = 0; p < parameter_count; p++)
+    {
+        printf(" %7.1f", *timing_field((timing_t *)&c->timing, &parameters[p]) / 1000.0);
+    }
+    printf(" %9.2f %9.2f\n", c->delay_s, c->wait_s);
+}
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr,
+            "usage: %s [--plan NAME] [--hours H] [--profiles N] [--rounds N] [--jobs N] [--headway S]\n"
+            "          [--seed S] [--emit FILE]\n"
+            "  --plan NAME   pedestrian or actuated (default pedestrian)\n"
+            "  --hours H     virtual hours per simulation (default 1)\n"
+            "  --profiles N  demand profiles every timing runs against (default 4, at most %d)\n"
+            "  --rounds N    search rounds after the grid sweep (default 2)\n"
+            "  --jobs N      worker processes (default one per core)\n"
+            "  --headway S   saturation headway on green in seconds (default 2)\n"
+            "  --seed S      seed of the demand profiles (default 1)\n"
+            "  --emit FILE   write the recommended timing as tlc_timing.h\n",
+            argv0, PROFILES_MAX);
+}
+
+static int parse_options(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (value == NULL)
+        {
+            usage(argv[0]);
+            return -1;
+        }
+        if (strcmp(arg, "--plan") == 0)
+        {
+            if (strcmp(value, "pedestrian") == 0)
+            {
+                opt.plan = &tlc_plan_pedestrian;
+            }
+            else if (strcmp(value, "actuated") == 0)
+            {
+                opt.plan = &tlc_plan_actuated;
+            }
+            else
+            {
+                usage(argv[0]);
+                return -1;
+            }
+        }
+        else if (strcmp(arg, "--hours") == 0)
+        {
+            opt.hours = atof(value);
+        }
+        else if (strcmp(arg, "--profiles") == 0)
+        {
+            opt.profiles = (unsigned)atoi(value);
+        }
+        else if (strcmp(arg, "--rounds") == 0)
+        {
+            opt.rounds = (unsigned)atoi(value);
+        }
+        else if (strcmp(arg, "--jobs") == 0)
+        {
+            opt.workers = (unsigned)atoi(value);
+        }
+        else if (strcmp(arg, "--headway") == 0)
+        {
+            opt.headway_s = atof(value);
+        }
+        else if (strcmp(arg, "--seed") == 0)
+        {
+            opt.seed = strtoull(value, NULL, 0);
+        }
+        else if (strcmp(arg, "--emit") == 0)
+        {
+            opt.emit = value;
+        }
+        else
+        {
+            usage(argv[0]);
+            return -1;
+        }
+        i++;
+    }
+    if (opt.hours <= 0 || opt.profiles == 0 || opt.profiles > PROFILES_MAX || opt.headway_s <= 0)
+    {
+        usage(argv[0]);
+        return -1;
+    }
+    if (opt.workers == 0)
+    {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        opt.workers = cores > 0 ? (unsigned)cores : 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (parse_options(argc, argv) != 0)
+    {
+        return 2;
+    }
+    bool actuated = opt.plan == &tlc_plan_actuated;
+    parameters = actuated ? actuated_parameters : pedestrian_parameters;
+    parameter_count = actuated ? sizeof(actuated_parameters) / sizeof(actuated_parameters[0])
+                               : sizeof(pedestrian_parameters) / sizeof(pedestrian_parameters[0]);
+
+    /* Light to heavy demand, the same arrivals for every timing */
+    rng_state = opt.seed ? opt.seed : 1;
+    for (unsigned i = 0; i < opt.profiles; i++)
+    {
+        profiles[i].veh_per_hour = 200.0 + 1000.0 * rng_uniform();
+        profiles[i].ped_per_hour = 20.0 + 160.0 * rng_uniform();
+        profiles[i].seed = rng_next() | 1;
+    }
+
+    struct timespec start, stop;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    const timing_t current = timing_current(opt.plan);
+    candidate_add(&current);
+    timing_t timing = current;
+    sweep(0, &timing);
+    int err = evaluate(0, candidate_count);
+    pareto_update();
+    for (unsigned round = 0; round < opt.rounds && err == 0; round++)
+    {
+        err = refine(round);
+        pareto_update();
+    }
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    if (err != 0)
+    {
+        fprintf(stderr, "simulation run failed\n");
+        return 1;
+    }
+    double elapsed = (double)(stop.tv_sec - start.tv_sec) + (stop.tv_nsec - start.tv_nsec) / 1e9;
+    const candidate_t base = candidates[0];
+
+    printf("tlc_optimize: %s plan, %u profiles x %.1f h, %u search rounds, %u workers\n", opt.plan->name,
+           opt.profiles, opt.hours, opt.rounds, opt.workers);
+    for (unsigned i = 0; i < opt.profiles; i++)
+    {
+        printf("  profile %u: %.0f veh/h per approach, %.0f presses/h\n", i, profiles[i].veh_per_hour,
+               profiles[i].ped_per_hour);
+    }
+    printf("  %zu timings, %zu simulations in %.1f s\n", candidate_count, simulations, elapsed);
+
+    /* Recommend the front timing with the largest combined gain over the current one */
+    qsort(candidates, candidate_count, sizeof(candidates[0]), candidate_order);
+    const candidate_t *best = NULL;
+    double best_score = 0;
+    for (size_t i = 0; i < candidate_count; i++)
+    {
+        const candidate_t *c = &candidates[i];
+        double score = c->delay_s / (base.delay_s > 0 ? base.delay_s : 1.0) + c->wait_s / (base.wait_s > 0 ? base.wait_s : 1.0);
+        if (c->pareto && (best == NULL || score < best_score))
+        {
+            best = c;
+            best_score = score;
+        }
+    }
+    printf("  Pareto front of vehicle delay against pedestrian wait, times in s, * recommended\n");
+    printf("    ");
+    for (size_t p = 0; p < parameter_count; p++)
+    {
+        printf(" %7s", parameters[p].name);
+    }
+    printf(" %9s %9s\n", "delay s", "ped s");
+    for (size_t i = 0; i < candidate_count; i++)
+    {
+        if (candidates[i].pareto)
+        {
+            print_candidate(&candidates[i], &candidates[i] == best ? "*" : "");
+        }
+    }
+    printf("  current:\n");
+    print_candidate(&base, base.pareto ? "" : "x");
+    printf("  recommended: delay %+.1f%%, pedestrian wait %+.1f%% against current\n",
+           base.delay_s > 0 ? 100.0 * (best->delay_s - base.delay_s) / base.delay_s : 0.0,
+           base.wait_s > 0 ? 100.0 * (best->wait_s - base.wait_s) / base.wait_s : 0.0);
+    if (opt.emit)
+    {
+        if (emit(opt.emit, &best->timing) != 0)
+        {
+            return 1;
+        }
+        printf("  wrote %s, copy it to main/tlc_timing.h and rebuild\n", opt.emit);
+    }
+    return 0;
+}
@@ -0,0 +1,547 @@
+/**
+ * @file tlc_race.c
+ * @brief Controller state snapshot and cross-core ring stress test
+ * @author Jorge Minjares (https://github.com/JorgeMinjares)
+ * @brief Runs the tlc_state seqlock on real threads: one writer publishing
+ *        as fast as it can, as the scheduler task does on its core, and
+ *        readers on the other threads, as timer callbacks and the other
+ *        core do. Every published tuple is derived from one counter, so a
+ *        reader can tell when the fields it got come from two publishes.
+ *        --plain copies the same tuple through a plain struct for
+ *        comparison. --controller makes the writer the firmware's scheduler
+ *        instead: it dispatches phase timer, button, density and preemption
+ *        events to a real intersection, which publishes through
+ *        tlc_controller_publish(), and the readers check what holds for
+ *        every real publish. --spsc instead pushes numbered items through a
+ *        tlc_spsc_t from one thread and pops them on another, checking
+ *        every item arrives whole, in order, or is counted in overflow.
+ *        Build with -DTLC_TSAN=ON to run under ThreadSanitizer.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "sim.h"
+#include "tlc_state.h"
+#include "tlc_spsc.h"
+#include "tlc_controller.h"
+#include "tlc_telemetry.h"
+
+#define MAX_READERS 16 /*!< Reader threads */
+#define SPSC_SLOTS 64  /*!< Ring size of the --spsc test */
+#define SPSC_WORDS 6   /*!< Words per --spsc item, the size of a tlc_event_t and then some */
+#define SEEN_SLOTS 1024 /*!< Transitions a --controller reader remembers */
+#define STEP_US 10000   /*!< Virtual time the --controller writer runs between dispatches */
+
+/**
+ * @brief Test options
+ */
+typedef struct
+{
+    double seconds;   /*!< Run time */
+    int readers;      /*!< Reader threads */
+    bool plain;       /*!< Copy through a plain struct instead of the seqlock */
+    bool spsc;        /*!< Test tlc_spsc_t instead of the seqlock */
+    bool controller;  /*!< Publish from a real intersection instead of synthetic tuples */
+} race_options_t;
+
+/**
+ * @brief Counters of one reader
+ */
+typedef struct
+{
+    pthread_t thread;   /*!< Reader thread */
+    uint64_t reads;     /*!< Snapshots read */
+    uint64_t retries;   /*!< Seqlock retries */
+    uint64_t torn;      /*!< Snapshots mixing two publishes */
+    uint64_t stale;     /*!< Snapshots older than the previous one read */
+} reader_t;
+
+/**
+ * @brief Phase a --controller reader saw for one transition count
+ */
+typedef struct
+{
+    uint32_t transitions;     /*!< Transition count, the slot is empty while the plan is NULL */
+    const tlc_plan_t *plan;   /*!< Plan */
+    int64_t started;          /*!< Phase start */
+    uint8_t index;            /*!< Phase */
+} seen_t;
+
+static race_options_t opt = {.seconds = 2.0, .readers = 3};
+static tlc_state_cell_t cell;
+static volatile tlc_state_t plain;
+static int stop = 0;
+static uint64_t published = 0;
+
+/**
+ * @brief Counters of the --spsc test
+ */
+typedef struct
+{
+    uint64_t attempts;   /*!< Pushes tried */
+    uint64_t popped;     /*!< Items taken */
+    uint64_t torn;       /*!< Items whose words disagree */
+    uint64_t reordered;  /*!< Items not numbered above the one before */
+} spsc_counts_t;
+
+static tlc_spsc_t ring;
+static uint32_t ring_slots[SPSC_SLOTS][SPSC_WORDS];
+static spsc_counts_t spsc;
+
+/* Tuple number k, every field a function of k */
+static void make_state(uint32_t k, tlc_state_t *state)
+{
+    static const tlc_plan_t *const plans[] = {&tlc_plan_pedestrian, &tlc_plan_actuated, &tlc_plan_coordinated};
+    *state = (tlc_state_t){
+        .plan = plans[k % 3],
+        .started = (int64_t)k * 1000,
+        .deadline = (int64_t)k * 1000 + (k % 7 + 1) * 1000,
+        .transitions = k,
+        .density = (uint16_t)(k * 7),
+        .index = (uint8_t)(k % TLC_PLAN_MAX_PHASES),
+        .flags = (uint8_t)(k & 0x0f),
+    };
+}
+
+static bool same_state(const tlc_state_t *a, const tlc_state_t *b)
+{
+    return a->plan == b->plan && a->started == b->started && a->deadline == b->deadline &&
+           a->transitions == b->transitions && a->density == b->density && a->index == b->index &&
+           a->flags == b->flags;
+}
+
+static void *writer(void *arg)
+{
+    (void)arg;
+    tlc_state_t state;
+    uint32_t k = 0;
+    while (!__atomic_load_n(&stop, __ATOMIC_RELAXED))
+    {
+        make_state(++k, &state);
+        if (opt.plain)
+        {
+            plain.plan = state.plan;
+            plain.started = state.started;
+            plain.deadline = state.deadline;
+            plain.transitions = state.transitions;
+            plain.density = state.density;
+            plain.index = state.index;
+            plain.flags = state.flags;
+        }
+        else
+        {
+            tlc_state_publish(&cell, &state);
+        }
+    }
+    published = k;
+    return NULL;
+}
+
+static void *reader(void *arg)
+{
+    reader_t *r = arg;
+    tlc_state_t got;
+    tlc_state_t want;
+    uint32_t last = 0;
+    while (!__atomic_load_n(&stop, __ATOMIC_RELAXED))
+    {
+        if (opt.plain)
+        {
+            got.plan = plain.plan;
+            got.started = plain.started;
+            got.deadline = plain.deadline;
+            got.transitions = plain.transitions;
+            got.density = plain.density;
+            got.index = plain.index;
+            got.flags = plain.flags;
+        }
+        else
+        {
+            r->retries += tlc_state_read(&cell, &got);
+        }
+        r->reads++;
+        if (got.transitions == 0 && got.plan == NULL)
+        {
+            continue;
+        }
+        make_state(got.transitions, &want);
+        r->torn += !same_state(&got, &want);
+        r->stale += got.transitions < last;
+        last = got.transitions;
+    }
+    return NULL;
+}
+
+/* ------------------------------------------------------------------ */
+/* --controller                                                       */
+/* ------------------------------------------------------------------ */
+
+static tlc_scheduler_t scheduler;
+static tlc_controller_t controllers[1];
+static tlc_t approaches[2];
+static uint64_t virtual_us = 0;
+static uint32_t rng_state = 1;
+
+static uint32_t rng_next(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+/* Telemetry is framed as on the board, then discarded */
+static void discard(const uint8_t *data, size_t size)
+{
+    (void)data;
+    (void)size;
+}
+
+static void release(void *arg)
+{
+    tlc_button_inject(&controllers[0].buttons, (uint8_t)(intptr_t)arg, 0);
+}
+
+/* A press every 1 - 4 s, held past TLC_BUTTON_HOLD_US one time in ten, never two at once */
+static void press(void *arg)
+{
+    (void)arg;
+    uint8_t button = (uint8_t)(rng_next() % 4);
+    int64_t length = rng_next() % 10 == 0 ? TLC_BUTTON_HOLD_US + 500000 : 150000;
+    tlc_button_inject(&controllers[0].buttons, button, 1);
+    sim_schedule(sim_now() + length, release, (void *)(intptr_t)button);
+    sim_schedule(sim_now() + length + 1000000 + rng_next() % 3000000, press, NULL);
+}
+
+static void dispatch(tlc_event_type_t type, uint8_t level)
+{
+    tlc_event_t event = {.type = type, .level = level, .timestamp = esp_timer_get_time()};
+    tlc_scheduler_dispatch(&scheduler, &event);
+}
+
+/* The scheduler task's loop, stepped in virtual time on this thread */
+static void *controller_writer(void *arg)
+{
+    (void)arg;
+    bool preempt = false;
+    while (!__atomic_load_n(&stop, __ATOMIC_RELAXED))
+    {
+        sim_run_until(sim_now() + STEP_US);
+        tlc_event_t event;
+        while (xQueueReceive(scheduler.queue, &event, 0) == pdPASS)
+        {
+            tlc_scheduler_dispatch(&scheduler, &event);
+        }
+        if (scheduler.button_deadline >= 0 && sim_now() >= scheduler.button_deadline)
+        {
+            dispatch(TLC_EVENT_BUTTON_TIMER, 0);
+        }
+        /* A new density every step keeps the actuated phases retiming */
+        tlc_scheduler_density(&scheduler, sim_now(), (uint16_t)(rng_next() % (MAX_CARS + 1)));
+        /* Preempted for 20 s of every 5 minutes */
+        bool active = sim_now() % 300000000 < 20000000;
+        if (active != preempt)
+        {
+            preempt = active;
+            dispatch(TLC_EVENT_PREEMPT, active);
+        }
+    }
+    virtual_us = (uint64_t)sim_now();
+    return NULL;
+}
+
+/* Flags every snapshot no single publish of the controller could give */
+static void *controller_reader(void *arg)
+{
+    reader_t *r = arg;
+    static __thread seen_t seen[SEEN_SLOTS];
+    tlc_state_t last = {0};
+    tlc_state_t got;
+    while (!__atomic_load_n(&stop, __ATOMIC_RELAXED))
+    {
+        r->retries += tlc_state_read(&controllers[0].state, &got);
+        r->reads++;
+        if (got.plan == NULL)
+        {
+            continue;
+        }
+        const tlc_state_counters_t *c = &got.counters;
+        bool torn = (got.deadline != TLC_PHASE_NEVER && got.deadline < got.started) ||
+                    (got.index >= got.plan->count && got.index < TLC_PHASE_PREEMPT_CLEAR) ||
+                    got.index > TLC_PHASE_PREEMPT_DWELL || c->reactions > c->button_events ||
+                    c->latency_sum_us > (int64_t)c->latency_max_us * c->reactions;
+        /* Plan, phase and start only change together with the transition count */
+        seen_t *s = &seen[got.transitions % SEEN_SLOTS];
+        if (s->plan == NULL || s->transitions != got.transitions)
+        {
+            *s = (seen_t){got.transitions, got.plan, got.started, got.index};
+        }
+        else
+        {
+            torn |= s->plan != got.plan || s->started != got.started || s->index != got.index;
+        }
+        r->torn += torn;
+        r->stale += got.transitions < last.transitions || got.started < last.started ||
+                    c->button_events < last.counters.button_events || c->reactions < last.counters.reactions ||
+                    c->button_wakeups < last.counters.button_wakeups;
+        last = got;
+    }
+    return NULL;
+}
+
+/* --controller */
+static int run_controller(const struct timespec *pause)
+{
+    tlc_telemetry_init(discard);
+    for (int d = 0; d < 2; d++)
+    {
+        approaches[d] = (tlc_t){
+            .direction = d ? DIRECTION_1 : DIRECTION_0,
+            .led = {GPIO_NUM_NC, GPIO_NUM_NC, GPIO_NUM_NC},
+            .button = {GPIO_NUM_NC, GPIO_NUM_NC},
+            .buzzer = GPIO_NUM_NC,
+            .walkingSignal = GPIO_NUM_NC,
+        };
+    }
+    if (tlc_scheduler_init(&scheduler, controllers, 1) != ESP_OK ||
+        tlc_controller_init(&scheduler, 0, approaches, 2, &tlc_plan_actuated) != ESP_OK)
+    {
+        fprintf(stderr, "tlc_race: controller init failed\n");
+        return 2;
+    }
+    sim_schedule(1000000, press, NULL);
+
+    static reader_t readers[MAX_READERS];
+    pthread_t write_thread;
+    pthread_create(&write_thread, NULL, controller_writer, NULL);
+    for (int i = 0; i < opt.readers; i++)
+    {
+        pthread_create(&readers[i].thread, NULL, controller_reader, &readers[i]);
+    }
+    nanosleep(pause, NULL);
+    __atomic_store_n(&stop, 1, __ATOMIC_RELAXED);
+    pthread_join(write_thread, NULL);
+
+    uint64_t reads = 0, retries = 0, torn = 0, stale = 0;
+    for (int i = 0; i < opt.readers; i++)
+    {
+        pthread_join(readers[i].thread, NULL);
+        reads += readers[i].reads;
+        retries += readers[i].retries;
+        torn += readers[i].torn;
+        stale += readers[i].stale;
+    }
+    tlc_state_t state;
+    tlc_state_read(&controllers[0].state, &state);
+    uint64_t publishes = controllers[0].state.seq / 2;
+    printf("tlc_race: tlc_controller_t, scheduler thread, %d readers, %.1f s\n", opt.readers, opt.seconds);
+    printf("  virtual time        : %.2f h, %u transitions, %u button events, %u reactions\n",
+           virtual_us / 3.6e9, (unsigned)state.transitions, (unsigned)state.counters.button_events,
+           (unsigned)state.counters.reactions);
+    printf("  events dispatched   : %u\n", (unsigned)scheduler.events);
+    printf("  publishes           : %llu (%.0f/s)\n", (unsigned long long)publishes, publishes / opt.seconds);
+    printf("  reads               : %llu (%.0f/s)\n", (unsigned long long)reads, reads / opt.seconds);
+    printf("  retries             : %llu (%.3f per read)\n", (unsigned long long)retries,
+           reads ? (double)retries / reads : 0.0);
+    printf("  torn reads          : %llu\n", (unsigned long long)torn);
+    printf("  out of order reads  : %llu\n", (unsigned long long)stale);
+    return torn || stale ? 1 : 0;
+}
+
+/* ------------------------------------------------------------------ */
+/* --spsc                                                             */
+/* ------------------------------------------------------------------ */
+
+/* Item k, every word a function of k */
+static void make_item(uint32_t k, uint32_t *item)
+{
+    for (uint32_t i = 0; i < SPSC_WORDS; i++)
+    {
+        item[i] = k * (2 * i + 1) ^ (0x9e3779b9u >> i);
+    }
+}
+
+static void *producer(void *arg)
+{
+    (void)arg;
+    uint32_t item[SPSC_WORDS];
+    uint32_t k = 0;
+    while (!__atomic_load_n(&stop, __ATOMIC_RELAXED))
+    {
+        make_item(++k, item);
+        tlc_spsc_push(&ring, item);
+    }
+    spsc.attempts = k;
+    return NULL;
+}
+
+/* Take every item waiting, returns false once the producer is done and the ring is empty */
+static bool consume(uint32_t *last)
+{
+    uint32_t got[SPSC_WORDS];
+    uint32_t want[SPSC_WORDS];
+    bool done = __atomic_load_n(&stop, __ATOMIC_ACQUIRE) == 2;
+    bool any = false;
+    while (tlc_spsc_pop(&ring, got))
+    {
+        /* Word 0 is k ^ 0x9e3779b9 */
+        uint32_t k = got[0] ^ 0x9e3779b9u;
+        make_item(k, want);
+        spsc.torn += memcmp(got, want, sizeof(got)) != 0;
+        spsc.reordered += k <= *last;
+        *last = k;
+        spsc.popped++;
+        any = true;
+    }
+    return !done || any;
+}
+
+static void *consumer(void *arg)
+{
+    (void)arg;
+    uint32_t last = 0;
+    while (consume(&last))
+    {
+    }
+    return NULL;
+}
+
+/* --spsc */
+static int run_spsc(const struct timespec *pause)
+{
+    tlc_spsc_init(&ring, ring_slots, SPSC_SLOTS, sizeof(ring_slots[0]));
+    pthread_t push_thread, pop_thread;
+    pthread_create(&pop_thread, NULL, consumer, NULL);
+    pthread_create(&push_thread, NULL, producer, NULL);
+    nanosleep(pause, NULL);
+    __atomic_store_n(&stop, 1, __ATOMIC_RELAXED);
+    pthread_join(push_thread, NULL);
+    /* The consumer drains what is left, then stops */
+    __atomic_store_n(&stop, 2, __ATOMIC_RELEASE);
+    pthread_join(pop_thread, NULL);
+
+    uint64_t overflow = tlc_spsc_overflow(&ring);
+    uint64_t missing = spsc.attempts - spsc.popped - overflow;
+    printf("tlc_race: tlc_spsc_t, 1 producer, 1 consumer, %u slots, %.1f s\n", (unsigned)SPSC_SLOTS, opt.seconds);
+    printf("  pushes tried        : %llu (%.0f/s)\n", (unsigned long long)spsc.attempts, spsc.attempts / opt.seconds);
+    printf("  items popped        : %llu\n", (unsigned long long)spsc.popped);
+    printf("  overflow            : %llu (%.3f per push)\n", (unsigned long long)overflow,
+           spsc.attempts ? (double)overflow / spsc.attempts : 0.0);
+    printf("  lost uncounted      : %lld\n", (long long)missing);
+    printf("  torn items          : %llu\n", (unsigned long long)spsc.torn);
+    printf("  out of order items  : %llu\n", (unsigned long long)spsc.reordered);
+    return spsc.torn || spsc.reordered || missing ? 1 : 0;
+}
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr,
+            "usage: %s [--seconds S] [--readers N] [--plain | --controller | --spsc]\n"
+            "  --seconds S  run time (default 2)\n"
+            "  --readers N  reader threads, 1 - %d (default 3)\n"
+            "  --plain      copy through a plain struct instead of the seqlock\n"
+            "  --controller publish from a real intersection driven by the scheduler's events\n"
+            "  --spsc       stress the cross-core tlc_spsc_t ring instead of the seqlock\n",
+            argv0, MAX_READERS);
+}
+
+static int parse_options(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(arg, "--plain") == 0)
+        {
+            opt.plain = true;
+        }
+        else if (strcmp(arg, "--spsc") == 0)
+        {
+            opt.spsc = true;
+        }
+        else if (strcmp(arg, "--controller") == 0)
+        {
+            opt.controller = true;
+        }
+        else if (value != NULL && strcmp(arg, "--seconds") == 0)
+        {
+            opt.seconds = atof(value);
+            i++;
+        }
+        else if (value != NULL && strcmp(arg, "--readers") == 0)
+        {
+            opt.readers = atoi(value);
+            i++;
+        }
+        else
+        {
+            usage(argv[0]);
+            return -1;
+        }
+    }
+    if (opt.seconds <= 0 || opt.readers < 1 || opt.readers > MAX_READERS ||
+        opt.plain + opt.spsc + opt.controller > 1)
+    {
+        usage(argv[0]);
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (parse_options(argc, argv) != 0)
+    {
+        return 2;
+    }
+    struct timespec pause = {
+        .tv_sec = (time_t)opt.seconds,
+        .tv_nsec = (long)((opt.seconds - (double)(time_t)opt.seconds) * 1e9),
+    };
+    if (opt.spsc)
+    {
+        return run_spsc(&pause);
+    }
+    if (opt.controller)
+    {
+        return run_controller(&pause);
+    }
+    static reader_t readers[MAX_READERS];
+    pthread_t write_thread;
+    pthread_create(&write_thread, NULL, writer, NULL);
+    for (int i = 0; i < opt.readers; i++)
+    {
+        pthread_create(&readers[i].thread, NULL, reader, &readers[i]);
+    }
+    nanosleep(&pause, NULL);
+    __atomic_store_n(&stop, 1, __ATOMIC_RELAXED);
+    pthread_join(write_thread, NULL);
+
+    uint64_t reads = 0, retries = 0, torn = 0, stale = 0;
+    for (int i = 0; i < opt.readers; i++)
+    {
+        pthread_join(readers[i].thread, NULL);
+        reads += readers[i].reads;
+        retries += readers[i].retries;
+        torn += readers[i].torn;
+        stale += readers[i].stale;
+    }
+    printf("tlc_race: %s, 1 writer, %d readers, %.1f s\n", opt.plain ? "plain struct" : "tlc_state seqlock",
+           opt.readers, opt.seconds);
+    printf("  publishes           : %llu (%.0f/s)\n", (unsigned long long)published, published / opt.seconds);
+    printf("  reads               : %llu (%.0f/s)\n", (unsigned long long)reads, reads / opt.seconds);
+    printf("  retries             : %llu (%.3f per read)\n", (unsigned long long)retries,
+           reads ? (double)retries / reads : 0.0);
+    printf("  torn reads          : %llu\n", (unsigned long long)torn);
+    printf("  out of order reads  : %llu\n", (unsigned long long)stale);
+    return torn ? 1 : 0;
+}
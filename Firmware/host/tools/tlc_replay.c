@@ -0,0 +1,545 @@
+/**
+ * @file tlc_replay.c
+ * @brief Replay of a recorder stream
+ * @author Jorge Minjares (https://github.com/JorgeMinjares)
+ * @brief Boots the unmodified firmware through app_main() with the plan of
+ *        a recording, feeds the recorded input edges, density values and
+ *        UART bytes back at their times and compares every light, walk and
+ *        tone change with the recorded ones. The ADC is left at 0, so the
+ *        only density the controller sees is the recorded one.
+ *
+ *        tlc_sim --capture run.bin && tlc_telemetry --quiet --record run.rec run.bin
+ *        tlc_replay run.rec
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <stdint.h>
+
+#include "sim.h"
+#include "tlc_config.h"
+#include "tlc_phase.h"
+#include "tlc_event.h"
+#include "tlc_record.h"
+#include "tlc_spsc.h"
+#include "tlc_controller.h"
+#include "driver/dac.h"
+
+void app_main(void);
+extern const tlc_plan_t *timing_plan;
+extern tlc_spsc_t io_events;
+extern tlc_scheduler_t scheduler;
+
+#define REPLAY_OUTPUTS (64 + DAC_CHANNEL_MAX) /*!< Output ids: pins 0 - 63, then the DAC channels */
+
+/**
+ * @brief Recorded input
+ */
+typedef struct
+{
+    int64_t at;          /*!< Time it is fed back */
+    tlc_event_t event;   /*!< Event pushed to the I/O events, type 0 for a button edge */
+    uint8_t pin;         /*!< Button edge pin */
+    uint8_t level;       /*!< Button edge level */
+} replay_input_t;
+
+/**
+ * @brief Output change
+ */
+typedef struct
+{
+    int64_t at;          /*!< Time of the change */
+    uint8_t level;       /*!< Level after it, 1 for a sounding tone */
+} replay_change_t;
+
+/**
+ * @brief Changes of one output
+ */
+typedef struct
+{
+    replay_change_t *changes;  /*!< In time order */
+    size_t count;              /*!< Changes */
+    size_t cap;                /*!< Capacity */
+} replay_output_t;
+
+static const tlc_plan_t *const plans[] = {&tlc_plan_pedestrian, &tlc_plan_actuated, &tlc_plan_four_way,
+                                          &tlc_plan_coordinated, &tlc_plan_staged};
+static replay_input_t *inputs;
+static size_t input_count;
+static size_t input_cap;
+static size_t input_next;
+static replay_output_t recorded[REPLAY_OUTPUTS];
+static replay_output_t replayed[REPLAY_OUTPUTS];
+
+static void *grow(void *items, size_t *cap, size_t count, size_t size)
+{
+    if (count < *cap)
+    {
+        return items;
+    }
+    *cap = *cap ? *cap * 2 : 256;
+    items = realloc(items, *cap * size);
+    if (items == NULL)
+    {
+        perror("realloc");
+        exit(1);
+    }
+    return items;
+}
+
+static void output_add(replay_output_t *out, int64_t at, uint8_t level)
+{
+    out->changes = grow(out->changes, &out->cap, out->count, sizeof(replay_change_t));
+    out->changes[out->count++] = (replay_change_t){.at = at, .level = level};
+}
+
+static bool get_varint(const uint8_t *buf, size_t size, size_t *pos, uint64_t *value)
+{
+    *value = 0;
+    for (int shift = 0; shift < 64 && *pos < size; shift += 7)
+    {
+        uint8_t b = buf[(*pos)++];
+        *value |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Recording contents
+ */
+typedef struct
+{
+    const tlc_plan_t *plan;  /*!< Plan named by BOOT */
+    int64_t boot_us;         /*!< Time of BOOT */
+    int64_t end_us;          /*!< Time of the last entry */
+    uint64_t entries;        /*!< Entries decoded */
+    uint64_t edges;          /*!< Button and preemption edges */
+    uint64_t density;        /*!< Density values */
+    uint64_t uart;           /*!< UART bytes */
+    uint64_t outputs;        /*!< Output changes, pins and tones */
+    uint64_t lost;           /*!< Entries the recorder dropped */
+    size_t cut;              /*!< Bytes of an entry cut short at the end */
+} replay_recording_t;
+
+/* Decode a recorder stream into inputs and recorded outputs, false if it cannot be replayed */
+static bool parse(const uint8_t *buf, size_t size, replay_recording_t *rec)
+{
+    size_t pos = 0;
+    int64_t now = 0;
+    while (pos < size)
+    {
+        size_t start = pos;
+        uint8_t type = buf[pos++];
+        uint64_t delta;
+        uint64_t a;
+        uint64_t b;
+        if (!get_varint(buf, size, &pos, &delta))
+        {
+            rec->cut = size - start;
+            break;
+        }
+        now += (int64_t)delta;
+        if (rec->entries == 0 && type != TLC_RECORD_BOOT)
+        {
+            fprintf(stderr, "tlc_replay: recording does not start with BOOT\n");
+            return false;
+        }
+        bool whole = true;
+        switch (type)
+        {
+        case TLC_RECORD_BOOT:
+        {
+            if (pos >= size || size - pos - 1 < buf[pos])
+            {
+                whole = false;
+                break;
+            }
+            uint8_t len = buf[pos];
+            for (size_t i = 0; i < sizeof(plans) / sizeof(plans[0]); i++)
+            {
+                if (strlen(plans[i]->name) == len && memcmp(plans[i]->name, &buf[pos + 1], len) == 0)
+                {
+                    rec->plan = plans[i];
+                }
+            }
+            if (rec->plan == NULL || rec->entries)
+            {
+                fprintf(stderr, "tlc_replay: %s plan %.*s\n", rec->entries ? "second boot with" : "unknown", len,
+                        (const char *)&buf[pos + 1]);
+                return false;
+            }
+            rec->boot_us = now;
+            pos += 1 + len;
+            break;
+        }
+        case TLC_RECORD_EDGE:
+            if (size - pos < 2)
+            {
+                whole = false;
+                break;
+            }
+            inputs = grow(inputs, &input_cap, input_count, sizeof(replay_input_t));
+            inputs[input_count++] = (replay_input_t){.at = now, .pin = buf[pos], .level = buf[pos + 1]};
+            rec->edges++;
+            pos += 2;
+            break;
+        case TLC_RECORD_EVENT:
+        {
+            if (pos >= size)
+            {
+                whole = false;
+                break;
+            }
+            uint8_t event = buf[pos++];
+            if (!get_varint(buf, size, &pos, &a) || !get_varint(buf, size, &pos, &b))
+            {
+                whole = false;
+                break;
+            }
+            int64_t stamp = (int64_t)(b >> 1) ^ -(int64_t)(b & 1);
+            /* When the controller took it, feed() has it taken again then */
+            replay_input_t input = {.at = now, .event = {.type = event, .timestamp = now + stamp}};
+            if (event == TLC_EVENT_DENSITY)
+            {
+                input.event.cars = (uint16_t)a;
+                rec->density++;
+            }
+            else
+            {
+                input.event.command = (uint8_t)a;
+                rec->uart++;
+            }
+            inputs = grow(inputs, &input_cap, input_count, sizeof(replay_input_t));
+            inputs[input_count++] = input;
+            break;
+        }
+        case TLC_RECORD_OUTPUT:
+            if (!get_varint(buf, size, &pos, &a) || !get_varint(buf, size, &pos, &b))
+            {
+                whole = false;
+                break;
+            }
+            for (int pin = 0; pin < 64; pin++)
+            {
+                if (a >> pin & 1)
+                {
+                    output_add(&recorded[pin], now, (uint8_t)(b >> pin & 1));
+                    rec->outputs++;
+                }
+            }
+            break;
+        case TLC_RECORD_TONE:
+            if (size - pos < 2 || buf[pos] >= DAC_CHANNEL_MAX)
+            {
+                whole = false;
+                break;
+            }
+            output_add(&recorded[64 + buf[pos]], now, buf[pos + 1]);
+            rec->outputs++;
+            pos += 2;
+            break;
+        case TLC_RECORD_LOST:
+            if (!get_varint(buf, size, &pos, &a))
+            {
+                whole = false;
+                break;
+            }
+            rec->lost += a;
+            break;
+        default:
+            fprintf(stderr, "tlc_replay: unknown entry type %u at byte %zu\n", type, start);
+            return false;
+        }
+        if (!whole)
+        {
+            /* The capture ended inside the last entry */
+            rec->cut = size - start;
+            now -= (int64_t)delta;
+            break;
+        }
+        rec->entries++;
+        rec->end_us = now;
+    }
+    if (rec->entries == 0)
+    {
+        fprintf(stderr, "tlc_replay: empty recording\n");
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Feed every input due now, then wait for the next one; one chain keeps them
+ * in recorded order. I/O events were recorded when the controller took
+ * them, so it is told to take them now whether or not it has a tick of its
+ * own at this time.
+ */
+static void feed(void *arg)
+{
+    (void)arg;
+    int64_t now = sim_now();
+    bool io = false;
+    while (input_next < input_count && inputs[input_next].at <= now)
+    {
+        const replay_input_t *input = &inputs[input_next++];
+        if (input->event.type)
+        {
+            io |= tlc_spsc_push(&io_events, &input->event);
+        }
+        else
+        {
+            sim_gpio_input(input->pin, input->level);
+        }
+    }
+    if (io)
+    {
+        tlc_event_t take = {.type = TLC_EVENT_ADC, .timestamp = now};
+        xQueueSendFromISR(scheduler.queue, &take, NULL);
+    }
+    if (input_next < input_count)
+    {
+        sim_schedule(inputs[input_next].at, feed, NULL);
+    }
+}
+
+static int input_order(const void *a, const void *b)
+{
+    const replay_input_t *x = a;
+    const replay_input_t *y = b;
+    if (x->at != y->at)
+    {
+        return x->at < y->at ? -1 : 1;
+    }
+    /* Stable: keep the recorded order of inputs fed together */
+    return x < y ? -1 : x > y;
+}
+
+static void observe_gpio(int pin, int level, int64_t now)
+{
+    if (pin >= 0 && pin < 64)
+    {
+        output_add(&replayed[pin], now, (uint8_t)level);
+    }
+}
+
+static void observe_dac(int channel, uint32_t hz, uint8_t amplitude, int64_t now)
+{
+    (void)amplitude;
+    if (channel >= 0 && channel < DAC_CHANNEL_MAX)
+    {
+        output_add(&replayed[64 + channel], now, hz != 0);
+    }
+}
+
+static void print_output(int id)
+{
+    if (id < 64)
+    {
+        printf("pin %d", id);
+    }
+    else
+    {
+        printf("DAC%d", id - 64 + 1);
+    }
+}
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr,
+            "usage: %s [--tolerance US] [--jitter US] [--verbose] FILE\n"
+            "  FILE           recorder stream (tlc_telemetry --record FILE)\n"
+            "  --tolerance US output changes this far from the recorded time still match (default 0)\n"
+            "  --jitter US    run every esp_timer callback up to US microseconds late\n"
+            "  --verbose      print where each output diverged\n",
+            argv0);
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = NULL;
+    int64_t tolerance_us = 0;
+    int64_t jitter_us = 0;
+    bool verbose = false;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc)
+        {
+            tolerance_us = strtoll(argv[++i], NULL, 0);
+        }
+        else if (strcmp(argv[i], "--jitter") == 0 && i + 1 < argc)
+        {
+            jitter_us = strtoll(argv[++i], NULL, 0);
+        }
+        else if (strcmp(argv[i], "--verbose") == 0)
+        {
+            verbose = true;
+        }
+        else if (path == NULL && argv[i][0] != '-')
+        {
+            path = argv[i];
+        }
+        else
+        {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (path == NULL || tolerance_us < 0 || jitter_us < 0)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+    FILE *in = fopen(path, "rb");
+    if (in == NULL)
+    {
+        perror(path);
+        return 2;
+    }
+    uint8_t *buf = NULL;
+    size_t size = 0;
+    size_t cap = 0;
+    size_t n;
+    do
+    {
+        buf = grow(buf, &cap, size, 1);
+        n = fread(&buf[size], 1, cap - size, in);
+        size += n;
+    } while (n > 0);
+    fclose(in);
+
+    replay_recording_t rec = {0};
+    if (!parse(buf, size, &rec))
+    {
+        return 2;
+    }
+    free(buf);
+    qsort(inputs, input_count, sizeof(replay_input_t), input_order);
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    timing_plan = rec.plan;
+    sim_log_enable(false);
+    sim_gpio_set_hook(observe_gpio);
+    sim_dac_set_hook(observe_dac);
+    sim_timer_set_jitter(jitter_us);
+    sim_run_until(rec.boot_us);
+    app_main();
+    if (input_count)
+    {
+        sim_schedule(inputs[0].at, feed, NULL);
+    }
+    /* Changes after the last entry were not recorded yet */
+    sim_run_until(rec.end_us);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    /* An output diverges at its first change that is missing, extra, of another level or too far off */
+    uint64_t outputs = 0;
+    uint64_t diverged = 0;
+    int64_t first_at = INT64_MAX;
+    int first_id = -1;
+    size_t matched[REPLAY_OUTPUTS];
+    for (int id = 0; id < REPLAY_OUTPUTS; id++)
+    {
+        const replay_output_t *want = &recorded[id];
+        replay_output_t *got = &replayed[id];
+        /* Changes after the last entry were not recorded */
+        while (got->count > 0 && got->changes[got->count - 1].at > rec.end_us)
+        {
+            got->count--;
+        }
+        outputs += got->count;
+        size_t i = 0;
+        while (i < want->count && i < got->count && want->changes[i].level == got->changes[i].level &&
+               llabs(got->changes[i].at - want->changes[i].at) <= tolerance_us)
+        {
+            i++;
+        }
+        matched[id] = i;
+        if (i == want->count && i == got->count)
+        {
+            continue;
+        }
+        const replay_change_t *w = i < want->count ? &want->changes[i] : NULL;
+        const replay_change_t *g = i < got->count ? &got->changes[i] : NULL;
+        int64_t at = w != NULL && (g == NULL || w->at < g->at) ? w->at : g->at;
+        if (at < first_at)
+        {
+            first_at = at;
+            first_id = id;
+        }
+        if (verbose)
+        {
+            printf("  ");
+            print_output(id);
+            printf(" change %zu: recorded ", i + 1);
+            if (w != NULL)
+            {
+                printf("%u at %.6f s", w->level, w->at / 1e6);
+            }
+            else
+            {
+                printf("none");
+            }
+            printf(", replayed ");
+            if (g != NULL)
+            {
+                printf("%u at %.6f s\n", g->level, g->at / 1e6);
+            }
+            else
+            {
+                printf("none\n");
+            }
+        }
+        diverged++;
+    }
+    /* Past the first divergence the outputs follow another history, their offsets mean nothing */
+    uint64_t agreed = 0;
+    int64_t offset_max = 0;
+    for (int id = 0; id < REPLAY_OUTPUTS; id++)
+    {
+        for (size_t i = 0; i < matched[id] && recorded[id].changes[i].at < first_at; i++)
+        {
+            int64_t offset = llabs(replayed[id].changes[i].at - recorded[id].changes[i].at);
+            offset_max = offset > offset_max ? offset : offset_max;
+            agreed++;
+        }
+    }
+
+    double wall = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+    double virt = (double)(rec.end_us - rec.boot_us) / SIM_SECOND;
+    printf("tlc_replay: plan %s, %.2f h replayed in %.2f s (%.0fx real time)\n", rec.plan->name, virt / 3600.0,
+           wall, virt / wall);
+    printf("  recording           : %llu entries, %llu lost by the recorder, %zu bytes cut at the end\n",
+           (unsigned long long)rec.entries, (unsigned long long)rec.lost, rec.cut);
+    printf("  inputs fed          : %llu input edges, %llu density values, %llu UART bytes\n",
+           (unsigned long long)rec.edges, (unsigned long long)rec.density, (unsigned long long)rec.uart);
+    printf("  output changes      : %llu recorded, %llu replayed\n", (unsigned long long)rec.outputs,
+           (unsigned long long)outputs);
+    printf("  agreed changes      : %llu before the first difference, off by %lld us at most\n",
+           (unsigned long long)agreed, (long long)offset_max);
+    printf("  diverged outputs    : %llu", (unsigned long long)diverged);
+    if (diverged)
+    {
+        printf(", first ");
+        print_output(first_id);
+        printf(" at %.6f s", first_at / 1e6);
+    }
+    printf("\n");
+    for (int id = 0; id < REPLAY_OUTPUTS; id++)
+    {
+        free(recorded[id].changes);
+        free(replayed[id].changes);
+    }
+    free(inputs);
+    return diverged ? 1 : 0;
+}
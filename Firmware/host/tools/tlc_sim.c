@@ -0,0 +1,1027 @@
+/**
+ * @file tlc_sim.c
+ * @brief Host simulation of the Traffic Light Controller
+ * @author Jorge Minjares (https://github.com/JorgeMinjares)
+ * @brief Boots the unmodified firmware through app_main() and runs it in
+ *        virtual time with random pedestrian presses and traffic density.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "sim.h"
+#include "tlc_config.h"
+#include "tlc_button.h"
+#include "tlc_phase.h"
+#include "tlc_controller.h"
+#include "tlc_monitor.h"
+#include "tlc_console.h"
+#include "tlc_telemetry.h"
+#include "tlc_spsc.h"
+#include "tlc_trace.h"
+#include "timer.h"
+#include "bsp/tlc_audio.h"
+#include "driver/adc.h"
+
+void app_main(void);
+extern const tlc_plan_t *timing_plan;
+extern bool low_power;
+extern TaskHandle_t controller_task_handle;
+extern TaskHandle_t io_task_handle;
+extern tlc_spsc_t io_events;
+
+/* Target sizes of the kernel objects, ESP-IDF 4.4 on the ESP32 */
+#define SIM_TCB_BYTES 352        /*!< Task control block */
+#define SIM_QUEUE_BYTES 80       /*!< Queue control block */
+#define SIM_ESP_TIMER_BYTES 40   /*!< esp_timer control block */
+
+#define CLOCK_SKEW_US 7345678    /*!< Master time at boot, any value not a cycle multiple */
+#define SIM_CONSOLE_LINES 32     /*!< --console options */
+#define SIM_TRACE_POLL_US SIM_SECOND /*!< Period of trace ring peeks, well inside a ring's worth of entries */
+#define SIM_GPIO_PINS 40         /*!< Output pins a blink pattern can drive */
+#define SIM_PREEMPT_HOLD_MIN_US (5 * SIM_SECOND)  /*!< Shortest preemption pulse */
+#define SIM_PREEMPT_HOLD_MAX_US (40 * SIM_SECOND) /*!< Longest preemption pulse */
+#define SIM_CLEARANCE_SLACK_US 1000 /*!< A stage starts on the deadline before it, its pins follow by the wakeup latency */
+#define SIM_NS_BUCKETS 40        /*!< Host latency histogram: [2^(b-1), 2^b) ns */
+#define SIM_AWAKE_MA 27.0        /*!< ESP32 awake with the CPU idle at 160 MHz, datasheet modem sleep low end */
+#define SIM_SLEEP_MA 0.8         /*!< ESP32 light sleep, datasheet */
+#define SIM_SLEEP_WAKE_US 1000   /*!< Awake time charged per light sleep: entry, exit and the work that woke it */
+
+/**
+ * @brief Simulation options
+ */
+typedef struct
+{
+    double hours;         /*!< Virtual hours to run */
+    double ped_per_hour;  /*!< Mean pedestrian presses per hour */
+    int hold_pct;         /*!< Percent of presses held for the disability mode */
+    uint64_t seed;        /*!< PRNG seed */
+    bool bounce;          /*!< Add contact bounce to every press and release */
+    bool verbose;         /*!< Print firmware log output */
+    bool uart;            /*!< Echo UART output */
+    const char *capture;  /*!< File receiving UART output */
+    double clock_s;       /*!< Period of master clock messages, 0 for none */
+    double monitor_s;     /*!< Period of monitor snapshot requests, 0 for none */
+    int baud;             /*!< UART0 baud rate, 0 for the one the firmware configures */
+    const char *console[SIM_CONSOLE_LINES]; /*!< Console lines, "SECONDS:LINE" */
+    int console_count;    /*!< Console lines given */
+    int64_t jitter_us;    /*!< Longest esp_timer callback delay */
+    double preempt_per_hour; /*!< Mean preemption pulses per hour, 0 for none */
+    bool low_power;       /*!< Boot in low power mode */
+} sim_options_t;
+
+/**
+ * @brief Observed behaviour
+ */
+typedef struct
+{
+    uint64_t presses;      /*!< Presses injected */
+    uint64_t holds;        /*!< Presses held */
+    uint64_t greens;       /*!< Entries into GREEN */
+    uint64_t reds;         /*!< Entries into RED */
+    uint64_t walks;        /*!< Walk signal rising edges */
+    uint64_t glitches;     /*!< Bus writes that left the directions inconsistent */
+    uint64_t unsafe_greens; /*!< Greens lit straight after a yellow, or after a walk without its warning */
+    uint64_t clocks;       /*!< Master clock messages sent */
+    uint64_t synced;       /*!< GREEN ends checked against the master cycle */
+    int64_t sync_err_max;  /*!< Largest GREEN end error from the master cycle point (us) */
+    uint64_t tones[DAC_CHANNEL_MAX]; /*!< Tones sounded per DAC channel */
+    uint64_t tone_cuts;    /*!< Tones ended early by a cue change */
+    int64_t tone_err_max;  /*!< Largest tone length error from the cadence table (us) */
+    int64_t period_err_max; /*!< Largest tone to tone error from the cadence period (us) */
+    int64_t skew_max;      /*!< Largest start difference of the two channels playing one cue (us) */
+    uint64_t traced;       /*!< Trace entries peeked */
+    uint64_t trace_lost;   /*!< Trace entries overwritten before they were peeked */
+    uint64_t phases[TLC_PLAN_MAX_PHASES];    /*!< Timed phases ended, per plan index */
+    int64_t phase_err_sum[TLC_PLAN_MAX_PHASES]; /*!< Sum of |shown length - planned length| (us) */
+    int64_t phase_err_max[TLC_PLAN_MAX_PHASES]; /*!< Largest |shown length - planned length| (us) */
+    int64_t drift_max;     /*!< Largest running sum of phase length errors of one intersection (us) */
+    uint64_t toggles;      /*!< Blink toggles checked against their grid */
+    int64_t grid_err_max;  /*!< Largest toggle error from the grid of its blink (us) */
+    int64_t blink_err_max; /*!< Largest toggle to toggle error from the blink interval (us) */
+    uint64_t preempts;     /*!< Preemption pulses injected */
+    uint64_t preempt_served; /*!< Pulses whose target green, or all red, was reached */
+    int64_t preempt_wait_sum; /*!< Sum of input to target green (us) */
+    int64_t preempt_wait_max; /*!< Longest input to target green (us) */
+    uint64_t clearance_errors; /*!< Preemption changes without the yellow or all red owed */
+    int64_t preempt_yellow_min; /*!< Shortest yellow shown while preempted (us), -1 if none */
+    uint64_t isr_ns[SIM_NS_BUCKETS]; /*!< Preemption ISR to its first bus write, host ns */
+    uint64_t isr_ns_max;   /*!< Longest of them */
+} sim_report_t;
+
+/**
+ * @brief Tone heard on one DAC channel
+ */
+typedef struct
+{
+    bool on;                /*!< Sounding */
+    tlc_audio_cue_t cue;    /*!< Cue of the last tone */
+    int64_t on_at;          /*!< Start of the last tone */
+    uint32_t cues;          /*!< Cues started on any channel before the last tone */
+} sim_tone_t;
+
+/**
+ * @brief Phase last shown by one intersection, from the trace
+ */
+typedef struct
+{
+    bool shown;             /*!< A phase was seen */
+    uint8_t index;          /*!< Plan index */
+    int64_t at;             /*!< Time it was shown */
+    uint32_t planned;       /*!< Planned length (us), 0 if it waits for a call */
+    int64_t drift;          /*!< Running sum of phase length errors (us) */
+} sim_shown_t;
+
+/**
+ * @brief Toggles of one blinking pin, from the trace
+ */
+typedef struct
+{
+    int64_t last;           /*!< Last write */
+    int64_t anchor;         /*!< First toggle of the run */
+    uint32_t toggles;       /*!< Toggles since the anchor, 0 before the anchor */
+    bool fresh;             /*!< Next write may be a pattern start, off the grid */
+} sim_blink_t;
+
+/**
+ * @brief Walk signal of one crosswalk, from the pins
+ */
+typedef struct
+{
+    int64_t rose;           /*!< Last rising edge */
+    bool warned;            /*!< The warning blink followed the last steady walk, true before any walk */
+} sim_walk_t;
+
+/**
+ * @brief Preemption seen on the pins
+ */
+typedef struct
+{
+    bool window;            /*!< From the input rising until the plan shows a green again */
+    bool active;            /*!< Input asserted */
+    bool waiting;           /*!< Target green not reached since the input rose */
+    int64_t at;             /*!< Last rising edge */
+    uint64_t isr_ns;        /*!< Host time of the last edge, 0 once its bus write was seen */
+    int64_t isr_at;         /*!< Virtual time of the last edge */
+    int aspect[2];          /*!< Aspect last lit per direction, lamp_bits() */
+    int64_t since[2];       /*!< Time it lit */
+    int64_t red_since;      /*!< Every direction red since, -1 if not */
+} sim_preempt_t;
+
+static const int buttons[] = {BUTTON_0, BUTTON_1, BUTTON_2, BUTTON_3}; /*!< Pedestrian inputs */
+static sim_options_t opt = {.hours = 24.0, .ped_per_hour = 30.0, .hold_pct = 10, .seed = 1};
+static sim_report_t report;
+static uint64_t rng_state;
+static FILE *capture;
+static sim_tone_t heard[DAC_CHANNEL_MAX];
+static uint32_t trace_cursor[TLC_TRACE_CORES];  /*!< Next slot to peek, the firmware's own reader is left alone */
+static sim_shown_t shown[TLC_CONTROLLER_MAX + 1];
+static sim_blink_t blinks[SIM_GPIO_PINS];
+static bool staged;  /*!< The plan has TLC_PHASE_STAGED phases */
+static sim_preempt_t pre = {.red_since = -1};
+static sim_walk_t walk_seen[2] = {{.warned = true}, {.warned = true}};
+static const int walk_pins[2] = {WALK_0, WALK_1};
+
+static uint64_t rng_next(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static double rng_uniform(void)
+{
+    return (double)(rng_next() >> 11) / 9007199254740992.0;
+}
+
+static int64_t rng_exponential(double mean_us)
+{
+    double u = rng_uniform();
+    return (int64_t)(-mean_us * __builtin_log(1.0 - u));
+}
+
+/* Toggle the pin a few times over 3 ms, ending on the new level */
+static void bounce_step(void *arg)
+{
+    intptr_t packed = (intptr_t)arg;
+    int pin = (int)(packed & 0xff);
+    int level = (int)((packed >> 8) & 1);
+    int left = (int)(packed >> 9);
+    sim_gpio_input(pin, left % 2 ? !level : level);
+    if (left > 0)
+    {
+        sim_schedule(sim_now() + 1000, bounce_step, (void *)((packed & 0x1ff) | ((intptr_t)(left - 1) << 9)));
+    }
+}
+
+static void pedestrian_edge(int pin, int level)
+{
+    sim_gpio_input(pin, level);
+    if (opt.bounce)
+    {
+        sim_schedule(sim_now() + 1000, bounce_step, (void *)(intptr_t)(pin | (level << 8) | (3 << 9)));
+    }
+}
+
+static void pedestrian_release(void *arg)
+{
+    pedestrian_edge((int)(intptr_t)arg, LOW);
+}
+
+static void pedestrian_press(void *arg)
+{
+    (void)arg;
+    int pin = buttons[rng_next() % 4];
+    bool hold = (int)(rng_next() % 100) < opt.hold_pct;
+    report.presses++;
+    report.holds += hold;
+    pedestrian_edge(pin, HIGH);
+    int64_t duration = hold ? 3 * SIM_SECOND : 300000;
+    sim_schedule(sim_now() + duration, pedestrian_release, (void *)(intptr_t)pin);
+    int64_t gap = rng_exponential(SIM_HOUR / opt.ped_per_hour);
+    sim_schedule(sim_now() + duration + gap, pedestrian_press, NULL);
+}
+
+static uint64_t host_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static void preempt_edge(int level)
+{
+    pre.active = level;
+    if (level)
+    {
+        pre.window = true;
+        pre.at = sim_now();
+        /* A target already green keeps it */
+        pre.waiting = PREEMPT_APPROACH >= 2 || pre.aspect[PREEMPT_APPROACH] != 1;
+        report.preempt_served += !pre.waiting;
+    }
+    pre.isr_at = sim_now();
+    pre.isr_ns = host_ns();
+    sim_gpio_input(PREEMPT_PIN, level);
+}
+
+static void preempt_release(void *arg)
+{
+    (void)arg;
+    preempt_edge(LOW);
+}
+
+/* An emergency vehicle holds the input while it approaches */
+static void preempt_press(void *arg)
+{
+    (void)arg;
+    report.preempts++;
+    preempt_edge(HIGH);
+    int64_t hold = SIM_PREEMPT_HOLD_MIN_US + (int64_t)(rng_uniform() * (SIM_PREEMPT_HOLD_MAX_US - SIM_PREEMPT_HOLD_MIN_US));
+    sim_schedule(sim_now() + hold, preempt_release, NULL);
+    sim_schedule(sim_now() + hold + rng_exponential(SIM_HOUR / opt.preempt_per_hour), preempt_press, NULL);
+}
+
+static void density_step(void *arg)
+{
+    static int raw = 1024;
+    (void)arg;
+    raw += (int)(rng_next() % 401) - 200;
+    raw = raw < 0 ? 0 : raw > 4095 ? 4095 : raw;
+    sim_adc_set(ADC1_CHANNEL_6, raw);
+    sim_schedule(sim_now() + 10 * SIM_SECOND, density_step, NULL);
+}
+
+/* Stand-in master clock: 'C' and master time, little endian */
+static void master_clock(void *arg)
+{
+    (void)arg;
+    uint64_t master = (uint64_t)(sim_now() + CLOCK_SKEW_US);
+    uint8_t message[9] = {'C'};
+    for (int i = 0; i < 8; i++)
+    {
+        message[1 + i] = (uint8_t)(master >> (8 * i));
+    }
+    sim_uart_rx(message, sizeof(message));
+    report.clocks++;
+    sim_schedule(sim_now() + (int64_t)(opt.clock_s * SIM_SECOND), master_clock, NULL);
+}
+
+/* Ask for a tlc_monitor snapshot */
+static void monitor_request(void *arg)
+{
+    (void)arg;
+    sim_uart_rx((const uint8_t *)"M", 1);
+    sim_schedule(sim_now() + (int64_t)(opt.monitor_s * SIM_SECOND), monitor_request, NULL);
+}
+
+/* Type a console line, the text after the time */
+static void console_line(void *arg)
+{
+    const char *text = strchr(arg, ':') + 1;
+    sim_uart_rx((const uint8_t *)text, strlen(text));
+    sim_uart_rx((const uint8_t *)"\r\n", 2);
+}
+
+/* Coordinated plans end GREEN on a cycle point of master time once synced */
+static void check_sync(int64_t now)
+{
+    /* A preemption ends GREEN off the cycle on purpose */
+    if (pre.window || !opt.clock_s || !timing_plan->cycle_ms || now < (int64_t)(opt.clock_s * SIM_SECOND) +
+                                                              2 * (int64_t)timing_plan->cycle_ms * 1000)
+    {
+        return;
+    }
+    int64_t cycle = (int64_t)timing_plan->cycle_ms * 1000;
+    int64_t err = (now + CLOCK_SKEW_US - (int64_t)COORD_OFFSET_MS * 1000) % cycle;
+    err = err > cycle / 2 ? err - cycle : err;
+    err = err < 0 ? -err : err;
+    report.synced++;
+    report.sync_err_max = err > report.sync_err_max ? err : report.sync_err_max;
+}
+
+static void observe_gpio(int pin, int level, int64_t now)
+{
+    if (pin == LED_0 && !level)
+    {
+        check_sync(now);
+    }
+    for (int c = 0; c < 2; c++)
+    {
+        if (pin != walk_pins[c])
+        {
+            continue;
+        }
+        /* A rise after a steady walk is the warning blink, a fall a blink later ends a steady walk */
+        sim_walk_t *w = &walk_seen[c];
+        w->warned = level || now - w->rose <= WALK_BLINK_US * 3 / 2;
+        w->rose = level ? now : w->rose;
+    }
+    if (!level)
+    {
+        return;
+    }
+    if (pin == LED_0)
+    {
+        report.greens++;
+    }
+    else if (pin == LED_2)
+    {
+        report.reds++;
+    }
+    else if (pin == WALK_0)
+    {
+        report.walks++;
+    }
+}
+
+/* Length of the tone step of a cadence */
+static int64_t tone_us(const tlc_audio_cadence_t *cadence)
+{
+    for (uint8_t i = 0; i < cadence->count; i++)
+    {
+        if (cadence->steps[i].on)
+        {
+            return cadence->steps[i].us;
+        }
+    }
+    return 0;
+}
+
+static int64_t max_abs(int64_t max, int64_t err)
+{
+    err = err < 0 ? -err : err;
+    return err > max ? err : max;
+}
+
+/* Every tone must last and repeat as its cadence table says, on both channels at once */
+static void observe_dac(int channel, uint32_t hz, uint8_t amplitude, int64_t now)
+{
+    (void)amplitude;
+    sim_tone_t *t = &heard[channel];
+    tlc_audio_cue_t cue = tlc_audio_playing(channel);
+    const tlc_audio_cadence_t *cadence = &tlc_audio_cadences[cue];
+    tlc_audio_stats_t a;
+    tlc_audio_get_stats(&a);
+    if (hz && !t->on)
+    {
+        report.tones[channel]++;
+        /* A cue restarted on a new phase counts from the phase start instead */
+        if (cue == t->cue && a.cues == t->cues)
+        {
+            report.period_err_max = max_abs(report.period_err_max, now - t->on_at - cadence->period_us);
+        }
+        const sim_tone_t *other = &heard[!channel];
+        if (other->on && other->cue == cue)
+        {
+            report.skew_max = max_abs(report.skew_max, now - other->on_at);
+        }
+        *t = (sim_tone_t){.on = true, .cue = cue, .on_at = now, .cues = a.cues};
+    }
+    else if (!hz && t->on)
+    {
+        t->on = false;
+        if (cue == t->cue)
+        {
+            report.tone_err_max = max_abs(report.tone_err_max, now - t->on_at - tone_us(cadence));
+        }
+        else
+        {
+            report.tone_cuts++;
+            t->cue = cue;
+        }
+    }
+}
+
+/* Phase lengths must match the plan, and their errors must not add up */
+static void trace_phase(const tlc_trace_entry_t *e, int64_t at)
+{
+    sim_shown_t *s = &shown[e->arg0 >> 8];
+    if (e->id == TLC_TRACE_DEADLINE)
+    {
+        s->planned = e->arg1;
+        return;
+    }
+    /* A phase cut short by a preemption ends early on purpose */
+    if (s->shown && s->planned && s->index < TLC_PLAN_MAX_PHASES && (e->arg0 & 0xff) < TLC_PLAN_MAX_PHASES)
+    {
+        int64_t err = at - s->at - s->planned;
+        report.phases[s->index]++;
+        report.phase_err_sum[s->index] += err < 0 ? -err : err;
+        report.phase_err_max[s->index] = max_abs(report.phase_err_max[s->index], err);
+        s->drift += err;
+        report.drift_max = max_abs(report.drift_max, s->drift);
+    }
+    *s = (sim_shown_t){.shown = true, .index = e->arg0 & 0xff, .at = at, .planned = e->arg1, .drift = s->drift};
+}
+
+/* Blink toggles must stay on the grid of the blink's first toggle */
+static void trace_pattern(const tlc_trace_entry_t *e, int64_t at)
+{
+    if (e->arg0 >= SIM_GPIO_PINS)
+    {
+        return;
+    }
+    sim_blink_t *b = &blinks[e->arg0];
+    int64_t interval = e->arg0 == WALK_0 || e->arg0 == WALK_1 ? WALK_BLINK_US : YELLOW_BLINK_US;
+    if (b->fresh || at - b->last > interval * 3 / 2)
+    {
+        /* A pattern start writes off the grid, the grid begins at the next toggle */
+        b->fresh = false;
+        b->toggles = 0;
+    }
+    else if (b->toggles++ == 0)
+    {
+        b->anchor = at;
+    }
+    else
+    {
+        report.toggles++;
+        report.grid_err_max = max_abs(report.grid_err_max, at - b->anchor - (int64_t)(b->toggles - 1) * interval);
+        report.blink_err_max = max_abs(report.blink_err_max, at - b->last - interval);
+    }
+    b->last = at;
+}
+
+/* Read the trace rings behind the firmware's back, in time order across both cores */
+static void trace_peek(void)
+{
+    static tlc_trace_entry_t entries[TLC_TRACE_CORES * TLC_TRACE_SIZE];
+    static int64_t at[TLC_TRACE_CORES * TLC_TRACE_SIZE];
+    int64_t now = sim_now();
+    size_t count = 0;
+    for (int core = 0; core < TLC_TRACE_CORES; core++)
+    {
+        const tlc_trace_ring_t *ring = &tlc_trace_rings[core];
+        uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        if (head - trace_cursor[core] > TLC_TRACE_SIZE)
+        {
+            report.trace_lost += head - trace_cursor[core] - TLC_TRACE_SIZE;
+            trace_cursor[core] = head - TLC_TRACE_SIZE;
+        }
+        for (; trace_cursor[core] != head; trace_cursor[core]++)
+        {
+            const tlc_trace_entry_t *e = &ring->entries[trace_cursor[core] & (TLC_TRACE_SIZE - 1)];
+            if (__atomic_load_n(&e->seq, __ATOMIC_ACQUIRE) != trace_cursor[core] + 1)
+            {
+                report.trace_lost++;
+                continue;
+            }
+            /* Insert by time, the entries of one core are already in order; a phase goes ahead of
+               the pattern writes of its output, which are traced before it at the same time */
+            int64_t t = now - (uint32_t)((uint32_t)now - e->time_us);
+            bool phase = e->id == TLC_TRACE_PHASE || e->id == TLC_TRACE_DEADLINE;
+            size_t i = count++;
+            for (; i > 0 && (at[i - 1] > t || (phase && at[i - 1] == t && entries[i - 1].id == TLC_TRACE_PATTERN)); i--)
+            {
+                entries[i] = entries[i - 1];
+                at[i] = at[i - 1];
+            }
+            entries[i] = *e;
+            at[i] = t;
+        }
+    }
+    report.traced += count;
+    for (size_t i = 0; i < count; i++)
+    {
+        switch (entries[i].id)
+        {
+            case TLC_TRACE_PHASE:
+            case TLC_TRACE_DEADLINE:
+                /* Outputs change with the phase, a blink after it is a new pattern */
+                for (int pin = 0; pin < SIM_GPIO_PINS; pin++)
+                {
+                    blinks[pin].fresh = true;
+                }
+                trace_phase(&entries[i], at[i]);
+                break;
+            case TLC_TRACE_PATTERN:
+                trace_pattern(&entries[i], at[i]);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+static void trace_poll(void *arg)
+{
+    trace_peek();
+    sim_schedule(sim_now() + SIM_TRACE_POLL_US, trace_poll, arg);
+}
+
+static int lamp_bits(int green, int yellow, int red)
+{
+    return sim_gpio_output(green) | sim_gpio_output(yellow) << 1 | sim_gpio_output(red) << 2;
+}
+
+/* Preempted, a green clears through the full yellow and a new green follows the full all red */
+static void observe_preempt(int64_t now, const int lamps[2])
+{
+    bool green = false;
+    for (int d = 0; d < 2; d++)
+    {
+        /* Dark is the off half of a blink, the aspect lit last holds */
+        if (lamps[d] == 0 || lamps[d] == pre.aspect[d])
+        {
+            continue;
+        }
+        if (pre.window)
+        {
+            bool skipped = pre.aspect[d] == 1 && lamps[d] != 2;
+            bool short_yellow = pre.aspect[d] == 2 && now - pre.since[d] + SIM_CLEARANCE_SLACK_US <
+                                                            TLC_PHASE_PREEMPT_YELLOW_MS * 1000LL;
+            bool no_red = lamps[d] == 1 && (pre.red_since < 0 ||
+                                           now - pre.red_since + SIM_CLEARANCE_SLACK_US < TLC_PHASE_PREEMPT_RED_MS * 1000LL);
+            report.clearance_errors += skipped || short_yellow || no_red;
+            if (pre.aspect[d] == 2 && (report.preempt_yellow_min < 0 || now - pre.since[d] < report.preempt_yellow_min))
+            {
+                report.preempt_yellow_min = now - pre.since[d];
+            }
+        }
+        green |= lamps[d] == 1;
+        pre.aspect[d] = lamps[d];
+        pre.since[d] = now;
+    }
+    bool red = pre.aspect[0] == 4 && pre.aspect[1] == 4;
+    pre.red_since = !red ? -1 : pre.red_since < 0 ? now : pre.red_since;
+    if (pre.window && pre.active && pre.waiting &&
+        (PREEMPT_APPROACH < 2 ? green && lamps[PREEMPT_APPROACH] == 1 : red))
+    {
+        pre.waiting = false;
+        report.preempt_served++;
+        report.preempt_wait_sum += now - pre.at;
+        report.preempt_wait_max = now - pre.at > report.preempt_wait_max ? now - pre.at : report.preempt_wait_max;
+    }
+    else if (pre.window && !pre.active && green)
+    {
+        /* The plan took over again */
+        pre.window = false;
+    }
+    if (pre.isr_ns && now == pre.isr_at)
+    {
+        /* The first write after the edge, in host time: virtual time stands still while tasks run */
+        uint64_t ns = host_ns() - pre.isr_ns;
+        int b = 0;
+        while (b < SIM_NS_BUCKETS - 1 && ns >> b)
+        {
+            b++;
+        }
+        report.isr_ns[b]++;
+        report.isr_ns_max = ns > report.isr_ns_max ? ns : report.isr_ns_max;
+        pre.isr_ns = 0;
+    }
+}
+
+/* Upper bound of the bucket holding fraction q of the host latencies */
+static uint64_t isr_ns_percentile(double q)
+{
+    uint64_t total = 0;
+    for (int b = 0; b < SIM_NS_BUCKETS; b++)
+    {
+        total += report.isr_ns[b];
+    }
+    uint64_t seen = 0;
+    for (int b = 0; b < SIM_NS_BUCKETS; b++)
+    {
+        seen += report.isr_ns[b];
+        if (seen > 0 && seen >= q * total)
+        {
+            uint64_t bound = b == 0 ? 0 : (1ull << b) - 1;
+            return bound < report.isr_ns_max ? bound : report.isr_ns_max;
+        }
+    }
+    return report.isr_ns_max;
+}
+
+/* A green follows a red, never a yellow, and never a walk that skipped its warning */
+static void observe_green(int64_t now, const int lamps[2])
+{
+    for (int d = 0; d < 2; d++)
+    {
+        if (lamps[d] != 1 || pre.aspect[d] == 1)
+        {
+            continue;
+        }
+        bool unsafe = pre.aspect[d] == 2;
+        /* A preemption cuts walks short on purpose, its all red clears them */
+        for (int c = 0; c < 2 && !pre.window; c++)
+        {
+            bool walking = sim_gpio_output(walk_pins[c]) && now - walk_seen[c].rose > WALK_BLINK_US * 3 / 2;
+            unsafe |= walking || !walk_seen[c].warned;
+        }
+        report.unsafe_greens += unsafe;
+    }
+}
+
+/* Both directions must show the same single aspect after every bus write, a staged plan may keep one GREEN */
+static void observe_bus(int64_t now)
+{
+    int dir0 = lamp_bits(LED_0, LED_1, LED_2);
+    int dir1 = lamp_bits(LED_3, LED_4, LED_5);
+    /* A preemption may clear or green one direction alone */
+    bool split = (staged && (dir0 == 1 || dir1 == 1)) || pre.window;
+    observe_green(now, (const int[2]){dir0, dir1});
+    observe_preempt(now, (const int[2]){dir0, dir1});
+    if ((dir0 != dir1 && !split) || (dir0 & (dir0 - 1)) != 0 || (dir1 & (dir1 - 1)) != 0)
+    {
+        report.glitches++;
+    }
+}
+
+static void echo_uart(const uint8_t *data, size_t size, int64_t now)
+{
+    (void)now;
+    fwrite(data, 1, size, opt.uart ? stdout : capture);
+}
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr,
+            "usage: %s [--hours H] [--ped-rate N] [--hold-pct P] [--seed S] [--bounce] [--verbose] [--uart]\n"
+            "          [--capture FILE] [--plan NAME] [--clock S] [--monitor S] [--console S:LINE]... [--baud B]\n"
+            "          [--jitter US] [--preempt-rate N] [--low-power]\n"
+            "  --hours H     virtual hours to simulate (default 24)\n"
+            "  --ped-rate N  mean pedestrian presses per hour (default 30)\n"
+            "  --hold-pct P  percent of presses held 3 s (default 10)\n"
+            "  --seed S      random seed (default 1)\n"
+            "  --bounce      add contact bounce to button edges\n"
+            "  --verbose     print firmware ESP_LOGx output\n"
+            "  --uart        echo UART0 output\n"
+            "  --capture F   write UART0 output to F, decode it with tlc_telemetry\n"
+            "  --plan NAME   pedestrian, actuated, coordinated or staged (default TLC_PLAN)\n"
+            "  --clock S     send a master clock message on UART0 every S seconds\n"
+            "  --monitor S   ask for a task and latency snapshot on UART0 every S seconds\n"
+            "  --console S:LINE  type LINE on the UART0 console S seconds in, e.g. \"60:set 0 min 8000\"\n"
+            "  --baud B      send UART0 output at B baud, a rate under the output backs it up\n"
+            "  --jitter US   run every esp_timer callback up to US microseconds late\n"
+            "  --preempt-rate N  mean emergency vehicle preemptions per hour, each holding the input 5-40 s\n"
+            "  --low-power   boot in low power mode: light sleep, density in bursts, no controller tick\n",
+            argv0);
+}
+
+static int parse_options(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(arg, "--verbose") == 0)
+        {
+            opt.verbose = true;
+        }
+        else if (strcmp(arg, "--bounce") == 0)
+        {
+            opt.bounce = true;
+        }
+        else if (strcmp(arg, "--uart") == 0)
+        {
+            opt.uart = true;
+        }
+        else if (value != NULL && strcmp(arg, "--capture") == 0)
+        {
+            opt.capture = value;
+            i++;
+        }
+        else if (value != NULL && strcmp(arg, "--hours") == 0)
+        {
+            opt.hours = atof(value);
+            i++;
+        }
+        else if (value != NULL && strcmp(arg, "--ped-rate") == 0)
+        {
+            opt.ped_per_hour = atof(value);
+            i++;
+        }
+        else if (value != NULL && strcmp(arg, "--hold-pct") == 0)
+        {
+            opt.hold_pct = atoi(value);
+            i++;
+        }
+        else if (value != NULL && strcmp(arg, "--clock") == 0)
+        {
+            opt.clock_s = atof(value);
+            i++;
+        }
+        else if (value != NULL && strcmp(arg, "--monitor") == 0)
+        {
+            opt.monitor_s = atof(value);
+            i++;
+        }
+        else if (value != NULL && strcmp(arg, "--baud") == 0)
+        {
+            opt.baud = atoi(value);
+            i++;
+        }
+        else if (strcmp(arg, "--low-power") == 0)
+        {
+            opt.low_power = true;
+        }
+        else if (value != NULL && strcmp(arg, "--preempt-rate") == 0)
+        {
+            opt.preempt_per_hour = atof(value);
+            i++;
+        }
+        else if (value != NULL && strcmp(arg, "--jitter") == 0)
+        {
+            opt.jitter_us = strtoll(value, NULL, 0);
+            i++;
+        }
+        else if (value != NULL && strcmp(arg, "--console") == 0 && opt.console_count < SIM_CONSOLE_LINES &&
+                 strchr(value, ':') != NULL)
+        {
+            opt.console[opt.console_count++] = value;
+            i++;
+        }
+        else if (value != NULL && strcmp(arg, "--plan") == 0)
+        {
+            if (strcmp(value, "pedestrian") == 0)
+            {
+                timing_plan = &tlc_plan_pedestrian;
+            }
+            else if (strcmp(value, "actuated") == 0)
+            {
+                timing_plan = &tlc_plan_actuated;
+            }
+            else if (strcmp(value, "coordinated") == 0)
+            {
+                timing_plan = &tlc_plan_coordinated;
+            }
+            else if (strcmp(value, "staged") == 0)
+            {
+                timing_plan = &tlc_plan_staged;
+            }
+            else
+            {
+                usage(argv[0]);
+                return -1;
+            }
+            i++;
+        }
+        else if (value != NULL && strcmp(arg, "--seed") == 0)
+        {
+            opt.seed = strtoull(value, NULL, 0);
+            i++;
+        }
+        else
+        {
+            usage(argv[0]);
+            return -1;
+        }
+    }
+    if (opt.hours <= 0 || opt.ped_per_hour <= 0 || opt.clock_s < 0 || opt.monitor_s < 0 || opt.baud < 0 ||
+        opt.jitter_us < 0)
+    {
+        usage(argv[0]);
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (parse_options(argc, argv) != 0)
+    {
+        return 2;
+    }
+    rng_state = opt.seed ? opt.seed : 1;
+    for (uint8_t i = 0; i < timing_plan->count; i++)
+    {
+        staged |= (timing_plan->phases[i].flags & TLC_PHASE_STAGED) != 0;
+    }
+    sim_log_enable(opt.verbose);
+    sim_gpio_set_hook(observe_gpio);
+    sim_gpio_set_bus_hook(observe_bus);
+    sim_dac_set_hook(observe_dac);
+    if (opt.capture != NULL && (capture = fopen(opt.capture, "wb")) == NULL)
+    {
+        perror(opt.capture);
+        return 1;
+    }
+    if (opt.uart || capture != NULL)
+    {
+        sim_uart_set_hook(echo_uart);
+    }
+
+    sim_uart_set_baud(opt.baud);
+    sim_timer_set_jitter(opt.jitter_us);
+    low_power = opt.low_power;
+    app_main();
+    sim_schedule(SIM_TRACE_POLL_US, trace_poll, NULL);
+    sim_schedule(rng_exponential(SIM_HOUR / opt.ped_per_hour), pedestrian_press, NULL);
+    sim_schedule(0, density_step, NULL);
+    if (opt.clock_s > 0)
+    {
+        /* The master comes up after the board, off the polling grid; the first cycles run on boot time */
+        sim_schedule((int64_t)(opt.clock_s * SIM_SECOND) + 37000, master_clock, NULL);
+    }
+    if (opt.monitor_s > 0)
+    {
+        sim_schedule((int64_t)(opt.monitor_s * SIM_SECOND), monitor_request, NULL);
+    }
+    report.preempt_yellow_min = -1;
+    if (opt.preempt_per_hour > 0)
+    {
+        sim_schedule(rng_exponential(SIM_HOUR / opt.preempt_per_hour), preempt_press, NULL);
+    }
+    for (int i = 0; i < opt.console_count; i++)
+    {
+        sim_schedule((int64_t)(atof(opt.console[i]) * SIM_SECOND), console_line, (void *)opt.console[i]);
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int64_t until = (int64_t)(opt.hours * SIM_HOUR);
+    sim_run_until(until);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    trace_peek();
+
+    double wall = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+    double virt = (double)until / SIM_SECOND;
+    const sim_stats_t *s = sim_stats();
+    printf("tlc_sim: %.1f h simulated in %.2f s (%.0fx real time)\n", opt.hours, wall, virt / wall);
+    printf("  pedestrian presses  : %llu (%llu held)\n", (unsigned long long)report.presses,
+           (unsigned long long)report.holds);
+    printf("  GREEN entries       : %llu\n", (unsigned long long)report.greens);
+    printf("  RED entries         : %llu\n", (unsigned long long)report.reds);
+    printf("  walk signal pulses  : %llu\n", (unsigned long long)report.walks);
+    printf("  inconsistent writes : %llu\n", (unsigned long long)report.glitches);
+    printf("  unsafe greens       : %llu after a yellow or an unwarned walk\n",
+           (unsigned long long)report.unsafe_greens);
+    tlc_audio_stats_t a;
+    tlc_audio_get_stats(&a);
+    printf("  APS tones           : %llu on DAC1, %llu on DAC2 from %u cues, %llu cut by a phase change\n",
+           (unsigned long long)report.tones[0], (unsigned long long)report.tones[1], (unsigned)a.cues,
+           (unsigned long long)report.tone_cuts);
+    printf("  tone timing         : length err %lld us, period err %lld us, channel skew %lld us, late %u us\n",
+           (long long)report.tone_err_max, (long long)report.period_err_max, (long long)report.skew_max,
+           (unsigned)a.late_max_us);
+    uint64_t phases = 0;
+    int64_t phase_err_max = 0;
+    for (int i = 0; i < TLC_PLAN_MAX_PHASES; i++)
+    {
+        phases += report.phases[i];
+        phase_err_max = report.phase_err_max[i] > phase_err_max ? report.phase_err_max[i] : phase_err_max;
+    }
+    printf("  phase timing        : %llu timed phases, length err max %lld us, drift max %lld us\n",
+           (unsigned long long)phases, (long long)phase_err_max, (long long)report.drift_max);
+    for (int i = 0; i < TLC_PLAN_MAX_PHASES; i++)
+    {
+        if (report.phases[i])
+        {
+            printf("    phase %-2d          : %llu, length err avg %.1f us, max %lld us\n", i,
+                   (unsigned long long)report.phases[i], (double)report.phase_err_sum[i] / report.phases[i],
+                   (long long)report.phase_err_max[i]);
+        }
+    }
+    printf("  blink timing        : %llu toggles, grid err max %lld us, interval err max %lld us\n",
+           (unsigned long long)report.toggles, (long long)report.grid_err_max, (long long)report.blink_err_max);
+    printf("  trace entries       : %llu peeked, %llu overwritten first\n", (unsigned long long)report.traced,
+           (unsigned long long)report.trace_lost);
+    if (opt.clock_s > 0)
+    {
+        printf("  master clocks       : %llu, %llu GREEN ends within %.1f ms of the cycle point\n",
+               (unsigned long long)report.clocks, (unsigned long long)report.synced, report.sync_err_max / 1000.0);
+    }
+    printf("  context switches    : %llu (%.1f/s)\n", (unsigned long long)s->context_switches,
+           s->context_switches / virt);
+    printf("  task wakeups        : %llu (%.1f/s)\n", (unsigned long long)s->task_wakeups,
+           s->task_wakeups / virt);
+    printf("  idle wakeups        : %llu (%.1f/s)\n", (unsigned long long)s->idle_wakeups,
+           s->idle_wakeups / virt);
+    /* Light sleep pays for its own entry and exit, the rest of the time is awake */
+    double slept = s->light_sleep_us - (double)s->light_sleeps * SIM_SLEEP_WAKE_US;
+    slept = slept > 0 ? slept / 1e6 : 0;
+    printf("  light sleeps        : %llu (%.0f/h), asleep %.1f%% of the time\n",
+           (unsigned long long)s->light_sleeps, s->light_sleeps / (virt / 3600), 100.0 * s->light_sleep_us / 1e6 / virt);
+    printf("  est. chip current   : %.2f mA (%.1f mA awake, %.1f mA in light sleep, LEDs not included)\n",
+           (SIM_AWAKE_MA * (virt - slept) + SIM_SLEEP_MA * slept) / virt, SIM_AWAKE_MA, SIM_SLEEP_MA);
+    printf("  esp_timer callbacks : %llu\n", (unsigned long long)s->timer_callbacks);
+    printf("  gpio writes         : %llu (%.1f/s)\n", (unsigned long long)s->gpio_writes,
+           s->gpio_writes / virt);
+    printf("  uart tx bytes       : %llu, writers blocked %.1f s on a full TX ring\n",
+           (unsigned long long)s->uart_tx_bytes, s->uart_tx_wait_us / 1e6);
+    printf("  log lines           : %llu\n", (unsigned long long)s->log_lines);
+    uint32_t tcb = s->tasks * SIM_TCB_BYTES;
+    uint32_t qcb = s->queues * SIM_QUEUE_BYTES;
+    printf("  tasks               : %u (%u B stack + %u B TCB)\n", (unsigned)s->tasks,
+           (unsigned)s->stack_bytes, (unsigned)tcb);
+    printf("  queues              : %u (%u B items + %u B control)\n", (unsigned)s->queues,
+           (unsigned)s->queue_bytes, (unsigned)qcb);
+    printf("  esp_timers          : %u (%u B)\n", (unsigned)s->timers, (unsigned)(s->timers * SIM_ESP_TIMER_BYTES));
+    printf("  RTOS object RAM     : %u B\n", (unsigned)(s->stack_bytes + tcb + s->queue_bytes + qcb +
+                                                      s->timers * SIM_ESP_TIMER_BYTES));
+
+    tlc_button_stats_t b;
+    tlc_button_get_stats(&b);
+    printf("  button edges        : %u (%u bounces rejected, %u dropped)\n", (unsigned)b.edges,
+           (unsigned)b.bounces, (unsigned)b.dropped);
+    printf("  button events       : %u\n", (unsigned)b.events);
+    printf("  press->reaction     : avg %lld us, max %lld us over %u reactions\n",
+           (long long)(b.reactions ? b.latency_sum_us / b.reactions : 0), (long long)b.latency_max_us,
+           (unsigned)b.reactions);
+    printf("  button wakeups      : %u (%.2f/min)\n", (unsigned)b.wakeups, b.wakeups / (virt / 60.0));
+    /* The firmware's own counters, host stack frames are larger than on the ESP32 */
+    printf("  controller stack    : %u B never used on the host\n",
+           (unsigned)uxTaskGetStackHighWaterMark(controller_task_handle));
+    printf("  io_task stack       : %u B never used on the host\n",
+           (unsigned)uxTaskGetStackHighWaterMark(io_task_handle));
+    printf("  controller cpu      : %.1f%% of host time\n",
+           100.0 * ulTaskGetRunTimeCounter(controller_task_handle) / (portGET_RUN_TIME_COUNTER_VALUE() + 1));
+    tlc_telemetry_stats_t t;
+    tlc_telemetry_get_stats(&t);
+    printf("  telemetry records   : %u, %u dropped on a full ring\n", (unsigned)t.records, (unsigned)t.dropped);
+    printf("  io->control events  : %u, %u dropped on a full ring\n",
+           (unsigned)__atomic_load_n(&io_events.head, __ATOMIC_ACQUIRE), (unsigned)tlc_spsc_overflow(&io_events));
+    static const char *const paths[] = {"button->plan",   "timer->task",  "ISR->task", "phase->pins",
+                                        "deadline->step", "preempt->pins"};
+    for (int path = 0; path < TLC_MONITOR_PATHS; path++)
+    {
+        const tlc_monitor_histogram_t *h = tlc_monitor_histogram(path);
+        uint64_t count = 0;
+        for (int i = 0; i < TLC_MONITOR_BUCKETS; i++)
+        {
+            count += h->count[i];
+        }
+        printf("  %-20s: %llu, max %u us\n", paths[path], (unsigned long long)count, (unsigned)h->max_us);
+    }
+    if (opt.preempt_per_hour > 0)
+    {
+        uint64_t edges = 0;
+        for (int b = 0; b < SIM_NS_BUCKETS; b++)
+        {
+            edges += report.isr_ns[b];
+        }
+        printf("  preemptions         : %llu, %llu reached the target, wait avg %.2f s, max %.2f s\n",
+               (unsigned long long)report.preempts, (unsigned long long)report.preempt_served,
+               report.preempt_served ? report.preempt_wait_sum / 1e6 / report.preempt_served : 0.0,
+               report.preempt_wait_max / 1e6);
+        printf("  preempt clearance   : %llu errors, shortest yellow %.2f s\n",
+               (unsigned long long)report.clearance_errors,
+               report.preempt_yellow_min < 0 ? 0.0 : report.preempt_yellow_min / 1e6);
+        printf("  preempt ISR->pins   : %llu edges, host p50 <= %llu ns, p99 <= %llu ns, max %llu ns\n",
+               (unsigned long long)edges, (unsigned long long)isr_ns_percentile(0.50),
+               (unsigned long long)isr_ns_percentile(0.99), (unsigned long long)report.isr_ns_max);
+    }
+    if (opt.console_count > 0)
+    {
+        tlc_console_stats_t c;
+        tlc_console_get_stats(&c);
+        printf("  console lines       : %u (%u rejected), longest took %lld us\n", (unsigned)c.lines,
+               (unsigned)c.errors, (long long)c.line_max_us);
+        printf("  console applies     : %u, longest %.1f ms to reach every intersection\n", (unsigned)c.applied,
+               c.apply_max_us / 1000.0);
+    }
+    if (capture != NULL)
+    {
+        fclose(capture);
+    }
+    return 0;
+}
@@ -0,0 +1,956 @@
+/**
+ * @file tlc_telemetry.c
+ * @brief Telemetry stream decoder
+ * @author Jorge Minjares (https://github.com/JorgeMinjares)
+ * @brief Splits a captured UART0 stream on 0x00, COBS decodes and CRC checks
+ *        every frame and prints its records. Bytes that are not a valid
+ *        frame, such as the boot banner, are counted and skipped.
+ *        --timeline merges the trace records of both cores in time order
+ *        and prints how long each phase really lasted. --bench encodes a
+ *        synthetic event mix through the old text path and through
+ *        tlc_telemetry and compares bytes and CPU per event. --record joins
+ *        the RECORD records into the recorder stream that tlc_replay reads.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "tlc_config.h"
+#include "tlc_telemetry.h"
+#include "tlc_phase.h"
+#include "tlc_button.h"
+#include "tlc_trace.h"
+#include "tlc_monitor.h"
+#include "tlc_history.h"
+
+#define LINE_RATE_BPS 11520.0   /*!< 115200 baud 8N1 in bytes per second */
+
+/**
+ * @brief Decoded trace record
+ */
+typedef struct
+{
+    int64_t time_us;     /*!< Entry time */
+    uint32_t seq;        /*!< Record sequence number */
+    uint8_t core;        /*!< Core that wrote it */
+    uint8_t id;          /*!< tlc_trace_id_t */
+    uint64_t arg0;       /*!< First argument */
+    uint64_t arg1;       /*!< Second argument */
+} trace_t;
+
+/**
+ * @brief Duration statistics of one phase
+ */
+typedef struct
+{
+    uint64_t count;      /*!< Completed phases */
+    double sum_ms;       /*!< Total time */
+    double min_ms;       /*!< Shortest */
+    double max_ms;       /*!< Longest */
+    double planned_ms;   /*!< Total planned time of the phases with a deadline */
+    uint64_t planned;    /*!< Phases with a deadline */
+} phase_stats_t;
+
+/**
+ * @brief Last TASK record of one task
+ */
+typedef struct
+{
+    char name[16];        /*!< Task name */
+    uint64_t permille;    /*!< CPU share since the previous snapshot */
+    uint64_t stack_size;  /*!< Stack given to the task */
+    uint64_t stack_free;  /*!< Stack never used */
+} task_info_t;
+
+/**
+ * @brief Last snapshot of one latency path
+ */
+typedef struct
+{
+    uint64_t count[TLC_MONITOR_BUCKETS]; /*!< Latencies per bucket */
+    uint64_t max_us;                     /*!< Worst latency */
+    uint8_t next;                        /*!< Bucket after the last chunk, a lower one starts a snapshot */
+} latency_info_t;
+
+/**
+ * @brief Decoder state and counters
+ */
+typedef struct
+{
+    const tlc_plan_t *plan;  /*!< Plan named by the last BOOT record */
+    bool print;              /*!< Print every record */
+    bool timeline;           /*!< Keep trace records for the timeline */
+    trace_t *trace;          /*!< Trace records kept */
+    size_t trace_count;      /*!< Trace records kept */
+    size_t trace_cap;        /*!< Trace capacity */
+    bool synced;             /*!< A sequence number has been seen */
+    uint32_t next_seq;       /*!< Expected sequence number */
+    uint64_t frames;         /*!< Valid frames */
+    uint64_t records;        /*!< Records decoded */
+    uint64_t bad;            /*!< Frames failing COBS, CRC or parsing */
+    uint64_t lost;           /*!< Records missing from the sequence */
+    uint64_t skipped;        /*!< Bytes in bad frames */
+    uint64_t by_type[16];    /*!< Records per type */
+    task_info_t tasks[TLC_MONITOR_TASKS];         /*!< Last snapshot of each task */
+    uint8_t task_count;                           /*!< Tasks seen */
+    latency_info_t latency[TLC_MONITOR_PATHS];    /*!< Last snapshot of each path */
+    FILE *record;            /*!< Recorder stream written here, NULL to skip it */
+    uint32_t record_next;    /*!< Stream offset of the next recorder byte */
+    uint64_t record_gaps;    /*!< Recorder bytes missing from the stream */
+} decoder_t;
+
+static const tlc_plan_t *const plans[] = {&tlc_plan_pedestrian, &tlc_plan_actuated, &tlc_plan_four_way,
+                                          &tlc_plan_coordinated, &tlc_plan_staged};
+static const char *const button_names[] = {"PRESS", "HOLD", "RELEASE", "HALT"};
+static const char *const stats_names[] = {"button events", "latency avg us", "latency max us", "button wakeups",
+                                          "adc samples", "adc rejected", "adc us/value", "records/events dropped",
+                                          "trace lost", "record lost"};
+static const char *const event_names[] = {"?",   "PHASE_TIMER", "BUTTON_EDGE", "BUTTON_TIMER",
+                                          "ADC", "UART",        "DENSITY",     "PREEMPT"};
+static const char *const trace_names[] = {"?",       "PHASE",   "TIMER", "EVENT", "EDGE",     "BUTTON",
+                                          "PATTERN", "DENSITY", "CLOCK", "TONE",  "DEADLINE", "PREEMPT",
+                                          "BURST"};
+static const char *const cue_names[] = {"off", "locator", "walk", "countdown"};
+static const char *const path_names[] = {"button to plan", "timer to task", "ISR to task", "phase to pins",
+                                        "deadline to step", "preempt to pins"};
+static const char *const preempt_names[] = {"PREEMPT CLEAR", "PREEMPT RED", "PREEMPT DWELL"};
+static const char *const level_names[] = {"second", "minute", "hour"};
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* COBS decode in place, returns the decoded size or -1 */
+static long cobs_decode(uint8_t *buf, size_t size)
+{
+    size_t in = 0;
+    size_t out = 0;
+    while (in < size)
+    {
+        uint8_t code = buf[in++];
+        if (code == 0 || in + code - 1 > size)
+        {
+            return -1;
+        }
+        for (uint8_t i = 1; i < code; i++)
+        {
+            buf[out++] = buf[in++];
+        }
+        if (code != 0xff && in < size)
+        {
+            buf[out++] = 0;
+        }
+    }
+    return (long)out;
+}
+
+static bool get_varint(const uint8_t *buf, size_t size, size_t *pos, uint64_t *value)
+{
+    *value = 0;
+    for (int shift = 0; shift < 64 && *pos < size; shift += 7)
+    {
+        uint8_t b = buf[(*pos)++];
+        *value |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static uint64_t get_le(const uint8_t *buf, size_t size)
+{
+    uint64_t value = 0;
+    for (size_t i = 0; i < size; i++)
+    {
+        value |= (uint64_t)buf[i] << (8 * i);
+    }
+    return value;
+}
+
+static void print_time(int64_t us)
+{
+    printf("%10.6f ", us / 1e6);
+}
+
+/* Intersection prefix, empty on a single intersection board */
+static const char *instance_name(uint8_t instance)
+{
+    static char name[8];
+    if (instance == 0)
+    {
+        return "";
+    }
+    snprintf(name, sizeof(name), "[%u] ", instance);
+    return name;
+}
+
+/* Name of a plan phase or preemption stage */
+static const char *phase_name(const decoder_t *d, uint64_t index)
+{
+    if (index >= TLC_PHASE_PREEMPT_CLEAR && index <= TLC_PHASE_PREEMPT_DWELL)
+    {
+        return preempt_names[index - TLC_PHASE_PREEMPT_CLEAR];
+    }
+    return d->plan && index < d->plan->count ? d->plan->phases[index].name : "?";
+}
+
+/* Parse one record, returns false if it runs past the frame */
+static bool record(decoder_t *d, const uint8_t *buf, size_t size, size_t *pos, int64_t *time_us, uint32_t seq)
+{
+    uint8_t type = buf[(*pos)++];
+    uint64_t zigzag;
+    if (!get_varint(buf, size, pos, &zigzag))
+    {
+        return false;
+    }
+    *time_us += (int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1);
+    const uint8_t *p = &buf[*pos];
+    size_t left = size - *pos;
+    switch (type)
+    {
+    case TLC_TELEMETRY_BOOT:
+    {
+        if (left < 2 || left < (size_t)p[0] + 2 || p[0] >= TLC_TELEMETRY_DATA_MAX)
+        {
+            return false;
+        }
+        char name[TLC_TELEMETRY_DATA_MAX];
+        memcpy(name, &p[1], p[0]);
+        name[p[0]] = '\0';
+        d->plan = NULL;
+        for (size_t i = 0; i < sizeof(plans) / sizeof(plans[0]); i++)
+        {
+            d->plan = strcmp(plans[i]->name, name) == 0 ? plans[i] : d->plan;
+        }
+        if (d->print)
+        {
+            print_time(*time_us);
+            printf("#%-6u BOOT    plan %s, %u phases\n", (unsigned)seq, name, p[1 + p[0]]);
+        }
+        *pos += p[0] + 2;
+        break;
+    }
+    case TLC_TELEMETRY_PHASE:
+        if (left < 3)
+        {
+            return false;
+        }
+        if (d->print)
+        {
+            print_time(*time_us);
+            printf("#%-6u PHASE   %s%u %s%s%s%s%s\n", (unsigned)seq, instance_name(p[0]), p[1],
+                   phase_name(d, p[1]), p[2] & TLC_TELEMETRY_PHASE_HALTED ? " halted" : "",
+                   p[2] & TLC_TELEMETRY_PHASE_ACCESSIBLE ? " accessible" : "",
+                   p[2] & TLC_TELEMETRY_PHASE_CALL ? " call" : "",
+                   p[2] & TLC_TELEMETRY_PHASE_PREEMPT ? " preempt" : "");
+        }
+        *pos += 3;
+        break;
+    case TLC_TELEMETRY_BUTTON:
+    {
+        uint64_t duration;
+        if (left < 4)
+        {
+            return false;
+        }
+        *pos += 3;
+        if (!get_varint(buf, size, pos, &duration))
+        {
+            return false;
+        }
+        if (d->print)
+        {
+            print_time(*time_us);
+            printf("#%-6u BUTTON  %s%s pin %u, %llu us\n", (unsigned)seq, instance_name(p[0]),
+                   p[1] < 4 ? button_names[p[1]] : "?", p[2], (unsigned long long)duration);
+        }
+        break;
+    }
+    case TLC_TELEMETRY_DENSITY:
+        if (left < 4)
+        {
+            return false;
+        }
+        if (d->print)
+        {
+            uint16_t cars_q8 = (uint16_t)get_le(p, 2);
+            print_time(*time_us);
+            printf("#%-6u DENSITY %.2f cars, raw %.1f%s\n", (unsigned)seq, cars_q8 / 256.0,
+                   get_le(&p[2], 2) / 16.0, cars_q8 > (MAX_CARS / 2) << 8 ? " heavy" : "");
+        }
+        *pos += 4;
+        break;
+    case TLC_TELEMETRY_STATS:
+    {
+        uint64_t values[10];
+        size_t n = 0;
+        while (*pos < size && n < 10 && get_varint(buf, size, pos, &values[n]))
+        {
+            n++;
+        }
+        if (d->print)
+        {
+            print_time(*time_us);
+            printf("#%-6u STATS  ", (unsigned)seq);
+            for (size_t i = 0; i < n; i++)
+            {
+                printf(" %s %llu%s", stats_names[i], (unsigned long long)values[i], i + 1 < n ? "," : "\n");
+            }
+        }
+        break;
+    }
+    case TLC_TELEMETRY_TRACE:
+    {
+        trace_t t = {.time_us = *time_us, .seq = seq};
+        if (left < 4)
+        {
+            return false;
+        }
+        t.core = p[0];
+        t.id = p[1];
+        *pos += 2;
+        if (!get_varint(buf, size, pos, &t.arg0) || !get_varint(buf, size, pos, &t.arg1))
+        {
+            return false;
+        }
+        if (d->timeline)
+        {
+            if (d->trace_count == d->trace_cap)
+            {
+                d->trace_cap = d->trace_cap ? d->trace_cap * 2 : 4096;
+                d->trace = realloc(d->trace, d->trace_cap * sizeof(*d->trace));
+                if (d->trace == NULL)
+                {
+                    abort();
+                }
+            }
+            d->trace[d->trace_count++] = t;
+        }
+        break;
+    }
+    case TLC_TELEMETRY_TASK:
+    {
+        task_info_t info = {0};
+        if (left < 1 || p[0] >= sizeof(info.name) || left < (size_t)p[0] + 4)
+        {
+            return false;
+        }
+        memcpy(info.name, &p[1], p[0]);
+        *pos += p[0] + 1;
+        if (!get_varint(buf, size, pos, &info.permille) || !get_varint(buf, size, pos, &info.stack_size) ||
+            !get_varint(buf, size, pos, &info.stack_free))
+        {
+            return false;
+        }
+        /* A name seen before starts the next snapshot */
+        uint8_t i = 0;
+        while (i < d->task_count && strcmp(d->tasks[i].name, info.name) != 0)
+        {
+            i++;
+        }
+        if (i < TLC_MONITOR_TASKS)
+        {
+            d->tasks[i] = info;
+            d->task_count = i == d->task_count ? i + 1 : d->task_count;
+        }
+        if (d->print)
+        {
+            print_time(*time_us);
+            printf("#%-6u TASK    %s cpu %.1f%%, stack %llu of %llu bytes free\n", (unsigned)seq, info.name,
+                   info.permille / 10.0, (unsigned long long)info.stack_free, (unsigned long long)info.stack_size);
+        }
+        break;
+    }
+    case TLC_TELEMETRY_LATENCY:
+    {
+        uint64_t max_us;
+        if (left < 4 || p[0] >= TLC_MONITOR_PATHS || p[1] + p[2] > TLC_MONITOR_BUCKETS)
+        {
+            return false;
+        }
+        uint8_t path = p[0], first = p[1], n = p[2];
+        *pos += 3;
+        if (!get_varint(buf, size, pos, &max_us))
+        {
+            return false;
+        }
+        latency_info_t *l = &d->latency[path];
+        if (first < l->next || (first == 0 && l->next == 0))
+        {
+            memset(l, 0, sizeof(*l));
+        }
+        l->max_us = max_us;
+        for (uint8_t b = 0; b < n; b++)
+        {
+            if (!get_varint(buf, size, pos, &l->count[first + b]))
+            {
+                return false;
+            }
+        }
+        l->next = first + n;
+        if (d->print)
+        {
+            print_time(*time_us);
+            printf("#%-6u LATENCY %s, max %llu us, buckets %u-%u:", (unsigned)seq, path_names[path],
+                   (unsigned long long)max_us, first, first + n - 1);
+            for (uint8_t b = 0; b < n; b++)
+            {
+                printf(" %llu", (unsigned long long)l->count[first + b]);
+            }
+            printf("\n");
+        }
+        break;
+    }
+    case TLC_TELEMETRY_CONSOLE:
+        if (left < 1 || left < (size_t)p[0] + 1)
+        {
+            return false;
+        }
+        if (d->print)
+        {
+            print_time(*time_us);
+            printf("#%-6u CONSOLE %.*s\n", (unsigned)seq, p[0], (const char *)&p[1]);
+        }
+        *pos += p[0] + 1;
+        break;
+    case TLC_TELEMETRY_HISTORY:
+    {
+        if (left < 2 || p[0] >= TLC_HISTORY_LEVELS)
+        {
+            return false;
+        }
+        size_t at = *pos + 2;
+        uint64_t time_s;
+        if (!get_varint(buf, size, &at, &time_s))
+        {
+            return false;
+        }
+        uint32_t span = tlc_history_span((tlc_history_level_t)p[0]);
+        int64_t mean = 0;
+        for (uint8_t i = 0; i < p[1]; i++)
+        {
+            uint64_t delta;
+            uint64_t low;
+            uint64_t high;
+            if (!get_varint(buf, size, &at, &delta) || !get_varint(buf, size, &at, &low) ||
+                !get_varint(buf, size, &at, &high))
+            {
+                return false;
+            }
+            mean += (int64_t)(delta >> 1) ^ -(int64_t)(delta & 1);
+            if (d->print)
+            {
+                print_time(*time_us);
+                printf("#%-6u HISTORY %s %llu s: mean %.2f, min %.2f, max %.2f cars\n", (unsigned)seq,
+                       level_names[p[0]], (unsigned long long)(time_s + i * span), mean / 16.0,
+                       (mean - (int64_t)low) / 16.0, (mean + (int64_t)high) / 16.0);
+            }
+        }
+        if (d->print && p[1] == 0)
+        {
+            print_time(*time_us);
+            printf("#%-6u HISTORY %s done\n", (unsigned)seq, level_names[p[0]]);
+        }
+        *pos = at;
+        break;
+    }
+    case TLC_TELEMETRY_RECORD:
+    {
+        size_t at = *pos;
+        uint64_t offset;
+        if (!get_varint(buf, size, &at, &offset) || at >= size || size - at - 1 < buf[at])
+        {
+            return false;
+        }
+        uint8_t n = buf[at++];
+        if (d->print)
+        {
+            print_time(*time_us);
+            printf("#%-6u RECORD  offset %llu, %u bytes\n", (unsigned)seq, (unsigned long long)offset, n);
+        }
+        /* Bytes after a gap no longer decode, only count them */
+        if ((uint32_t)offset != d->record_next)
+        {
+            d->record_gaps += (uint32_t)offset - d->record_next;
+        }
+        if (d->record != NULL && d->record_gaps == 0)
+        {
+            fwrite(&buf[at], 1, n, d->record);
+        }
+        d->record_next = (uint32_t)offset + n;
+        *pos = at + n;
+        break;
+    }
+    default:
+        return false;
+    }
+    d->by_type[type]++;
+    return true;
+}
+
+/* Upper bound of the bucket holding the given share of a histogram */
+static uint64_t latency_percentile(const latency_info_t *l, double share)
+{
+    uint64_t total = 0;
+    for (int b = 0; b < TLC_MONITOR_BUCKETS; b++)
+    {
+        total += l->count[b];
+    }
+    uint64_t sum = 0;
+    for (int b = 0; b < TLC_MONITOR_BUCKETS; b++)
+    {
+        sum += l->count[b];
+        if (total && sum >= share * total)
+        {
+            return b == 0 ? 0 : (1ULL << b) - 1;
+        }
+    }
+    return 0;
+}
+
+/* Latest tlc_monitor snapshot */
+static void monitor_summary(const decoder_t *d)
+{
+    if (d->task_count == 0 && d->by_type[TLC_TELEMETRY_LATENCY] == 0)
+    {
+        return;
+    }
+    printf("  monitor, last snapshot:\n");
+    for (uint8_t i = 0; i < d->task_count; i++)
+    {
+        const task_info_t *t = &d->tasks[i];
+        printf("    %-16s cpu %5.1f%%  stack %5llu bytes, %5llu never used\n", t->name, t->permille / 10.0,
+               (unsigned long long)t->stack_size, (unsigned long long)t->stack_free);
+    }
+    for (int path = 0; path < TLC_MONITOR_PATHS; path++)
+    {
+        const latency_info_t *l = &d->latency[path];
+        uint64_t count = 0;
+        for (int b = 0; b < TLC_MONITOR_BUCKETS; b++)
+        {
+            count += l->count[b];
+        }
+        printf("    %-16s %8llu  p50 <= %llu us, p99 <= %llu us, max %llu us\n", path_names[path],
+               (unsigned long long)count, (unsigned long long)latency_percentile(l, 0.50),
+               (unsigned long long)latency_percentile(l, 0.99), (unsigned long long)l->max_us);
+    }
+}
+
+/* Decode one delimited frame in place */
+static void frame(decoder_t *d, uint8_t *buf, size_t size)
+{
+    long n = cobs_decode(buf, size);
+    if (n < TLC_TELEMETRY_HEADER + 2 || buf[0] != TLC_TELEMETRY_VERSION ||
+        tlc_telemetry_crc16(buf, (size_t)n - 2) != get_le(&buf[n - 2], 2))
+    {
+        d->bad++;
+        d->skipped += size + 1;
+        return;
+    }
+    size_t end = (size_t)n - 2;
+    uint32_t seq = (uint32_t)get_le(&buf[1], 4);
+    int64_t time_us = (int64_t)get_le(&buf[5], 8);
+    if (d->synced && seq != d->next_seq)
+    {
+        d->lost += (uint32_t)(seq - d->next_seq);
+    }
+    size_t pos = TLC_TELEMETRY_HEADER;
+    while (pos < end)
+    {
+        if (!record(d, buf, end, &pos, &time_us, seq))
+        {
+            d->bad++;
+            break;
+        }
+        seq++;
+        d->records++;
+    }
+    d->synced = true;
+    d->next_seq = seq;
+    d->frames++;
+}
+
+/* Split a stream on delimiters, returns the bytes left over */
+static size_t decode(decoder_t *d, uint8_t *buf, size_t size)
+{
+    size_t start = 0;
+    for (size_t i = 0; i < size; i++)
+    {
+        if (buf[i] == 0)
+        {
+            if (i > start)
+            {
+                frame(d, &buf[start], i - start);
+            }
+            start = i + 1;
+        }
+    }
+    return size - start;
+}
+
+/* ------------------------------------------------------------------ */
+/* Timeline                                                           */
+/* ------------------------------------------------------------------ */
+
+static int trace_order(const void *a, const void *b)
+{
+    const trace_t *x = a;
+    const trace_t *y = b;
+    if (x->time_us != y->time_us)
+    {
+        return x->time_us < y->time_us ? -1 : 1;
+    }
+    return x->seq < y->seq ? -1 : x->seq > y->seq;
+}
+
+static void timeline(decoder_t *d)
+{
+    phase_stats_t phases[TLC_PHASE_PREEMPT_DWELL + 1] = {0};
+    /* Last phase of every intersection, durations of all of them are pooled */
+    const trace_t *last_phase[256] = {NULL};
+    /* Planned length of each one's phase, as last set */
+    uint64_t planned_us[256] = {0};
+    qsort(d->trace, d->trace_count, sizeof(*d->trace), trace_order);
+    for (size_t i = 0; i < d->trace_count; i++)
+    {
+        const trace_t *t = &d->trace[i];
+        const char *name = t->id < sizeof(trace_names) / sizeof(trace_names[0]) ? trace_names[t->id] : "?";
+        if (d->print)
+        {
+            print_time(t->time_us);
+            printf("core %u %-8s", t->core, name);
+            switch (t->id)
+            {
+            case TLC_TRACE_PHASE:
+            case TLC_TRACE_DEADLINE:
+                printf("%s%llu %s, %.1f ms planned\n", instance_name((uint8_t)(t->arg0 >> 8)),
+                       (unsigned long long)(t->arg0 & 0xff), phase_name(d, t->arg0 & 0xff), t->arg1 / 1e3);
+                break;
+            case TLC_TRACE_EVENT:
+                printf("%s\n", t->arg0 < sizeof(event_names) / sizeof(event_names[0]) ? event_names[t->arg0] : "?");
+                break;
+            case TLC_TRACE_BUTTON_EDGE:
+            case TLC_TRACE_PREEMPT:
+                printf("pin %llu level %llu\n", (unsigned long long)t->arg0, (unsigned long long)t->arg1);
+                break;
+            case TLC_TRACE_BUTTON:
+                printf("%s pin %llu\n", t->arg0 < 4 ? button_names[t->arg0] : "?", (unsigned long long)t->arg1);
+                break;
+            case TLC_TRACE_DENSITY:
+                printf("%llu cars\n", (unsigned long long)t->arg0);
+                break;
+            case TLC_TRACE_ADC_SHORT:
+                printf("%llu samples missing\n", (unsigned long long)t->arg0);
+                break;
+            case TLC_TRACE_TONE:
+                printf("DAC %llu %s\n", (unsigned long long)t->arg0 + 1,
+                       t->arg1 < sizeof(cue_names) / sizeof(cue_names[0]) ? cue_names[t->arg1] : "?");
+                break;
+            default:
+                printf("%llu %llu\n", (unsigned long long)t->arg0, (unsigned long long)t->arg1);
+                break;
+            }
+        }
+        if (t->id == TLC_TRACE_DEADLINE)
+        {
+            planned_us[(t->arg0 >> 8) & 0xff] = t->arg1;
+        }
+        if (t->id != TLC_TRACE_PHASE)
+        {
+            continue;
+        }
+        const trace_t *last = last_phase[(t->arg0 >> 8) & 0xff];
+        if (last != NULL && (last->arg0 & 0xff) <= TLC_PHASE_PREEMPT_DWELL)
+        {
+            phase_stats_t *s = &phases[last->arg0 & 0xff];
+            double ms = (t->time_us - last->time_us) / 1e3;
+            s->min_ms = s->count == 0 || ms < s->min_ms ? ms : s->min_ms;
+            s->max_ms = s->count == 0 || ms > s->max_ms ? ms : s->max_ms;
+            s->sum_ms += ms;
+            s->count++;
+            if (planned_us[(t->arg0 >> 8) & 0xff])
+            {
+                s->planned_ms += planned_us[(t->arg0 >> 8) & 0xff] / 1e3;
+                s->planned++;
+            }
+        }
+        last_phase[(t->arg0 >> 8) & 0xff] = t;
+        planned_us[(t->arg0 >> 8) & 0xff] = t->arg1;
+    }
+    printf("  phase              count     min ms     avg ms     max ms  planned ms\n");
+    for (int i = 0; i <= TLC_PHASE_PREEMPT_DWELL; i++)
+    {
+        const phase_stats_t *s = &phases[i];
+        if (s->count == 0)
+        {
+            continue;
+        }
+        printf("  %-2d %-14s %7llu %10.1f %10.1f %10.1f  %10.1f\n", i, phase_name(d, (uint64_t)i),
+               (unsigned long long)s->count, s->min_ms, s->sum_ms / s->count, s->max_ms,
+               s->planned ? s->planned_ms / s->planned : 0.0);
+    }
+}
+
+/* ------------------------------------------------------------------ */
+/* Benchmark                                                          */
+/* ------------------------------------------------------------------ */
+
+static uint8_t *bench_buf;
+static size_t bench_size;
+static size_t bench_cap;
+
+static void bench_write(const uint8_t *data, size_t size)
+{
+    if (bench_size + size > bench_cap)
+    {
+        bench_cap = (bench_cap + size) * 2;
+        bench_buf = realloc(bench_buf, bench_cap);
+        if (bench_buf == NULL)
+        {
+            abort();
+        }
+    }
+    memcpy(&bench_buf[bench_size], data, size);
+    bench_size += size;
+}
+
+/* What the firmware printed before: sprintf, strlen and a write per message */
+static void bench_text_write(char *str)
+{
+    bench_write((const uint8_t *)str, strlen(str));
+}
+
+static int bench(uint32_t events)
+{
+    /* Event mix of a busy hour: a density value per second, a phase change
+       every 10 s and a button event every 30 s */
+    static const uint8_t mix[60] = {
+        [9] = 1, [19] = 1, [29] = 2, [39] = 1, [49] = 1, [59] = 2,
+    };
+    const tlc_plan_t *plan = &tlc_plan_pedestrian;
+    char buffer[96];
+
+    double start = now_ns();
+    for (uint32_t i = 0; i < events; i++)
+    {
+        int64_t t = (int64_t)i * 1000000;
+        switch (mix[i % 60])
+        {
+        case 0:
+            sprintf(buffer, "Traffic Congestion: %d\r\n", (int)(i % MAX_CARS));
+            bench_text_write(buffer);
+            if ((MAX_CARS / 2) < (int)(i % MAX_CARS))
+            {
+                bench_text_write("\033[1;31m Whoa Traffic is Heavy\033[1;39m\r\n");
+            }
+            break;
+        case 1:
+            snprintf(buffer, sizeof(buffer), "I (%lld) %s: %s\n", (long long)(t / 1000), "STATE: ",
+                     plan->phases[i % plan->count].name);
+            bench_text_write(buffer);
+            break;
+        default:
+            snprintf(buffer, sizeof(buffer), "I (%lld) %s: %s\n", (long long)(t / 1000), "BUTTON: ", "PRESSED ONCE");
+            bench_text_write(buffer);
+            break;
+        }
+    }
+    double text_ns = now_ns() - start;
+    size_t text_bytes = bench_size;
+
+    bench_size = 0;
+    tlc_telemetry_init(bench_write);
+    start = now_ns();
+    for (uint32_t i = 0; i < events; i++)
+    {
+        int64_t t = (int64_t)i * 1000000;
+        switch (mix[i % 60])
+        {
+        case 0:
+            tlc_telemetry_density(t, (uint16_t)((i % MAX_CARS) << 8), (uint16_t)((i % MAX_CARS) * 2621));
+            break;
+        case 1:
+            tlc_telemetry_phase(t, 0, (uint8_t)(i % plan->count), 0);
+            break;
+        default:
+            tlc_telemetry_button(t, 0, TLC_BUTTON_PRESS, BUTTON_0, 0);
+            break;
+        }
+        if (i % TELEMETRY_BATCH == TELEMETRY_BATCH - 1)
+        {
+            tlc_telemetry_flush();
+        }
+    }
+    tlc_telemetry_flush();
+    double bin_ns = now_ns() - start;
+    size_t bin_bytes = bench_size;
+
+    decoder_t d = {.plan = plan};
+    start = now_ns();
+    decode(&d, bench_buf, bench_size);
+    double decode_ns = now_ns() - start;
+
+    /* Control path cost: a log line against a trace entry */
+    bench_size = 0;
+    start = now_ns();
+    for (uint32_t i = 0; i < events; i++)
+    {
+        snprintf(buffer, sizeof(buffer), "I (%lld) %s: %s\n", (long long)i, "STATE: ",
+                 plan->phases[i % plan->count].name);
+        bench_text_write(buffer);
+    }
+    double log_ns = now_ns() - start;
+    start = now_ns();
+    for (uint32_t i = 0; i < events; i++)
+    {
+        tlc_trace(TLC_TRACE_PHASE, (uint16_t)(i % plan->count), i);
+    }
+    double trace_ns = now_ns() - start;
+
+    printf("tlc_telemetry: %u events, batches of %d density values\n", (unsigned)events, TELEMETRY_BATCH);
+    printf("  path        bytes/event  ns/event  line time\n");
+    printf("  text        %11.2f  %8.1f  %8.1f%%\n", (double)text_bytes / events, text_ns / events,
+           100.0 * text_bytes / LINE_RATE_BPS / events);
+    printf("  telemetry   %11.2f  %8.1f  %8.1f%%\n", (double)bin_bytes / events, bin_ns / events,
+           100.0 * bin_bytes / LINE_RATE_BPS / events);
+    printf("  control path: log line %.1f ns, trace entry %.1f ns\n", log_ns / events, trace_ns / events);
+    printf("  decode: %llu frames, %llu records, %llu bad, %.1f MB/s (%.0fx line rate)\n",
+           (unsigned long long)d.frames, (unsigned long long)d.records, (unsigned long long)d.bad,
+           bin_bytes / decode_ns * 1e3, bin_bytes / (decode_ns / 1e9) / LINE_RATE_BPS);
+    free(bench_buf);
+    return d.records == events && d.bad == 0 ? 0 : 1;
+}
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr,
+            "usage: %s [--quiet] [--timeline] [--record OUT] [FILE]\n"
+            "       %s --bench [EVENTS]\n"
+            "  FILE       captured UART0 stream, - or none for stdin (tlc_sim --capture FILE)\n"
+            "  --quiet    only print the summary\n"
+            "  --timeline print the trace records in time order and per-phase durations\n"
+            "  --record OUT write the recorder stream to OUT for tlc_replay\n"
+            "  --bench N  compare text and telemetry output over N synthetic events (default 1000000)\n",
+            argv0, argv0);
+}
+
+int main(int argc, char **argv)
+{
+    decoder_t d = {.print = true};
+    const char *path = NULL;
+    const char *record_path = NULL;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--bench") == 0)
+        {
+            return bench(i + 1 < argc ? (uint32_t)strtoul(argv[i + 1], NULL, 0) : 1000000);
+        }
+        else if (strcmp(argv[i], "--quiet") == 0)
+        {
+            d.print = false;
+        }
+        else if (strcmp(argv[i], "--timeline") == 0)
+        {
+            d.timeline = true;
+        }
+        else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+        {
+            record_path = argv[++i];
+        }
+        else if (path == NULL && argv[i][0] != '-')
+        {
+            path = argv[i];
+        }
+        else if (path == NULL && strcmp(argv[i], "-") == 0)
+        {
+            path = "-";
+        }
+        else
+        {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    bool print = d.print;
+    d.print = d.print && !d.timeline;
+    FILE *in = path == NULL || strcmp(path, "-") == 0 ? stdin : fopen(path, "rb");
+    if (in == NULL)
+    {
+        perror(path);
+        return 1;
+    }
+    if (record_path != NULL && (d.record = fopen(record_path, "wb")) == NULL)
+    {
+        perror(record_path);
+        return 1;
+    }
+
+    static uint8_t buf[1 << 16];
+    size_t held = 0;
+    uint64_t total = 0;
+    double busy = 0;
+    size_t n;
+    while ((n = fread(&buf[held], 1, sizeof(buf) - held, in)) > 0)
+    {
+        total += n;
+        double start = now_ns();
+        size_t left = decode(&d, buf, held + n);
+        busy += now_ns() - start;
+        /* Keep a partial frame for the next read, drop it if it fills the buffer */
+        if (left == held + n && left == sizeof(buf))
+        {
+            d.skipped += left;
+            left = 0;
+        }
+        memmove(buf, &buf[held + n - left], left);
+        held = left;
+    }
+    d.skipped += held;
+    if (in != stdin)
+    {
+        fclose(in);
+    }
+    if (d.timeline)
+    {
+        d.print = print;
+        timeline(&d);
+        free(d.trace);
+    }
+
+    printf("tlc_telemetry: %llu bytes, %llu frames, %llu records, %llu bad frames, %llu records lost, %llu bytes skipped\n",
+           (unsigned long long)total, (unsigned long long)d.frames, (unsigned long long)d.records,
+           (unsigned long long)d.bad, (unsigned long long)d.lost, (unsigned long long)d.skipped);
+    printf("  boot %llu, phase %llu, button %llu, density %llu, stats %llu, trace %llu, task %llu, latency %llu, console %llu, history %llu\n",
+           (unsigned long long)d.by_type[TLC_TELEMETRY_BOOT], (unsigned long long)d.by_type[TLC_TELEMETRY_PHASE],
+           (unsigned long long)d.by_type[TLC_TELEMETRY_BUTTON], (unsigned long long)d.by_type[TLC_TELEMETRY_DENSITY],
+           (unsigned long long)d.by_type[TLC_TELEMETRY_STATS], (unsigned long long)d.by_type[TLC_TELEMETRY_TRACE],
+           (unsigned long long)d.by_type[TLC_TELEMETRY_TASK], (unsigned long long)d.by_type[TLC_TELEMETRY_LATENCY],
+           (unsigned long long)d.by_type[TLC_TELEMETRY_CONSOLE], (unsigned long long)d.by_type[TLC_TELEMETRY_HISTORY]);
+    if (d.by_type[TLC_TELEMETRY_RECORD])
+    {
+        printf("  record %u bytes, %llu bytes missing%s\n", (unsigned)d.record_next, (unsigned long long)d.record_gaps,
+               d.record_gaps && d.record != NULL ? ", recording cut at the first gap" : "");
+    }
+    if (d.record != NULL)
+    {
+        fclose(d.record);
+    }
+    monitor_summary(&d);
+    if (d.records && busy > 0)
+    {
+        printf("  %.2f bytes/record, decoded at %.1f MB/s (%.0fx line rate)\n", (double)total / d.records,
+               total / busy * 1e3, total / (busy / 1e9) / LINE_RATE_BPS);
+    }
+    return 0;
+}
@@ -0,0 +1,775 @@
+/**
+ * @file tlc_traffic.c
+ * @brief Vehicle and pedestrian microsimulator
+ * @author Jorge Minjares (https://github.com/JorgeMinjares)
+ * @brief Drives the firmware, app_main() on the simulated BSP, with Poisson
+ *        or trace driven vehicle arrivals on both approaches and pedestrians
+ *        pressing BUTTON_0 - BUTTON_3. Vehicles queue while the green LED of
+ *        their approach is off and leave at the saturation headway once it
+ *        lights; pedestrians wait for the walk signal of their crosswalk.
+ *        Reports throughput, queue lengths, delay percentiles and walk time.
+ * @brief The vehicle model keeps its own event calendar, one arrival and one
+ *        departure per approach, and only catches up with virtual time when
+ *        the firmware can see it: on a signal change and once per density
+ *        block. Its outcome depends on nothing but the arrivals and the signal
+ *        timeline, so the run is replayed from the recorded timeline without
+ *        the firmware; the replay must match and measures the model alone.
+ *        With the firmware the density ADC path sets the pace, far more
+ *        than the vehicles; --low-power samples it in bursts instead. The
+ *        run falls short of TARGET_EVENTS_S at any realistic traffic.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "sim.h"
+#include "tlc_config.h"
+#include "tlc_phase.h"
+#include "tlc_density.h"
+#include "driver/adc.h"
+
+#define APPROACHES 2        /*!< Approaches modelled, each with its crosswalk */
+#define QUEUE_MAX 4096      /*!< Vehicles one approach can queue */
+#define QUEUE_BINS 256      /*!< Queue length histogram, the last bin holds longer queues */
+#define DELAY_BIN_US 100000 /*!< Width of a delay histogram bin */
+#define DELAY_BINS 6000     /*!< Delay histogram up to 10 minutes, then one overflow bin */
+#define PED_PENDING_MAX 64  /*!< Presses waiting for a walk */
+#define NEVER INT64_MAX     /*!< Time of an event not scheduled */
+#define REPLAY_MIN_S 0.25   /*!< Shortest wall time the replays are timed over */
+#define TARGET_EVENTS_S 1e6 /*!< Vehicle events per wall second wanted with the firmware in the loop */
+
+void app_main(void);
+extern const tlc_plan_t *timing_plan;
+extern bool low_power;
+
+/**
+ * @brief Microsimulator options
+ */
+typedef struct
+{
+    double hours;         /*!< Virtual hours to run */
+    double veh_per_hour;  /*!< Mean vehicles per hour per approach at the daily peak */
+    double ped_per_hour;  /*!< Mean pedestrian presses per hour */
+    double headway_s;     /*!< Saturation headway on green */
+    const char *trace;    /*!< Arrival trace, NULL for Poisson arrivals */
+    uint64_t seed;        /*!< PRNG seed */
+    int recall;           /*!< Crosswalks every service walks, -1 for the plan's own */
+    bool low_power;       /*!< Boot the firmware in low power mode, density in bursts */
+} traffic_options_t;
+
+/**
+ * @brief Counters of one approach
+ */
+typedef struct
+{
+    uint64_t arrived;               /*!< Vehicles arrived */
+    uint64_t departed;              /*!< Vehicles through the stop line */
+    uint64_t stopped;               /*!< Vehicles that queued */
+    uint64_t blocked;               /*!< Arrivals turned away by a full queue */
+    uint32_t queue_max;             /*!< Longest queue */
+    int64_t queue_us[QUEUE_BINS];   /*!< Time spent at each queue length */
+} approach_stats_t;
+
+/**
+ * @brief Outcome of the vehicle model, identical for a run and its replay
+ */
+typedef struct
+{
+    approach_stats_t approach[APPROACHES]; /*!< Per approach counters */
+    uint64_t delay[DELAY_BINS + 1];        /*!< Stopped delay of departed vehicles */
+    int64_t delay_sum_us;                  /*!< Total stopped delay */
+    int64_t delay_max_us;                  /*!< Longest stopped delay */
+    uint64_t events;                       /*!< Arrivals and departures run */
+} traffic_stats_t;
+
+/**
+ * @brief Vehicle queue and calendar of one approach
+ */
+typedef struct
+{
+    int64_t arrival[QUEUE_MAX]; /*!< Arrival times, oldest first */
+    uint32_t head;              /*!< Oldest vehicle */
+    uint32_t count;             /*!< Vehicles queued */
+    bool green;                 /*!< Green LED lit */
+    int64_t next_arrival;       /*!< Next arrival, NEVER past the end of a trace */
+    int64_t next_departure;     /*!< Next departure, NEVER unless discharging */
+    int64_t changed;            /*!< Last change of the queue length */
+    uint64_t rng;               /*!< Arrival stream */
+    const int64_t *trace;       /*!< Traced arrivals, NULL for Poisson */
+    size_t trace_count;         /*!< Traced arrivals */
+    size_t trace_next;          /*!< Next traced arrival */
+} approach_t;
+
+/**
+ * @brief Green LED change seen by the model
+ */
+typedef struct
+{
+    int64_t time;     /*!< Virtual time */
+    uint8_t approach; /*!< Approach */
+    bool green;       /*!< Green lit */
+} signal_change_t;
+
+/**
+ * @brief Arrival trace of one approach
+ */
+typedef struct
+{
+    int64_t *time;   /*!< Arrival times, ascending */
+    size_t count;    /*!< Arrivals */
+    size_t capacity; /*!< Allocated arrivals */
+} trace_t;
+
+/**
+ * @brief Pedestrian outcome, measured on the firmware run only
+ */
+typedef struct
+{
+    uint64_t presses;               /*!< Button presses */
+    uint64_t served;                /*!< Presses served by a walk */
+    uint64_t wait[DELAY_BINS + 1];  /*!< Press to walk time */
+    int64_t wait_sum_us;            /*!< Total press to walk time */
+    int64_t wait_max_us;            /*!< Longest press to walk time */
+    uint64_t walks[APPROACHES];     /*!< Walks shown on each crosswalk */
+    int64_t walk_us[APPROACHES];    /*!< Time each walk signal showed walk or flashed */
+    uint64_t empty;                 /*!< Walks shown with nobody waiting at the crosswalk */
+} ped_stats_t;
+
+/* Share of the peak rate in each hour of the day */
+static const double profile[24] = {
+    0.10, 0.05, 0.05, 0.05, 0.10, 0.25, 0.55, 0.90, 1.00, 0.75, 0.60, 0.60,
+    0.65, 0.60, 0.60, 0.70, 0.85, 1.00, 0.90, 0.65, 0.45, 0.35, 0.25, 0.15,
+};
+
+static const int buttons[] = {BUTTON_0, BUTTON_1, BUTTON_2, BUTTON_3};
+static const int green_pins[APPROACHES] = {LED_0, LED_3};
+static const int walk_pins[APPROACHES] = {WALK_0, WALK_1};
+static traffic_options_t opt = {.hours = 24.0, .veh_per_hour = 900.0, .ped_per_hour = 60.0, .headway_s = 2.0, .seed = 1,
+                                .recall = -1};
+static approach_t approach[APPROACHES];
+static traffic_stats_t stats;
+static int64_t headway_us;
+static trace_t traces[APPROACHES];
+static signal_change_t *timeline;
+static size_t timeline_count;
+static size_t timeline_capacity;
+static ped_stats_t ped;
+static int64_t ped_pending[APPROACHES][PED_PENDING_MAX];
+static uint32_t ped_pending_count[APPROACHES];
+static int64_t walk_fall[APPROACHES];
+static int64_t walk_start[APPROACHES];  /*!< Start of the walk being shown, 0 before the first */
+static tlc_plan_t recall_plan;
+static uint64_t ped_rng;
+
+static uint64_t rng_next(uint64_t *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+static double rng_uniform(uint64_t *state)
+{
+    return (double)(rng_next(state) >> 11) / 9007199254740992.0;
+}
+
+static int64_t rng_exponential(uint64_t *state, double mean_us)
+{
+    double u = rng_uniform(state);
+    return (int64_t)(-mean_us * __builtin_log(1.0 - u)) + 1;
+}
+
+static double wall_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void histogram_add(uint64_t *histogram, int64_t us)
+{
+    int64_t bin = us / DELAY_BIN_US;
+    histogram[bin < DELAY_BINS ? bin : DELAY_BINS]++;
+}
+
+/* Smallest bin holding at least share of the total, weights may be counts or time */
+static size_t histogram_percentile(const void *histogram, bool timed, size_t bins, double share)
+{
+    double total = 0;
+    for (size_t i = 0; i < bins; i++)
+    {
+        total += timed ? (double)((const int64_t *)histogram)[i] : (double)((const uint64_t *)histogram)[i];
+    }
+    double sum = 0;
+    for (size_t i = 0; i < bins; i++)
+    {
+        sum += timed ? (double)((const int64_t *)histogram)[i] : (double)((const uint64_t *)histogram)[i];
+        if (total > 0 && sum >= share * total)
+        {
+            return i;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Vehicle model
+ */
+
+static void arrival_schedule(approach_t *a, int64_t now)
+{
+    if (a->trace != NULL)
+    {
+        a->next_arrival = a->trace_next < a->trace_count ? a->trace[a->trace_next++] : NEVER;
+        return;
+    }
+    int hour = (int)((now / SIM_HOUR) % 24);
+    double rate = opt.veh_per_hour * profile[hour];
+    rate = rate < 1.0 ? 1.0 : rate;
+    a->next_arrival = now + rng_exponential(&a->rng, SIM_HOUR / rate);
+}
+
+/* Charge the time since the last change to the current queue length */
+static void queue_account(int index, int64_t now)
+{
+    approach_t *a = &approach[index];
+    uint32_t bin = a->count < QUEUE_BINS ? a->count : QUEUE_BINS - 1;
+    stats.approach[index].queue_us[bin] += now - a->changed;
+    a->changed = now;
+}
+
+static void vehicle_arrive(int index, int64_t now)
+{
+    approach_t *a = &approach[index];
+    approach_stats_t *s = &stats.approach[index];
+    s->arrived++;
+    if (a->green && a->count == 0)
+    {
+        /* Rolls through without stopping */
+        s->departed++;
+        stats.delay[0]++;
+    }
+    else if (a->count < QUEUE_MAX)
+    {
+        queue_account(index, now);
+        a->arrival[(a->head + a->count) % QUEUE_MAX] = now;
+        a->count++;
+        s->stopped++;
+        s->queue_max = a->count > s->queue_max ? a->count : s->queue_max;
+    }
+    else
+    {
+        s->blocked++;
+    }
+    arrival_schedule(a, now);
+}
+
+static void vehicle_depart(int index, int64_t now)
+{
+    approach_t *a = &approach[index];
+    int64_t delay = now - a->arrival[a->head];
+    queue_account(index, now);
+    a->head = (a->head + 1) % QUEUE_MAX;
+    a->count--;
+    stats.approach[index].departed++;
+    histogram_add(stats.delay, delay);
+    stats.delay_sum_us += delay;
+    stats.delay_max_us = delay > stats.delay_max_us ? delay : stats.delay_max_us;
+    a->next_departure = a->count ? now + headway_us : NEVER;
+}
+
+/* Run every vehicle event up to and including until, in time order */
+static void traffic_advance(int64_t until)
+{
+    for (;;)
+    {
+        int64_t next = NEVER;
+        int index = -1;
+        bool departure = false;
+        for (int i = 0; i < APPROACHES; i++)
+        {
+            /* Departures first on a tie, they free the stop line */
+            if (approach[i].next_departure < next)
+            {
+                next = approach[i].next_departure;
+                index = i;
+                departure = true;
+            }
+            if (approach[i].next_arrival < next)
+            {
+                next = approach[i].next_arrival;
+                index = i;
+                departure = false;
+            }
+        }
+        if (index < 0 || next > until)
+        {
+            return;
+        }
+        stats.events++;
+        if (departure)
+        {
+            vehicle_depart(index, next);
+        }
+        else
+        {
+            vehicle_arrive(index, next);
+        }
+    }
+}
+
+/* The first queued vehicle reaches the stop line one headway after green */
+static void traffic_signal(int index, bool green, int64_t now)
+{
+    approach_t *a = &approach[index];
+    a->green = green;
+    a->next_departure = green && a->count ? now + headway_us : NEVER;
+}
+
+static void traffic_init(void)
+{
+    memset(approach, 0, sizeof(approach));
+    memset(&stats, 0, sizeof(stats));
+    headway_us = (int64_t)(opt.headway_s * SIM_SECOND);
+    for (int i = 0; i < APPROACHES; i++)
+    {
+        approach_t *a = &approach[i];
+        a->next_departure = NEVER;
+        a->rng = (opt.seed ? opt.seed : 1) * 0x9e3779b97f4a7c15ULL + (uint64_t)i + 1;
+        a->trace = opt.trace ? traces[i].time : NULL;
+        a->trace_count = opt.trace ? traces[i].count : 0;
+        arrival_schedule(a, 0);
+    }
+}
+
+static void traffic_finish(int64_t end)
+{
+    traffic_advance(end);
+    for (int i = 0; i < APPROACHES; i++)
+    {
+        queue_account(i, end);
+    }
+}
+
+/*
+ * Firmware run
+ */
+
+/* Queue length drives the density input, the way a loop detector would */
+static void update_density(void)
+{
+    uint32_t cars = 0;
+    for (int i = 0; i < APPROACHES; i++)
+    {
+        cars += approach[i].count;
+    }
+    cars = cars > MAX_CARS ? MAX_CARS : cars;
+    int raw = (int)((cars * MAX_ADC_VAL + MAX_CARS - 1) / MAX_CARS);
+    sim_adc_set(ADC1_CHANNEL_6, raw > 4095 ? 4095 : raw);
+}
+
+static void density_block(void *arg)
+{
+    (void)arg;
+    traffic_advance(sim_now());
+    update_density();
+    sim_schedule(sim_now() + TLC_DENSITY_BLOCK_MS * 1000, density_block, NULL);
+}
+
+static void timeline_record(int64_t now, int index, bool green)
+{
+    if (timeline_count == timeline_capacity)
+    {
+        timeline_capacity = timeline_capacity ? 2 * timeline_capacity : 4096;
+        timeline = realloc(timeline, timeline_capacity * sizeof(*timeline));
+        if (timeline == NULL)
+        {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+    }
+    timeline[timeline_count++] = (signal_change_t){.time = now, .approach = (uint8_t)index, .green = green};
+}
+
+static void pedestrian_release(void *arg)
+{
+    sim_gpio_input((int)(intptr_t)arg, LOW);
+}
+
+static void pedestrian_press(void *arg)
+{
+    (void)arg;
+    int button = (int)(rng_next(&ped_rng) % 4);
+    int pin = buttons[button];
+    /* BUTTON_0 and BUTTON_1 are the two ends of crosswalk 0 */
+    int c = button / 2;
+    sim_gpio_input(pin, HIGH);
+    sim_schedule(sim_now() + 300000, pedestrian_release, (void *)(intptr_t)pin);
+    ped.presses++;
+    if (sim_gpio_output(walk_pins[c]) && sim_now() - walk_fall[c] > SIM_SECOND)
+    {
+        /* Walk already showing, the firmware treats the press as served */
+        ped.served++;
+        ped.wait[0]++;
+    }
+    else if (ped_pending_count[c] < PED_PENDING_MAX)
+    {
+        ped_pending[c][ped_pending_count[c]++] = sim_now();
+    }
+    /* Never overlap presses: both directions pressed together halts the lights */
+    sim_schedule(sim_now() + 300000 + rng_exponential(&ped_rng, SIM_HOUR / opt.ped_per_hour), pedestrian_press, NULL);
+}
+
+/* Close the walk shown on a crosswalk, ended by its last fall */
+static void walk_end(int c)
+{
+    if (walk_start[c])
+    {
+        ped.walk_us[c] += walk_fall[c] - walk_start[c];
+    }
+}
+
+static void observe_gpio(int pin, int level, int64_t now)
+{
+    for (int c = 0; c < APPROACHES; c++)
+    {
+        if (pin != walk_pins[c])
+        {
+            continue;
+        }
+        if (!level)
+        {
+            walk_fall[c] = now;
+        }
+        /* A walk starts after a dark signal, not on a warning blink */
+        else if (now - walk_fall[c] > SIM_SECOND)
+        {
+            walk_end(c);
+            walk_start[c] = now;
+            ped.walks[c]++;
+            ped.empty += ped_pending_count[c] == 0;
+            for (uint32_t i = 0; i < ped_pending_count[c]; i++)
+            {
+                int64_t wait = now - ped_pending[c][i];
+                histogram_add(ped.wait, wait);
+                ped.wait_sum_us += wait;
+                ped.wait_max_us = wait > ped.wait_max_us ? wait : ped.wait_max_us;
+            }
+            ped.served += ped_pending_count[c];
+            ped_pending_count[c] = 0;
+        }
+        return;
+    }
+    for (int i = 0; i < APPROACHES; i++)
+    {
+        if (pin == green_pins[i])
+        {
+            /* Vehicles due before the change see the old signal */
+            traffic_advance(now);
+            traffic_signal(i, level != 0, now);
+            timeline_record(now, i, level != 0);
+            update_density();
+        }
+    }
+}
+
+/* Replay the recorded signal timeline through the vehicle model alone */
+static void replay(int64_t end)
+{
+    traffic_init();
+    for (size_t i = 0; i < timeline_count; i++)
+    {
+        traffic_advance(timeline[i].time);
+        traffic_signal(timeline[i].approach, timeline[i].green, timeline[i].time);
+    }
+    traffic_finish(end);
+}
+
+/*
+ * Arrival traces
+ */
+
+static int trace_load(const char *path)
+{
+    FILE *file = fopen(path, "r");
+    if (file == NULL)
+    {
+        perror(path);
+        return -1;
+    }
+    char line[256];
+    unsigned number = 0;
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        number++;
+        double seconds;
+        int index;
+        char *text = line + strspn(line, " \t");
+        if (*text == '#' || *text == '\n' || *text == '\0')
+        {
+            continue;
+        }
+        if (sscanf(text, "%lf %d", &seconds, &index) != 2 || seconds < 0 || index < 0 || index >= APPROACHES)
+        {
+            fprintf(stderr, "%s:%u: expected \"<seconds> <approach 0-%d>\"\n", path, number, APPROACHES - 1);
+            fclose(file);
+            return -1;
+        }
+        trace_t *t = &traces[index];
+        int64_t time = (int64_t)(seconds * SIM_SECOND);
+        if (t->count && time < t->time[t->count - 1])
+        {
+            fprintf(stderr, "%s:%u: arrivals of approach %d out of order\n", path, number, index);
+            fclose(file);
+            return -1;
+        }
+        if (t->count == t->capacity)
+        {
+            t->capacity = t->capacity ? 2 * t->capacity : 1024;
+            t->time = realloc(t->time, t->capacity * sizeof(*t->time));
+            if (t->time == NULL)
+            {
+                fprintf(stderr, "out of memory\n");
+                fclose(file);
+                return -1;
+            }
+        }
+        t->time[t->count++] = time;
+    }
+    fclose(file);
+    return 0;
+}
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr,
+            "usage: %s [--hours H] [--plan NAME] [--veh-rate N] [--trace FILE] [--ped-rate N]\n"
+            "          [--headway S] [--seed S] [--recall MASK] [--low-power]\n"
+            "  --hours H     virtual hours to simulate (default 24)\n"
+            "  --plan NAME   pedestrian, actuated, coordinated or staged (default TLC_PLAN)\n"
+            "  --veh-rate N  peak Poisson vehicles per hour per approach (default 900)\n"
+            "  --trace FILE  vehicle arrivals, one \"<seconds> <approach>\" per line, instead of Poisson\n"
+            "  --ped-rate N  mean pedestrian presses per hour (default 60)\n"
+            "  --headway S   saturation headway on green in seconds (default 2)\n"
+            "  --seed S      random seed (default 1)\n"
+            "  --recall MASK walk the crosswalks in MASK on every service, 3 serves both on any call\n"
+            "  --low-power   boot the firmware in low power mode: density in bursts, not the 20 kHz stream\n",
+            argv0);
+}
+
+static int parse_options(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(arg, "--low-power") == 0)
+        {
+            opt.low_power = true;
+            continue;
+        }
+        if (value == NULL)
+        {
+            usage(argv[0]);
+            return -1;
+        }
+        if (strcmp(arg, "--hours") == 0)
+        {
+            opt.hours = atof(value);
+        }
+        else if (strcmp(arg, "--plan") == 0)
+        {
+            if (strcmp(value, "pedestrian") == 0)
+            {
+                timing_plan = &tlc_plan_pedestrian;
+            }
+            else if (strcmp(value, "actuated") == 0)
+            {
+                timing_plan = &tlc_plan_actuated;
+            }
+            else if (strcmp(value, "coordinated") == 0)
+            {
+                timing_plan = &tlc_plan_coordinated;
+            }
+            else if (strcmp(value, "staged") == 0)
+            {
+                timing_plan = &tlc_plan_staged;
+            }
+            else
+            {
+                usage(argv[0]);
+                return -1;
+            }
+        }
+        else if (strcmp(arg, "--veh-rate") == 0)
+        {
+            opt.veh_per_hour = atof(value);
+        }
+        else if (strcmp(arg, "--trace") == 0)
+        {
+            opt.trace = value;
+        }
+        else if (strcmp(arg, "--ped-rate") == 0)
+        {
+            opt.ped_per_hour = atof(value);
+        }
+        else if (strcmp(arg, "--headway") == 0)
+        {
+            opt.headway_s = atof(value);
+        }
+        else if (strcmp(arg, "--seed") == 0)
+        {
+            opt.seed = strtoull(value, NULL, 0);
+        }
+        else if (strcmp(arg, "--recall") == 0)
+        {
+            opt.recall = atoi(value);
+        }
+        else
+        {
+            usage(argv[0]);
+            return -1;
+        }
+        i++;
+    }
+    if (opt.hours <= 0 || opt.veh_per_hour <= 0 || opt.ped_per_hour <= 0 || opt.headway_s <= 0 ||
+        opt.recall >= 1 << APPROACHES)
+    {
+        usage(argv[0]);
+        return -1;
+    }
+    if (opt.recall >= 0)
+    {
+        /* The same plan, walking every crosswalk in the mask whoever called */
+        recall_plan = *timing_plan;
+        recall_plan.recall = (uint8_t)opt.recall;
+        timing_plan = &recall_plan;
+    }
+    return 0;
+}
+
+static void print_report(double run_s, double replay_s, unsigned replays, bool match)
+{
+    double hours = opt.hours;
+    printf("tlc_traffic: %s plan, %.1f h, ", timing_plan->name, hours);
+    if (opt.trace)
+    {
+        printf("arrivals from %s", opt.trace);
+    }
+    else
+    {
+        printf("Poisson peak %.0f veh/h per approach", opt.veh_per_hour);
+    }
+    printf(", %.0f presses/h, %.1f s headway, seed %llu", opt.ped_per_hour, opt.headway_s,
+           (unsigned long long)opt.seed);
+    if (timing_plan->recall)
+    {
+        printf(", recall %u", (unsigned)timing_plan->recall);
+    }
+    if (opt.low_power)
+    {
+        printf(", low power");
+    }
+    printf("\n");
+    printf("  %-8s %9s %9s %8s %9s %8s %6s %6s %8s\n", "approach", "arrived", "departed", "veh/h", "stopped %",
+           "queue", "p95", "max", "blocked");
+    uint64_t departed = 0;
+    for (int i = 0; i < APPROACHES; i++)
+    {
+        const approach_stats_t *s = &stats.approach[i];
+        double queued = 0;
+        int64_t total = 0;
+        for (int b = 0; b < QUEUE_BINS; b++)
+        {
+            queued += (double)b * s->queue_us[b];
+            total += s->queue_us[b];
+        }
+        printf("  %-8d %9llu %9llu %8.0f %9.1f %8.2f %6zu %6u %8llu\n", i, (unsigned long long)s->arrived,
+               (unsigned long long)s->departed, s->departed / hours,
+               s->arrived ? 100.0 * s->stopped / s->arrived : 0.0, total ? queued / total : 0.0,
+               histogram_percentile(s->queue_us, true, QUEUE_BINS, 0.95), (unsigned)s->queue_max,
+               (unsigned long long)s->blocked);
+        departed += s->departed;
+    }
+    static const double shares[] = {0.50, 0.90, 0.95, 0.99};
+    printf("  %-18s %8s %7s %7s %7s %7s %8s\n", "", "mean s", "p50", "p90", "p95", "p99", "max");
+    printf("  %-18s %8.2f", "vehicle delay", departed ? stats.delay_sum_us / 1e6 / departed : 0.0);
+    for (int i = 0; i < 4; i++)
+    {
+        printf(" %7.1f", histogram_percentile(stats.delay, false, DELAY_BINS + 1, shares[i]) * DELAY_BIN_US / 1e6);
+    }
+    printf(" %8.1f\n", stats.delay_max_us / 1e6);
+    printf("  %-18s %8.2f", "pedestrian wait", ped.served ? ped.wait_sum_us / 1e6 / ped.served : 0.0);
+    for (int i = 0; i < 4; i++)
+    {
+        printf(" %7.1f", histogram_percentile(ped.wait, false, DELAY_BINS + 1, shares[i]) * DELAY_BIN_US / 1e6);
+    }
+    printf(" %8.1f  (%llu of %llu presses served)\n", ped.wait_max_us / 1e6, (unsigned long long)ped.served,
+           (unsigned long long)ped.presses);
+    printf("  walk shown         :");
+    for (int c = 0; c < APPROACHES; c++)
+    {
+        printf(" crosswalk %d %.2f h in %llu walks,", c, ped.walk_us[c] / 3.6e9, (unsigned long long)ped.walks[c]);
+    }
+    printf(" %llu with nobody waiting\n", (unsigned long long)ped.empty);
+    printf("  %llu vehicle events, %zu signal changes: %.2f s with the firmware (%.0f events/s, %s)\n",
+           (unsigned long long)stats.events, timeline_count, run_s, stats.events / run_s,
+           opt.low_power ? "density bursts" : "20 kHz density");
+    printf("  target %.0e events/s with the firmware: %s\n", TARGET_EVENTS_S,
+           stats.events / run_s >= TARGET_EVENTS_S ? "met" : "MISSED");
+    printf("  model alone: %.0f events/s over %u replays, replay %s\n",
+           (double)stats.events * replays / replay_s, replays, match ? "matches" : "DIFFERS");
+}
+
+int main(int argc, char **argv)
+{
+    if (parse_options(argc, argv) != 0)
+    {
+        return 2;
+    }
+    if (opt.trace && trace_load(opt.trace) != 0)
+    {
+        return 1;
+    }
+    int64_t end = (int64_t)(opt.hours * SIM_HOUR);
+    ped_rng = (opt.seed ? opt.seed : 1) ^ 0x5bd1e995ULL;
+    traffic_init();
+    sim_gpio_set_hook(observe_gpio);
+    update_density();
+    low_power = opt.low_power;
+    double start = wall_seconds();
+    app_main();
+    sim_schedule(TLC_DENSITY_BLOCK_MS * 1000, density_block, NULL);
+    sim_schedule(rng_exponential(&ped_rng, SIM_HOUR / opt.ped_per_hour), pedestrian_press, NULL);
+    sim_run_until(end);
+    traffic_finish(end);
+    for (int c = 0; c < APPROACHES; c++)
+    {
+        walk_fall[c] = sim_gpio_output(walk_pins[c]) ? end : walk_fall[c];
+        walk_end(c);
+    }
+    double run_s = wall_seconds() - start;
+    traffic_stats_t run = stats;
+
+    /* Time the model on its own until the clock reads something meaningful */
+    unsigned replays = 0;
+    start = wall_seconds();
+    double replay_s;
+    do
+    {
+        replay(end);
+        replays++;
+        replay_s = wall_seconds() - start;
+    } while (replay_s < REPLAY_MIN_S);
+    bool match = memcmp(&run, &stats, sizeof(stats)) == 0;
+    stats = run;
+    print_report(run_s, replay_s, replays, match);
+    return match ? 0 : 1;
+}
@@ -0,0 +1,314 @@
+/**
+ * @file tlc_audio.c
+ * @brief Accessible pedestrian signal tones on the DAC source code
+ * @author Jorge Minjares (https://github.com/JorgeMinjares)
+ * @brief Step boundaries are kept on the grid of each cue's origin, so a
+ *        late timer never pushes the following steps back and both channels
+ *        of a cue started together change on the same callback. A tone is
+ *        gated by powering the channel's pad while the cosine generator runs.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include "tlc_audio.h"
+#include "../tlc_config.h"
+#include "../timer.h"
+#include "../tlc_trace.h"
+#include "../tlc_record.h"
+#include "esp_timer.h"
+#include "esp_pm.h"
+#include "freertos/FreeRTOS.h"
+
+const tlc_audio_cadence_t tlc_audio_cadences[TLC_AUDIO_CUES] = {
+    [TLC_AUDIO_OFF] = {.count = 0},
+    /* Quiet, so it is heard near the button only */
+    [TLC_AUDIO_LOCATOR] =
+        {
+            .steps = {{LOCATOR_ON_US, true}, {LOCATOR_PERIOD_US - LOCATOR_ON_US, false}},
+            .count = 2,
+            .scale = 2,
+            .period_us = LOCATOR_PERIOD_US,
+        },
+    [TLC_AUDIO_WALK] =
+        {
+            .steps = {{WALK_TICK_ON_US, true}, {WALK_TICK_PERIOD_US - WALK_TICK_ON_US, false}},
+            .count = 2,
+            .scale = 0,
+            .period_us = WALK_TICK_PERIOD_US,
+        },
+    /* On for one tick out of BEEP_TICKS */
+    [TLC_AUDIO_COUNTDOWN] =
+        {
+            .steps = {{BEEP_TICK_US, true}, {(BEEP_TICKS - 1) * BEEP_TICK_US, false}},
+            .count = 2,
+            .scale = 0,
+            .period_us = BEEP_TICKS * BEEP_TICK_US,
+        },
+};
+
+/**
+ * @brief Playback of one DAC channel
+ */
+typedef struct
+{
+    tlc_audio_cue_t cue;  /*!< Cue played */
+    int64_t origin;       /*!< Start of the cadence period being played */
+    int64_t next;         /*!< End of the step being played */
+    uint8_t step;         /*!< Step being played */
+    bool on;              /*!< Pad powered, the tone sounds */
+    bool hold;            /*!< Silent until the next step, the cue changed in the middle of it */
+    int64_t played;       /*!< Origin given to the last tlc_audio_play() */
+} tlc_audio_channel_t;
+
+static portMUX_TYPE audio_mux = portMUX_INITIALIZER_UNLOCKED;  /*!< Guards the channels and the timer */
+static tlc_audio_channel_t channels[DAC_CHANNEL_MAX];          /*!< Playback per channel */
+static esp_timer_handle_t audio_timer = NULL;                  /*!< One shot timer to the next step boundary */
+static uint32_t audio_hz;                                      /*!< Cosine generator frequency */
+static esp_pm_lock_handle_t audio_lock = NULL;                 /*!< Keeps the chip awake while a pad sounds, NULL without power management */
+static tlc_audio_stats_t audio_stats;                          /*!< Counters */
+
+/* DAC channel of an approach's buzzer, -1 if it has none */
+static int tlc_audio_channel(const tlc_t *tlc)
+{
+    if (tlc->buzzer == (gpio_num_t)25)
+    {
+        return DAC_CHANNEL_1;
+    }
+    if (tlc->buzzer == (gpio_num_t)26)
+    {
+        return DAC_CHANNEL_2;
+    }
+    return -1;
+}
+
+static void tlc_audio_gate(dac_channel_t channel, bool on)
+{
+    tlc_audio_channel_t *ch = &channels[channel];
+    if (ch->on == on)
+    {
+        return;
+    }
+    ch->on = on;
+    if (on)
+    {
+        /* The cosine generator stops in light sleep */
+        if (audio_lock != NULL)
+        {
+            esp_pm_lock_acquire(audio_lock);
+        }
+        dac_output_enable(channel);
+        audio_stats.tones++;
+    }
+    else
+    {
+        dac_output_disable(channel);
+        if (audio_lock != NULL)
+        {
+            esp_pm_lock_release(audio_lock);
+        }
+    }
+    tlc_trace(TLC_TRACE_TONE, channel, on ? ch->cue : 0);
+    tlc_record_tone(channel, on);
+}
+
+/* Find the step of a playing channel at time now */
+static void tlc_audio_seek(tlc_audio_channel_t *ch, int64_t now)
+{
+    const tlc_audio_cadence_t *cadence = &tlc_audio_cadences[ch->cue];
+    if (now < ch->origin)
+    {
+        now = ch->origin;
+    }
+    /* Whole periods are skipped, the steps stay on the origin's grid */
+    ch->origin += (now - ch->origin) / cadence->period_us * cadence->period_us;
+    int64_t end = ch->origin + cadence->steps[0].us;
+    uint8_t step = 0;
+    while (end <= now)
+    {
+        end += cadence->steps[++step].us;
+    }
+    ch->step = step;
+    ch->next = end;
+}
+
+/* Arm the timer for the earliest step boundary of every playing channel */
+static void tlc_audio_arm(int64_t now)
+{
+    int64_t next = -1;
+    for (int c = 0; c < DAC_CHANNEL_MAX; c++)
+    {
+        if (tlc_audio_cadences[channels[c].cue].count && (next < 0 || channels[c].next < next))
+        {
+            next = channels[c].next;
+        }
+    }
+    esp_timer_stop(audio_timer);
+    if (next >= 0)
+    {
+        esp_timer_start_once(audio_timer, next > now ? next - now : 1);
+    }
+}
+
+/* Move every channel past the boundaries reached by now, gate them and re-arm */
+static void tlc_audio_advance(int64_t now)
+{
+    for (int c = 0; c < DAC_CHANNEL_MAX; c++)
+    {
+        tlc_audio_channel_t *ch = &channels[c];
+        if (tlc_audio_cadences[ch->cue].count && ch->next <= now)
+        {
+            if (now - ch->next > audio_stats.late_max_us)
+            {
+                audio_stats.late_max_us = (uint32_t)(now - ch->next);
+            }
+            tlc_audio_seek(ch, now);
+            ch->hold = false;
+        }
+    }
+    /* Every boundary reached is written back to back */
+    for (int c = 0; c < DAC_CHANNEL_MAX; c++)
+    {
+        const tlc_audio_cadence_t *cadence = &tlc_audio_cadences[channels[c].cue];
+        tlc_audio_gate(c, cadence->count && cadence->steps[channels[c].step].on && !channels[c].hold);
+    }
+    tlc_audio_arm(now);
+}
+
+static void tlc_audio_callback(void *arg)
+{
+    (void)arg;
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&audio_mux);
+    tlc_audio_advance(now);
+    portEXIT_CRITICAL(&audio_mux);
+}
+
+/**
+ * @brief Start the tone generator, silent
+ *
+ * @param tone_hz tone frequency, 130 Hz to 55 kHz, shared by both channels
+ * @return ESP_OK or the esp_timer error
+ * @note Call once, after tlc_bsp_init() of the approaches with a buzzer
+ */
+esp_err_t tlc_audio_init(uint32_t tone_hz)
+{
+    audio_hz = tone_hz;
+    for (int c = 0; c < DAC_CHANNEL_MAX; c++)
+    {
+        channels[c] = (tlc_audio_channel_t){.cue = TLC_AUDIO_OFF};
+        dac_output_disable(c);
+        dac_cw_config_t cw = {
+            .en_ch = c,
+            .scale = DAC_CW_SCALE_1,
+            .phase = DAC_CW_PHASE_0,
+            .freq = tone_hz,
+            .offset = 0,
+        };
+        dac_cw_generator_config(&cw);
+    }
+    dac_cw_generator_enable();
+    if (esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "audio", &audio_lock) != ESP_OK)
+    {
+        audio_lock = NULL;
+    }
+    esp_timer_create_args_t timer_args = {
+        .callback = tlc_audio_callback,
+        .arg = NULL,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "Audio Timer",
+        .skip_unhandled_events = true,
+    };
+    return esp_timer_create(&timer_args, &audio_timer);
+}
+
+/**
+ * @brief Play a cue on each approach
+ *
+ * @param tlc approaches
+ * @param cues cue of each approach
+ * @param count number of approaches
+ * @param origin time the cadences count from, the same for every approach
+ *               so their steps line up
+ * @note Returns immediately. An approach already playing its cue keeps
+ *       going undisturbed, approaches without a buzzer are skipped. Every
+ *       channel that changes does so in the same burst of register writes.
+ *       A cue changed again with the same origin, later in the same phase,
+ *       waits for its next step instead of sounding part of a tone.
+ */
+void tlc_audio_play(const tlc_t *tlc, const tlc_audio_cue_t *cues, uint8_t count, int64_t origin)
+{
+    if (audio_timer == NULL)
+    {
+        return;
+    }
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&audio_mux);
+    for (uint8_t i = 0; i < count; i++)
+    {
+        int c = tlc_audio_channel(&tlc[i]);
+        if (c < 0 || cues[i] >= TLC_AUDIO_CUES)
+        {
+            continue;
+        }
+        tlc_audio_channel_t *ch = &channels[c];
+        bool again = ch->played == origin;
+        ch->played = origin;
+        if (ch->cue == cues[i])
+        {
+            continue;
+        }
+        ch->cue = cues[i];
+        ch->origin = origin;
+        const tlc_audio_cadence_t *cadence = &tlc_audio_cadences[ch->cue];
+        if (cadence->count)
+        {
+            dac_cw_config_t cw = {
+                .en_ch = c,
+                .scale = (dac_cw_scale_t)cadence->scale,
+                .phase = DAC_CW_PHASE_0,
+                .freq = audio_hz,
+                .offset = 0,
+            };
+            dac_cw_generator_config(&cw);
+            tlc_audio_seek(ch, now);
+            /* Changed later in the same phase: a tone already under way is skipped, not clipped */
+            ch->hold = again && ch->next - cadence->steps[ch->step].us < now;
+            audio_stats.cues++;
+        }
+    }
+    /* A boundary due now on a channel left alone is taken here rather than after the timer */
+    tlc_audio_advance(now);
+    portEXIT_CRITICAL(&audio_mux);
+}
+
+/**
+ * @brief Cue a DAC channel plays
+ *
+ * @param channel DAC channel
+ * @return cue, TLC_AUDIO_OFF if silent
+ */
+tlc_audio_cue_t tlc_audio_playing(dac_channel_t channel)
+{
+    if (channel >= DAC_CHANNEL_MAX)
+    {
+        return TLC_AUDIO_OFF;
+    }
+    portENTER_CRITICAL(&audio_mux);
+    tlc_audio_cue_t cue = channels[channel].cue;
+    portEXIT_CRITICAL(&audio_mux);
+    return cue;
+}
+
+/**
+ * @brief Read the audio counters
+ *
+ * @param stats receives the counters
+ */
+void tlc_audio_get_stats(tlc_audio_stats_t *stats)
+{
+    portENTER_CRITICAL(&audio_mux);
+    *stats = audio_stats;
+    portEXIT_CRITICAL(&audio_mux);
+}
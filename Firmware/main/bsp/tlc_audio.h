@@ -0,0 +1,84 @@
+/**
+ * @file tlc_audio.h
+ * @brief Accessible pedestrian signal tones on the DAC
+ * @author Jorge Minjares (https://github.com/JorgeMinjares)
+ * @brief The DAC cosine generator makes the tone in hardware on both
+ *        channels, so no CPU time or DMA buffer is spent per sample. Each
+ *        cue is a precomputed cadence table of on and off steps; a single
+ *        esp_timer walks the tables of both channels and gates their pads at
+ *        the same instant. Starting a cue only updates the tables and the
+ *        timer, so the caller never waits for a tone to finish.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef TLC_AUDIO_H
+#define TLC_AUDIO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <driver/dac.h>
+#include "../traffic_light.h"
+#include "esp_err.h"
+
+/**
+ * @brief Sound of one approach
+ */
+typedef enum
+{
+    TLC_AUDIO_OFF = 0,        /*!< Silent */
+    TLC_AUDIO_LOCATOR = 1,    /*!< Locator tone, where the button is, through DON'T WALK */
+    TLC_AUDIO_WALK = 2,       /*!< Rapid tick through WALK */
+    TLC_AUDIO_COUNTDOWN = 3,  /*!< Beep through the walk warning */
+    TLC_AUDIO_CUES,           /*!< Cue count */
+} tlc_audio_cue_t;
+
+/**
+ * @brief One step of a cadence
+ */
+typedef struct
+{
+    uint32_t us;  /*!< Step length */
+    bool on;      /*!< Tone sounds through the step */
+} tlc_audio_step_t;
+
+#define TLC_AUDIO_MAX_STEPS 4 /*!< Steps of the longest cadence */
+
+/******************************************************************
+ * \struct tlc_audio_cadence_t tlc_audio.h
+ * \brief Steps a cue repeats while it plays
+ *
+ * ### Example
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~.c
+ * tlc_audio_cue_t cues[2] = {TLC_AUDIO_WALK, TLC_AUDIO_WALK};
+ * tlc_audio_play(tlc, cues, 2, esp_timer_get_time());
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *******************************************************************/
+typedef struct
+{
+    tlc_audio_step_t steps[TLC_AUDIO_MAX_STEPS];  /*!< Steps, the first one starts at the cue's origin */
+    uint8_t count;                                /*!< Steps in use, 0 for a silent cue */
+    uint8_t scale;                                /*!< Tone amplitude, full scale >> scale */
+    uint32_t period_us;                           /*!< Sum of the steps */
+} tlc_audio_cadence_t;
+
+extern const tlc_audio_cadence_t tlc_audio_cadences[TLC_AUDIO_CUES];
+
+/**
+ * @brief Audio counters
+ */
+typedef struct
+{
+    uint32_t cues;         /*!< Cues started on a channel */
+    uint32_t tones;        /*!< Tones sounded */
+    uint32_t late_max_us;  /*!< Longest a step boundary waited for the timer */
+} tlc_audio_stats_t;
+
+esp_err_t tlc_audio_init(uint32_t tone_hz);
+void tlc_audio_play(const tlc_t *tlc, const tlc_audio_cue_t *cues, uint8_t count, int64_t origin);
+tlc_audio_cue_t tlc_audio_playing(dac_channel_t channel);
+void tlc_audio_get_stats(tlc_audio_stats_t *stats);
+
+#endif
@@ -9,14 +9,65 @@
  * @copyright Copyright (c) 2022
  */
 #include "tlc_bsp.h"
+#include "tlc_pattern.h"
+#include "../timer.h"
+#include "../tlc_record.h"
+#include "soc/soc.h"
+#include "soc/gpio_reg.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include <driver/gpio.h>
 #include <driver/dac.h>
 #include <driver/adc.h>
+#include "esp_adc_cal.h"
+#include "esp_pm.h"
+#include "esp_sleep.h"
 #include "driver/uart.h"
 #include <string.h>
 
+#define TLC_BSP_ADC_FRAME_BYTES 1024 /*!< Bytes per DMA frame, 512 conversions */
+#define TLC_BSP_ADC_BURST_FRAME_BYTES 128 /*!< Bytes per DMA frame in bursts, 64 conversions, one low power density block */
+#define TLC_BSP_ADC_BUFFER_BYTES (8 * TLC_BSP_ADC_FRAME_BYTES) /*!< Driver ring buffer, 200 ms at 20 kHz */
+#define TLC_BSP_WAKE_PINS 5 /*!< Inputs that wake the chip: four buttons and the preemption input */
+#define TLC_BSP_UART_WAKE_EDGES 3 /*!< RX edges that wake the chip, the bytes carrying them are lost */
+
+/**
+ * @brief Input that wakes the chip from light sleep
+ */
+typedef struct
+{
+    gpio_num_t pin;  /*!< Input */
+    gpio_isr_t isr;  /*!< Handler of both edges */
+    void *arg;       /*!< Handler argument */
+} tlc_bsp_wake_t;
+
+static esp_adc_cal_characteristics_t adc_chars;      /*!< ADC1 calibration */
+static bool light_sleep = false;                     /*!< tlc_bsp_power_init() enabled light sleep */
+static tlc_bsp_wake_t wake_pins[TLC_BSP_WAKE_PINS];  /*!< Inputs attached while light sleep is on */
+static uint8_t wake_count = 0;                       /*!< wake_pins in use */
+static tlc_pattern_t yellow_blink;                   /*!< Blink of tlc_bsp_yellow_toggle() */
+static tlc_pattern_t walk_blink[TLC_BSP_MAX_DIRECTIONS]; /*!< Blinks of tlc_bsp_walk_warning() */
+
+/**
+ * @brief Find the walk warning blink of an approach
+ * 
+ * @param tlc pointer to a tlc structure
+ * @return tlc_pattern_t* pattern used for its walk signal
+ */
+static tlc_pattern_t *tlc_bsp_walk_blink(tlc_t * const tlc){
+    for(int i = 0; i < TLC_BSP_MAX_DIRECTIONS; i++){
+        if(walk_blink[i].count && walk_blink[i].pins[0] == tlc->walkingSignal){
+            return &walk_blink[i];
+        }
+    }
+    for(int i = 0; i < TLC_BSP_MAX_DIRECTIONS; i++){
+        if(walk_blink[i].count == 0){
+            return &walk_blink[i];
+        }
+    }
+    return &walk_blink[0];
+}
+
 /**
  * @brief Initialize bsp LEDs
  * 
@@ -75,21 +126,17 @@ void tlc_bsp_yellow_led_off(tlc_t * const tlc){
 /**
  * @brief Toggle Yellow LED
  * 
- * @param tlc pointer to a tlc structure
+ * @param tlc_0 pointer to a tlc structure
+ * @param tlc_1 pointer to a tlc structure
+ * @note Starts the blink on a timer and returns immediately. The blink runs
+ *       until tlc_bsp_lights() sets the next state.
  * @return None
  */
 void tlc_bsp_yellow_toggle(tlc_t * const tlc_0, tlc_t * const tlc_1){
+    const gpio_num_t pins[] = {tlc_0->led[1], tlc_1->led[1]};
     tlc_bsp_green_led_off(tlc_0);
     tlc_bsp_green_led_off(tlc_1);
-    for (int i = 0; i < 10; i++)
-        {
-            tlc_bsp_yellow_led_on(tlc_0);
-            tlc_bsp_yellow_led_on(tlc_1);
-            vTaskDelay(250 / portTICK_PERIOD_MS);
-            tlc_bsp_yellow_led_off(tlc_0);
-            tlc_bsp_yellow_led_off(tlc_1);
-            vTaskDelay(250 / portTICK_PERIOD_MS);
-        }
+    tlc_pattern_start(&yellow_blink, pins, 2, YELLOW_BLINK_US, YELLOW_BLINK_US, TLC_PATTERN_FOREVER);
 }
 
 /**
@@ -137,6 +184,90 @@ uint8_t tlc_bsp_button_read(tlc_t * const tlc){
    return gpio_get_level(tlc->button[0]) | gpio_get_level(tlc->button[1]);
 
 }
+/**
+ * @brief Run an input's handler and wait for its other level
+ * 
+ * @param arg tlc_bsp_wake_t of the input
+ * @note Only level interrupts wake the ESP32 from light sleep, so inputs
+ *       that must wake it trigger on the level they are not at. Flipping
+ *       the level on every interrupt fires the handler once per edge, and
+ *       a held input lets the chip sleep.
+ */
+static void tlc_bsp_wake_isr(void *arg){
+    tlc_bsp_wake_t *wake = arg;
+    gpio_wakeup_enable(wake->pin, gpio_get_level(wake->pin) ? GPIO_INTR_LOW_LEVEL : GPIO_INTR_HIGH_LEVEL);
+    wake->isr(wake->arg);
+}
+/**
+ * @brief Attach a handler to both edges of an input
+ * 
+ * @param pin input
+ * @param isr handler
+ * @param arg argument passed to isr
+ * @note With light sleep on, the input also wakes the chip
+ */
+static void tlc_bsp_edge_isr_add(gpio_num_t pin, gpio_isr_t isr, void *arg){
+    if(light_sleep && wake_count < TLC_BSP_WAKE_PINS){
+        tlc_bsp_wake_t *wake = &wake_pins[wake_count++];
+        *wake = (tlc_bsp_wake_t){.pin = pin, .isr = isr, .arg = arg};
+        gpio_wakeup_enable(pin, gpio_get_level(pin) ? GPIO_INTR_LOW_LEVEL : GPIO_INTR_HIGH_LEVEL);
+        gpio_isr_handler_add(pin, tlc_bsp_wake_isr, wake);
+    }
+    else{
+        gpio_set_intr_type(pin, GPIO_INTR_ANYEDGE);
+        gpio_isr_handler_add(pin, isr, arg);
+    }
+    gpio_intr_enable(pin);
+}
+/**
+ * @brief Attach an edge interrupt handler to bsp buttons
+ * 
+ * @param tlc pointer to a tlc structure
+ * @param isr handler
+ * @param args argument passed to isr, one per button
+ * @note Call after tlc_bsp_button_init(). Buttons on GPIO_NUM_NC are skipped.
+ * @return None
+ */
+void tlc_bsp_button_isr_init(tlc_t * const tlc, gpio_isr_t isr, void * const args[2]){
+    /* ESP_ERR_INVALID_STATE only means the service is already installed */
+    gpio_install_isr_service(0);
+    for(int i = 0; i < 2; i++){
+        if(tlc->button[i] == GPIO_NUM_NC){
+            continue;
+        }
+        tlc_bsp_edge_isr_add(tlc->button[i], isr, args[i]);
+    }
+}
+/**
+ * @brief Initialize the preemption input and attach its edge interrupt
+ * 
+ * @param pin preemption input, active high
+ * @param isr handler, runs on both edges
+ * @param arg argument passed to isr
+ * @note The pulldown holds the input inactive while the detector is
+ *       unplugged. GPIO_NUM_NC does nothing.
+ * @return None
+ */
+void tlc_bsp_preempt_init(gpio_num_t pin, gpio_isr_t isr, void *arg){
+    if(pin == GPIO_NUM_NC){
+        return;
+    }
+    gpio_pad_select_gpio(pin);
+    gpio_set_direction(pin, GPIO_MODE_INPUT);
+    gpio_set_pull_mode(pin, GPIO_PULLDOWN_ONLY);
+    /* ESP_ERR_INVALID_STATE only means the service is already installed */
+    gpio_install_isr_service(0);
+    tlc_bsp_edge_isr_add(pin, isr, arg);
+}
+/**
+ * @brief Read the preemption input
+ * 
+ * @param pin preemption input
+ * @return gpio level, 0 for GPIO_NUM_NC
+ */
+uint8_t tlc_bsp_preempt_read(gpio_num_t pin){
+    return pin == GPIO_NUM_NC ? 0 : (uint8_t)gpio_get_level(pin);
+}
 /**
  * @brief Initialize bsp buzzer
  * 
@@ -159,6 +290,9 @@ void tlc_bsp_buzzer_init(tlc_t * const tlc){
  * @return None
  */
 void tlc_bsp_buzzer_on(tlc_t * const tlc, uint8_t volume){
+    if(tlc->buzzer == GPIO_NUM_NC){
+        return;
+    }
     dac_channel_t channel = tlc->buzzer == (gpio_num_t)25 ? DAC_CHANNEL_1 : DAC_CHANNEL_2;
     dac_output_voltage(channel, volume);
 }
@@ -170,6 +304,9 @@ void tlc_bsp_buzzer_on(tlc_t * const tlc, uint8_t volume){
  * @return None
  */
 void tlc_bsp_buzzer_off(tlc_t * const tlc){
+    if(tlc->buzzer == GPIO_NUM_NC){
+        return;
+    }
     dac_channel_t channel = tlc->buzzer == (gpio_num_t)25 ? DAC_CHANNEL_1 : DAC_CHANNEL_2;
     dac_output_voltage(channel, 0);
 }
@@ -192,9 +329,11 @@ void tlc_bsp_walk_init(tlc_t * const tlc){
  * @brief Turn on walk signal
  * 
  * @param tlc pointer to a tlc structure
+ * @note Cancels a running walk warning
  * @return None
  */
 void tlc_bsp_walk_on(tlc_t * const tlc){
+    tlc_pattern_cancel(tlc_bsp_walk_blink(tlc));
     gpio_set_level(tlc->walkingSignal, HIGH);
 }
 
@@ -202,9 +341,11 @@ void tlc_bsp_walk_on(tlc_t * const tlc){
  * @brief Turn off walk signal
  * 
  * @param tlc pointer to a tlc structure
+ * @note Cancels a running walk warning
  * @return None
  */
 void tlc_bsp_walk_off(tlc_t * const tlc){
+    tlc_pattern_cancel(tlc_bsp_walk_blink(tlc));
     gpio_set_level(tlc->walkingSignal, LOW);
 }
 
@@ -212,15 +353,12 @@ void tlc_bsp_walk_off(tlc_t * const tlc){
  * @brief Toggle walk signal
  * 
  * @param tlc pointer to a tlc structure
+ * @note Starts the blink on a timer and returns immediately. The blink runs
+ *       until tlc_bsp_walk_on() or tlc_bsp_walk_off() is called.
  * @return None
  */
 void tlc_bsp_walk_warning(tlc_t * const tlc){
-    for(int i = 0; i < 4; i++){
-        tlc_bsp_walk_on(tlc);
-        vTaskDelay(100 / portTICK_PERIOD_MS);
-        tlc_bsp_walk_off(tlc);
-        vTaskDelay(100 / portTICK_PERIOD_MS);
-    }
+    tlc_pattern_start(tlc_bsp_walk_blink(tlc), &tlc->walkingSignal, 1, WALK_BLINK_US, WALK_BLINK_US, TLC_PATTERN_FOREVER);
 }
 
 /**
@@ -241,47 +379,220 @@ void tlc_bsp_init(tlc_t * const tlc){
  * 
  * @param tlc pointer to a tlc structure
  * @param state current state
+ * @note All three LEDs change in one W1TC and one W1TS write
  * @return None
  */
 void tlc_bsp_lights(state_t state, tlc_t * const tlc)
 {
-    if (state == GREEN)
+    tlc_bsp_mask_t mask = {0};
+    /* A new state ends the yellow blink */
+    tlc_pattern_cancel(&yellow_blink);
+    /* led[] is ordered like state_t: GREEN, YELLOW, RED */
+    for (int i = 0; i < 3; i++)
     {
-        tlc_bsp_green_led_on(tlc);
-        tlc_bsp_yellow_led_off(tlc);
-        tlc_bsp_red_led_off(tlc);
+        tlc_bsp_mask_pin(&mask, tlc->led[i], i == (int)state ? HIGH : LOW);
     }
-    else if (state == YELLOW)
+    tlc_bsp_mask_write(&mask);
+}
+
+/**
+ * @brief Add a pin to an output mask
+ * 
+ * @param mask mask to update
+ * @param pin output pin, GPIO_NUM_NC adds nothing
+ * @param level level the pin is driven to when the mask is written
+ * @return None
+ */
+void tlc_bsp_mask_pin(tlc_bsp_mask_t * const mask, gpio_num_t pin, uint32_t level)
+{
+    if (pin == GPIO_NUM_NC)
+    {
+        return;
+    }
+    int bank = pin < 32 ? 0 : 1;
+    uint32_t bit = 1UL << (pin & 31);
+    if (level)
     {
-        tlc_bsp_green_led_off(tlc);
-        tlc_bsp_yellow_led_on(tlc);
-        tlc_bsp_red_led_off(tlc);
+        mask->set[bank] |= bit;
+        mask->clr[bank] &= ~bit;
     }
-    else if (state == RED)
+    else
     {
-        tlc_bsp_green_led_off(tlc);
-        tlc_bsp_yellow_led_off(tlc);
-        tlc_bsp_red_led_on(tlc);
+        mask->clr[bank] |= bit;
+        mask->set[bank] &= ~bit;
     }
 }
 
 /**
- * @brief Initialize bsp adc
+ * @brief Write an output mask
  * 
+ * @param mask pins to set and clear
+ * @note One W1TC then one W1TS register write per bank in use. Clearing first
+ *       means no two aspects of a direction are ever lit together.
  * @return None
  */
-void tlc_bsp_adc_init(void){
-    adc1_config_width(ADC_WIDTH_BIT_12);
-    adc1_config_channel_atten(ADC1_CHANNEL_6, ADC_ATTEN_DB_11);
+void tlc_bsp_mask_write(const tlc_bsp_mask_t * const mask)
+{
+    tlc_record_output((uint64_t)mask->set[1] << 32 | mask->set[0], (uint64_t)mask->clr[1] << 32 | mask->clr[0]);
+    if (mask->clr[0])
+    {
+        REG_WRITE(GPIO_OUT_W1TC_REG, mask->clr[0]);
+    }
+    if (mask->set[0])
+    {
+        REG_WRITE(GPIO_OUT_W1TS_REG, mask->set[0]);
+    }
+    if (mask->clr[1])
+    {
+        REG_WRITE(GPIO_OUT1_W1TC_REG, mask->clr[1]);
+    }
+    if (mask->set[1])
+    {
+        REG_WRITE(GPIO_OUT1_W1TS_REG, mask->set[1]);
+    }
+}
+
+/**
+ * @brief Precompile the outputs of one intersection aspect
+ * 
+ * @param out compiled output
+ * @param tlc array of tlc structures, one per approach
+ * @param count number of approaches
+ * @param light aspect of every approach
+ * @param walk_mask approaches whose walk signal shows walk
+ * @param walk walk signal state for those approaches, the rest stay off
+ * @note Call once per aspect after tlc_bsp_init() on every approach
+ * @return None
+ */
+void tlc_bsp_output_compile(tlc_bsp_output_t * const out, tlc_t * const tlc, uint8_t count,
+                            const state_t * const light, uint8_t walk_mask, walk_t walk)
+{
+    memset(out, 0, sizeof(*out));
+    count = count < TLC_BSP_MAX_DIRECTIONS ? count : TLC_BSP_MAX_DIRECTIONS;
+    for (uint8_t d = 0; d < count; d++)
+    {
+        bool walking = (walk_mask & (1U << d)) && walk != WALK_OFF;
+        /* led[] is ordered like state_t: GREEN, YELLOW, RED */
+        for (int i = 0; i < 3; i++)
+        {
+            tlc_bsp_mask_pin(&out->mask, tlc[d].led[i], i == (int)light[d] ? HIGH : LOW);
+        }
+        /* Warning starts lit, then the pattern takes over */
+        tlc_bsp_mask_pin(&out->mask, tlc[d].walkingSignal, walking ? HIGH : LOW);
+        if (light[d] == YELLOW)
+        {
+            out->yellow[out->yellow_count++] = tlc[d].led[1];
+        }
+        if (walking && walk == WALK_WARNING)
+        {
+            out->walk[out->walk_count++] = tlc[d].walkingSignal;
+        }
+    }
+}
+
+/**
+ * @brief Initialize bsp adc in continuous mode
+ * 
+ * @param bursts false to start converting now, true to convert only
+ *        between tlc_bsp_adc_start() and tlc_bsp_adc_stop()
+ * @return ESP_OK or the driver error
+ * @note DMA converts ADC1_CHANNEL_6 at DENSITY_SAMPLE_HZ into the driver
+ *       ring buffer; nothing wakes up per sample. The driver keeps the chip
+ *       out of light sleep while converting, and bursts use short frames so
+ *       their conversions reach the ring buffer as soon as they are done.
+ */
+esp_err_t tlc_bsp_adc_init(bool bursts){
+    adc_digi_init_config_t init_config = {
+        .max_store_buf_size = TLC_BSP_ADC_BUFFER_BYTES,
+        .conv_num_each_intr = bursts ? TLC_BSP_ADC_BURST_FRAME_BYTES : TLC_BSP_ADC_FRAME_BYTES,
+        .adc1_chan_mask = BIT(ADC1_CHANNEL_6),
+        .adc2_chan_mask = 0,
+    };
+    adc_digi_pattern_config_t pattern = {
+        .atten = ADC_ATTEN_DB_11,
+        .channel = ADC1_CHANNEL_6,
+        .unit = 0,
+        .bit_width = 12,
+    };
+    adc_digi_configuration_t config = {
+        .conv_limit_en = ADC_CONV_LIMIT_EN,
+        .conv_limit_num = 250,
+        .pattern_num = 1,
+        .adc_pattern = &pattern,
+        .sample_freq_hz = DENSITY_SAMPLE_HZ,
+        .conv_mode = ADC_CONV_SINGLE_UNIT_1,
+        .format = ADC_DIGI_OUTPUT_FORMAT_TYPE1,
+    };
+    esp_adc_cal_characterize(ADC_UNIT_1, ADC_ATTEN_DB_11, ADC_WIDTH_BIT_12, 1100, &adc_chars);
+    esp_err_t err = adc_digi_initialize(&init_config);
+    if (err == ESP_OK)
+    {
+        err = adc_digi_controller_configure(&config);
+    }
+    if (err == ESP_OK && !bursts)
+    {
+        err = adc_digi_start();
+    }
+    return err;
+}
+/**
+ * @brief Start a burst of conversions
+ * 
+ * @return ESP_OK or the driver error
+ */
+esp_err_t tlc_bsp_adc_start(void){
+    return adc_digi_start();
 }
 /**
- * @brief Read adc channel
+ * @brief End a burst of conversions
  * 
- * @return raw adc value
- * @note ADC is set at 12 bits resolution: 0-4096
+ * @note Conversions left in the ring buffer are dropped, so the next burst
+ *       starts with fresh ones
  */
-uint32_t tlc_bsp_adc_read(void){
-    return adc1_get_raw(ADC1_CHANNEL_6);  
+void tlc_bsp_adc_stop(void){
+    uint8_t frame[TLC_BSP_ADC_BURST_FRAME_BYTES];
+    uint32_t length;
+    adc_digi_stop();
+    while (adc_digi_read_bytes(frame, sizeof(frame), &length, 0) == ESP_OK && length > 0)
+    {
+    }
+}
+/**
+ * @brief Read the conversions collected since the last call
+ * 
+ * @param samples buffer for 12-bit conversions, oldest first
+ * @param max buffer size in samples
+ * @return number of samples stored, 0 when the buffer is drained
+ * @note Never blocks. Conversions lost to a full driver buffer are skipped.
+ */
+size_t tlc_bsp_adc_read(uint16_t *samples, size_t max){
+    uint32_t length = 0;
+    /* Conversions are 16-bit words, decode them in place */
+    adc_digi_output_data_t *data = (adc_digi_output_data_t *)samples;
+    esp_err_t err = adc_digi_read_bytes((uint8_t *)data, max * sizeof(*data), &length, 0);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE)
+    {
+        return 0;
+    }
+    size_t count = 0;
+    for (size_t i = 0; i < length / sizeof(*data); i++)
+    {
+        if (data[i].type1.channel == ADC1_CHANNEL_6)
+        {
+            samples[count++] = data[i].type1.data;
+        }
+    }
+    return count;
+}
+/**
+ * @brief Convert a raw conversion to millivolts
+ * 
+ * @param raw 12-bit conversion
+ * @return calibrated voltage in mV
+ * @note Uses the eFuse calibration read by tlc_bsp_adc_init()
+ */
+uint32_t tlc_bsp_adc_mv(uint32_t raw){
+    return esp_adc_cal_raw_to_voltage(raw, &adc_chars);
 }
 
 /**
@@ -314,6 +625,17 @@ void tlc_bsp_uart_init(void){
 void tlc_bsp_uart_write_byte(char*str){
     uart_write_bytes(UART_NUM_0, (const char *)str, strlen(str));
 }
+/**
+ * @brief Write binary data to uart driver
+ * 
+ * @param data bytes to be sent
+ * @param size number of bytes
+ * @note Utilze UART-0 at 115200 b/s 
+ */
+void tlc_bsp_uart_write(const uint8_t *data, size_t size){
+    uart_write_bytes(UART_NUM_0, (const char *)data, size);
+}
+
 /**
  * @brief Read single byte from uart driver
  * 
@@ -323,16 +645,44 @@ void tlc_bsp_uart_write_byte(char*str){
 int tlc_bsp_uart_read_byte(char *c){
     return uart_read_bytes(UART_NUM_0, (void *)c, 1, portMAX_DELAY);
 }
+
+/**
+ * @brief Read single byte from uart driver without waiting
+ * 
+ * @param c character to store byte
+ * @return int total bytes read, 0 if nothing arrived
+ */
+int tlc_bsp_uart_poll_byte(char *c){
+    return uart_read_bytes(UART_NUM_0, (void *)c, 1, 0);
+}
+
 /**
- * @brief Map value
+ * @brief Turn on automatic light sleep
  * 
- * @param x         value to be mapped
- * @param in_min    input minimum
- * @param in_max    input maximum
- * @param out_min   output minimum
- * @param out_max   output maximum
- * @return uint16_t value mapped
+ * @return ESP_OK, ESP_ERR_NOT_SUPPORTED without CONFIG_PM_ENABLE (set by
+ *         sdkconfig.defaults.lowpower) or the driver error
+ * @note Call after tlc_bsp_uart_init() and before any button or preemption
+ *       handler is attached, so they wake the chip. Idle FreeRTOS ticks are
+ *       skipped (CONFIG_FREERTOS_USE_TICKLESS_IDLE) and the chip sleeps
+ *       until the next esp_timer or task deadline, an input edge or UART0
+ *       bytes. The CPU stays at 80 MHz or more so the UART keeps its baud.
  */
-uint16_t map(uint16_t x, uint16_t in_min, uint16_t in_max, uint16_t out_min, uint16_t out_max){
-    return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+esp_err_t tlc_bsp_power_init(void){
+    esp_pm_config_esp32_t config = {
+        .max_freq_mhz = 160,
+        .min_freq_mhz = 80,
+        .light_sleep_enable = true,
+    };
+    esp_err_t err = esp_pm_configure(&config);
+    if(err == ESP_OK){
+        err = esp_sleep_enable_gpio_wakeup();
+    }
+    if(err == ESP_OK){
+        err = uart_set_wakeup_threshold(UART_NUM_0, TLC_BSP_UART_WAKE_EDGES);
+    }
+    if(err == ESP_OK){
+        err = esp_sleep_enable_uart_wakeup(UART_NUM_0);
+    }
+    light_sleep = err == ESP_OK;
+    return err;
 }
@@ -13,6 +13,50 @@
 #define TLC_BSP_H
 #include "../tlc_config.h"
 #include "../traffic_light.h"
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdbool.h>
+
+/******************************************************************
+ * \struct tlc_bsp_mask_t tlc_bsp.h
+ * \brief Output pins to set and clear, per GPIO register bank
+ *
+ * ### Example
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~.c
+ * typedef struct{
+ *      uint32_t set[2];
+ *      uint32_t clr[2];
+ * }tlc_bsp_mask_t;
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *******************************************************************/
+typedef struct
+{
+    uint32_t set[2]; /*!< W1TS bits, bank 0 is GPIO0-31, bank 1 is GPIO32-39 */
+    uint32_t clr[2]; /*!< W1TC bits, bank 0 is GPIO0-31, bank 1 is GPIO32-39 */
+} tlc_bsp_mask_t;
+
+#define TLC_BSP_MAX_DIRECTIONS 4 /*!< Approaches one output can drive */
+
+/******************************************************************
+ * \struct tlc_bsp_output_t tlc_bsp.h
+ * \brief Precompiled intersection output
+ *
+ * ### Example
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~.c
+ * tlc_bsp_output_t out;
+ * const state_t light[] = {GREEN, RED};
+ * tlc_bsp_output_compile(&out, tlc, 2, light, 0, WALK_OFF);
+ * tlc_bsp_mask_write(&out.mask);
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *******************************************************************/
+typedef struct
+{
+    tlc_bsp_mask_t mask;                        /*!< Every LED and walk signal */
+    gpio_num_t yellow[TLC_BSP_MAX_DIRECTIONS];  /*!< Yellow LEDs blinked together */
+    uint8_t yellow_count;                       /*!< Yellow LEDs in use */
+    gpio_num_t walk[TLC_BSP_MAX_DIRECTIONS];    /*!< Walk signals blinked together */
+    uint8_t walk_count;                         /*!< Walk signals in use */
+} tlc_bsp_output_t;
 
 void tlc_bsp_led_init(tlc_t * const tlc);
 void tlc_bsp_green_led_on(tlc_t * const tlc);
@@ -25,6 +69,9 @@ void tlc_bsp_red_led_off(tlc_t * const tlc);
 void tlc_bsp_button_init(tlc_t * const tlc);
 void tlc_bsp_buzzer_init(tlc_t * const tlc);
 uint8_t tlc_bsp_button_read(tlc_t * const tlc);
+void tlc_bsp_button_isr_init(tlc_t * const tlc, gpio_isr_t isr, void * const args[2]);
+void tlc_bsp_preempt_init(gpio_num_t pin, gpio_isr_t isr, void *arg);
+uint8_t tlc_bsp_preempt_read(gpio_num_t pin);
 void tlc_bsp_buzzer_on(tlc_t * const tlc, uint8_t volume);
 void tlc_bsp_buzzer_off(tlc_t * const tlc);
 void tlc_bsp_walk_init(tlc_t * const tlc);
@@ -33,11 +80,20 @@ void tlc_bsp_walk_off(tlc_t * const tlc);
 void tlc_bsp_walk_warning(tlc_t * const tlc);
 void tlc_bsp_init(tlc_t * const tlc);
 void tlc_bsp_lights(state_t state, tlc_t * const tlc);
-void tlc_bsp_adc_init(void);
-uint32_t tlc_bsp_adc_read(void);
+void tlc_bsp_mask_pin(tlc_bsp_mask_t * const mask, gpio_num_t pin, uint32_t level);
+void tlc_bsp_mask_write(const tlc_bsp_mask_t * const mask);
+void tlc_bsp_output_compile(tlc_bsp_output_t * const out, tlc_t * const tlc, uint8_t count,
+                            const state_t * const light, uint8_t walk_mask, walk_t walk);
+esp_err_t tlc_bsp_adc_init(bool bursts);
+esp_err_t tlc_bsp_adc_start(void);
+void tlc_bsp_adc_stop(void);
+size_t tlc_bsp_adc_read(uint16_t *samples, size_t max);
+uint32_t tlc_bsp_adc_mv(uint32_t raw);
 void tlc_bsp_uart_init(void);
 void tlc_bsp_uart_write_byte(char*str);
+void tlc_bsp_uart_write(const uint8_t *data, size_t size);
 int tlc_bsp_uart_read_byte(char *c);
-uint16_t map(uint16_t x, uint16_t in_min, uint16_t in_max, uint16_t out_min, uint16_t out_max);
+int tlc_bsp_uart_poll_byte(char *c);
+esp_err_t tlc_bsp_power_init(void);
 
 #endif
\ No newline at end of file
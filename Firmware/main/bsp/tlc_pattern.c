@@ -0,0 +1,220 @@
+/**
+ * @file tlc_pattern.c
+ * @brief Timer-driven blink patterns source code
+ * @author Jorge Minjares (https://github.com/JorgeMinjares)
+ * @brief Each pattern owns a one-shot esp_timer that re-arms itself for the
+ *        next on or off interval. Toggles are due on a fixed grid counted
+ *        from the pattern's origin, so a late callback shortens the next
+ *        interval instead of delaying every later toggle. Starting and
+ *        cancelling only touch the pattern itself, so neither ever blocks the
+ *        caller.
+ * @brief pattern_mux covers the pattern fields and pin writes only. The
+ *        timer is created, armed and stopped after leaving it, since
+ *        esp_timer allocates and takes its own lock. A callback re-arms a
+ *        timer only if it is idle, and a start stops it first, so a callback
+ *        racing a restart cannot put back the old grid.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include "tlc_pattern.h"
+#include "tlc_bsp.h"
+#include "../tlc_config.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "../tlc_trace.h"
+
+static portMUX_TYPE pattern_mux = portMUX_INITIALIZER_UNLOCKED;  /*!< Guards every pattern */
+
+static void tlc_pattern_write(tlc_pattern_t *p, uint8_t level)
+{
+    p->level = level;
+    tlc_bsp_mask_write(level ? &p->on : &p->off);
+    tlc_trace(TLC_TRACE_PATTERN, p->pins[0], level);
+}
+
+/* Set the toggle due at next, under pattern_mux */
+static void tlc_pattern_due(tlc_pattern_t *p, int64_t next)
+{
+    int64_t now = esp_timer_get_time();
+    /* Missed a whole interval: start the grid again rather than toggle back to back */
+    if (now - next > (int64_t)(p->level ? p->on_us : p->off_us))
+    {
+        next = now;
+    }
+    p->next = next;
+}
+
+/* Arm the timer for the toggle due at next, outside pattern_mux */
+static void tlc_pattern_arm(tlc_pattern_t *p, int64_t next)
+{
+    int64_t now = esp_timer_get_time();
+    esp_timer_start_once(p->timer, next > now ? next - now : 1);
+}
+
+static void tlc_pattern_callback(void *arg)
+{
+    tlc_pattern_t *p = arg;
+    bool rearm = false;
+    int64_t next = 0;
+    portENTER_CRITICAL(&pattern_mux);
+    if (p->active)
+    {
+        tlc_pattern_write(p, !p->level);
+        /* A cycle ends on the falling edge */
+        if (p->level == LOW && p->cycles != TLC_PATTERN_FOREVER && --p->left == 0)
+        {
+            p->active = false;
+        }
+        else
+        {
+            tlc_pattern_due(p, p->next + (p->level ? p->on_us : p->off_us));
+            rearm = true;
+            next = p->next;
+        }
+    }
+    portEXIT_CRITICAL(&pattern_mux);
+    /* Fails if a restart armed the timer meanwhile, its grid wins */
+    if (rearm)
+    {
+        tlc_pattern_arm(p, next);
+    }
+}
+
+/**
+ * @brief Start blinking a group of pins now
+ *
+ * @param p pattern
+ * @param pins pins to blink together, already configured as outputs
+ * @param count number of pins
+ * @param on_us on interval in microseconds
+ * @param off_us off interval in microseconds
+ * @param cycles on/off cycles, TLC_PATTERN_FOREVER to blink until cancelled
+ * @return true if the pattern is running
+ * @note Returns immediately. Starting a pattern that is already running
+ *       leaves it alone.
+ */
+bool tlc_pattern_start(tlc_pattern_t *p, const gpio_num_t *pins, uint8_t count, uint32_t on_us, uint32_t off_us,
+                       uint16_t cycles)
+{
+    return tlc_pattern_start_at(p, pins, count, on_us, off_us, cycles, esp_timer_get_time());
+}
+
+/**
+ * @brief Start blinking a group of pins on the grid of an earlier time
+ *
+ * @param p pattern
+ * @param pins pins to blink together, already configured as outputs
+ * @param count number of pins
+ * @param on_us on interval in microseconds
+ * @param off_us off interval in microseconds
+ * @param cycles on/off cycles, TLC_PATTERN_FOREVER to blink until cancelled
+ * @param origin time the first on interval began, at or before now
+ * @return true if the pattern is running
+ * @note Picks up where the pattern would be had it started at origin, so a
+ *       blink started late still toggles on time. Returns immediately;
+ *       starting a pattern that is already running leaves it alone.
+ */
+bool tlc_pattern_start_at(tlc_pattern_t *p, const gpio_num_t *pins, uint8_t count, uint32_t on_us, uint32_t off_us,
+                          uint16_t cycles, int64_t origin)
+{
+    if (count == 0 || count > TLC_PATTERN_MAX_PINS)
+    {
+        return false;
+    }
+    if (p->timer == NULL)
+    {
+        /* First start, by the task owning the pattern */
+        esp_timer_create_args_t timer_args = {
+            .callback = tlc_pattern_callback,
+            .arg = p,
+            .dispatch_method = ESP_TIMER_TASK,
+            .name = "Pattern Timer",
+            .skip_unhandled_events = true,
+        };
+        if (esp_timer_create(&timer_args, &p->timer) != ESP_OK)
+        {
+            p->timer = NULL;
+            return false;
+        }
+    }
+    bool armed = false;
+    portENTER_CRITICAL(&pattern_mux);
+    if (!p->active)
+    {
+        p->on = (tlc_bsp_mask_t){0};
+        p->off = (tlc_bsp_mask_t){0};
+        for (uint8_t j = 0; j < count; j++)
+        {
+            p->pins[j] = pins[j];
+            tlc_bsp_mask_pin(&p->on, pins[j], HIGH);
+            tlc_bsp_mask_pin(&p->off, pins[j], LOW);
+        }
+        p->count = count;
+        p->on_us = on_us;
+        p->off_us = off_us;
+        p->cycles = cycles;
+        int64_t now = esp_timer_get_time();
+        int64_t period = (int64_t)on_us + off_us;
+        int64_t done = origin < now ? (now - origin) / period : 0;
+        int64_t start = origin < now ? origin + done * period : now;
+        if (cycles != TLC_PATTERN_FOREVER && done >= cycles)
+        {
+            /* Every cycle is already over */
+            tlc_pattern_write(p, LOW);
+        }
+        else
+        {
+            p->left = (uint16_t)(cycles - done);
+            p->active = true;
+            bool on = now - start < (int64_t)on_us;
+            tlc_pattern_write(p, on);
+            p->next = on ? start + on_us : start + period;
+            armed = true;
+        }
+    }
+    int64_t next = p->next;
+    portEXIT_CRITICAL(&pattern_mux);
+    if (armed)
+    {
+        /* A callback of the last run may have armed it for its own grid */
+        esp_timer_stop(p->timer);
+        tlc_pattern_arm(p, next);
+    }
+    return true;
+}
+
+/**
+ * @brief Cancel a pattern
+ *
+ * @param p pattern
+ * @note The pins keep their current level; the caller writes the next one
+ */
+void tlc_pattern_cancel(tlc_pattern_t *p)
+{
+    portENTER_CRITICAL(&pattern_mux);
+    bool active = p->active;
+    p->active = false;
+    portEXIT_CRITICAL(&pattern_mux);
+    if (active)
+    {
+        /* A callback already running finds the pattern inactive */
+        esp_timer_stop(p->timer);
+    }
+}
+
+/**
+ * @brief Check if a pattern is blinking
+ *
+ * @param p pattern
+ * @return true if it runs
+ */
+bool tlc_pattern_active(tlc_pattern_t *p)
+{
+    portENTER_CRITICAL(&pattern_mux);
+    bool active = p->active;
+    portEXIT_CRITICAL(&pattern_mux);
+    return active;
+}
@@ -0,0 +1,61 @@
+/**
+ * @file tlc_pattern.h
+ * @brief Timer-driven blink patterns
+ * @author Jorge Minjares (https://github.com/JorgeMinjares)
+ * @brief Blinks a group of output pins from esp_timer callbacks so the task
+ *        that starts a pattern returns immediately. The caller owns the
+ *        pattern, so each intersection blinks its own pins without a shared
+ *        table to search.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef TLC_PATTERN_H
+#define TLC_PATTERN_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <driver/gpio.h>
+#include "esp_timer.h"
+#include "tlc_bsp.h"
+
+#define TLC_PATTERN_MAX_PINS 4  /*!< Pins blinked together by one pattern */
+#define TLC_PATTERN_FOREVER 0   /*!< Blink until cancelled */
+
+/******************************************************************
+ * \struct tlc_pattern_t tlc_pattern.h
+ * \brief Blink pattern, zero initialized before first use
+ *
+ * ### Example
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~.c
+ * static tlc_pattern_t blink;
+ * tlc_pattern_start(&blink, &tlc->walkingSignal, 1, WALK_BLINK_US, WALK_BLINK_US, TLC_PATTERN_FOREVER);
+ * tlc_pattern_cancel(&blink);
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *******************************************************************/
+typedef struct
+{
+    gpio_num_t pins[TLC_PATTERN_MAX_PINS]; /*!< Pins blinked together */
+    uint8_t count;                         /*!< Pins in use */
+    tlc_bsp_mask_t on;                     /*!< Mask that lights every pin */
+    tlc_bsp_mask_t off;                    /*!< Mask that clears every pin */
+    uint8_t level;                         /*!< Current level */
+    bool active;                           /*!< Running */
+    uint32_t on_us;                        /*!< On interval */
+    uint32_t off_us;                       /*!< Off interval */
+    uint16_t cycles;                       /*!< On/off cycles, 0 forever */
+    uint16_t left;                         /*!< Cycles remaining */
+    int64_t next;                          /*!< Time the next toggle is due */
+    esp_timer_handle_t timer;              /*!< Interval timer, created on first start */
+} tlc_pattern_t;
+
+bool tlc_pattern_start(tlc_pattern_t *p, const gpio_num_t *pins, uint8_t count, uint32_t on_us, uint32_t off_us,
+                       uint16_t cycles);
+bool tlc_pattern_start_at(tlc_pattern_t *p, const gpio_num_t *pins, uint8_t count, uint32_t on_us, uint32_t off_us,
+                          uint16_t cycles, int64_t origin);
+void tlc_pattern_cancel(tlc_pattern_t *p);
+bool tlc_pattern_active(tlc_pattern_t *p);
+
+#endif
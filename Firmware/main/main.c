@@ -10,44 +10,69 @@
  *
  */
 #include <stdio.h>
+#include <stdint.h>
+#include <string.h>
 #include "esp_timer.h"
 
 /*FreeRTOS files*/
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
-#include "freertos/semphr.h"
 
 /* Configs files*/
 #include <tlc_config.h>
 #include <traffic_light.h>
 #include "bsp/tlc_bsp.h"
+#include "bsp/tlc_audio.h"
 #include "timer.h"
+#include "tlc_button.h"
+#include "tlc_phase.h"
+#include "tlc_density.h"
+#include "tlc_history.h"
+#include "tlc_record.h"
+#include "tlc_telemetry.h"
+#include "tlc_trace.h"
+#include "tlc_event.h"
+#include "tlc_controller.h"
+#include "tlc_monitor.h"
+#include "tlc_console.h"
+#include "tlc_spsc.h"
 
 #include <driver/gpio.h>
 #include <driver/dac.h>
 
 #include "esp_log.h"
 static const char* STATE_TAG = "STATE: "; /*!< String Tag to check current state*/
-static const char* BUTTON_TAG = "BUTTON: "; /*!< String Tag to check button event */
 
 
-esp_timer_handle_t timer_yellow_handle; /*!< One shot timer handle to yellow callback*/
+#define STATS_SAMPLES 60 /*!< Density values between STATS records */
+#define CONTROLLER_STACK 3072 /*!< Stack of the controller task in bytes */
+#define IO_STACK 3072 /*!< Stack of the I/O task in bytes */
+#define IO_PRIORITY 10 /*!< Priority of the I/O task, under the controller task */
+#define IO_EVENTS 32 /*!< Density values and UART bytes in flight to the controller, a power of two */
+#define IO_BURST_SLACK 3 /*!< Ticks a low power burst may run late before it is cut short */
+#define IO_REQUEST_TRACE 0x01 /*!< Controller asked for the trace rings */
+#define IO_REQUEST_STATS 0x02 /*!< Controller asked for a STATS record */
+#define IO_REQUEST_HISTORY 0x04 /*!< Controller asked for a history scan */
 
-TaskHandle_t light_task_handle = NULL; /*!< Task handle for Light Task*/
-TaskHandle_t button_task_handle = NULL; /*!< Task handle for Button Task*/
-TaskHandle_t yellow_task_handle = NULL; /*!< Task handle for Yellow Task*/
-TaskHandle_t walk_task_handle = NULL; /*!< Task handle for Walk Task*/
+static tlc_controller_t controllers[TLC_CONTROLLERS]; /*!< Intersections driven by the board*/
+tlc_scheduler_t scheduler; /*!< Event loop of every intersection*/
+TaskHandle_t controller_task_handle = NULL; /*!< Task handle for the Controller Task*/
+TaskHandle_t io_task_handle = NULL; /*!< Task handle for the I/O Task*/
+tlc_spsc_t io_events; /*!< Density values and UART bytes from the I/O task to the controller*/
+static tlc_event_t io_event_slots[IO_EVENTS]; /*!< Storage of io_events*/
+static uint32_t io_requests = 0; /*!< IO_REQUEST_x not yet served by the I/O task*/
 
-QueueHandle_t adc_queue = NULL; /*!< Queue Variable to send data between tasks*/
-
-SemaphoreHandle_t walk_semaphore = NULL; /*!< Semaphore to synchronize tasks*/
-
-state_t state = GREEN; /*!< Global state_t variable to keep track of lights' state*/
-uint8_t pedestrainTime = 0; /*!< Global variable that increase time for pedestrain walk*/
-static bool isPressed = false; /*!< Boolean variable to check amount of times button event occurs*/
-static bool isPressedOnce = false; /*!< Boolean variable to check if amount of times button event is not greater than 1*/
-static bool halt = false; /*!< Halt if button event occurs*/
+const tlc_plan_t *timing_plan = &TLC_PLAN; /*!< Timing plan started by app_main*/
+bool low_power = LOW_POWER; /*!< Power mode started by app_main, see LOW_POWER*/
+static uint16_t density = 0; /*!< Latest filtered traffic density*/
+static tlc_density_t density_filter; /*!< Traffic density filter*/
+static int64_t adc_busy_us = 0; /*!< Time spent reading and filtering samples*/
+static uint32_t density_count = 0; /*!< Density values published*/
+static tlc_history_t history; /*!< Density values and their minute and hour rollups*/
+static uint64_t history_query = 0; /*!< Scan asked by the console: level, from and to seconds ago*/
+static tlc_history_cursor_t history_scan; /*!< Scan being sent*/
+static bool history_scanning = false; /*!< history_scan has records left to send*/
 
 static char *banner="\033[1;33m   __  __________________ \r\n"
                                   "  / / / /_  __/ ____/ __ \\ \r\n"
@@ -57,298 +82,518 @@ static char *banner="\033[1;33m   __  __________________ \r\n"
 
 /**
  * @brief Default tlc configuration
+ * @note Intersections past the first have no pins on the board; they run
+ *       headless with GPIO_NUM_NC and take button input from tlc_button_inject()
  */
-tlc_t tlc[2] = {
+tlc_t tlc[TLC_CONTROLLERS][2] = {
     {
-        .direction = DIRECTION_0,
-        .led = {LED_0, LED_1, LED_2},
-        .button = {BUTTON_0, BUTTON_1},
-        .buzzer = BUZZER_0,
-        .walkingSignal = WALK_0,
-    },
-    {
-        .direction = DIRECTION_1,
-        .led = {LED_3, LED_4, LED_5},
-        .button = {BUTTON_2, BUTTON_3},
-        .buzzer = BUZZER_1,
-        .walkingSignal = WALK_1,
+        {
+            .direction = DIRECTION_0,
+            .led = {LED_0, LED_1, LED_2},
+            .button = {BUTTON_0, BUTTON_1},
+            .buzzer = BUZZER_0,
+            .walkingSignal = WALK_0,
+        },
+        {
+            .direction = DIRECTION_1,
+            .led = {LED_3, LED_4, LED_5},
+            .button = {BUTTON_2, BUTTON_3},
+            .buzzer = BUZZER_1,
+            .walkingSignal = WALK_1,
+        },
     },
 };
 
 /**
- * @brief Timer callback to trigger yellow state
+ * @brief Move the trace rings into the telemetry
  * 
- * @param arg generic argument
+ * @note Entries carry the low 32 bits of esp_timer time; they are widened
+ *       against the current time, which holds for entries under 71 minutes old
  */
-void timer_yellow_callback(void *arg)
+static void trace_drain(void)
 {
-    /* Change state for the system */
-    state = YELLOW;
-    /* Display event with ESP_LOGGER */
-    ESP_LOGI(STATE_TAG, "YELLOW");
-    /* Send Notification */
-    xTaskNotifyGive(yellow_task_handle);
+    tlc_trace_entry_t entry;
+    for (uint8_t core = 0; core < TLC_TRACE_CORES; core++)
+    {
+        while (tlc_trace_read(core, &entry))
+        {
+            int64_t now = esp_timer_get_time();
+            int64_t time_us = now - (uint32_t)((uint32_t)now - entry.time_us);
+            /* Make room rather than drop, the I/O task is the sender */
+            if (tlc_telemetry_pending() >= TLC_TELEMETRY_RING)
+            {
+                tlc_telemetry_flush();
+            }
+            tlc_telemetry_trace(time_us, core, (uint8_t)entry.id, entry.arg0, entry.arg1);
+        }
+    }
 }
 
 /**
- * @brief Light task manages the traffic light states changes 
- * 
- * @param pvParameters generic argument 
+ * @brief Report button latency, filter cost and telemetry health
+ *
+ * @note Runs on the I/O task; the controller's counters come from the
+ *       snapshots its core publishes
  */
-void light_task(void *pvParameters){
-
-    while(1){
-        /* If state is either GREEN or RED turn on the LED */
-        if(state == GREEN || state == RED){
-            tlc_bsp_lights(state, &tlc[0]);
-            tlc_bsp_lights(state, &tlc[1]);
-        }
-        /* Toggle YELLOW LED on YELLOW State */
-        else{
-            tlc_bsp_yellow_toggle(&tlc[0], &tlc[1]);
+static void send_stats(void)
+{
+    tlc_state_counters_t stats = {0};
+    for (uint8_t i = 0; i < scheduler.count; i++)
+    {
+        tlc_state_t state;
+        tlc_state_read(&scheduler.controllers[i].state, &state);
+        stats.button_events += state.counters.button_events;
+        stats.button_wakeups += state.counters.button_wakeups;
+        stats.reactions += state.counters.reactions;
+        stats.latency_sum_us += state.counters.latency_sum_us;
+        if (state.counters.latency_max_us > stats.latency_max_us)
+        {
+            stats.latency_max_us = state.counters.latency_max_us;
         }
-        /* Avoid WDT */
-        vTaskDelay(100 / portTICK_PERIOD_MS);
+        stats.timers_lost += state.counters.timers_lost;
     }
+    tlc_density_stats_t density_stats = density_filter.stats;
+    tlc_telemetry_stats_t telemetry;
+    tlc_telemetry_get_stats(&telemetry);
+    tlc_record_stats_t record;
+    tlc_record_get_stats(&record);
+    uint32_t values[] = {
+        stats.button_events,
+        (uint32_t)(stats.reactions ? stats.latency_sum_us / stats.reactions : 0),
+        stats.latency_max_us,
+        stats.button_wakeups,
+        density_stats.samples,
+        density_stats.rejected,
+        (uint32_t)(density_stats.published ? adc_busy_us / density_stats.published : 0),
+        telemetry.dropped + stats.timers_lost + tlc_spsc_overflow(&io_events),
+        tlc_trace_rings[0].lost + tlc_trace_rings[1].lost,
+        record.lost,
+    };
+    tlc_telemetry_stats(values, sizeof(values) / sizeof(values[0]));
 }
 
 /**
- * @brief Halt task changes the state of traffic light
+ * @brief Filter the samples collected since the last block
  * 
- * @param pvParameters generic argument 
+ * @param max samples to take at most, the rest stay in the driver
+ * @return samples taken
+ * @note A value is published once per second; the controller gets it when
+ *       it changes and retimes the actuated phases. Runs on the I/O task.
  */
-void halt_light_task(void *pvParameters){
-    while(1){
-        /* Halt system if both buttons are pressed */
-        if(tlc_bsp_button_read(&tlc[0]) && tlc_bsp_button_read(&tlc[1]) && halt == false){
-            state = RED;
-            halt = true;
-            isPressed = false;
-            isPressedOnce = false;
-            vTaskDelay(1000 / portTICK_PERIOD_MS);
+static size_t handle_adc(size_t max)
+{
+    /* One block of conversions, static to keep it off the task stack */
+    static uint16_t samples[TLC_DENSITY_BLOCK_SAMPLES];
+    int64_t start = esp_timer_get_time();
+    bool published = false;
+    size_t taken = 0;
+    size_t count;
+    while (taken < max &&
+           (count = tlc_bsp_adc_read(samples, max - taken < TLC_DENSITY_BLOCK_SAMPLES ? max - taken
+                                                                                     : TLC_DENSITY_BLOCK_SAMPLES)) > 0)
+    {
+        published |= tlc_density_feed(&density_filter, samples, count);
+        taken += count;
+    }
+    int64_t now = esp_timer_get_time();
+    adc_busy_us += now - start;
+    if (published)
+    {
+        /* Calibrated lookup from MIN_DENSITY_MV - MAX_DENSITY_MV to MIN_CARS - MAX_CARS */
+        uint16_t cars = tlc_density_cars(&density_filter);
+        tlc_telemetry_density(now, density_filter.cars_q8, density_filter.raw_q4);
+        tlc_trace(TLC_TRACE_DENSITY, cars, 0);
+        tlc_history_add(&history, now, density_filter.cars_q8);
+        if (cars != density)
+        {
+            /* One sensor feeds every intersection */
+            density = cars;
+            tlc_event_t event = {.type = TLC_EVENT_DENSITY, .cars = density, .timestamp = now};
+            tlc_spsc_push(&io_events, &event);
         }
-        /* Restart system if both buttons are pressed again */
-        if(tlc_bsp_button_read(&tlc[0]) && tlc_bsp_button_read(&tlc[1]) && halt == true){
-            state = GREEN;
-            halt = false;
-            isPressed = false;
-            isPressedOnce = false;
-            vTaskDelay(1000 / portTICK_PERIOD_MS);
+        if (++density_count % STATS_SAMPLES == 0)
+        {
+            send_stats();
         }
-        /* Avoid WDT */
-        vTaskDelay(100 / portTICK_PERIOD_MS);
     }
+    /* Batch records into as few frames as possible */
+    if ((published && density_count % TELEMETRY_BATCH == 0) ||
+        tlc_telemetry_pending() >= TLC_TELEMETRY_RING / 2)
+    {
+        if (TRACE_STREAM)
+        {
+            trace_drain();
+        }
+        tlc_telemetry_flush();
+    }
+    return taken;
 }
 
 /**
- * @brief Button task starts one-shot timer and update pedestrian time
+ * @brief Send the next records of a history scan
  * 
- * @param pvParameters generic argument
+ * @note A few records per ADC block, so a scan over days shares the UART
+ *       with the live telemetry instead of holding it. Runs on the I/O task,
+ *       the only one touching the store.
  */
-void button_task(void *pvParameters)
+static void history_send(void)
 {
-    /* Set arguments for timer*/
-    esp_timer_create_args_t timer_args = {
-        .callback = timer_yellow_callback,
-        .arg = NULL,
-        .dispatch_method = ESP_TIMER_TASK,
-        .name = "Yellow Timer Trigger",
-        .skip_unhandled_events = false,
-    };
-    /* Create timer with arguemnt and */
-    esp_timer_create(&timer_args, &timer_yellow_handle);
-    /* Default time period */
-    uint32_t period = ONE_SECOND;
-
-    while (1)
+    if (!history_scanning)
     {
-        /* While system state is green and button read, start light sequence  */
-        if (state == GREEN && (tlc_bsp_button_read(&tlc[0]) || tlc_bsp_button_read(&tlc[1])) && isPressedOnce == false)
+        return;
+    }
+    for (uint8_t i = 0; i < TLC_HISTORY_RECORDS && history_scanning; i++)
+    {
+        uint8_t data[TLC_TELEMETRY_DATA_MAX];
+        size_t size = tlc_history_encode(&history, &history_scan, data, sizeof(data));
+        if (tlc_telemetry_pending() >= TLC_TELEMETRY_RING / 2)
         {
-            /* Start One shot timer after 3 seconds */
-            esp_timer_start_once(timer_yellow_handle, period * 3);
-            /* Display event with ESP_LOGGER */
-            ESP_LOGI(BUTTON_TAG, "PRESSED ONCE");
-            isPressedOnce = true; /* Set event true */
-            pedestrainTime = 15; /* Set time to 15 seconds */
+            tlc_telemetry_flush();
         }
-        /* If button is pressed and hold enable disability */
-        if ((tlc_bsp_button_read(&tlc[0]) || tlc_bsp_button_read(&tlc[1])) && isPressed == false)
+        tlc_telemetry_record(TLC_TELEMETRY_HISTORY, esp_timer_get_time(), data, size);
+        /* The record without buckets ends the scan */
+        history_scanning = data[1] != 0;
+    }
+    tlc_telemetry_flush();
+}
+
+/**
+ * @brief Send what the recorder wrote since the last ADC block
+ * 
+ * @note Every record carries the stream offset of its first byte, so the
+ *       host can join them back and tell when one was lost. Runs on the I/O
+ *       task, the only reader of the recorder.
+ */
+static void record_send(void)
+{
+    for (uint8_t i = 0; i < TLC_RECORD_RECORDS; i++)
+    {
+        uint8_t data[TLC_TELEMETRY_DATA_MAX];
+        uint8_t bytes[TLC_TELEMETRY_DATA_MAX - 6];
+        uint32_t offset;
+        size_t size = tlc_record_read(bytes, sizeof(bytes), &offset);
+        if (size == 0)
         {
-            /* Wait 2 seconds and recheck buttons */
-            vTaskDelay(2000 / portTICK_PERIOD_MS); 
-            if((tlc_bsp_button_read(&tlc[0]) || tlc_bsp_button_read(&tlc[1]))){
-                /* Increase time */
-                pedestrainTime += 15;     
-                /* Set event true*/
-                isPressed = true; 
-                /* Display event with ESP_LOGGER */
-                ESP_LOGI(BUTTON_TAG, "PRESSED & HOLD");         
-            }
+            break;
         }
-        else
+        size_t n = tlc_telemetry_varint(data, offset);
+        data[n++] = (uint8_t)size;
+        memcpy(&data[n], bytes, size);
+        if (tlc_telemetry_pending() >= TLC_TELEMETRY_RING / 2)
         {
-            /* Avoid WDT */
-            vTaskDelay(100 / portTICK_PERIOD_MS);
+            tlc_telemetry_flush();
         }
+        tlc_telemetry_record(TLC_TELEMETRY_RECORD, esp_timer_get_time(), data, n + size);
     }
 }
 
 /**
- * @brief Yellow task controls yellow->red transition 
+ * @brief Hand work to the I/O task
+ *
+ * @param request IO_REQUEST_x
+ */
+static void io_request(uint32_t request)
+{
+    __atomic_fetch_or(&io_requests, request, __ATOMIC_RELEASE);
+    xTaskNotifyGive(io_task_handle);
+}
+
+/**
+ * @brief Console stats command, the counters belong to the I/O task
+ */
+static void request_stats(void)
+{
+    io_request(IO_REQUEST_STATS);
+}
+
+/**
+ * @brief Console history command, the store belongs to the I/O task
+ *
+ * @param level tlc_history_level_t
+ * @param from_s start, seconds before the newest value, under 2^31
+ * @param to_s end, seconds before the newest value, under 2^31
+ * @note The query is packed in one word so the I/O task never reads half
+ *       of a newer one; a scan still being sent is replaced.
+ */
+static void request_history(uint8_t level, uint32_t from_s, uint32_t to_s)
+{
+    uint64_t query = (uint64_t)level << 62 | (uint64_t)(from_s & 0x7fffffff) << 31 | (to_s & 0x7fffffff);
+    __atomic_store_n(&history_query, query, __ATOMIC_RELAXED);
+    io_request(IO_REQUEST_HISTORY);
+}
+
+/**
+ * @brief Run a command received on UART0
  * 
- * @param pvParameters generic argument
+ * @param command command byte
+ * @param now time the byte was read
+ * @note 'T' sends every trace entry at once when TRACE_STREAM is 0.
+ *       'C' and 8 bytes of little endian master time in microseconds set
+ *       the shared time base of coordinated plans; the byte polling puts up
+ *       to one ADC block of error on it. 'M' sends a tlc_monitor snapshot.
+ *       Anything else is a tlc_console line.
  */
-void yellow_task(void *pvParameters)
+static void handle_uart(uint8_t command, int64_t now)
 {
-    while (1)
-    {   
-        /* Wait for notification */
-        uint32_t count = ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
-        vTaskDelay( 5000 / portTICK_PERIOD_MS);
-        /* Update state after 5 seconds */
-        state = RED;
-        /* Display event in ESP_LOGGER */
-        ESP_LOGI(STATE_TAG, "RED");
-        /* Send semaphore */
-        xSemaphoreGive(walk_semaphore);
-        vTaskDelay(100 / portTICK_PERIOD_MS);
+    static uint8_t clock_bytes = 0; /* Master time bytes still expected */
+    static uint64_t clock = 0;
+    if (clock_bytes)
+    {
+        clock |= (uint64_t)command << (8 * (8 - clock_bytes));
+        if (--clock_bytes == 0)
+        {
+            tlc_scheduler_clock(&scheduler, now, (int64_t)clock);
+        }
+        return;
+    }
+    /* Lines act on the plan now, not when the I/O task read their bytes */
+    if (tlc_console_byte(command, esp_timer_get_time()))
+    {
+        return;
+    }
+    if (command == 'C')
+    {
+        clock_bytes = 8;
+        clock = 0;
+    }
+    else if (!TRACE_STREAM && command == 'T')
+    {
+        io_request(IO_REQUEST_TRACE);
+    }
+    else if (command == 'M')
+    {
+        tlc_monitor_send();
+        tlc_telemetry_flush();
     }
 }
 
 /**
- * @brief Walk task manages red state transition and display walking signals (LEDs, Buzzer)
+ * @brief Run the events that belong to no intersection
  * 
- * @param pvParameters 
+ * @param scheduler scheduler running the event
+ * @param event TLC_EVENT_ADC, TLC_EVENT_UART or TLC_EVENT_DENSITY
  */
-void walk_task(void *pvParameters)
+static void controller_handler(tlc_scheduler_t *scheduler, const tlc_event_t *event)
 {
-    while (1)
-    {   /* Wait to receive semaphore */
-        if (xSemaphoreTake(walk_semaphore, portMAX_DELAY) == pdTRUE)
+    switch (event->type)
+    {
+    case TLC_EVENT_UART:
+        handle_uart(event->command, event->timestamp);
+        break;
+    case TLC_EVENT_DENSITY:
+        /* Retime from now, the plan must not step back to when the value was read */
+        tlc_scheduler_density(scheduler, esp_timer_get_time(), event->cars);
+        break;
+    case TLC_EVENT_ADC:
+    {
+        /* What the I/O task received since the last tick */
+        tlc_event_t io;
+        while (tlc_spsc_pop(&io_events, &io))
         {
-            /* Iterate time */
-            while (pedestrainTime-- > 0)
-            {
-                /* Trigger Walk Signal */
-                if (pedestrainTime > 10)
-                {
-                    tlc_bsp_walk_on(&tlc[0]);
-                    tlc_bsp_walk_on(&tlc[1]);
-                }
-                /* Trigger Walk Signal Warning */
-                else
-                {   /* Disability Enable */
-                    if(isPressed == true){
-                        tlc_bsp_buzzer_on(&tlc[0], 126);
-                        vTaskDelay(100 / portTICK_PERIOD_MS);
-                        tlc_bsp_buzzer_off(&tlc[0]);
-                        tlc_bsp_buzzer_on(&tlc[1], 126);
-                        vTaskDelay(100 / portTICK_PERIOD_MS);
-                        tlc_bsp_buzzer_off(&tlc[1]);
-                    }
-                    tlc_bsp_walk_warning(&tlc[0]);
-                    tlc_bsp_walk_warning(&tlc[1]);
-                }
-                vTaskDelay(500 / portTICK_PERIOD_MS);
-            };
-            /* Update State */
-            state = GREEN;
-            /* Display event in ESP_LOGGER */
-            ESP_LOGI(STATE_TAG, "GREEN");
-            /* Restart events to false*/
-            isPressed = false;
-            isPressedOnce = false;
+            tlc_record_event(&io);
+            tlc_scheduler_dispatch(scheduler, &io);
         }
-        /* Avoid WDT */
-        vTaskDelay(100 / portTICK_PERIOD_MS);
+        tlc_console_poll();
+        break;
+    }
+    default:
+        break;
     }
 }
 
 /**
- * @brief ADC task read traffic congestions and sends data through queue
+ * @brief Work done once the samples of a block or burst are in
  * 
- * @param pvParameters generic argument 
+ * @note In low power mode the controller has no tick of its own, so the
+ *       batch is handed to it as a TLC_EVENT_ADC; a full queue only delays
+ *       it to the next batch.
  */
-void adc_task(void *pvParameters)
+static void io_batch(void)
 {
-    while (1)
+    history_send();
+    if (RECORD_IO)
     {
-        /* Read ADC channel */
-        uint32_t adc = tlc_bsp_adc_read();
-        /* Map ADC values 
-           MIN_ADC_VAL - MAX_ADC_VAL (0 - 4096)
-           MIN_CARS - MAX_CARS (0 - 25)
-        */
-        uint16_t adc_map = map(adc, MIN_ADC_VAL, MAX_ADC_VAL, MIN_CARS, MAX_CARS);
-        /* Send Mapped Values through queue */
-        xQueueSendToBack(adc_queue, &adc_map, 0);
-        /* Avoid WDT */
-        vTaskDelay(1000 / portTICK_PERIOD_MS);
+        record_send();
+    }
+    /* Bytes wait in the driver rather than fill the ring, one slot stays free for the next density */
+    char command;
+    while (tlc_spsc_count(&io_events) < IO_EVENTS - 1 && tlc_bsp_uart_poll_byte(&command) == 1)
+    {
+        tlc_event_t uart = {.type = TLC_EVENT_UART, .command = (uint8_t)command, .timestamp = esp_timer_get_time()};
+        tlc_spsc_push(&io_events, &uart);
+    }
+    if (low_power)
+    {
+        tlc_event_t event = {.type = TLC_EVENT_ADC, .timestamp = esp_timer_get_time()};
+        xQueueSend(scheduler.queue, &event, 0);
     }
 }
 
 /**
- * @brief UART task receives queue and display message via serial port
+ * @brief Density filter, UART polling and telemetry, pinned to IO_CORE
  * 
- * @param pvParameters generic argument 
+ * @param pvParameters unused
+ * @note Everything that waits on the UART runs here, so a backed up TX ring
+ *       never holds up the controller. Wakes every ADC block and whenever
+ *       tlc_telemetry_flush() or io_request() is called on the other core.
+ *       In low power mode it wakes once a second instead, converts one
+ *       burst and lets the chip sleep until the next one.
  */
-void uart_task(void *pvParamters){
-    /* Variable to store queue information */
-    uint16_t adc_map = 0;
-    while(1){
-        /* Receive queue information and store it in variable */
-        if(xQueueReceive(adc_queue, &adc_map, (TickType_t)100) == pdPASS){
-            /* Create buffer array for messages */
-            char buffer[32];
-            /* Set meesage to send */
-            sprintf(buffer, "Traffic Congestion: %d\r\n", adc_map);
-            /* Send message to UART */
-            tlc_bsp_uart_write_byte(buffer);
-            /* Send message if exceeds threshold */
-            if((MAX_CARS / 2) < adc_map){
-                tlc_bsp_uart_write_byte("\033[1;31m Whoa Traffic is Heavy\033[1;39m\r\n");
+static void io_task(void *pvParameters)
+{
+    (void)pvParameters;
+    TickType_t tick = pdMS_TO_TICKS(low_power ? TLC_DENSITY_BURST_MS : TLC_DENSITY_BLOCK_MS);
+    TickType_t tick_wake = xTaskGetTickCount() + tick;
+    /* Whole ticks that cover a burst */
+    TickType_t burst = (TLC_DENSITY_BURST_SAMPLES * 1000 / DENSITY_SAMPLE_HZ + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS;
+    TickType_t burst_wake = 0;
+    TickType_t burst_end = 0;
+    size_t burst_left = 0; /* Samples the running burst still owes */
+    while (1)
+    {
+        TickType_t ticks = (burst_left ? burst_wake : tick_wake) - xTaskGetTickCount();
+        ticks = (int32_t)ticks < 0 ? 0 : ticks;
+        bool woken = ulTaskNotifyTake(pdTRUE, ticks) > 0;
+        uint32_t requests = __atomic_exchange_n(&io_requests, 0, __ATOMIC_ACQUIRE);
+        if (requests & IO_REQUEST_STATS)
+        {
+            send_stats();
+        }
+        if (requests & IO_REQUEST_TRACE)
+        {
+            trace_drain();
+        }
+        if (requests & IO_REQUEST_HISTORY)
+        {
+            uint64_t query = __atomic_load_n(&history_query, __ATOMIC_RELAXED);
+            tlc_history_range(&history, &history_scan, (tlc_history_level_t)(query >> 62),
+                              (uint32_t)(query >> 31) & 0x7fffffff, (uint32_t)query & 0x7fffffff);
+            history_scanning = true;
+        }
+        if (burst_left == 0 && (int32_t)(xTaskGetTickCount() - tick_wake) >= 0)
+        {
+            tick_wake += tick;
+            if (low_power)
+            {
+                burst_left = tlc_bsp_adc_start() == ESP_OK ? TLC_DENSITY_BURST_SAMPLES : 0;
+                burst_wake = xTaskGetTickCount() + burst;
+                burst_end = burst_wake + IO_BURST_SLACK;
+            }
+            else
+            {
+                handle_adc(SIZE_MAX);
+                io_batch();
             }
         }
+        if (burst_left && (int32_t)(xTaskGetTickCount() - burst_wake) >= 0)
+        {
+            burst_left -= handle_adc(burst_left);
+            if (burst_left && (int32_t)(xTaskGetTickCount() - burst_end) < 0)
+            {
+                /* The last frames are still on their way */
+                burst_wake++;
+            }
+            else
+            {
+                /* A stalled or short burst keeps what it filtered, the block finishes in the next one */
+                if (burst_left)
+                {
+                    tlc_trace(TLC_TRACE_ADC_SHORT, (uint16_t)burst_left, 0);
+                    burst_left = 0;
+                }
+                tlc_bsp_adc_stop();
+                io_batch();
+            }
+        }
+        if (woken || requests)
+        {
+            tlc_telemetry_flush();
+        }
     }
 }
 
 void app_main(void)
 {
+    /* Ahead of the first output write and button edge */
+    if (RECORD_IO)
+    {
+        tlc_record_init(timing_plan->name);
+    }
+    /* Intersections past the board pinout run headless */
+    for (uint8_t i = 1; i < TLC_CONTROLLERS; i++)
+    {
+        for (uint8_t d = 0; d < 2; d++)
+        {
+            tlc[i][d] = (tlc_t){
+                .direction = tlc[0][d].direction,
+                .led = {GPIO_NUM_NC, GPIO_NUM_NC, GPIO_NUM_NC},
+                .button = {GPIO_NUM_NC, GPIO_NUM_NC},
+                .buzzer = GPIO_NUM_NC,
+                .walkingSignal = GPIO_NUM_NC,
+            };
+        }
+    }
     /* Initialize TLC hardware */
-    tlc_bsp_init(&tlc[0]);
-    tlc_bsp_init(&tlc[1]);
-    /* Initialize TLC UART communication */
+    tlc_bsp_init(&tlc[0][0]);
+    tlc_bsp_init(&tlc[0][1]);
+    /* Accessible signal tones of the board's approaches, silent until a phase asks for one */
+    if (tlc_audio_init(AUDIO_TONE_HZ) != ESP_OK)
+    {
+        ESP_LOGE(STATE_TAG, "Audio timer failed");
+    }
+    /* One queue carries every event of every intersection */
+    if (tlc_scheduler_init(&scheduler, controllers, TLC_CONTROLLERS) != ESP_OK)
+    {
+        ESP_LOGE(STATE_TAG, "Controller queue failed");
+        return;
+    }
+    /* In low power mode the I/O task posts TLC_EVENT_ADC once per burst instead */
+    scheduler.tick_ms = low_power ? 0 : TLC_DENSITY_BLOCK_MS;
+    scheduler.handler = controller_handler;
+    tlc_spsc_init(&io_events, io_event_slots, IO_EVENTS, sizeof(tlc_event_t));
+    /* Initialize TLC UART communication and its command console */
     tlc_bsp_uart_init();
-    /* Default State based on Direction_0 
-       North-South -> GREEN
-       East-West -> RED
-     */
-    if(DIRECTION_0 == NORTH){
-        state = GREEN;
-        ESP_LOGI(STATE_TAG, "GREEN");
+    /* Light sleep ahead of the button and preemption handlers, so they wake the chip */
+    if (low_power && tlc_bsp_power_init() != ESP_OK)
+    {
+        ESP_LOGE(STATE_TAG, "Light sleep unavailable, density still sampled in bursts");
     }
-    else{
-        state = RED;
-        ESP_LOGI(STATE_TAG, "RED");
+    tlc_console_init(&scheduler, request_stats, request_history);
+    /* Start continuous ADC sampling and the calibrated density filter */
+    if (tlc_bsp_adc_init(low_power) != ESP_OK)
+    {
+        ESP_LOGE(STATE_TAG, "ADC continuous mode failed");
     }
-    /* Display Banner through UART */
-    tlc_bsp_uart_write_byte(banner);
-    /* Create Binary Semaphore */    
-    walk_semaphore = xSemaphoreCreateBinary();
-    /* Create Queue of size 2 */
-    adc_queue = xQueueCreate(2, sizeof(uint16_t));
-    /* Wait until Semaphore is created */
-    if (walk_semaphore != NULL)
+    /* Lookup table needs the calibration read by tlc_bsp_adc_init() */
+    tlc_density_init(&density_filter, tlc_bsp_adc_mv);
+    if (low_power)
     {
-        /* Create Tasks */
-        xTaskCreate(&halt_light_task, "Halt Lights Task", 2048, NULL, 15, NULL);
-        xTaskCreate(&light_task, "light_task", 2048, NULL, 5, &light_task_handle);
-        xTaskCreate(&button_task, "button_task", 2048, NULL, 10, &button_task_handle);
-        xTaskCreate(&yellow_task, "yellow_task", 2048, NULL, 5, &yellow_task_handle);
-        xTaskCreate(&walk_task, "walk_task", 2048, NULL, 5, &walk_task_handle);
-        xTaskCreate(&adc_task, "adc_task", 2048, NULL, 10, NULL);
-        xTaskCreate(&uart_task, "uart_task", 2048, NULL, 10, NULL);
-
+        /* A whole window in one burst, still one value per second */
+        density_filter.block_samples = TLC_DENSITY_BURST_BLOCK;
+    }
+    tlc_history_init(&history);
+    /* Start the timing plan of every intersection, the first phases show once the controller runs */
+    for (uint8_t i = 0; i < TLC_CONTROLLERS; i++)
+    {
+        if (tlc_controller_init(&scheduler, i, tlc[i], 2, timing_plan) != ESP_OK)
+        {
+            ESP_LOGE(STATE_TAG, "Invalid timing plan %s", timing_plan->name);
+            return;
+        }
+        tlc_controller_offset(&controllers[i], ((int64_t)COORD_OFFSET_MS + i * COORD_OFFSET_STEP_MS) * 1000);
     }
-}
\ No newline at end of file
+    /* Emergency vehicle preemption of every intersection */
+    tlc_scheduler_preempt_init(&scheduler, (gpio_num_t)PREEMPT_PIN, PREEMPT_APPROACH);
+    /* Display Banner through UART */
+    tlc_bsp_uart_write_byte(banner);
+    /* Binary telemetry follows the banner */
+    tlc_telemetry_init(tlc_bsp_uart_write);
+    tlc_telemetry_boot(timing_plan->name, timing_plan->count);
+    /* Create Tasks: sampling and telemetry on one core, the lights on the other */
+    xTaskCreatePinnedToCore(&io_task, "io_task", IO_STACK, NULL, IO_PRIORITY, &io_task_handle, IO_CORE);
+    tlc_telemetry_consumer(io_task_handle);
+    xTaskCreatePinnedToCore(&tlc_scheduler_task, "controller_task", CONTROLLER_STACK, &scheduler, 15,
+                            &controller_task_handle, CONTROL_CORE);
+    tlc_monitor_task(controller_task_handle, "controller_task", CONTROLLER_STACK);
+    tlc_monitor_task(io_task_handle, "io_task", IO_STACK);
+}
@@ -20,4 +20,16 @@
 #define FIFTEENTH_SECOND 15000000 /*!< 15 second period */
 #define THIRTY_SECOND 30000000    /*!< 30 second period */
 
+/* Blink intervals, same on and off */
+#define YELLOW_BLINK_US 250000    /*!< Yellow flash half period */
+#define WALK_BLINK_US 100000      /*!< Walk warning half period */
+
+/* Accessible signal cadences, see bsp/tlc_audio.c */
+#define LOCATOR_ON_US 150000      /*!< Locator tone length */
+#define LOCATOR_PERIOD_US 1000000 /*!< One locator tone per second */
+#define WALK_TICK_ON_US 30000     /*!< Walk tick length */
+#define WALK_TICK_PERIOD_US 100000 /*!< Ten walk ticks per second */
+#define BEEP_TICK_US 100000       /*!< Warning beep cadence tick, on for one tick out of BEEP_TICKS */
+#define BEEP_TICKS 5              /*!< Ticks per beep */
+
 #endif
\ No newline at end of file
@@ -0,0 +1,308 @@
+/**
+ * @file tlc_button.c
+ * @brief Pedestrian button engine source code
+ * @author Jorge Minjares (https://github.com/JorgeMinjares)
+ * @brief The ISR only timestamps edges and posts them to the controller
+ *        queue. Debouncing and tap/hold/halt classification run in the
+ *        controller, which also waits for the next hold or debounce deadline.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include "tlc_button.h"
+#include "bsp/tlc_bsp.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "tlc_trace.h"
+#include "tlc_monitor.h"
+#include "tlc_record.h"
+
+static QueueHandle_t event_queue = NULL;  /*!< Controller queue taking the edges */
+static tlc_button_stats_t stats;         /*!< Counters of every engine */
+
+/**
+ * @brief Post an edge to the controller
+ *
+ * @param p button
+ * @param level level after the edge
+ */
+static void IRAM_ATTR tlc_button_post(tlc_button_pin_t *p, uint8_t level)
+{
+    BaseType_t woken = pdFALSE;
+    tlc_event_t edge = {
+        .type = TLC_EVENT_BUTTON_EDGE,
+        .instance = p->instance,
+        .button = p->index,
+        .level = level,
+        .timestamp = esp_timer_get_time(),
+    };
+    stats.edges++;
+    tlc_trace(TLC_TRACE_BUTTON_EDGE, (uint16_t)p->pin, level);
+    if (xQueueSendFromISR(event_queue, &edge, &woken) != pdPASS)
+    {
+        stats.dropped++;
+    }
+    portYIELD_FROM_ISR(woken);
+}
+
+/**
+ * @brief Button edge ISR
+ *
+ * @param arg tlc_button_pin_t of the button
+ */
+static void IRAM_ATTR tlc_button_isr(void *arg)
+{
+    tlc_button_pin_t *p = arg;
+    uint8_t level = (uint8_t)gpio_get_level(p->pin);
+    tlc_record_edge((uint8_t)p->pin, level);
+    tlc_button_post(p, level);
+}
+
+static void tlc_button_push(tlc_button_t *b, tlc_button_type_t type, const tlc_button_pin_t *p, int64_t timestamp,
+                            int64_t duration)
+{
+    if (b->pending_count == TLC_BUTTON_PENDING)
+    {
+        return;
+    }
+    tlc_button_event_t *event = &b->pending[(b->pending_head + b->pending_count++) % TLC_BUTTON_PENDING];
+    event->type = type;
+    event->pin = p->pin;
+    event->direction = p->direction;
+    event->timestamp = timestamp;
+    event->duration = duration;
+    stats.events++;
+}
+
+static bool tlc_button_other_pressed(const tlc_button_t *b, uint8_t direction)
+{
+    for (uint8_t i = 0; i < b->pin_count; i++)
+    {
+        if (b->pins[i].direction != direction && b->pins[i].level)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void tlc_button_accept(tlc_button_t *b, tlc_button_pin_t *p, uint8_t level, int64_t timestamp)
+{
+    p->level = level;
+    p->last_edge = timestamp;
+    p->unsettled = false;
+    if (level)
+    {
+        p->pressed_at = timestamp;
+        p->held = false;
+        /* Both directions pressed together halts the intersection */
+        tlc_button_push(b, tlc_button_other_pressed(b, p->direction) ? TLC_BUTTON_HALT : TLC_BUTTON_PRESS, p, timestamp,
+                        0);
+    }
+    else
+    {
+        tlc_button_push(b, TLC_BUTTON_RELEASE, p, timestamp, timestamp - p->pressed_at);
+    }
+}
+
+static void tlc_button_edge(tlc_button_t *b, const tlc_event_t *edge)
+{
+    if (edge->button >= b->pin_count)
+    {
+        return;
+    }
+    tlc_button_pin_t *p = &b->pins[edge->button];
+    p->raw = edge->level;
+    if (edge->level == p->level)
+    {
+        return;
+    }
+    if (edge->timestamp - p->last_edge < TLC_BUTTON_DEBOUNCE_US)
+    {
+        /* Re-read the pin once the debounce window closes */
+        stats.bounces++;
+        p->unsettled = true;
+        return;
+    }
+    tlc_button_accept(b, p, edge->level, edge->timestamp);
+}
+
+/**
+ * @brief Next debounce or hold deadline
+ *
+ * @param buttons engine
+ * @return int64_t esp_timer time, -1 if none is pending
+ */
+int64_t tlc_button_deadline(const tlc_button_t *buttons)
+{
+    int64_t deadline = -1;
+    for (uint8_t i = 0; i < buttons->pin_count; i++)
+    {
+        const tlc_button_pin_t *p = &buttons->pins[i];
+        int64_t t = -1;
+        if (p->unsettled)
+        {
+            t = p->last_edge + TLC_BUTTON_DEBOUNCE_US;
+        }
+        else if (p->level && !p->held)
+        {
+            t = p->pressed_at + TLC_BUTTON_HOLD_US;
+        }
+        if (t >= 0 && (deadline < 0 || t < deadline))
+        {
+            deadline = t;
+        }
+    }
+    return deadline;
+}
+
+static void tlc_button_expire(tlc_button_t *b, int64_t now)
+{
+    for (uint8_t i = 0; i < b->pin_count; i++)
+    {
+        tlc_button_pin_t *p = &b->pins[i];
+        if (p->unsettled && now >= p->last_edge + TLC_BUTTON_DEBOUNCE_US)
+        {
+            p->unsettled = false;
+            /* Injected inputs have no pin to read, their last edge stands */
+            uint8_t level = p->pin == GPIO_NUM_NC ? p->raw : (uint8_t)gpio_get_level(p->pin);
+            if (level != p->level)
+            {
+                tlc_button_accept(b, p, level, now);
+            }
+        }
+        if (p->level && !p->held && now >= p->pressed_at + TLC_BUTTON_HOLD_US)
+        {
+            p->held = true;
+            tlc_button_push(b, TLC_BUTTON_HOLD, p, p->pressed_at + TLC_BUTTON_HOLD_US, now - p->pressed_at);
+        }
+    }
+}
+
+/**
+ * @brief Initialize the button engine of one intersection
+ *
+ * @param buttons engine
+ * @param instance intersection, carried by the edge events
+ * @param tlc array of tlc structures
+ * @param count number of tlc structures
+ * @param events controller queue of tlc_event_t the ISR posts edges to
+ * @note Call after tlc_bsp_init() has configured the button pins
+ */
+void tlc_button_init(tlc_button_t *buttons, uint8_t instance, tlc_t * const tlc, uint8_t count, QueueHandle_t events)
+{
+    event_queue = events;
+    buttons->pin_count = 0;
+    buttons->pending_head = 0;
+    buttons->pending_count = 0;
+    for (uint8_t d = 0; d < count && d < TLC_BUTTON_MAX_DIRECTIONS; d++)
+    {
+        void *args[2];
+        for (int i = 0; i < 2; i++)
+        {
+            tlc_button_pin_t *p = &buttons->pins[buttons->pin_count];
+            p->pin = tlc[d].button[i];
+            p->instance = instance;
+            p->index = buttons->pin_count++;
+            p->direction = d;
+            p->level = p->pin == GPIO_NUM_NC ? 0 : (uint8_t)gpio_get_level(p->pin);
+            p->raw = p->level;
+            p->unsettled = false;
+            p->held = p->level;
+            p->last_edge = -TLC_BUTTON_DEBOUNCE_US;
+            p->pressed_at = 0;
+            args[i] = p;
+        }
+        tlc_bsp_button_isr_init(&tlc[d], tlc_button_isr, args);
+    }
+}
+
+/**
+ * @brief Feed an edge from an input without a GPIO interrupt
+ *
+ * @param buttons engine
+ * @param index button, tlc_button_pin_t index
+ * @param level level after the edge
+ * @note Safe from ISRs and timer callbacks, like the GPIO ISR it stands in for
+ */
+void IRAM_ATTR tlc_button_inject(tlc_button_t *buttons, uint8_t index, uint8_t level)
+{
+    if (index < buttons->pin_count)
+    {
+        tlc_button_post(&buttons->pins[index], level);
+    }
+}
+
+/**
+ * @brief Run the engine on a button edge or deadline event
+ *
+ * @param buttons engine of the event's instance
+ * @param event TLC_EVENT_BUTTON_EDGE or TLC_EVENT_BUTTON_TIMER
+ * @note Classified events are collected with tlc_button_next()
+ */
+void tlc_button_handle(tlc_button_t *buttons, const tlc_event_t *event)
+{
+    if (event->type == TLC_EVENT_BUTTON_EDGE)
+    {
+        tlc_button_edge(buttons, event);
+    }
+    else
+    {
+        stats.wakeups++;
+    }
+    tlc_button_expire(buttons, esp_timer_get_time());
+}
+
+/**
+ * @brief Take the next classified button event
+ *
+ * @param buttons engine
+ * @param event event storage
+ * @return false if none is pending
+ */
+bool tlc_button_next(tlc_button_t *buttons, tlc_button_event_t *event)
+{
+    if (buttons->pending_count == 0)
+    {
+        return false;
+    }
+    *event = buttons->pending[buttons->pending_head];
+    buttons->pending_head = (buttons->pending_head + 1) % TLC_BUTTON_PENDING;
+    buttons->pending_count--;
+    return true;
+}
+
+/**
+ * @brief Record the latency from an event to the controller's reaction
+ *
+ * @param event event that was acted on
+ * @return latency (us)
+ */
+int64_t tlc_button_reaction(const tlc_button_event_t *event)
+{
+    int64_t latency = esp_timer_get_time() - event->timestamp;
+    tlc_monitor_latency(TLC_MONITOR_BUTTON, latency);
+    stats.reactions++;
+    stats.latency_sum_us += latency;
+    if (latency > stats.latency_max_us)
+    {
+        stats.latency_max_us = latency;
+    }
+    return latency;
+}
+
+/**
+ * @brief Copy the button engine counters
+ *
+ * @param out counter storage
+ * @note Plain copy for the host tools; on the target the scheduler task
+ *       publishes its share of them per intersection, see tlc_state_t
+ */
+void tlc_button_get_stats(tlc_button_stats_t *out)
+{
+    *out = stats;
+}
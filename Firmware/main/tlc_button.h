@@ -0,0 +1,130 @@
+/**
+ * @file tlc_button.h
+ * @brief Pedestrian button engine
+ * @author Jorge Minjares (https://github.com/JorgeMinjares)
+ * @brief Edge interrupts on the pedestrian buttons feed timestamped events
+ *        to the controller queue. The engine debounces the edges and
+ *        classifies presses by measured duration instead of polling and sleeping.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef TLC_BUTTON_H
+#define TLC_BUTTON_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "traffic_light.h"
+#include "tlc_event.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+
+#define TLC_BUTTON_DEBOUNCE_US 20000   /*!< Edges closer than this are contact bounce */
+#define TLC_BUTTON_HOLD_US 2000000     /*!< Press duration that counts as press & hold */
+#define TLC_BUTTON_MAX_DIRECTIONS 2    /*!< tlc_t directions served by one engine */
+#define TLC_BUTTON_MAX_PINS (TLC_BUTTON_MAX_DIRECTIONS * 2) /*!< Buttons of one engine */
+#define TLC_BUTTON_PENDING 4           /*!< Classified events buffered */
+
+/******************************************************************
+ * \enum tlc_button_type_t tlc_button.h
+ * \brief Classified button events
+ *
+ * ### Example
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~.c
+ * typedef enum{
+ *      TLC_BUTTON_PRESS,
+ *      TLC_BUTTON_HOLD,
+ *      TLC_BUTTON_RELEASE,
+ *      TLC_BUTTON_HALT,
+ * }tlc_button_type_t;
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *******************************************************************/
+typedef enum
+{
+    TLC_BUTTON_PRESS = 0x00,   /*!< Debounced press edge */
+    TLC_BUTTON_HOLD = 0x01,    /*!< Still pressed after TLC_BUTTON_HOLD_US */
+    TLC_BUTTON_RELEASE = 0x02, /*!< Debounced release edge */
+    TLC_BUTTON_HALT = 0x03,    /*!< Both directions pressed together */
+} tlc_button_type_t;
+
+/******************************************************************
+ * \struct tlc_button_event_t tlc_button.h
+ * \brief Classified button event
+ *******************************************************************/
+typedef struct
+{
+    tlc_button_type_t type; /*!< Event type */
+    gpio_num_t pin;         /*!< Button pin */
+    uint8_t direction;      /*!< Index of the tlc_t the pin belongs to */
+    int64_t timestamp;      /*!< Time the event happened (us) */
+    int64_t duration;       /*!< Press duration for HOLD and RELEASE (us) */
+} tlc_button_event_t;
+
+/**
+ * @brief Debounced state of one button
+ */
+typedef struct
+{
+    gpio_num_t pin;     /*!< Button pin, GPIO_NUM_NC for inputs fed by tlc_button_inject() */
+    uint8_t instance;   /*!< Intersection, copied to its edge events */
+    uint8_t index;      /*!< Position in tlc_button_t pins */
+    uint8_t direction;  /*!< Owning tlc_t index */
+    uint8_t level;      /*!< Debounced level */
+    uint8_t raw;        /*!< Level of the last edge */
+    bool unsettled;     /*!< Edges were rejected since the last accepted one */
+    bool held;          /*!< HOLD already reported for this press */
+    int64_t last_edge;  /*!< Last accepted edge */
+    int64_t pressed_at; /*!< Start of the current press */
+} tlc_button_pin_t;
+
+/******************************************************************
+ * \struct tlc_button_t tlc_button.h
+ * \brief Button engine of one intersection
+ *
+ * ### Example
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~.c
+ * tlc_button_init(&buttons, 0, tlc, 2, queue);
+ * // controller, on TLC_EVENT_BUTTON_x for instance 0
+ * tlc_button_handle(&buttons, &event);
+ * while (tlc_button_next(&buttons, &button))
+ * {
+ *      ...
+ * }
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *******************************************************************/
+typedef struct
+{
+    tlc_button_pin_t pins[TLC_BUTTON_MAX_PINS];      /*!< Button states */
+    uint8_t pin_count;                               /*!< Buttons registered */
+    tlc_button_event_t pending[TLC_BUTTON_PENDING];  /*!< Classified events */
+    uint8_t pending_head;                            /*!< Next event to return */
+    uint8_t pending_count;                           /*!< Events buffered */
+} tlc_button_t;
+
+/******************************************************************
+ * \struct tlc_button_stats_t tlc_button.h
+ * \brief Button engine counters, summed over every engine
+ *******************************************************************/
+typedef struct
+{
+    uint32_t edges;          /*!< Edges taken by the ISR */
+    uint32_t bounces;        /*!< Edges rejected as bounce */
+    uint32_t dropped;        /*!< Edges lost to a full controller queue */
+    uint32_t events;         /*!< Classified events */
+    uint32_t wakeups;        /*!< Debounce and hold deadlines handled */
+    uint32_t reactions;      /*!< Latency samples */
+    int64_t latency_sum_us;  /*!< Sum of press-to-reaction latencies */
+    int64_t latency_max_us;  /*!< Worst press-to-reaction latency */
+} tlc_button_stats_t;
+
+void tlc_button_init(tlc_button_t *buttons, uint8_t instance, tlc_t * const tlc, uint8_t count, QueueHandle_t events);
+void tlc_button_inject(tlc_button_t *buttons, uint8_t index, uint8_t level);
+int64_t tlc_button_deadline(const tlc_button_t *buttons);
+void tlc_button_handle(tlc_button_t *buttons, const tlc_event_t *event);
+bool tlc_button_next(tlc_button_t *buttons, tlc_button_event_t *event);
+int64_t tlc_button_reaction(const tlc_button_event_t *event);
+void tlc_button_get_stats(tlc_button_stats_t *stats);
+
+#endif
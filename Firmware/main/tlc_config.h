@@ -70,6 +70,41 @@
 #define MAX_ADC_VAL 4096 /*!< Maximum adc value */
 #define MIN_CARS 0 /*!< Minimum cars */
 #define MAX_CARS 25  /*!< Maximum cars */
+#define MIN_DENSITY_MV 150  /*!< Sensor voltage read as MIN_CARS */
+#define MAX_DENSITY_MV 3100 /*!< Sensor voltage read as MAX_CARS */
+
+/* Traffic density sampling */
+#define DENSITY_SAMPLE_HZ 20000 /*!< Continuous ADC conversions per second, the ESP32 minimum */
+
+/* Telemetry, see tlc_telemetry.h */
+#define TELEMETRY_BATCH 10 /*!< Density values between telemetry frames */
+#define TRACE_STREAM 1     /*!< Send the trace ring with the telemetry, 0 keeps it until 'T' arrives on UART0 */
+#define RECORD_IO 1        /*!< Record inputs and outputs and send them with the telemetry, see tlc_record.h */
+
+/* Accessible pedestrian signal, see bsp/tlc_audio.h */
+#define AUDIO_TONE_HZ 880 /*!< Tone of every cue, from the DAC cosine generator */
+#define AUDIO_LOCATOR 0   /*!< Locator tone on approaches showing DON'T WALK, 0 keeps them quiet */
+
+/* Power management, see main.c; build with sdkconfig.defaults.lowpower for light sleep */
+#define LOW_POWER 0 /*!< Automatic light sleep: density sampled in bursts, the controller wakes only on events */
+
+/* Task placement, see main.c */
+#define CONTROL_CORE 1 /*!< Core of the controller task: lights, buttons and walk signals */
+#define IO_CORE 0      /*!< Core of the I/O task: density filter, UART polling and telemetry */
+
+/* Emergency vehicle preemption, see tlc_phase_preempt() */
+#define PREEMPT_PIN 27      /*!< Preemption input, active high with the pulldown on; GPIO_NUM_NC for none */
+#define PREEMPT_APPROACH 0  /*!< Approach given the green, TLC_PHASE_ALL_RED stops every approach */
+
+/* Intersections, see tlc_controller.h */
+#define TLC_CONTROLLERS 1 /*!< Intersections run by the board, the first one on the pins above */
+
+/* Coordination, see tlc_plan_coordinated */
+#define COORD_OFFSET_MS 0      /*!< Offset of the first intersection into the common cycle */
+#define COORD_OFFSET_STEP_MS 0 /*!< Offset added per further intersection on the board */
+
+/* Timing Plan, see tlc_plan.c */
+#define TLC_PLAN tlc_plan_pedestrian /*!< Plan run by the phase task, tlc_plan_actuated follows traffic density, tlc_plan_coordinated runs a green wave */
 
 /* Logic Level */
 #define LOW 0  /*!< Logic Level Low */
@@ -0,0 +1,444 @@
+/**
+ * @file tlc_console.c
+ * @brief Line console on UART0 source code
+ * @author Jorge Minjares (https://github.com/JorgeMinjares)
+ * @brief Retimed plans live in two RAM copies of a plan table. Edits go to
+ *        the copy no intersection runs or has staged, so a phase in
+ *        progress never sees its times change under it; apply stages the
+ *        copy and each intersection switches at its next phase boundary.
+ *        Everything runs on the scheduler task; the replies are sent by the
+ *        telemetry consumer.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "tlc_console.h"
+#include "tlc_telemetry.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+
+#if configGENERATE_RUN_TIME_STATS
+#define TLC_CONSOLE_CLOCK() ((uint32_t)portGET_RUN_TIME_COUNTER_VALUE()) /*!< Run time of the CPU */
+#else
+#define TLC_CONSOLE_CLOCK() ((uint32_t)esp_timer_get_time()) /*!< Run time of the CPU */
+#endif
+
+static tlc_scheduler_t *console_scheduler;              /*!< Intersections the commands act on */
+static tlc_console_stats_fn console_stats;              /*!< Runs the stats command */
+static tlc_console_history_fn console_history;          /*!< Runs the history command */
+static char line[TLC_CONSOLE_LINE + 1];                 /*!< Line being received */
+static uint8_t length = 0;                              /*!< Bytes in line */
+static bool overflow = false;                           /*!< Line too long, dropped at its end */
+static tlc_plan_t plans[2];                             /*!< Retimed copies of a plan */
+static tlc_phase_t phases[2][TLC_PLAN_MAX_PHASES];      /*!< Phase tables of the copies */
+static tlc_plan_t *draft = NULL;                        /*!< Copy being edited, NULL for none */
+static bool draft_restart = false;                      /*!< Draft was taken from a plan staged to restart */
+static bool applying = false;                           /*!< A staged plan has not reached every intersection */
+static tlc_console_stats_t stats;                       /*!< Counters */
+
+/* Queue a reply, starting the sending early rather than dropping it */
+static void tlc_console_reply(const char *format, ...)
+{
+    char data[TLC_TELEMETRY_DATA_MAX];
+    va_list args;
+    va_start(args, format);
+    int size = vsnprintf(&data[1], sizeof(data) - 1, format, args);
+    va_end(args);
+    /* Longer replies are cut, vsnprintf leaves room for its terminator */
+    size = size < 0 ? 0 : size >= (int)sizeof(data) - 1 ? (int)sizeof(data) - 2 : size;
+    data[0] = (char)size;
+    if (tlc_telemetry_pending() >= TLC_TELEMETRY_RING / 2)
+    {
+        tlc_telemetry_flush();
+    }
+    tlc_telemetry_record(TLC_TELEMETRY_CONSOLE, esp_timer_get_time(), (const uint8_t *)data, (size_t)size + 1);
+}
+
+/* Latest plan given to the intersections, staged or running */
+static const tlc_plan_t *tlc_console_newest(bool *restart)
+{
+    const tlc_phase_engine_t *engine = &console_scheduler->controllers[0].engine;
+    *restart = engine->next_plan != NULL && engine->next_restart;
+    return engine->next_plan != NULL ? engine->next_plan : engine->plan;
+}
+
+/* Copy no intersection runs or has staged */
+static tlc_plan_t *tlc_console_free_copy(void)
+{
+    for (uint8_t b = 0; b < 2; b++)
+    {
+        bool used = false;
+        for (uint8_t i = 0; i < console_scheduler->count && !used; i++)
+        {
+            const tlc_phase_engine_t *engine = &console_scheduler->controllers[i].engine;
+            used = engine->plan == &plans[b] || engine->next_plan == &plans[b];
+        }
+        if (!used)
+        {
+            return &plans[b];
+        }
+    }
+    return NULL;
+}
+
+/* Start a draft from the newest plan */
+static bool tlc_console_edit(void)
+{
+    if (draft != NULL)
+    {
+        return true;
+    }
+    tlc_plan_t *copy = tlc_console_free_copy();
+    if (copy == NULL)
+    {
+        return false;
+    }
+    const tlc_plan_t *base = tlc_console_newest(&draft_restart);
+    tlc_phase_t *table = phases[copy - plans];
+    memcpy(table, base->phases, base->count * sizeof(tlc_phase_t));
+    *copy = *base;
+    copy->phases = table;
+    draft = copy;
+    return true;
+}
+
+/* get */
+static bool tlc_console_get(void)
+{
+    bool restart;
+    const tlc_plan_t *plan = draft != NULL ? draft : tlc_console_newest(&restart);
+    const tlc_phase_engine_t *engine = &console_scheduler->controllers[0].engine;
+    tlc_console_reply("plan %s, %s: min max call pass", plan->name,
+                      plan == draft ? "draft" : plan == engine->plan ? "running" : "staged");
+    for (uint8_t i = 0; i < plan->count; i++)
+    {
+        const tlc_phase_t *phase = &plan->phases[i];
+        tlc_console_reply("%u %.10s %u %u %u %u", (unsigned)i, phase->name,
+                          (unsigned)phase->min_ms, (unsigned)phase->max_ms, (unsigned)phase->call_ms,
+                          (unsigned)phase->passage_ms);
+    }
+    return true;
+}
+
+/* Yellow, flashing don't walk and the all red between greens clear the intersection */
+static bool tlc_console_clearance(const tlc_plan_t *plan, const tlc_phase_t *phase)
+{
+    if (phase->flags & TLC_PHASE_REST)
+    {
+        return false;
+    }
+    if (phase->walk == WALK_WARNING)
+    {
+        return true;
+    }
+    bool red = true;
+    for (uint8_t d = 0; d < plan->approaches; d++)
+    {
+        if (phase->light[d] == YELLOW)
+        {
+            return true;
+        }
+        red &= phase->light[d] == RED;
+    }
+    return red && phase->walk == WALK_OFF;
+}
+
+/* set PHASE FIELD MS */
+static bool tlc_console_set(const char *args)
+{
+    unsigned index;
+    unsigned ms;
+    char field[8];
+    if (sscanf(args, "%u %7s %u", &index, field, &ms) != 3 || ms > TLC_CONSOLE_MAX_MS)
+    {
+        tlc_console_reply("error: set PHASE min|max|call|pass MS");
+        tlc_console_reply("clearances: yellow, don't walk, all red fixed");
+        return false;
+    }
+    if (!tlc_console_edit())
+    {
+        tlc_console_reply("error: busy until the last apply is done");
+        return false;
+    }
+    if (index >= draft->count)
+    {
+        tlc_console_reply("error: %u phases", (unsigned)draft->count);
+        return false;
+    }
+    tlc_phase_t *phase = &phases[draft - plans][index];
+    if (tlc_console_clearance(draft, phase))
+    {
+        tlc_console_reply("error: %u %.10s is a clearance, fixed", index, phase->name);
+        return false;
+    }
+    if (strcmp(field, "min") == 0)
+    {
+        phase->min_ms = ms;
+    }
+    else if (strcmp(field, "max") == 0)
+    {
+        phase->max_ms = ms;
+    }
+    else if (strcmp(field, "call") == 0)
+    {
+        phase->call_ms = ms;
+    }
+    else if (strcmp(field, "pass") == 0)
+    {
+        phase->passage_ms = ms;
+    }
+    else
+    {
+        tlc_console_reply("error: field %s", field);
+        return false;
+    }
+    tlc_console_reply("ok %u %s %u, apply to run it", index, field, ms);
+    return true;
+}
+
+/* apply */
+static bool tlc_console_apply(int64_t now)
+{
+    if (draft == NULL)
+    {
+        tlc_console_reply("error: nothing set");
+        return false;
+    }
+    if (tlc_scheduler_replan(console_scheduler, now, draft, draft_restart) != ESP_OK)
+    {
+        tlc_console_reply("error: invalid plan, draft kept");
+        return false;
+    }
+    draft = NULL;
+    applying = true;
+    tlc_console_reply("ok staged on %u", (unsigned)console_scheduler->count);
+    return true;
+}
+
+/* mode NAME */
+static bool tlc_console_mode(const char *args, int64_t now)
+{
+    static const tlc_plan_t *const modes[] = {&tlc_plan_pedestrian, &tlc_plan_actuated, &tlc_plan_coordinated,
+                                              &tlc_plan_staged};
+    for (uint8_t i = 0; i < sizeof(modes) / sizeof(modes[0]); i++)
+    {
+        if (strcmp(args, modes[i]->name) == 0)
+        {
+            if (tlc_scheduler_replan(console_scheduler, now, modes[i], true) != ESP_OK)
+            {
+                break;
+            }
+            /* A draft of the old plan no longer applies */
+            draft = NULL;
+            applying = true;
+            tlc_console_reply("ok %s staged on %u", modes[i]->name, (unsigned)console_scheduler->count);
+            return true;
+        }
+    }
+    tlc_console_reply("error: mode pedestrian|actuated|coordinated|staged");
+    return false;
+}
+
+/* halt [I], resume [I] */
+static bool tlc_console_halt(const char *args, bool halt)
+{
+    uint8_t first = 0;
+    uint8_t last = console_scheduler->count;
+    if (*args != '\0')
+    {
+        char *end;
+        unsigned long id = strtoul(args, &end, 10);
+        if (*end != '\0' || id >= console_scheduler->count)
+        {
+            tlc_console_reply("error: %u intersections", (unsigned)console_scheduler->count);
+            return false;
+        }
+        first = (uint8_t)id;
+        last = first + 1;
+    }
+    for (uint8_t i = first; i < last; i++)
+    {
+        tlc_controller_t *ctrl = &console_scheduler->controllers[i];
+        if (ctrl->engine.halted != halt)
+        {
+            tlc_controller_halt(ctrl, esp_timer_get_time(), halt);
+        }
+    }
+    tlc_console_reply("ok %s", halt ? "halted" : "resumed");
+    return true;
+}
+
+/* history RES FROM [TO] */
+static bool tlc_console_history(const char *args)
+{
+    static const char *const levels[] = {"second", "minute", "hour"};
+    char level[8];
+    unsigned long from;
+    unsigned long to = 0;
+    int fields = sscanf(args, "%7s %lu %lu", level, &from, &to);
+    for (uint8_t i = 0; fields >= 2 && i < sizeof(levels) / sizeof(levels[0]); i++)
+    {
+        if (strcmp(level, levels[i]) == 0 && from <= TLC_CONSOLE_MAX_AGE_S && to <= TLC_CONSOLE_MAX_AGE_S)
+        {
+            console_history(i, (uint32_t)from, (uint32_t)to);
+            tlc_console_reply("ok history %s %lu %lu", level, from, to);
+            return true;
+        }
+    }
+    tlc_console_reply("error: history second|minute|hour FROM [TO]");
+    return false;
+}
+
+/* Run a complete line */
+static bool tlc_console_run(char *text, int64_t now)
+{
+    char *args = strchr(text, ' ');
+    if (args != NULL)
+    {
+        *args++ = '\0';
+        while (*args == ' ')
+        {
+            args++;
+        }
+    }
+    else
+    {
+        args = text + strlen(text);
+    }
+    if (strcmp(text, "get") == 0)
+    {
+        return tlc_console_get();
+    }
+    if (strcmp(text, "set") == 0)
+    {
+        return tlc_console_set(args);
+    }
+    if (strcmp(text, "apply") == 0)
+    {
+        return tlc_console_apply(now);
+    }
+    if (strcmp(text, "mode") == 0)
+    {
+        return tlc_console_mode(args, now);
+    }
+    if (strcmp(text, "halt") == 0 || strcmp(text, "resume") == 0)
+    {
+        return tlc_console_halt(args, text[0] == 'h');
+    }
+    if (strcmp(text, "stats") == 0 && console_stats != NULL)
+    {
+        console_stats();
+        return true;
+    }
+    if (strcmp(text, "history") == 0 && console_history != NULL)
+    {
+        return tlc_console_history(args);
+    }
+    tlc_console_reply("error: get set apply mode halt resume stats history");
+    return false;
+}
+
+/**
+ * @brief Start the console
+ *
+ * @param scheduler intersections the commands act on, every one runs the
+ *                  same plan
+ * @param stats_fn runs the stats command, may be NULL
+ * @param history_fn runs the history command, may be NULL
+ */
+void tlc_console_init(tlc_scheduler_t *scheduler, tlc_console_stats_fn stats_fn, tlc_console_history_fn history_fn)
+{
+    console_scheduler = scheduler;
+    console_stats = stats_fn;
+    console_history = history_fn;
+}
+
+/**
+ * @brief Feed one received byte
+ *
+ * @param byte byte read from UART0
+ * @param now current time
+ * @return false if the byte is no console input: an upper case letter
+ *         between lines, left to the single byte commands
+ * @note A line ends with CR or LF and runs at once, its replies are queued
+ *       and their sending started before returning. Backspace and DEL
+ *       edit the line.
+ */
+bool tlc_console_byte(uint8_t byte, int64_t now)
+{
+    if (length == 0 && !overflow && byte >= 'A' && byte <= 'Z')
+    {
+        return false;
+    }
+    if (byte == '\r' || byte == '\n')
+    {
+        if (overflow)
+        {
+            tlc_console_reply("error: line over %u bytes", (unsigned)TLC_CONSOLE_LINE);
+            stats.errors++;
+        }
+        else if (length > 0)
+        {
+            uint32_t start = TLC_CONSOLE_CLOCK();
+            line[length] = '\0';
+            stats.errors += !tlc_console_run(line, now);
+            stats.lines++;
+            uint32_t took = TLC_CONSOLE_CLOCK() - start;
+            stats.line_max_us = took > stats.line_max_us ? took : stats.line_max_us;
+        }
+        else
+        {
+            return true;
+        }
+        length = 0;
+        overflow = false;
+        tlc_telemetry_flush();
+        return true;
+    }
+    if ((byte == '\b' || byte == 0x7f) && length > 0)
+    {
+        length--;
+    }
+    else if (byte >= ' ' && byte < 0x7f && !overflow)
+    {
+        overflow = length == TLC_CONSOLE_LINE;
+        line[length] = (char)byte;
+        length += !overflow;
+    }
+    return true;
+}
+
+/**
+ * @brief Report a staged plan every intersection switched to
+ *
+ * @note Call periodically from the scheduler task
+ */
+void tlc_console_poll(void)
+{
+    if (!applying || console_scheduler->replan_pending)
+    {
+        return;
+    }
+    applying = false;
+    int64_t took = console_scheduler->replan_us;
+    stats.applied++;
+    stats.apply_max_us = took > stats.apply_max_us ? took : stats.apply_max_us;
+    tlc_console_reply("applied on %u after %lld ms", (unsigned)console_scheduler->count, (long long)(took / 1000));
+    tlc_telemetry_flush();
+}
+
+/**
+ * @brief Copy the console counters
+ *
+ * @param out destination
+ */
+void tlc_console_get_stats(tlc_console_stats_t *out)
+{
+    *out = stats;
+}
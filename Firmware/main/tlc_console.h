@@ -0,0 +1,72 @@
+/**
+ * @file tlc_console.h
+ * @brief Line console on UART0
+ * @author Jorge Minjares (https://github.com/JorgeMinjares)
+ * @brief Lower case command lines retime the running plan, switch plans
+ *        and halt or resume intersections without reflashing. Bytes are fed
+ *        one at a time from the UART bytes the scheduler receives and a line runs
+ *        when its end arrives, so nothing ever waits for input. Replies go
+ *        out as CONSOLE telemetry records.
+ *
+ *        get                 running, staged or draft plan, one line per phase
+ *        set PHASE FIELD MS  edit the draft; FIELD is min, max, call or pass,
+ *                            clearances (yellow, flashing don't walk and
+ *                            all red) are fixed
+ *        apply               stage the draft on every intersection
+ *        mode NAME           stage pedestrian, actuated, coordinated or staged
+ *        halt [I]            halt every intersection or intersection I
+ *        resume [I]          resume every intersection or intersection I
+ *        stats               send a STATS record now
+ *        history RES FROM [TO]
+ *                            send the density history as HISTORY records;
+ *                            RES is second, minute or hour, FROM and TO
+ *                            are seconds before the newest value
+ *
+ *        Staged plans take over at each intersection's next phase boundary,
+ *        a mode at the end of its cycle, and the console reports when the
+ *        last one switched.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef TLC_CONSOLE_H
+#define TLC_CONSOLE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "tlc_controller.h"
+
+#define TLC_CONSOLE_LINE 48         /*!< Longest command line, end of line excluded */
+#define TLC_CONSOLE_MAX_MS 600000   /*!< Longest time a set command accepts */
+#define TLC_CONSOLE_MAX_AGE_S 0x7fffffff /*!< Furthest back a history command reaches */
+
+/**
+ * @brief Console counters
+ */
+typedef struct
+{
+    uint32_t lines;         /*!< Command lines run */
+    uint32_t errors;        /*!< Lines rejected */
+    uint32_t applied;       /*!< Staged plans every intersection switched to */
+    uint32_t line_max_us;   /*!< Longest time to run a line and queue its replies, run time counter units (us) */
+    int64_t apply_max_us;   /*!< Longest time from staging to the last intersection switching */
+} tlc_console_stats_t;
+
+/**
+ * @brief Runs the stats command
+ */
+typedef void (*tlc_console_stats_fn)(void);
+
+/**
+ * @brief Runs the history command, the scan must not run on the caller
+ */
+typedef void (*tlc_console_history_fn)(uint8_t level, uint32_t from_s, uint32_t to_s);
+
+void tlc_console_init(tlc_scheduler_t *scheduler, tlc_console_stats_fn stats_fn, tlc_console_history_fn history_fn);
+bool tlc_console_byte(uint8_t byte, int64_t now);
+void tlc_console_poll(void);
+void tlc_console_get_stats(tlc_console_stats_t *stats);
+
+#endif
@@ -0,0 +1,828 @@
+/**
+ * @file tlc_controller.c
+ * @brief Intersection controllers and their scheduler source code
+ * @author Jorge Minjares (https://github.com/JorgeMinjares)
+ * @brief Timer callbacks and button ISRs post events tagged with their
+ *        intersection; the scheduler task routes each one straight to its
+ *        controller. Scheduler ticks and button deadlines are raised when the
+ *        queue wait times out, so periodic work costs no extra timer. The
+ *        preemption ISR posts to the front of the queue, so it waits for
+ *        the event in progress and nothing else.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include "tlc_controller.h"
+#include "tlc_telemetry.h"
+#include "tlc_trace.h"
+#include "tlc_monitor.h"
+#include "tlc_record.h"
+#include "bsp/tlc_audio.h"
+#include "timer.h"
+#include "esp_attr.h"
+#include "freertos/task.h"
+
+#define TLC_CONTROLLER_TICK_US (portTICK_PERIOD_MS * 1000) /*!< Microseconds per tick */
+
+/**
+ * @brief Timer callback at the phase deadline
+ *
+ * @param arg controller
+ */
+static void tlc_controller_phase_callback(void *arg)
+{
+    tlc_controller_t *ctrl = arg;
+    tlc_event_t event = {
+        .type = TLC_EVENT_PHASE_TIMER,
+        .instance = ctrl->id,
+        .timestamp = esp_timer_get_time(),
+    };
+    tlc_trace(TLC_TRACE_PHASE_TIMER, ctrl->id, 0);
+    if (xQueueSendToBack(ctrl->scheduler->queue, &event, 0) != pdPASS)
+    {
+        __atomic_fetch_add(&ctrl->scheduler->dropped, 1, __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * @brief Sound an approach makes through a phase
+ *
+ * @param engine timing plan being run
+ * @param phase phase shown
+ * @param walking crosswalks the phase shows a walk signal on
+ * @param d approach
+ * @return walk tick and warning countdown for an accessible call, the
+ *         locator tone through DON'T WALK if AUDIO_LOCATOR is set
+ */
+static tlc_audio_cue_t tlc_controller_cue(const tlc_phase_engine_t *engine, const tlc_phase_t *phase,
+                                          uint8_t walking, uint8_t d)
+{
+    walk_t walk = walking & (1U << d) ? phase->walk : WALK_OFF;
+    if (engine->served_accessible && walk == WALK_ON)
+    {
+        return TLC_AUDIO_WALK;
+    }
+    if (engine->served_accessible && walk == WALK_WARNING)
+    {
+        return TLC_AUDIO_COUNTDOWN;
+    }
+    return AUDIO_LOCATOR && walk == WALK_OFF ? TLC_AUDIO_LOCATOR : TLC_AUDIO_OFF;
+}
+
+/**
+ * @brief Output of the current phase
+ *
+ * @param ctrl controller
+ * @return the precompiled output, or one compiled now for a preemption
+ *         stage or when the phase walks only the crosswalks being served or
+ *         keeps the other approaches moving
+ */
+static const tlc_bsp_output_t *tlc_controller_phase_output(tlc_controller_t *ctrl)
+{
+    const tlc_phase_engine_t *engine = &ctrl->engine;
+    const tlc_plan_t *plan = engine->plan;
+    const tlc_phase_t *phase = tlc_phase_current(engine);
+    uint8_t all = (uint8_t)((1U << plan->approaches) - 1);
+    uint8_t walking = tlc_phase_walking(engine);
+    bool staged = (phase->flags & TLC_PHASE_STAGED) && (engine->served & all) != all;
+    if (!tlc_phase_preempting(engine) && !staged && walking == (phase->walk == WALK_OFF ? 0 : phase->walk_mask))
+    {
+        return &ctrl->outputs[engine->index];
+    }
+    state_t light[TLC_PLAN_MAX_APPROACHES];
+    for (uint8_t d = 0; d < plan->approaches; d++)
+    {
+        light[d] = tlc_phase_aspect(engine, d);
+    }
+    if (ctrl->shown == &ctrl->partial)
+    {
+        ctrl->shown = NULL;
+    }
+    tlc_bsp_output_compile(&ctrl->partial, ctrl->tlc, plan->approaches, light, walking, phase->walk);
+    return &ctrl->partial;
+}
+
+/**
+ * @brief Put a precompiled output on the pins
+ *
+ * @param ctrl controller
+ * @param out output from tlc_bsp_output_compile()
+ * @param origin start of the phase, the blink patterns toggle on its grid
+ * @note Does nothing if out is already shown. Otherwise every approach
+ *       changes in the same register writes and the blink patterns of the
+ *       previous output stop.
+ */
+static void tlc_controller_output(tlc_controller_t *ctrl, const tlc_bsp_output_t *out, int64_t origin)
+{
+    if (out == ctrl->shown)
+    {
+        return;
+    }
+    tlc_pattern_cancel(&ctrl->yellow);
+    tlc_pattern_cancel(&ctrl->walk);
+    tlc_bsp_mask_write(&out->mask);
+    if (out->yellow_count)
+    {
+        tlc_pattern_start_at(&ctrl->yellow, out->yellow, out->yellow_count, YELLOW_BLINK_US, YELLOW_BLINK_US,
+                             TLC_PATTERN_FOREVER, origin);
+    }
+    if (out->walk_count)
+    {
+        tlc_pattern_start_at(&ctrl->walk, out->walk, out->walk_count, WALK_BLINK_US, WALK_BLINK_US,
+                             TLC_PATTERN_FOREVER, origin);
+    }
+    ctrl->shown = out;
+}
+
+/**
+ * @brief Publish the engine state for readers outside the scheduler task
+ *
+ * @param ctrl controller
+ */
+static void tlc_controller_publish(tlc_controller_t *ctrl)
+{
+    const tlc_phase_engine_t *engine = &ctrl->engine;
+    tlc_state_t state = {
+        .plan = engine->plan,
+        .started = engine->started,
+        .deadline = engine->deadline,
+        .transitions = engine->transitions,
+        .density = engine->density,
+        .index = engine->index,
+        .flags = (engine->halted ? TLC_STATE_HALTED : 0) | (engine->demand ? TLC_STATE_CALL : 0) |
+                 (engine->serving ? TLC_STATE_SERVING : 0) |
+                 (engine->served_accessible ? TLC_STATE_ACCESSIBLE : 0) |
+                 (engine->preempt_active ? TLC_STATE_PREEMPT : 0),
+        .counters = ctrl->counters,
+    };
+    tlc_state_publish(&ctrl->state, &state);
+}
+
+/**
+ * @brief Play the cues of the current phase
+ *
+ * @param ctrl controller
+ * @note Every approach's cadence counts from the phase start, so they tick
+ *       together
+ */
+static void tlc_controller_sound(tlc_controller_t *ctrl)
+{
+    const tlc_phase_engine_t *engine = &ctrl->engine;
+    const tlc_phase_t *phase = tlc_phase_current(engine);
+    tlc_audio_cue_t cues[TLC_PLAN_MAX_APPROACHES];
+    uint8_t walking = tlc_phase_walking(engine);
+    for (uint8_t d = 0; d < engine->plan->approaches; d++)
+    {
+        cues[d] = tlc_controller_cue(engine, phase, walking, d);
+    }
+    tlc_audio_play(ctrl->tlc, cues, engine->plan->approaches, engine->started);
+}
+
+/**
+ * @brief Trace the planned length of the current phase
+ *
+ * @param ctrl controller
+ * @param id TLC_TRACE_PHASE or TLC_TRACE_DEADLINE
+ * @note The length is deadline - started in us, 0 if the phase waits for a
+ *       call, so a reader can tell how late each phase really ended
+ */
+static void tlc_controller_trace(tlc_controller_t *ctrl, uint16_t id)
+{
+    const tlc_phase_engine_t *engine = &ctrl->engine;
+    int64_t planned = engine->deadline == TLC_PHASE_NEVER ? 0 : engine->deadline - engine->started;
+    tlc_trace(id, (uint16_t)(engine->index | ctrl->id << 8), planned > UINT32_MAX ? UINT32_MAX : (uint32_t)planned);
+    ctrl->traced = engine->deadline;
+}
+
+/**
+ * @brief Show the current phase and arm the timer for its deadline
+ *
+ * @param ctrl controller
+ * @param changed phase changed since the last call
+ */
+static void tlc_controller_show(tlc_controller_t *ctrl, bool changed)
+{
+    tlc_phase_engine_t *engine = &ctrl->engine;
+    if (changed)
+    {
+        tlc_controller_output(ctrl, tlc_controller_phase_output(ctrl), engine->started);
+        tlc_monitor_latency(TLC_MONITOR_PHASE, esp_timer_get_time() - engine->started);
+        /* Report the phase through telemetry, the log stays off UART0 */
+        uint8_t flags = (engine->halted ? TLC_TELEMETRY_PHASE_HALTED : 0) |
+                        (engine->served_accessible ? TLC_TELEMETRY_PHASE_ACCESSIBLE : 0) |
+                        (engine->demand ? TLC_TELEMETRY_PHASE_CALL : 0) |
+                        (engine->preempt_active ? TLC_TELEMETRY_PHASE_PREEMPT : 0);
+        tlc_telemetry_phase(engine->started, ctrl->id, engine->index, flags);
+        tlc_controller_trace(ctrl, TLC_TRACE_PHASE);
+        tlc_controller_sound(ctrl);
+    }
+    else if (engine->deadline != ctrl->traced)
+    {
+        tlc_controller_trace(ctrl, TLC_TRACE_DEADLINE);
+    }
+    esp_timer_stop(ctrl->phase_timer);
+    if (engine->deadline != TLC_PHASE_NEVER)
+    {
+        int64_t wait = engine->deadline - esp_timer_get_time();
+        esp_timer_start_once(ctrl->phase_timer, wait > 0 ? wait : 1);
+    }
+    tlc_controller_publish(ctrl);
+}
+
+/**
+ * @brief Compile the outputs of every phase of the plan being run
+ *
+ * @param ctrl controller
+ */
+static void tlc_controller_compile(tlc_controller_t *ctrl)
+{
+    const tlc_plan_t *plan = ctrl->engine.plan;
+    for (uint8_t i = 0; i < plan->count; i++)
+    {
+        const tlc_phase_t *phase = &plan->phases[i];
+        tlc_bsp_output_compile(&ctrl->outputs[i], ctrl->tlc, plan->approaches, phase->light, phase->walk_mask,
+                               phase->walk);
+    }
+}
+
+/**
+ * @brief Take over a plan the engine switched to at a phase boundary
+ *
+ * @param ctrl controller
+ * @param now current time
+ */
+static void tlc_controller_replanned(tlc_controller_t *ctrl, int64_t now)
+{
+    tlc_scheduler_t *scheduler = ctrl->scheduler;
+    /* The blink patterns read the outputs being recompiled */
+    tlc_pattern_cancel(&ctrl->yellow);
+    tlc_pattern_cancel(&ctrl->walk);
+    tlc_controller_compile(ctrl);
+    ctrl->shown = NULL;
+    if (scheduler->replan_pending && --scheduler->replan_pending == 0)
+    {
+        scheduler->replan_us = now - scheduler->replan_at;
+    }
+}
+
+/**
+ * @brief Advance the timing plan and show the result
+ *
+ * @param ctrl controller
+ * @param now current time
+ * @param changed phase already changed by the caller
+ */
+static void tlc_controller_update(tlc_controller_t *ctrl, int64_t now, bool changed)
+{
+    const tlc_plan_t *plan = ctrl->engine.plan;
+    int64_t deadline = ctrl->engine.deadline;
+    if (!changed && deadline != ctrl->traced)
+    {
+        /* Moved by the caller, the phase may end on it right now */
+        tlc_controller_trace(ctrl, TLC_TRACE_DEADLINE);
+    }
+    if (tlc_phase_step(&ctrl->engine, now))
+    {
+        changed = true;
+        tlc_monitor_latency(TLC_MONITOR_DEADLINE, now - deadline);
+    }
+    if (ctrl->engine.plan != plan)
+    {
+        tlc_controller_replanned(ctrl, now);
+    }
+    tlc_controller_show(ctrl, changed);
+}
+
+/**
+ * @brief Halt or resume an intersection now
+ *
+ * @param ctrl controller
+ * @param now current time
+ * @param halt true to hold the halt phase, false to restart the plan
+ * @note What holding both directions' buttons does; a staged plan takes
+ *       over here
+ */
+void tlc_controller_halt(tlc_controller_t *ctrl, int64_t now, bool halt)
+{
+    const tlc_plan_t *plan = ctrl->engine.plan;
+    tlc_phase_halt(&ctrl->engine, now, halt);
+    if (ctrl->engine.plan != plan)
+    {
+        tlc_controller_replanned(ctrl, now);
+    }
+    tlc_controller_show(ctrl, true);
+}
+
+/**
+ * @brief Follow the preemption input now
+ *
+ * @param ctrl controller
+ * @param now current time
+ * @param active input asserted
+ * @param approach approach to give the green, TLC_PHASE_ALL_RED for none
+ * @note The clearance is on the pins when this returns
+ */
+void tlc_controller_preempt(tlc_controller_t *ctrl, int64_t now, bool active, uint8_t approach)
+{
+    uint32_t transitions = ctrl->engine.transitions;
+    if (tlc_phase_preempt(&ctrl->engine, now, active, approach))
+    {
+        /* A release past the shortest dwell ends it now */
+        tlc_controller_update(ctrl, now, ctrl->engine.transitions != transitions);
+    }
+    else
+    {
+        /* Release before the dwell, the flags still change */
+        tlc_controller_publish(ctrl);
+    }
+}
+
+/**
+ * @brief Preemption input ISR
+ *
+ * @param arg scheduler
+ */
+static void IRAM_ATTR tlc_scheduler_preempt_isr(void *arg)
+{
+    tlc_scheduler_t *scheduler = arg;
+    BaseType_t woken = pdFALSE;
+    uint8_t level = (uint8_t)gpio_get_level(scheduler->preempt_pin);
+    tlc_event_t event = {
+        .type = TLC_EVENT_PREEMPT,
+        .level = level,
+        .timestamp = esp_timer_get_time(),
+    };
+    tlc_record_edge((uint8_t)scheduler->preempt_pin, level);
+    tlc_trace(TLC_TRACE_PREEMPT, (uint16_t)scheduler->preempt_pin, level);
+    if (xQueueSendToFrontFromISR(scheduler->queue, &event, &woken) != pdPASS)
+    {
+        /* The scheduler reads the pin once it has room again */
+        scheduler->preempt_missed = true;
+    }
+    portYIELD_FROM_ISR(woken);
+}
+
+/**
+ * @brief Give a preemption edge to every intersection
+ *
+ * @param scheduler scheduler
+ * @param event TLC_EVENT_PREEMPT
+ */
+static void tlc_scheduler_preempt(tlc_scheduler_t *scheduler, const tlc_event_t *event)
+{
+    for (uint8_t i = 0; i < scheduler->count; i++)
+    {
+        tlc_controller_t *ctrl = &scheduler->controllers[i];
+        uint32_t transitions = ctrl->engine.transitions;
+        tlc_controller_preempt(ctrl, esp_timer_get_time(), event->level, scheduler->preempt_approach);
+        if (ctrl->engine.transitions != transitions)
+        {
+            tlc_monitor_latency(TLC_MONITOR_PREEMPT, esp_timer_get_time() - event->timestamp);
+        }
+    }
+}
+
+/**
+ * @brief Count the latency of a button event acted on
+ *
+ * @param ctrl controller
+ * @param button event
+ */
+static void tlc_controller_reaction(tlc_controller_t *ctrl, const tlc_button_event_t *button)
+{
+    int64_t latency = tlc_button_reaction(button);
+    ctrl->counters.reactions++;
+    ctrl->counters.latency_sum_us += latency;
+    if (latency > ctrl->counters.latency_max_us)
+    {
+        ctrl->counters.latency_max_us = (uint32_t)latency;
+    }
+}
+
+/**
+ * @brief Forward classified button events to the timing plan
+ *
+ * @param ctrl controller
+ * @param event TLC_EVENT_BUTTON_EDGE or TLC_EVENT_BUTTON_TIMER
+ */
+static void tlc_controller_button(tlc_controller_t *ctrl, const tlc_event_t *event)
+{
+    tlc_button_event_t button;
+    bool acted = false;
+    uint32_t transitions = ctrl->engine.transitions;
+    uint8_t walking = tlc_phase_walking(&ctrl->engine);
+    bool accessible = ctrl->engine.served_accessible;
+    tlc_button_handle(&ctrl->buttons, event);
+    ctrl->counters.button_wakeups += event->type == TLC_EVENT_BUTTON_TIMER;
+    while (tlc_button_next(&ctrl->buttons, &button))
+    {
+        ctrl->counters.button_events++;
+        int64_t now = esp_timer_get_time();
+        tlc_telemetry_button(button.timestamp, ctrl->id, button.type, button.pin, button.duration);
+        tlc_trace(TLC_TRACE_BUTTON, button.type, button.pin);
+        switch (button.type)
+        {
+        case TLC_BUTTON_PRESS:
+            /* The plan decides when the call is served, both ends of a crosswalk share its call */
+            tlc_phase_call(&ctrl->engine, now, (uint8_t)(1U << button.direction), false);
+            tlc_controller_reaction(ctrl, &button);
+            acted = true;
+            break;
+        case TLC_BUTTON_HOLD:
+            /* Press and hold asks for accessible timing */
+            tlc_phase_call(&ctrl->engine, now, (uint8_t)(1U << button.direction), true);
+            tlc_controller_reaction(ctrl, &button);
+            acted = true;
+            break;
+        case TLC_BUTTON_HALT:
+            /* Halt the intersection if running, restart it if halted */
+            tlc_controller_halt(ctrl, now, !ctrl->engine.halted);
+            break;
+        default:
+            break;
+        }
+    }
+    if (acted && ctrl->engine.transitions == transitions)
+    {
+        /* A crosswalk joined the walk shown or asked for accessible timing */
+        if (tlc_phase_walking(&ctrl->engine) != walking)
+        {
+            tlc_controller_output(ctrl, tlc_controller_phase_output(ctrl), ctrl->engine.started);
+        }
+        if (tlc_phase_walking(&ctrl->engine) != walking || ctrl->engine.served_accessible != accessible)
+        {
+            tlc_controller_sound(ctrl);
+        }
+    }
+    if (acted)
+    {
+        tlc_controller_update(ctrl, esp_timer_get_time(), false);
+    }
+    else
+    {
+        /* Only the counters moved */
+        tlc_controller_publish(ctrl);
+    }
+}
+
+/**
+ * @brief Find the earliest button deadline of every intersection
+ *
+ * @param scheduler scheduler
+ * @note O(intersections), only run after button events
+ */
+static void tlc_scheduler_button_deadline(tlc_scheduler_t *scheduler)
+{
+    scheduler->button_deadline = -1;
+    for (uint8_t i = 0; i < scheduler->count; i++)
+    {
+        int64_t t = tlc_button_deadline(&scheduler->controllers[i].buttons);
+        if (t >= 0 && (scheduler->button_deadline < 0 || t < scheduler->button_deadline))
+        {
+            scheduler->button_deadline = t;
+        }
+    }
+}
+
+/**
+ * @brief Initialize a scheduler
+ *
+ * @param scheduler scheduler
+ * @param controllers storage for the intersections
+ * @param count intersections, each set up with tlc_controller_init(), the u8
+ *              bounds it to TLC_CONTROLLER_MAX
+ * @return ESP_OK, ESP_ERR_INVALID_ARG or ESP_ERR_NO_MEM
+ * @note Set tick_ms and handler afterwards to receive TLC_EVENT_ADC
+ */
+esp_err_t tlc_scheduler_init(tlc_scheduler_t *scheduler, tlc_controller_t *controllers, uint8_t count)
+{
+    if (count == 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *scheduler = (tlc_scheduler_t){
+        .controllers = controllers,
+        .count = count,
+        .button_deadline = -1,
+        .replan_us = -1,
+        .preempt_pin = GPIO_NUM_NC,
+        .preempt_approach = TLC_PHASE_ALL_RED,
+    };
+    /* Intersections running the same plan reach their deadlines together */
+    scheduler->queue =
+        xQueueCreate(TLC_EVENT_QUEUE_LEN + TLC_EVENT_QUEUE_PER_INSTANCE * (count - 1), sizeof(tlc_event_t));
+    return scheduler->queue != NULL ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+/**
+ * @brief Initialize one intersection
+ *
+ * @param scheduler scheduler serving it
+ * @param id instance, below the scheduler's count
+ * @param tlc approaches, already set up with tlc_bsp_init(); pins may be
+ *            GPIO_NUM_NC
+ * @param approaches number of tlc structures
+ * @param plan timing plan, started now
+ * @return ESP_OK, ESP_ERR_INVALID_ARG for a plan that does not fit or the
+ *         esp_timer error
+ * @note The first phase shows once the scheduler task runs
+ */
+esp_err_t tlc_controller_init(tlc_scheduler_t *scheduler, uint8_t id, tlc_t *tlc, uint8_t approaches,
+                              const tlc_plan_t *plan)
+{
+    if (id >= scheduler->count || plan->approaches > approaches)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    tlc_controller_t *ctrl = &scheduler->controllers[id];
+    *ctrl = (tlc_controller_t){
+        .id = id,
+        .tlc = tlc,
+        .scheduler = scheduler,
+    };
+    esp_err_t err = tlc_phase_init(&ctrl->engine, plan, esp_timer_get_time());
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+    /* Precompile the output masks of every phase */
+    tlc_controller_compile(ctrl);
+    esp_timer_create_args_t phase_timer_args = {
+        .callback = tlc_controller_phase_callback,
+        .arg = ctrl,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "Phase Timer",
+        .skip_unhandled_events = false,
+    };
+    err = esp_timer_create(&phase_timer_args, &ctrl->phase_timer);
+    /* Edge interrupts on the pedestrian buttons */
+    tlc_button_init(&ctrl->buttons, id, tlc, plan->approaches, scheduler->queue);
+    return err;
+}
+
+/**
+ * @brief Run one event to completion
+ *
+ * @param scheduler scheduler
+ * @param event event to handle
+ */
+void tlc_scheduler_dispatch(tlc_scheduler_t *scheduler, const tlc_event_t *event)
+{
+    scheduler->events++;
+    if (event->type != TLC_EVENT_ADC)
+    {
+        tlc_trace(TLC_TRACE_EVENT, event->type, event->instance);
+    }
+    switch (event->type)
+    {
+    case TLC_EVENT_PHASE_TIMER:
+        tlc_monitor_latency(TLC_MONITOR_TIMER, esp_timer_get_time() - event->timestamp);
+        if (event->instance < scheduler->count)
+        {
+            tlc_controller_update(&scheduler->controllers[event->instance], esp_timer_get_time(), false);
+        }
+        break;
+    case TLC_EVENT_PREEMPT:
+        tlc_scheduler_preempt(scheduler, event);
+        break;
+    case TLC_EVENT_BUTTON_EDGE:
+    case TLC_EVENT_BUTTON_TIMER:
+        if (event->type == TLC_EVENT_BUTTON_EDGE)
+        {
+            tlc_monitor_latency(TLC_MONITOR_EDGE, esp_timer_get_time() - event->timestamp);
+        }
+        if (event->instance < scheduler->count)
+        {
+            tlc_controller_button(&scheduler->controllers[event->instance], event);
+            tlc_scheduler_button_deadline(scheduler);
+        }
+        break;
+    default:
+        if (scheduler->handler != NULL)
+        {
+            scheduler->handler(scheduler, event);
+        }
+        break;
+    }
+}
+
+/**
+ * @brief Give a new traffic density to every intersection
+ *
+ * @param scheduler scheduler
+ * @param now time of the reading
+ * @param cars density
+ * @note Actuated phases extend or gap out on the new density
+ */
+void tlc_scheduler_density(tlc_scheduler_t *scheduler, int64_t now, uint16_t cars)
+{
+    for (uint8_t i = 0; i < scheduler->count; i++)
+    {
+        tlc_controller_t *ctrl = &scheduler->controllers[i];
+        if (tlc_phase_density(&ctrl->engine, now, cars))
+        {
+            tlc_controller_update(ctrl, now, false);
+        }
+    }
+}
+
+/**
+ * @brief Reference every intersection to a shared time base
+ *
+ * @param scheduler scheduler
+ * @param now local time the reading arrived
+ * @param master_us time base reading
+ * @note Coordinated plans keep their cycle points on master time; others
+ *       ignore it. Until the first reading the time base is local boot.
+ */
+void tlc_scheduler_clock(tlc_scheduler_t *scheduler, int64_t now, int64_t master_us)
+{
+    int64_t sync_us = now - master_us;
+    tlc_trace(TLC_TRACE_CLOCK, 0, (uint32_t)(int32_t)((sync_us - scheduler->sync_us) / 1000));
+    scheduler->sync_us = sync_us;
+    for (uint8_t i = 0; i < scheduler->count; i++)
+    {
+        tlc_controller_t *ctrl = &scheduler->controllers[i];
+        if (tlc_phase_coordinate(&ctrl->engine, now, sync_us, ctrl->engine.offset_us))
+        {
+            tlc_controller_update(ctrl, now, false);
+        }
+    }
+}
+
+/**
+ * @brief Stage a plan on every intersection for its next phase boundary
+ *
+ * @param scheduler scheduler
+ * @param now current time
+ * @param plan plan to run, kept by reference until every intersection
+ *             left it again
+ * @param restart true to start the plan at its start phase, false for a
+ *                retimed copy of the running table
+ * @return ESP_OK, or ESP_ERR_INVALID_ARG if the plan is malformed or drives
+ *         other approaches than the running one; nothing is staged then
+ * @note Each intersection switches when its current phase ends, on halt
+ *       and resume, or now if it rests without a call or is halted.
+ *       replan_pending counts down to 0 as they do.
+ */
+esp_err_t tlc_scheduler_replan(tlc_scheduler_t *scheduler, int64_t now, const tlc_plan_t *plan, bool restart)
+{
+    for (uint8_t i = 0; i < scheduler->count; i++)
+    {
+        const tlc_phase_engine_t *engine = &scheduler->controllers[i].engine;
+        /* Buttons and outputs were set up for the running approaches */
+        if (plan->approaches != engine->plan->approaches ||
+            (!restart && plan->count != engine->plan->count) || tlc_phase_validate(plan) != ESP_OK)
+        {
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+    scheduler->replan_pending = scheduler->count;
+    scheduler->replan_at = now;
+    for (uint8_t i = 0; i < scheduler->count; i++)
+    {
+        tlc_controller_t *ctrl = &scheduler->controllers[i];
+        uint8_t index = ctrl->engine.index;
+        tlc_phase_replan(&ctrl->engine, now, plan, restart);
+        if (ctrl->engine.next_plan == NULL)
+        {
+            /* Switched at once, put the recompiled output back */
+            tlc_controller_replanned(ctrl, now);
+            tlc_controller_output(ctrl, tlc_controller_phase_output(ctrl), ctrl->engine.started);
+            tlc_controller_show(ctrl, restart || ctrl->engine.index != index);
+        }
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Drive every intersection from a preemption input
+ *
+ * @param scheduler scheduler
+ * @param pin input, active high; GPIO_NUM_NC for none
+ * @param approach approach to give the green, TLC_PHASE_ALL_RED stops every
+ *                 approach
+ * @note Call before the scheduler task starts, which reads the input once
+ *       in case it is already asserted
+ */
+void tlc_scheduler_preempt_init(tlc_scheduler_t *scheduler, gpio_num_t pin, uint8_t approach)
+{
+    scheduler->preempt_pin = pin;
+    scheduler->preempt_approach = approach;
+    tlc_bsp_preempt_init(pin, tlc_scheduler_preempt_isr, scheduler);
+}
+
+/**
+ * @brief Set the offset of an intersection into the common cycle
+ *
+ * @param ctrl controller, before the scheduler task starts
+ * @param offset_us offset, usually the travel time from the first intersection
+ */
+void tlc_controller_offset(tlc_controller_t *ctrl, int64_t offset_us)
+{
+    tlc_phase_coordinate(&ctrl->engine, esp_timer_get_time(), ctrl->scheduler->sync_us, offset_us);
+}
+
+/**
+ * @brief Raise the deadlines the scheduler keeps itself
+ *
+ * @param scheduler scheduler
+ * @param now current time
+ */
+static void tlc_scheduler_expire(tlc_scheduler_t *scheduler, int64_t now)
+{
+    if (scheduler->preempt_missed)
+    {
+        scheduler->preempt_missed = false;
+        tlc_event_t event = {
+            .type = TLC_EVENT_PREEMPT,
+            .level = tlc_bsp_preempt_read(scheduler->preempt_pin),
+            .timestamp = now,
+        };
+        tlc_scheduler_dispatch(scheduler, &event);
+    }
+    if (scheduler->button_deadline >= 0 && now >= scheduler->button_deadline)
+    {
+        for (uint8_t i = 0; i < scheduler->count; i++)
+        {
+            int64_t t = tlc_button_deadline(&scheduler->controllers[i].buttons);
+            if (t >= 0 && now >= t)
+            {
+                tlc_event_t event = {.type = TLC_EVENT_BUTTON_TIMER, .instance = i, .timestamp = now};
+                tlc_scheduler_dispatch(scheduler, &event);
+            }
+        }
+        tlc_scheduler_button_deadline(scheduler);
+    }
+    uint32_t dropped = __atomic_load_n(&scheduler->dropped, __ATOMIC_RELAXED);
+    if (scheduler->recovered != dropped)
+    {
+        /* A phase timer event was lost to a full queue */
+        scheduler->recovered = dropped;
+        for (uint8_t i = 0; i < scheduler->count; i++)
+        {
+            tlc_controller_t *ctrl = &scheduler->controllers[i];
+            if (ctrl->engine.deadline != TLC_PHASE_NEVER && now >= ctrl->engine.deadline)
+            {
+                ctrl->counters.timers_lost++;
+                tlc_controller_update(ctrl, now, false);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Scheduler task runs every event of every intersection
+ *
+ * @param pvParameters tlc_scheduler_t to run
+ * @note Sleeps on the queue until an ISR or timer posts an event, the next
+ *       TLC_EVENT_ADC is due or a button deadline passes.
+ */
+void tlc_scheduler_task(void *pvParameters)
+{
+    tlc_scheduler_t *scheduler = pvParameters;
+    tlc_event_t event;
+    TickType_t tick = pdMS_TO_TICKS(scheduler->tick_ms);
+    TickType_t tick_wake = xTaskGetTickCount() + tick;
+    for (uint8_t i = 0; i < scheduler->count; i++)
+    {
+        tlc_controller_show(&scheduler->controllers[i], true);
+    }
+    if (tlc_bsp_preempt_read(scheduler->preempt_pin))
+    {
+        /* Asserted before the ISR was attached */
+        event = (tlc_event_t){.type = TLC_EVENT_PREEMPT, .level = 1, .timestamp = esp_timer_get_time()};
+        tlc_scheduler_dispatch(scheduler, &event);
+    }
+    while (1)
+    {
+        TickType_t ticks = portMAX_DELAY;
+        if (tick != 0)
+        {
+            ticks = tick_wake - xTaskGetTickCount();
+            ticks = (int32_t)ticks < 0 ? 0 : ticks;
+        }
+        int64_t deadline = scheduler->button_deadline;
+        if (deadline >= 0)
+        {
+            int64_t wait = deadline - esp_timer_get_time();
+            TickType_t button_ticks =
+                wait <= 0 ? 0 : (TickType_t)((wait + TLC_CONTROLLER_TICK_US - 1) / TLC_CONTROLLER_TICK_US);
+            ticks = button_ticks < ticks ? button_ticks : ticks;
+        }
+        if (xQueueReceive(scheduler->queue, &event, ticks) == pdPASS)
+        {
+            tlc_scheduler_dispatch(scheduler, &event);
+        }
+        int64_t now = esp_timer_get_time();
+        tlc_scheduler_expire(scheduler, now);
+        if (tick != 0 && (int32_t)(xTaskGetTickCount() - tick_wake) >= 0)
+        {
+            tick_wake += tick;
+            event = (tlc_event_t){.type = TLC_EVENT_ADC, .timestamp = now};
+            tlc_scheduler_dispatch(scheduler, &event);
+        }
+    }
+}
@@ -0,0 +1,112 @@
+/**
+ * @file tlc_controller.h
+ * @brief Intersection controllers and their scheduler
+ * @author Jorge Minjares (https://github.com/JorgeMinjares)
+ * @brief A tlc_controller_t is one intersection: its approaches, timing
+ *        plan, outputs, blink patterns, buttons and timers. Any number of
+ *        them share one tlc_scheduler_t, which runs every event of every
+ *        intersection to completion from a single queue in a single task.
+ *        Each event names its intersection, so handling one costs the same
+ *        no matter how many intersections the board drives.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef TLC_CONTROLLER_H
+#define TLC_CONTROLLER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "traffic_light.h"
+#include "tlc_event.h"
+#include "tlc_phase.h"
+#include "tlc_button.h"
+#include "tlc_state.h"
+#include "bsp/tlc_bsp.h"
+#include "bsp/tlc_pattern.h"
+#include "esp_err.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+
+#define TLC_CONTROLLER_MAX 255 /*!< Intersections one scheduler serves, events carry a u8 instance */
+
+struct tlc_scheduler;
+
+/******************************************************************
+ * \struct tlc_controller_t tlc_controller.h
+ * \brief One intersection
+ *
+ * ### Example
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~.c
+ * static tlc_controller_t controllers[2];
+ * static tlc_scheduler_t scheduler;
+ * tlc_scheduler_init(&scheduler, controllers, 2);
+ * tlc_controller_init(&scheduler, 0, tlc_main_street, 2, &tlc_plan_pedestrian);
+ * tlc_controller_init(&scheduler, 1, tlc_side_street, 2, &tlc_plan_actuated);
+ * xTaskCreate(&tlc_scheduler_task, "controller_task", 3072, &scheduler, 15, NULL);
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *******************************************************************/
+typedef struct
+{
+    uint8_t id;                                     /*!< Instance, index in the scheduler */
+    tlc_t *tlc;                                     /*!< Approaches, plan->approaches of them */
+    struct tlc_scheduler *scheduler;                /*!< Scheduler serving the intersection */
+    tlc_phase_engine_t engine;                      /*!< Timing plan being run */
+    tlc_bsp_output_t outputs[TLC_PLAN_MAX_PHASES];  /*!< Precompiled output of every phase */
+    tlc_bsp_output_t partial;                       /*!< Output of a phase serving only some crosswalks */
+    const tlc_bsp_output_t *shown;                  /*!< Output on the pins */
+    tlc_pattern_t yellow;                           /*!< Yellow blink of the shown output */
+    tlc_pattern_t walk;                             /*!< Walk warning blink of the shown output */
+    tlc_button_t buttons;                           /*!< Pedestrian buttons */
+    esp_timer_handle_t phase_timer;                 /*!< One shot timer to the phase deadline */
+    int64_t traced;                                 /*!< Deadline last given to the trace */
+    tlc_state_counters_t counters;                  /*!< Counters of the scheduler task, published with the state */
+    tlc_state_cell_t state;                         /*!< engine and counters as last published, see tlc_state_read() */
+} tlc_controller_t;
+
+/**
+ * @brief Handler of the events that belong to no intersection
+ */
+typedef void (*tlc_scheduler_handler_t)(struct tlc_scheduler *scheduler, const tlc_event_t *event);
+
+/******************************************************************
+ * \struct tlc_scheduler_t tlc_controller.h
+ * \brief Event loop shared by every intersection
+ *******************************************************************/
+typedef struct tlc_scheduler
+{
+    tlc_controller_t *controllers;    /*!< Intersections */
+    uint8_t count;                    /*!< Intersections in use */
+    QueueHandle_t queue;              /*!< Events of every intersection */
+    uint32_t tick_ms;                 /*!< Period of TLC_EVENT_ADC, 0 for none */
+    tlc_scheduler_handler_t handler;  /*!< Receives TLC_EVENT_ADC, TLC_EVENT_UART and TLC_EVENT_DENSITY */
+    int64_t button_deadline;          /*!< Earliest button deadline of any intersection, -1 for none */
+    uint32_t events;                  /*!< Events handled */
+    uint32_t dropped;                 /*!< Timer events lost to a full queue, written by the timer callbacks */
+    uint32_t recovered;               /*!< Value of dropped when the phases were last checked */
+    int64_t sync_us;                  /*!< Local time at which the shared time base read zero */
+    uint8_t replan_pending;           /*!< Intersections still running the plan before the last replan */
+    int64_t replan_at;                /*!< Time of the last replan */
+    int64_t replan_us;                /*!< Last replan to the last intersection switching, -1 before any */
+    gpio_num_t preempt_pin;           /*!< Preemption input, GPIO_NUM_NC for none */
+    uint8_t preempt_approach;         /*!< Approach the preemption gives the green, TLC_PHASE_ALL_RED for none */
+    volatile bool preempt_missed;     /*!< A preemption edge found the queue full */
+} tlc_scheduler_t;
+
+esp_err_t tlc_scheduler_init(tlc_scheduler_t *scheduler, tlc_controller_t *controllers, uint8_t count);
+esp_err_t tlc_controller_init(tlc_scheduler_t *scheduler, uint8_t id, tlc_t *tlc, uint8_t approaches,
+                              const tlc_plan_t *plan);
+void tlc_scheduler_dispatch(tlc_scheduler_t *scheduler, const tlc_event_t *event);
+void tlc_scheduler_density(tlc_scheduler_t *scheduler, int64_t now, uint16_t cars);
+void tlc_scheduler_clock(tlc_scheduler_t *scheduler, int64_t now, int64_t master_us);
+void tlc_controller_offset(tlc_controller_t *ctrl, int64_t offset_us);
+void tlc_controller_halt(tlc_controller_t *ctrl, int64_t now, bool halt);
+void tlc_controller_preempt(tlc_controller_t *ctrl, int64_t now, bool active, uint8_t approach);
+void tlc_scheduler_preempt_init(tlc_scheduler_t *scheduler, gpio_num_t pin, uint8_t approach);
+esp_err_t tlc_scheduler_replan(tlc_scheduler_t *scheduler, int64_t now, const tlc_plan_t *plan, bool restart);
+void tlc_scheduler_task(void *pvParameters);
+
+#endif
@@ -0,0 +1,186 @@
+/**
+ * @file tlc_density.c
+ * @brief Traffic density filter source code
+ * @author Jorge Minjares (https://github.com/JorgeMinjares)
+ * @brief Integer only. The per-sample work is one add and one range check;
+ *        everything else runs once per block or once per published value.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include "tlc_density.h"
+
+#define LUT_FRAC_BITS (TLC_DENSITY_LUT_SHIFT + 4) /*!< Fraction bits of a Q4 raw value inside a segment */
+#define CARS_FULL_Q8 ((uint32_t)MAX_CARS << 8)     /*!< Saturated density in Q8 */
+
+static uint16_t median3(uint16_t a, uint16_t b, uint16_t c)
+{
+    if (a > b)
+    {
+        uint16_t t = a;
+        a = b;
+        b = t;
+    }
+    return c <= a ? a : c >= b ? b : c;
+}
+
+/* Close a block: mean, median of three, moving average, maybe publish */
+static bool tlc_density_block(tlc_density_t *filter)
+{
+    uint16_t mean_q4;
+    if (filter->primed && filter->kept >= filter->seen / 2)
+    {
+        mean_q4 = (uint16_t)((filter->sum << 4) / filter->kept);
+        filter->stats.rejected += filter->seen - filter->kept;
+    }
+    else
+    {
+        /* First block, or the input really moved: take every sample */
+        mean_q4 = (uint16_t)((filter->sum_all << 4) / filter->seen);
+        if (filter->primed)
+        {
+            filter->stats.steps++;
+        }
+        filter->prev[0] = mean_q4;
+        filter->prev[1] = mean_q4;
+    }
+    uint16_t median = median3(filter->prev[0], filter->prev[1], mean_q4);
+    filter->prev[0] = filter->prev[1];
+    filter->prev[1] = mean_q4;
+
+    /* Gate the next block around this one */
+    uint16_t centre = median >> 4;
+    filter->gate_lo = centre > TLC_DENSITY_GATE ? centre - TLC_DENSITY_GATE : 0;
+    filter->gate_span = centre + TLC_DENSITY_GATE - filter->gate_lo;
+    filter->primed = true;
+    filter->sum = 0;
+    filter->sum_all = 0;
+    filter->kept = 0;
+    filter->seen = 0;
+
+    /* Moving average in O(1) */
+    if (filter->filled == TLC_DENSITY_WINDOW)
+    {
+        filter->window_sum -= filter->window[filter->head];
+    }
+    else
+    {
+        filter->filled++;
+    }
+    filter->window[filter->head] = median;
+    filter->window_sum += median;
+    filter->head = (filter->head + 1) % TLC_DENSITY_WINDOW;
+
+    if (++filter->stats.blocks % TLC_DENSITY_WINDOW != 0)
+    {
+        return false;
+    }
+    filter->raw_q4 = (uint16_t)((filter->window_sum + filter->filled / 2) / filter->filled);
+    filter->cars_q8 = tlc_density_lookup(filter, filter->raw_q4);
+    filter->stats.published++;
+    return true;
+}
+
+/**
+ * @brief Initialize the filter and build the lookup table
+ *
+ * @param filter filter state
+ * @param raw_to_mv calibrated raw to millivolt conversion, NULL for the
+ *        uncalibrated linear MIN_ADC_VAL..MAX_ADC_VAL to MIN_CARS..MAX_CARS map
+ * @note MIN_DENSITY_MV reads as no cars and MAX_DENSITY_MV as MAX_CARS
+ */
+void tlc_density_init(tlc_density_t *filter, uint32_t (*raw_to_mv)(uint32_t raw))
+{
+    *filter = (tlc_density_t){.block_samples = TLC_DENSITY_BLOCK_SAMPLES};
+    for (uint32_t i = 0; i < TLC_DENSITY_LUT_SIZE; i++)
+    {
+        uint32_t raw = i << TLC_DENSITY_LUT_SHIFT;
+        int32_t q8;
+        if (raw_to_mv == NULL)
+        {
+            q8 = (int32_t)(raw * CARS_FULL_Q8 / (MAX_ADC_VAL - MIN_ADC_VAL));
+        }
+        else
+        {
+            int32_t mv = (int32_t)raw_to_mv(raw > 4095 ? 4095 : raw);
+            q8 = (mv - MIN_DENSITY_MV) * (int32_t)CARS_FULL_Q8 / (MAX_DENSITY_MV - MIN_DENSITY_MV);
+        }
+        filter->lut[i] = (uint16_t)(q8 < 0 ? 0 : q8 > (int32_t)CARS_FULL_Q8 ? (int32_t)CARS_FULL_Q8 : q8);
+    }
+}
+
+/**
+ * @brief Convert a raw reading to cars
+ *
+ * @param filter filter holding the lookup table
+ * @param raw_q4 raw counts in Q4
+ * @return cars in Q8, interpolated between lookup entries
+ */
+uint16_t tlc_density_lookup(const tlc_density_t *filter, uint16_t raw_q4)
+{
+    uint32_t i = raw_q4 >> LUT_FRAC_BITS;
+    int32_t frac = raw_q4 & ((1 << LUT_FRAC_BITS) - 1);
+    int32_t step = (int32_t)filter->lut[i + 1] - filter->lut[i];
+    return (uint16_t)(filter->lut[i] + ((step * frac) >> LUT_FRAC_BITS));
+}
+
+/**
+ * @brief Feed raw samples
+ *
+ * @param filter filter state
+ * @param samples 12-bit conversions, oldest first
+ * @param count number of samples
+ * @return true if a new value was published, read it with tlc_density_cars()
+ * @note Blocks are counted in samples, so how the stream is chunked does not
+ *       change the result
+ */
+bool tlc_density_feed(tlc_density_t *filter, const uint16_t *samples, size_t count)
+{
+    bool published = false;
+    filter->stats.samples += count;
+    while (count > 0)
+    {
+        size_t n = filter->block_samples - filter->seen;
+        n = n < count ? n : count;
+        uint32_t sum = 0;
+        uint32_t sum_all = 0;
+        uint32_t kept = 0;
+        uint16_t lo = filter->gate_lo;
+        uint16_t span = filter->gate_span;
+        for (size_t i = 0; i < n; i++)
+        {
+            uint16_t s = samples[i];
+            sum_all += s;
+            /* One unsigned compare checks both sides of the gate */
+            if ((uint16_t)(s - lo) <= span)
+            {
+                sum += s;
+                kept++;
+            }
+        }
+        filter->sum += sum;
+        filter->sum_all += sum_all;
+        filter->kept += kept;
+        filter->seen += n;
+        samples += n;
+        count -= n;
+        if (filter->seen == filter->block_samples)
+        {
+            published |= tlc_density_block(filter);
+        }
+    }
+    return published;
+}
+
+/**
+ * @brief Last published density
+ *
+ * @param filter filter state
+ * @return cars, rounded
+ */
+uint16_t tlc_density_cars(const tlc_density_t *filter)
+{
+    return (filter->cars_q8 + 128) >> 8;
+}
@@ -0,0 +1,86 @@
+/**
+ * @file tlc_density.h
+ * @brief Traffic density filter
+ * @author Jorge Minjares (https://github.com/JorgeMinjares)
+ * @brief Turns the continuous ADC stream into one density value per second:
+ *        outlier gate per sample, mean per block, median of three blocks,
+ *        moving average over the window, then a calibrated fixed-point
+ *        lookup from raw counts to cars.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef TLC_DENSITY_H
+#define TLC_DENSITY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "tlc_config.h"
+
+#define TLC_DENSITY_BLOCK_MS 100 /*!< Samples averaged into one block */
+#define TLC_DENSITY_BLOCK_SAMPLES (DENSITY_SAMPLE_HZ * TLC_DENSITY_BLOCK_MS / 1000) /*!< Samples per block */
+#define TLC_DENSITY_WINDOW 10    /*!< Blocks in the moving average, also blocks per published value */
+#define TLC_DENSITY_BURST_MS 1000  /*!< Low power: one burst of conversions per published value */
+#define TLC_DENSITY_BURST_BLOCK 64 /*!< Low power: samples per block */
+#define TLC_DENSITY_BURST_SAMPLES (TLC_DENSITY_WINDOW * TLC_DENSITY_BURST_BLOCK) /*!< Low power: samples per burst, 32 ms at 20 kHz */
+#define TLC_DENSITY_GATE 256     /*!< LSB a sample may stray from the last block before it is dropped */
+#define TLC_DENSITY_LUT_SHIFT 7  /*!< Raw counts per lookup segment, as a power of two */
+#define TLC_DENSITY_LUT_SIZE ((4096 >> TLC_DENSITY_LUT_SHIFT) + 1) /*!< Lookup entries */
+
+/**
+ * @brief Filter counters
+ */
+typedef struct
+{
+    uint32_t samples;   /*!< Samples fed */
+    uint32_t rejected;  /*!< Samples dropped by the gate */
+    uint32_t blocks;    /*!< Blocks completed */
+    uint32_t steps;     /*!< Blocks where most samples failed the gate and the gate moved */
+    uint32_t published; /*!< Values published */
+} tlc_density_stats_t;
+
+/******************************************************************
+ * \struct tlc_density_t tlc_density.h
+ * \brief Filter state
+ *
+ * ### Example
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~.c
+ * tlc_density_t filter;
+ * tlc_density_init(&filter, tlc_bsp_adc_mv);
+ * filter.block_samples = TLC_DENSITY_BURST_BLOCK; // optional, for bursts
+ * if (tlc_density_feed(&filter, samples, count))
+ * {
+ *      uint16_t cars = tlc_density_cars(&filter);
+ * }
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *******************************************************************/
+typedef struct
+{
+    uint16_t lut[TLC_DENSITY_LUT_SIZE];   /*!< Cars in Q8 at raw i << TLC_DENSITY_LUT_SHIFT */
+    uint16_t block_samples;               /*!< Samples per block, TLC_DENSITY_BLOCK_SAMPLES unless set after init */
+    uint32_t sum;                         /*!< Gated sum of the current block */
+    uint32_t sum_all;                     /*!< Sum of every sample of the current block */
+    uint16_t kept;                        /*!< Samples that passed the gate */
+    uint16_t seen;                        /*!< Samples in the current block */
+    uint16_t gate_lo;                     /*!< Lowest raw value passing the gate */
+    uint16_t gate_span;                   /*!< Raw values passing the gate above gate_lo */
+    bool primed;                          /*!< A block has completed and the gate is set */
+    uint16_t prev[2];                     /*!< Last two block means, raw Q4 */
+    uint16_t window[TLC_DENSITY_WINDOW];  /*!< Median filtered block means, raw Q4 */
+    uint32_t window_sum;                  /*!< Sum of window */
+    uint8_t head;                         /*!< Oldest window entry */
+    uint8_t filled;                       /*!< Window entries in use */
+    uint16_t raw_q4;                      /*!< Published value, raw counts Q4 */
+    uint16_t cars_q8;                     /*!< Published value, cars Q8 */
+    tlc_density_stats_t stats;            /*!< Counters */
+} tlc_density_t;
+
+void tlc_density_init(tlc_density_t *filter, uint32_t (*raw_to_mv)(uint32_t raw));
+uint16_t tlc_density_lookup(const tlc_density_t *filter, uint16_t raw_q4);
+bool tlc_density_feed(tlc_density_t *filter, const uint16_t *samples, size_t count);
+uint16_t tlc_density_cars(const tlc_density_t *filter);
+
+#endif
@@ -0,0 +1,77 @@
+/**
+ * @file tlc_event.h
+ * @brief Controller events
+ * @author Jorge Minjares (https://github.com/JorgeMinjares)
+ * @brief Everything the controller reacts to arrives as one of these. ISRs
+ *        and timer callbacks post them to the controller queue; deadlines
+ *        the controller keeps itself are raised when its queue wait times out.
+ *        Density values and UART bytes come from the other core through a
+ *        tlc_spsc_t ring of them, drained on every scheduler tick.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef TLC_EVENT_H
+#define TLC_EVENT_H
+
+#include <stdint.h>
+
+#define TLC_EVENT_QUEUE_LEN 32         /*!< Controller queue depth for one intersection */
+#define TLC_EVENT_QUEUE_PER_INSTANCE 2 /*!< Extra depth per further intersection: a phase timer and a button edge */
+
+/******************************************************************
+ * \enum tlc_event_type_t tlc_event.h
+ * \brief Controller event types
+ *
+ * ### Example
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~.c
+ * typedef enum{
+ *      TLC_EVENT_PHASE_TIMER = 1,
+ *      TLC_EVENT_BUTTON_EDGE = 2,
+ *      TLC_EVENT_BUTTON_TIMER = 3,
+ *      TLC_EVENT_ADC = 4,
+ *      TLC_EVENT_UART = 5,
+ *      TLC_EVENT_DENSITY = 6,
+ *      TLC_EVENT_PREEMPT = 7,
+ * }tlc_event_type_t;
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *******************************************************************/
+typedef enum
+{
+    TLC_EVENT_PHASE_TIMER = 1,  /*!< Phase deadline timer expired: instance */
+    TLC_EVENT_BUTTON_EDGE = 2,  /*!< Button ISR: instance, button, level */
+    TLC_EVENT_BUTTON_TIMER = 3, /*!< Button debounce or hold deadline reached: instance */
+    TLC_EVENT_ADC = 4,          /*!< Scheduler tick, once per ADC block period */
+    TLC_EVENT_UART = 5,         /*!< Command byte received: command */
+    TLC_EVENT_DENSITY = 6,      /*!< Traffic density published: cars */
+    TLC_EVENT_PREEMPT = 7,      /*!< Preemption ISR, queued ahead of everything else: level */
+} tlc_event_type_t;
+
+/******************************************************************
+ * \struct tlc_event_t tlc_event.h
+ * \brief Controller event, 16 bytes
+ *
+ * ### Example
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~.c
+ * tlc_event_t event = {
+ *      .type = TLC_EVENT_PHASE_TIMER,
+ *      .instance = ctrl->id,
+ *      .timestamp = esp_timer_get_time(),
+ * };
+ * xQueueSendToBack(controller_queue, &event, 0);
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *******************************************************************/
+typedef struct
+{
+    uint8_t type;       /*!< tlc_event_type_t */
+    uint8_t instance;   /*!< PHASE_TIMER, BUTTON_x: intersection the event belongs to */
+    uint8_t button;     /*!< BUTTON_EDGE: button of the intersection, 0 - 3 */
+    uint8_t level;      /*!< BUTTON_EDGE, PREEMPT: level read in the ISR */
+    uint8_t command;    /*!< UART: command byte */
+    uint16_t cars;      /*!< DENSITY: traffic density (cars) */
+    int64_t timestamp;  /*!< esp_timer time the event happened (us) */
+} tlc_event_t;
+
+#endif
@@ -0,0 +1,364 @@
+/**
+ * @file tlc_history.c
+ * @brief Traffic density history source code
+ * @author Jorge Minjares (https://github.com/JorgeMinjares)
+ * @brief Adding a value costs one store in the raw ring and one add per
+ *        rollup; a bucket is encoded only when it closes. Values are
+ *        numbered rather than timed, so bucket edges follow the filter's
+ *        one value per second and no bucket is ever short or skipped. Scans
+ *        decode from the start of a block and hold only a byte position,
+ *        so values added between two reads never stop them; buckets evicted
+ *        meanwhile are skipped.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <string.h>
+#include "tlc_history.h"
+#include "tlc_telemetry.h"
+
+#define SECOND_US 1000000 /*!< Time between two values */
+
+/* Eviction never reaches the open block while a ring holds two full ones */
+#if TLC_HISTORY_MINUTE_BYTES < 2 * 60 * TLC_HISTORY_BUCKET_MAX || TLC_HISTORY_HOUR_BYTES < 2 * 24 * TLC_HISTORY_BUCKET_MAX
+#error "A history ring must hold two blocks of the largest buckets"
+#endif
+#if TLC_HISTORY_MINUTE_BLOCKS < 2 || TLC_HISTORY_HOUR_BLOCKS < 2
+#error "A history rollup must index two blocks"
+#endif
+
+static const tlc_history_rollup_t *tlc_history_rollup(const tlc_history_t *history, tlc_history_level_t level)
+{
+    return &history->rollup[level - TLC_HISTORY_MINUTE];
+}
+
+/* Encode a bucket after the one whose mean is prev */
+static size_t tlc_history_pack(uint8_t *out, uint16_t prev, uint16_t min, uint16_t mean, uint16_t max)
+{
+    int32_t delta = (int32_t)mean - prev;
+    size_t n = tlc_telemetry_varint(out, ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31));
+    n += tlc_telemetry_varint(&out[n], (uint32_t)(mean - min));
+    n += tlc_telemetry_varint(&out[n], (uint32_t)(max - mean));
+    return n;
+}
+
+static uint32_t tlc_history_varint(const tlc_history_rollup_t *r, uint32_t *at)
+{
+    uint32_t value = 0;
+    uint8_t byte;
+    uint8_t shift = 0;
+    do
+    {
+        byte = r->bytes[(*at)++ % r->size];
+        value |= (uint32_t)(byte & 0x7f) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    return value;
+}
+
+/* Decode the bucket at cursor->at */
+static void tlc_history_unpack(const tlc_history_rollup_t *r, tlc_history_cursor_t *cursor,
+                               tlc_history_bucket_t *bucket)
+{
+    uint32_t zigzag = tlc_history_varint(r, &cursor->at);
+    bucket->mean = (uint16_t)(cursor->prev + (int32_t)((zigzag >> 1) ^ (0U - (zigzag & 1))));
+    bucket->min = (uint16_t)(bucket->mean - tlc_history_varint(r, &cursor->at));
+    bucket->max = (uint16_t)(bucket->mean + tlc_history_varint(r, &cursor->at));
+    cursor->prev = bucket->mean;
+}
+
+/* Close the open bucket of a rollup */
+static void tlc_history_close(tlc_history_rollup_t *r)
+{
+    uint32_t block = r->count / r->per_block;
+    if (r->count % r->per_block == 0)
+    {
+        if (block - r->first >= r->blocks)
+        {
+            r->first++;
+        }
+        r->block_at[block % r->blocks] = r->head;
+        r->prev = 0;
+    }
+    /* Q8 to Q4 rounds the same way at every level, so min <= mean <= max holds */
+    uint16_t mean = (uint16_t)((r->sum + r->seen * 8U) / (r->seen * 16U));
+    uint8_t data[TLC_HISTORY_BUCKET_MAX];
+    size_t n = tlc_history_pack(data, r->prev, (r->min + 8) >> 4, mean, (r->max + 8) >> 4);
+    /* Make room by dropping whole blocks, never the open one */
+    while (r->head + n - r->block_at[r->first % r->blocks] > r->size)
+    {
+        r->first++;
+    }
+    for (size_t i = 0; i < n; i++)
+    {
+        r->bytes[r->head++ % r->size] = data[i];
+    }
+    r->prev = mean;
+    r->count++;
+    r->sum = 0;
+    r->seen = 0;
+}
+
+/* Position a cursor on cursor->next */
+static void tlc_history_seek(const tlc_history_t *history, tlc_history_cursor_t *cursor)
+{
+    if (cursor->level == TLC_HISTORY_SECOND)
+    {
+        return;
+    }
+    const tlc_history_rollup_t *r = tlc_history_rollup(history, cursor->level);
+    uint32_t block = cursor->next / r->per_block;
+    cursor->at = r->block_at[block % r->blocks];
+    cursor->prev = 0;
+    tlc_history_bucket_t skipped;
+    for (uint32_t i = block * r->per_block; i < cursor->next; i++)
+    {
+        tlc_history_unpack(r, cursor, &skipped);
+    }
+}
+
+/**
+ * @brief Clear the store
+ *
+ * @param history store
+ */
+void tlc_history_init(tlc_history_t *history)
+{
+    memset(history, 0, sizeof(*history));
+    history->rollup[0] = (tlc_history_rollup_t){
+        .bytes = history->minute_bytes,
+        .size = TLC_HISTORY_MINUTE_BYTES,
+        .block_at = history->minute_at,
+        .blocks = TLC_HISTORY_MINUTE_BLOCKS,
+        .per_block = 60,
+        .span = 60,
+    };
+    history->rollup[1] = (tlc_history_rollup_t){
+        .bytes = history->hour_bytes,
+        .size = TLC_HISTORY_HOUR_BYTES,
+        .block_at = history->hour_at,
+        .blocks = TLC_HISTORY_HOUR_BLOCKS,
+        .per_block = 24,
+        .span = 3600,
+    };
+}
+
+/**
+ * @brief Add a published density value
+ *
+ * @param history store
+ * @param now time the value was published
+ * @param cars_q8 cars in Q8
+ * @note Call once per published value. Value n is taken to be n seconds
+ *       after the first one, the filter's own clock.
+ */
+void tlc_history_add(tlc_history_t *history, int64_t now, uint16_t cars_q8)
+{
+    if (history->count == 0)
+    {
+        history->origin_us = now;
+    }
+    history->seconds[history->count % TLC_HISTORY_SECONDS] = (uint16_t)((cars_q8 + 8) >> 4);
+    history->count++;
+    for (uint8_t i = 0; i < TLC_HISTORY_LEVELS - 1; i++)
+    {
+        tlc_history_rollup_t *r = &history->rollup[i];
+        if (r->seen == 0 || cars_q8 < r->min)
+        {
+            r->min = cars_q8;
+        }
+        if (r->seen == 0 || cars_q8 > r->max)
+        {
+            r->max = cars_q8;
+        }
+        r->sum += cars_q8;
+        if (++r->seen == r->span)
+        {
+            tlc_history_close(r);
+        }
+    }
+}
+
+/**
+ * @brief Seconds per bucket
+ *
+ * @param level resolution
+ * @return 1, 60 or 3600
+ */
+uint32_t tlc_history_span(tlc_history_level_t level)
+{
+    static const uint32_t spans[TLC_HISTORY_LEVELS] = {1, 60, 3600};
+    return spans[level];
+}
+
+/**
+ * @brief Oldest bucket kept
+ *
+ * @param history store
+ * @param level resolution
+ * @return bucket number, counted from the first value
+ */
+uint32_t tlc_history_oldest(const tlc_history_t *history, tlc_history_level_t level)
+{
+    if (level == TLC_HISTORY_SECOND)
+    {
+        return history->count > TLC_HISTORY_SECONDS ? history->count - TLC_HISTORY_SECONDS : 0;
+    }
+    const tlc_history_rollup_t *r = tlc_history_rollup(history, level);
+    return r->first * r->per_block;
+}
+
+/**
+ * @brief Bytes taken by the buckets kept
+ *
+ * @param history store
+ * @param level resolution
+ * @return bytes in use, at most the ring size
+ */
+uint32_t tlc_history_bytes(const tlc_history_t *history, tlc_history_level_t level)
+{
+    if (level == TLC_HISTORY_SECOND)
+    {
+        return (history->count - tlc_history_oldest(history, level)) * sizeof(history->seconds[0]);
+    }
+    const tlc_history_rollup_t *r = tlc_history_rollup(history, level);
+    return r->count ? r->head - r->block_at[r->first % r->blocks] : 0;
+}
+
+/**
+ * @brief Start a scan
+ *
+ * @param history store
+ * @param cursor scan position, set even when nothing matches
+ * @param level resolution
+ * @param from_s start, seconds before the newest value
+ * @param to_s end, seconds before the newest value
+ * @return false if no closed bucket of the range is kept
+ * @note Covers every bucket holding a value of the range; the open bucket
+ *       of a rollup is left out until it closes. Cost is one block at most.
+ */
+bool tlc_history_range(const tlc_history_t *history, tlc_history_cursor_t *cursor, tlc_history_level_t level,
+                       uint32_t from_s, uint32_t to_s)
+{
+    *cursor = (tlc_history_cursor_t){.level = (uint8_t)level};
+    if (history->count == 0 || level >= TLC_HISTORY_LEVELS)
+    {
+        return false;
+    }
+    if (from_s < to_s)
+    {
+        uint32_t t = from_s;
+        from_s = to_s;
+        to_s = t;
+    }
+    uint32_t newest = history->count - 1;
+    if (to_s > newest)
+    {
+        return false;
+    }
+    uint32_t span = tlc_history_span(level);
+    uint32_t count = level == TLC_HISTORY_SECOND ? history->count : tlc_history_rollup(history, level)->count;
+    uint32_t first = (from_s > newest ? 0 : newest - from_s) / span;
+    uint32_t oldest = tlc_history_oldest(history, level);
+    uint32_t end = (newest - to_s) / span + 1;
+    cursor->next = first > oldest ? first : oldest;
+    cursor->end = end < count ? end : count;
+    if (cursor->next >= cursor->end)
+    {
+        cursor->end = cursor->next;
+        return false;
+    }
+    tlc_history_seek(history, cursor);
+    return true;
+}
+
+/**
+ * @brief Read the next bucket of a scan
+ *
+ * @param history store
+ * @param cursor scan position
+ * @param bucket bucket read
+ * @return false once the scan is done
+ */
+bool tlc_history_next(const tlc_history_t *history, tlc_history_cursor_t *cursor, tlc_history_bucket_t *bucket)
+{
+    if (cursor->next >= cursor->end)
+    {
+        return false;
+    }
+    uint32_t oldest = tlc_history_oldest(history, cursor->level);
+    if (cursor->next < oldest)
+    {
+        /* Evicted since the last read */
+        cursor->next = oldest;
+        if (cursor->next >= cursor->end)
+        {
+            return false;
+        }
+        tlc_history_seek(history, cursor);
+    }
+    bucket->index = cursor->next;
+    if (cursor->level == TLC_HISTORY_SECOND)
+    {
+        uint16_t value = history->seconds[cursor->next % TLC_HISTORY_SECONDS];
+        bucket->min = value;
+        bucket->mean = value;
+        bucket->max = value;
+    }
+    else
+    {
+        const tlc_history_rollup_t *r = tlc_history_rollup(history, cursor->level);
+        /* Blocks follow each other in the ring, only the deltas start again */
+        if (cursor->next % r->per_block == 0)
+        {
+            cursor->prev = 0;
+        }
+        tlc_history_unpack(r, cursor, bucket);
+    }
+    cursor->next++;
+    return true;
+}
+
+/**
+ * @brief Pack the next buckets of a scan into a HISTORY record payload
+ *
+ * @param history store
+ * @param cursor scan position, moved past the buckets packed
+ * @param out payload
+ * @param size payload bytes, TLC_TELEMETRY_DATA_MAX
+ * @return payload bytes, its bucket count is 0 once the scan is done
+ * @note level:u8 n:u8 time_s:varint then n buckets encoded as in the
+ *       store, the first against 0. time_s is the start of the first bucket
+ *       in seconds since boot.
+ */
+size_t tlc_history_encode(const tlc_history_t *history, tlc_history_cursor_t *cursor, uint8_t *out, size_t size)
+{
+    uint32_t span = tlc_history_span(cursor->level);
+    uint32_t origin_s = (uint32_t)(history->origin_us / SECOND_US);
+    tlc_history_cursor_t peek = *cursor;
+    tlc_history_bucket_t bucket;
+    bool any = tlc_history_next(history, &peek, &bucket);
+    out[0] = cursor->level;
+    size_t n = 2 + tlc_telemetry_varint(&out[2], origin_s + (any ? bucket.index : cursor->end) * span);
+    uint8_t count = 0;
+    uint16_t prev = 0;
+    while (any)
+    {
+        uint8_t data[TLC_HISTORY_BUCKET_MAX];
+        size_t packed = tlc_history_pack(data, prev, bucket.min, bucket.mean, bucket.max);
+        if (n + packed > size || count == UINT8_MAX)
+        {
+            break;
+        }
+        memcpy(&out[n], data, packed);
+        n += packed;
+        count++;
+        prev = bucket.mean;
+        *cursor = peek;
+        any = tlc_history_next(history, &peek, &bucket);
+    }
+    out[1] = count;
+    return n;
+}
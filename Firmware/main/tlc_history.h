@@ -0,0 +1,133 @@
+/**
+ * @file tlc_history.h
+ * @brief Traffic density history
+ * @author Jorge Minjares (https://github.com/JorgeMinjares)
+ * @brief Keeps every published density value for the last
+ *        TLC_HISTORY_SECONDS and rolls them up into minute and hour buckets
+ *        of min, mean and max. Rollups are delta encoded into fixed byte
+ *        rings, so the RAM taken never grows; once a ring is full the
+ *        oldest block of buckets makes room for the newest. Values are cars
+ *        in Q4 at every level.
+ *
+ *        bucket = mean - prev:svarint mean - min:varint max - mean:varint
+ *
+ *        prev is the mean of the bucket before in the same block, 0 for the
+ *        first. A block holds one hour of minutes or one day of hours and
+ *        decodes on its own, so a scan starts at the block of its first
+ *        bucket.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef TLC_HISTORY_H
+#define TLC_HISTORY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define TLC_HISTORY_SECONDS 900          /*!< Raw values kept, one per second */
+#define TLC_HISTORY_MINUTE_BYTES 32768   /*!< Encoded minute buckets, 7 days at up to 3.2 B per bucket */
+#define TLC_HISTORY_MINUTE_BLOCKS 180    /*!< Hours of minute buckets indexed, over 7 days */
+#define TLC_HISTORY_HOUR_BYTES 3072      /*!< Encoded hour buckets, 28 days at up to 4.5 B per bucket */
+#define TLC_HISTORY_HOUR_BLOCKS 30       /*!< Days of hour buckets indexed, over 28 days */
+#define TLC_HISTORY_BUCKET_MAX 9         /*!< Encoded bytes of one bucket at most */
+#define TLC_HISTORY_RECORDS 4            /*!< HISTORY records sent per ADC block while a scan runs */
+
+/**
+ * @brief Resolution of a scan
+ */
+typedef enum
+{
+    TLC_HISTORY_SECOND = 0, /*!< Raw values */
+    TLC_HISTORY_MINUTE = 1, /*!< Minute buckets */
+    TLC_HISTORY_HOUR = 2,   /*!< Hour buckets */
+    TLC_HISTORY_LEVELS,     /*!< Resolutions */
+} tlc_history_level_t;
+
+/**
+ * @brief Bucket returned by a scan, cars in Q4
+ */
+typedef struct
+{
+    uint32_t index;  /*!< Bucket number at its level, counted from the first value */
+    uint16_t min;    /*!< Lowest value */
+    uint16_t mean;   /*!< Mean value */
+    uint16_t max;    /*!< Highest value */
+} tlc_history_bucket_t;
+
+/**
+ * @brief Encoded rollup of one resolution
+ */
+typedef struct
+{
+    uint8_t *bytes;      /*!< Byte ring of encoded buckets */
+    uint32_t size;       /*!< Bytes in the ring */
+    uint32_t *block_at;  /*!< Byte where each indexed block starts, by block number modulo blocks */
+    uint16_t blocks;     /*!< Blocks indexed */
+    uint16_t per_block;  /*!< Buckets per block */
+    uint16_t span;       /*!< Seconds per bucket */
+    uint32_t head;       /*!< Bytes written */
+    uint32_t first;      /*!< Oldest block kept */
+    uint32_t count;      /*!< Buckets closed */
+    uint16_t prev;       /*!< Mean of the last bucket of the open block */
+    uint32_t sum;        /*!< Sum of the open bucket, cars Q8 */
+    uint16_t min;        /*!< Lowest value of the open bucket, cars Q8 */
+    uint16_t max;        /*!< Highest value of the open bucket, cars Q8 */
+    uint16_t seen;       /*!< Values in the open bucket */
+} tlc_history_rollup_t;
+
+/******************************************************************
+ * \struct tlc_history_t tlc_history.h
+ * \brief History store, owned and used by one task
+ *
+ * ### Example
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~.c
+ * static tlc_history_t history;
+ * tlc_history_init(&history);
+ * tlc_history_add(&history, now, filter.cars_q8);
+ * tlc_history_cursor_t scan;
+ * tlc_history_bucket_t bucket;
+ * tlc_history_range(&history, &scan, TLC_HISTORY_MINUTE, 3600, 0);
+ * while (tlc_history_next(&history, &scan, &bucket))
+ * {
+ * }
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *******************************************************************/
+typedef struct
+{
+    uint16_t seconds[TLC_HISTORY_SECONDS];               /*!< Raw values, cars Q4, by value number modulo the size */
+    uint32_t count;                                      /*!< Values added */
+    int64_t origin_us;                                   /*!< Time of the first value */
+    tlc_history_rollup_t rollup[TLC_HISTORY_LEVELS - 1]; /*!< Minute and hour buckets */
+    uint8_t minute_bytes[TLC_HISTORY_MINUTE_BYTES];      /*!< Byte ring of the minute rollup */
+    uint32_t minute_at[TLC_HISTORY_MINUTE_BLOCKS];       /*!< Block index of the minute rollup */
+    uint8_t hour_bytes[TLC_HISTORY_HOUR_BYTES];          /*!< Byte ring of the hour rollup */
+    uint32_t hour_at[TLC_HISTORY_HOUR_BLOCKS];           /*!< Block index of the hour rollup */
+} tlc_history_t;
+
+/**
+ * @brief Position of a scan, survives values added between two reads
+ */
+typedef struct
+{
+    uint8_t level;  /*!< tlc_history_level_t */
+    uint32_t next;  /*!< Bucket read next */
+    uint32_t end;   /*!< Bucket after the last one */
+    uint32_t at;    /*!< Byte of the next bucket, rollups only */
+    uint16_t prev;  /*!< Mean of the bucket before next in its block */
+} tlc_history_cursor_t;
+
+void tlc_history_init(tlc_history_t *history);
+void tlc_history_add(tlc_history_t *history, int64_t now, uint16_t cars_q8);
+uint32_t tlc_history_span(tlc_history_level_t level);
+uint32_t tlc_history_oldest(const tlc_history_t *history, tlc_history_level_t level);
+uint32_t tlc_history_bytes(const tlc_history_t *history, tlc_history_level_t level);
+bool tlc_history_range(const tlc_history_t *history, tlc_history_cursor_t *cursor, tlc_history_level_t level,
+                       uint32_t from_s, uint32_t to_s);
+bool tlc_history_next(const tlc_history_t *history, tlc_history_cursor_t *cursor, tlc_history_bucket_t *bucket);
+size_t tlc_history_encode(const tlc_history_t *history, tlc_history_cursor_t *cursor, uint8_t *out, size_t size);
+
+#endif
@@ -0,0 +1,164 @@
+/**
+ * @file tlc_monitor.c
+ * @brief Task and control path instrumentation source code
+ * @author Jorge Minjares (https://github.com/JorgeMinjares)
+ * @brief Latencies are recorded by the scheduler task only, so the
+ *        histograms need no lock. CPU shares come from the FreeRTOS run time
+ *        counters and cover the time since the previous snapshot;
+ *        sdkconfig.defaults enables the counters, without them every share
+ *        reads 0.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <string.h>
+#include "tlc_monitor.h"
+#include "tlc_telemetry.h"
+#include "esp_timer.h"
+
+#define TLC_MONITOR_CHUNK 8 /*!< Buckets per LATENCY record, five byte varints fit TLC_TELEMETRY_DATA_MAX */
+
+/**
+ * @brief Watched task
+ */
+typedef struct
+{
+    TaskHandle_t handle;  /*!< Task */
+    const char *name;     /*!< Name sent with the snapshot */
+    uint32_t stack_size;  /*!< Stack given to xTaskCreate, bytes */
+    uint32_t run_time;    /*!< Run time counter at the last snapshot */
+} tlc_monitor_task_t;
+
+static tlc_monitor_task_t tasks[TLC_MONITOR_TASKS]; /*!< Watched tasks */
+static uint8_t task_count = 0;                      /*!< Tasks in use */
+static uint32_t total_time = 0;                     /*!< Run time clock at the last snapshot */
+static tlc_monitor_histogram_t histograms[TLC_MONITOR_PATHS]; /*!< One per path */
+
+/**
+ * @brief Watch a task
+ *
+ * @param task task handle from xTaskCreate
+ * @param name name for the snapshot, kept by reference
+ * @param stack_size stack given to xTaskCreate in bytes
+ * @note Tasks past TLC_MONITOR_TASKS are ignored
+ */
+void tlc_monitor_task(TaskHandle_t task, const char *name, uint32_t stack_size)
+{
+    if (task == NULL || task_count == TLC_MONITOR_TASKS)
+    {
+        return;
+    }
+    tasks[task_count++] = (tlc_monitor_task_t){
+        .handle = task,
+        .name = name,
+        .stack_size = stack_size,
+    };
+}
+
+/**
+ * @brief Count one latency
+ *
+ * @param path path measured
+ * @param latency_us latency, negative ones count as 0
+ * @note Call from the scheduler task only
+ */
+void tlc_monitor_latency(tlc_monitor_path_t path, int64_t latency_us)
+{
+    if (path >= TLC_MONITOR_PATHS)
+    {
+        return;
+    }
+    tlc_monitor_histogram_t *h = &histograms[path];
+    uint32_t us = latency_us <= 0 ? 0 : latency_us > UINT32_MAX ? UINT32_MAX : (uint32_t)latency_us;
+    /* Bucket b holds [2^(b-1), 2^b), the bit length of the latency */
+    uint32_t bucket = us ? 32 - __builtin_clz(us) : 0;
+    h->count[bucket < TLC_MONITOR_BUCKETS ? bucket : TLC_MONITOR_BUCKETS - 1]++;
+    h->max_us = us > h->max_us ? us : h->max_us;
+}
+
+/**
+ * @brief Latencies of one path
+ *
+ * @param path path
+ * @return histogram since boot
+ */
+const tlc_monitor_histogram_t *tlc_monitor_histogram(tlc_monitor_path_t path)
+{
+    return &histograms[path < TLC_MONITOR_PATHS ? path : 0];
+}
+
+/* Start the sending early rather than drop, a snapshot is asked for */
+static void tlc_monitor_record(tlc_telemetry_type_t type, const uint8_t *data, size_t size)
+{
+    if (tlc_telemetry_pending() >= TLC_TELEMETRY_RING / 2)
+    {
+        tlc_telemetry_flush();
+    }
+    tlc_telemetry_record(type, esp_timer_get_time(), data, size);
+}
+
+/**
+ * @brief Queue a snapshot: one TASK record per watched task, then the
+ *        LATENCY records of every path
+ *
+ * @note Flushes the telemetry once half a ring is queued; the caller
+ *       flushes the rest
+ */
+void tlc_monitor_send(void)
+{
+    uint8_t data[TLC_TELEMETRY_DATA_MAX];
+#if configGENERATE_RUN_TIME_STATS
+    uint32_t total = portGET_RUN_TIME_COUNTER_VALUE();
+    uint32_t elapsed = total - total_time;
+    total_time = total;
+#endif
+    for (uint8_t i = 0; i < task_count; i++)
+    {
+        tlc_monitor_task_t *t = &tasks[i];
+        uint32_t permille = 0;
+#if configGENERATE_RUN_TIME_STATS
+        uint32_t run_time = ulTaskGetRunTimeCounter(t->handle);
+        permille = elapsed ? (uint32_t)((uint64_t)(run_time - t->run_time) * 1000 / elapsed) : 0;
+        t->run_time = run_time;
+#endif
+        size_t length = strnlen(t->name, 15);
+        data[0] = (uint8_t)length;
+        memcpy(&data[1], t->name, length);
+        size_t size = 1 + length;
+        size += tlc_telemetry_varint(&data[size], permille);
+        size += tlc_telemetry_varint(&data[size], t->stack_size);
+        size += tlc_telemetry_varint(&data[size], uxTaskGetStackHighWaterMark(t->handle));
+        tlc_monitor_record(TLC_TELEMETRY_TASK, data, size);
+    }
+    for (uint8_t path = 0; path < TLC_MONITOR_PATHS; path++)
+    {
+        const tlc_monitor_histogram_t *h = &histograms[path];
+        /* Only the buckets from the first to the last one used */
+        uint8_t first = 0;
+        uint8_t last = TLC_MONITOR_BUCKETS;
+        while (first < last && h->count[first] == 0)
+        {
+            first++;
+        }
+        while (last > first && h->count[last - 1] == 0)
+        {
+            last--;
+        }
+        do
+        {
+            uint8_t n = last - first < TLC_MONITOR_CHUNK ? last - first : TLC_MONITOR_CHUNK;
+            data[0] = path;
+            data[1] = first;
+            data[2] = n;
+            size_t size = 3 + tlc_telemetry_varint(&data[3], h->max_us);
+            for (uint8_t b = 0; b < n; b++)
+            {
+                size += tlc_telemetry_varint(&data[size], h->count[first + b]);
+            }
+            tlc_monitor_record(TLC_TELEMETRY_LATENCY, data, size);
+            first += n;
+        } while (first < last);
+    }
+}
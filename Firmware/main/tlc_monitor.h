@@ -0,0 +1,54 @@
+/**
+ * @file tlc_monitor.h
+ * @brief Task and control path instrumentation
+ * @author Jorge Minjares (https://github.com/JorgeMinjares)
+ * @brief Keeps the stack high-water mark and CPU share of the watched
+ *        tasks, and log2 histograms of the latencies on the control path.
+ *        tlc_monitor_send() queues all of it as telemetry records, which
+ *        main.c does when 'M' arrives on UART0.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef TLC_MONITOR_H
+#define TLC_MONITOR_H
+
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define TLC_MONITOR_TASKS 4    /*!< Tasks that can be watched */
+#define TLC_MONITOR_BUCKETS 24 /*!< 0 us, then [2^(b-1), 2^b) us, the last one from 4.2 s on */
+
+/**
+ * @brief Control path latencies
+ */
+typedef enum
+{
+    TLC_MONITOR_BUTTON = 0,   /*!< Button edge to the call reaching the plan, debouncing included */
+    TLC_MONITOR_TIMER = 1,    /*!< Phase timer callback to the scheduler running its event */
+    TLC_MONITOR_EDGE = 2,     /*!< Button ISR to the scheduler running its event */
+    TLC_MONITOR_PHASE = 3,    /*!< Phase start to its output on the pins */
+    TLC_MONITOR_DEADLINE = 4, /*!< Phase deadline to the scheduler stepping past it, the transition jitter */
+    TLC_MONITOR_PREEMPT = 5,  /*!< Preemption ISR to the clearance on the pins */
+    TLC_MONITOR_PATHS,        /*!< Number of paths */
+} tlc_monitor_path_t;
+
+/******************************************************************
+ * \struct tlc_monitor_histogram_t tlc_monitor.h
+ * \brief Latencies of one path
+ *******************************************************************/
+typedef struct
+{
+    uint32_t count[TLC_MONITOR_BUCKETS]; /*!< Latencies per bucket */
+    uint32_t max_us;                     /*!< Worst latency */
+} tlc_monitor_histogram_t;
+
+void tlc_monitor_task(TaskHandle_t task, const char *name, uint32_t stack_size);
+void tlc_monitor_latency(tlc_monitor_path_t path, int64_t latency_us);
+const tlc_monitor_histogram_t *tlc_monitor_histogram(tlc_monitor_path_t path);
+void tlc_monitor_send(void);
+
+#endif
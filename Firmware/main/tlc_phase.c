@@ -0,0 +1,692 @@
+/**
+ * @file tlc_phase.c
+ * @brief Table-driven phase engine source code
+ * @author Jorge Minjares (https://github.com/JorgeMinjares)
+ * @brief The engine never sleeps or touches hardware. The caller feeds it the
+ *        current time and calls, then sleeps until tlc_phase_engine_t.deadline.
+ *        A phase that ends on time starts the next one at its own deadline,
+ *        not at the moment the caller woke up, so wakeup latency never
+ *        accumulates over a cycle.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include "tlc_phase.h"
+
+#define MS_TO_US(ms) ((int64_t)(ms) * 1000) /*!< Milliseconds to microseconds */
+
+/* Earliest pending call of any crosswalk, TLC_PHASE_NEVER if none */
+static int64_t tlc_phase_first_call(const tlc_phase_engine_t *engine)
+{
+    int64_t first = TLC_PHASE_NEVER;
+    for (uint8_t d = 0; d < engine->plan->approaches; d++)
+    {
+        if ((engine->demand & (1U << d)) && engine->demand_at[d] < first)
+        {
+            first = engine->demand_at[d];
+        }
+    }
+    return first;
+}
+
+/* End of the current phase given the pending call, before coordination */
+static int64_t tlc_phase_length(const tlc_phase_engine_t *engine)
+{
+    const tlc_phase_t *phase = tlc_phase_current(engine);
+    if (tlc_phase_preempting(engine))
+    {
+        /* The dwell lasts while the input is asserted, then at least its minimum */
+        if (engine->index == TLC_PHASE_PREEMPT_DWELL && engine->preempt_active)
+        {
+            return TLC_PHASE_NEVER;
+        }
+        return engine->started + MS_TO_US(phase->min_ms);
+    }
+    if (engine->halted)
+    {
+        return TLC_PHASE_NEVER;
+    }
+    uint16_t cars = engine->density;
+    if (cars > engine->plan->density_full)
+    {
+        cars = engine->plan->density_full;
+    }
+    if (phase->flags & TLC_PHASE_REST)
+    {
+        if (!engine->demand)
+        {
+            return TLC_PHASE_NEVER;
+        }
+        /* Actuated: extend while cars are queued, gap out once they clear */
+        int64_t call_at = tlc_phase_first_call(engine);
+        int64_t end = call_at + MS_TO_US(phase->call_ms);
+        if (phase->flags & TLC_PHASE_ACTUATED)
+        {
+            end += MS_TO_US(phase->passage_ms) * cars;
+        }
+        if (end < engine->started + MS_TO_US(phase->min_ms))
+        {
+            end = engine->started + MS_TO_US(phase->min_ms);
+        }
+        if (phase->max_ms && end > call_at + MS_TO_US(phase->max_ms))
+        {
+            end = call_at + MS_TO_US(phase->max_ms);
+        }
+        return end;
+    }
+    int64_t end = engine->started + MS_TO_US(phase->min_ms);
+    if (phase->flags & TLC_PHASE_ACTUATED)
+    {
+        /* Actuated: give the time cars are not using back to pedestrians */
+        end += MS_TO_US(phase->passage_ms) * (engine->plan->density_full - cars);
+    }
+    if (phase->max_ms && end > engine->started + MS_TO_US(phase->max_ms))
+    {
+        end = engine->started + MS_TO_US(phase->max_ms);
+    }
+    if ((phase->flags & TLC_PHASE_ACCESSIBLE) && engine->served_accessible)
+    {
+        end += MS_TO_US(engine->plan->accessible_ms);
+    }
+    return end;
+}
+
+/* First cycle point at or after t; cycle points are sync_us + offset_us + k * cycle_ms */
+static int64_t tlc_phase_cycle_point(const tlc_phase_engine_t *engine, int64_t t)
+{
+    int64_t cycle = MS_TO_US(engine->plan->cycle_ms);
+    int64_t into = (t - engine->sync_us - engine->offset_us) % cycle;
+    if (into < 0)
+    {
+        into += cycle;
+    }
+    return into == 0 ? t : t + cycle - into;
+}
+
+/* End of the current phase given the pending call */
+static int64_t tlc_phase_end(const tlc_phase_engine_t *engine)
+{
+    const tlc_phase_t *phase = tlc_phase_current(engine);
+    int64_t end = tlc_phase_length(engine);
+    if ((phase->flags & TLC_PHASE_SYNC) && end != TLC_PHASE_NEVER)
+    {
+        /* Coordinated: hold until the cycle point, the other phases keep their times */
+        end = tlc_phase_cycle_point(engine, end);
+    }
+    return end;
+}
+
+/* Recompute the deadline after an input changed, never moving it into the past */
+static bool tlc_phase_retime(tlc_phase_engine_t *engine, int64_t now)
+{
+    int64_t deadline = engine->deadline;
+    engine->deadline = tlc_phase_end(engine);
+    if (engine->deadline < now)
+    {
+        engine->deadline = now;
+    }
+    return engine->deadline != deadline;
+}
+
+/* The phase entered for index, past the on-call phases nobody called */
+static uint8_t tlc_phase_skip(const tlc_phase_engine_t *engine, uint8_t index)
+{
+    const tlc_phase_t *phases = engine->plan->phases;
+    /* validate() guarantees a phase without TLC_PHASE_ON_CALL in every loop */
+    while ((phases[index].flags & TLC_PHASE_ON_CALL) && !(engine->serving ? engine->served : engine->demand))
+    {
+        index = phases[index].next;
+    }
+    return index;
+}
+
+/* Enter a phase, skipping on-call phases nobody called */
+static void tlc_phase_enter(tlc_phase_engine_t *engine, uint8_t index, int64_t start)
+{
+    index = tlc_phase_skip(engine, index);
+    uint8_t flags = engine->plan->phases[index].flags;
+    if ((flags & (TLC_PHASE_SERVE | TLC_PHASE_STAGED)) && !engine->serving)
+    {
+        /* Serve the crosswalks called so far, later calls wait for the next service */
+        engine->serving = true;
+        engine->served = engine->demand | engine->plan->recall;
+        engine->served_accessible = (engine->demand_accessible & engine->served) != 0;
+        engine->demand &= (uint8_t)~engine->served;
+        engine->demand_accessible &= (uint8_t)~engine->served;
+    }
+    else if (!(flags & (TLC_PHASE_ON_CALL | TLC_PHASE_SERVE | TLC_PHASE_STAGED)))
+    {
+        /* The on-call phases that followed the serving phase are over */
+        engine->serving = false;
+        engine->served = 0;
+        engine->served_accessible = false;
+    }
+    engine->index = index;
+    engine->started = start;
+    engine->deadline = tlc_phase_end(engine);
+    engine->transitions++;
+}
+
+/* Hand over to the staged plan at a phase boundary, returns the phase to enter */
+static uint8_t tlc_phase_switch(tlc_phase_engine_t *engine, uint8_t next)
+{
+    if (engine->next_plan == NULL)
+    {
+        return next;
+    }
+    engine->plan = engine->next_plan;
+    engine->next_plan = NULL;
+    return engine->next_restart ? engine->plan->start : next;
+}
+
+/* The cycle wraps into next: the plan's start phase or a resting phase follows, every clearance has run */
+static bool tlc_phase_wraps(const tlc_phase_engine_t *engine, uint8_t next)
+{
+    next = tlc_phase_skip(engine, next);
+    return next == engine->plan->start || (engine->plan->phases[next].flags & TLC_PHASE_REST);
+}
+
+/* Show a preemption stage, light is NULL for every approach red */
+static void tlc_phase_preempt_enter(tlc_phase_engine_t *engine, uint8_t index, const state_t *light, int64_t start)
+{
+    static const char *const names[] = {"PREEMPT CLEAR", "PREEMPT RED", "PREEMPT DWELL"};
+    static const uint32_t min_ms[] = {TLC_PHASE_PREEMPT_YELLOW_MS, TLC_PHASE_PREEMPT_RED_MS,
+                                      TLC_PHASE_PREEMPT_DWELL_MS};
+    uint8_t stage = index - TLC_PHASE_PREEMPT_CLEAR;
+    engine->preempt_phase = (tlc_phase_t){
+        .name = names[stage],
+        .walk = WALK_OFF,
+        .min_ms = min_ms[stage],
+        .next = engine->plan->start,
+    };
+    for (uint8_t d = 0; d < TLC_PLAN_MAX_APPROACHES; d++)
+    {
+        engine->preempt_phase.light[d] = light != NULL ? light[d] : RED;
+    }
+    engine->index = index;
+    engine->started = start;
+    engine->deadline = tlc_phase_end(engine);
+    engine->transitions++;
+}
+
+/* Enter the dwell: the target green and the rest red, or every approach red */
+static void tlc_phase_preempt_dwell(tlc_phase_engine_t *engine, int64_t start)
+{
+    state_t light[TLC_PLAN_MAX_APPROACHES] = {RED, RED, RED, RED};
+    if (engine->preempt_approach != TLC_PHASE_ALL_RED)
+    {
+        light[engine->preempt_approach] = GREEN;
+    }
+    tlc_phase_preempt_enter(engine, TLC_PHASE_PREEMPT_DWELL, light, start);
+}
+
+/* Clear the greens of a preemption stage, the yellows that were clearing turn red */
+static void tlc_phase_preempt_clear(tlc_phase_engine_t *engine, int64_t start)
+{
+    state_t light[TLC_PLAN_MAX_APPROACHES];
+    for (uint8_t d = 0; d < TLC_PLAN_MAX_APPROACHES; d++)
+    {
+        light[d] = engine->preempt_phase.light[d] == GREEN ? YELLOW : RED;
+    }
+    tlc_phase_preempt_enter(engine, TLC_PHASE_PREEMPT_CLEAR, light, start);
+}
+
+/* Move past the preemption stage that ended */
+static void tlc_phase_preempt_step(tlc_phase_engine_t *engine, int64_t start)
+{
+    uint8_t target = engine->preempt_approach;
+    bool kept = target != TLC_PHASE_ALL_RED && engine->preempt_phase.light[target] == GREEN;
+    if (kept && engine->index == TLC_PHASE_PREEMPT_CLEAR && engine->preempt_active)
+    {
+        /* Nothing conflicting with the green is left moving */
+        tlc_phase_preempt_dwell(engine, start);
+    }
+    else if (kept)
+    {
+        /* The green clears like any other */
+        tlc_phase_preempt_clear(engine, start);
+    }
+    else if (engine->index == TLC_PHASE_PREEMPT_CLEAR)
+    {
+        tlc_phase_preempt_enter(engine, TLC_PHASE_PREEMPT_RED, NULL, start);
+    }
+    else if (engine->index == TLC_PHASE_PREEMPT_RED && engine->preempt_active)
+    {
+        tlc_phase_preempt_dwell(engine, start);
+    }
+    else
+    {
+        /* Every approach has been red long enough, the plan starts over; calls waited out the
+           preemption, their timing starts with it */
+        for (uint8_t d = 0; d < engine->plan->approaches; d++)
+        {
+            if (engine->demand & (1U << d))
+            {
+                engine->demand_at[d] = start;
+            }
+        }
+        tlc_phase_switch(engine, 0);
+        tlc_phase_enter(engine, engine->halted ? engine->plan->halt : engine->plan->start, start);
+    }
+}
+
+/**
+ * @brief Check a timing plan
+ *
+ * @param plan plan to check
+ * @return ESP_OK, or ESP_ERR_INVALID_ARG if the table is malformed
+ * @note Catches bad next indices, approaches beyond the table, resting or
+ *       zero-length phases that could never end, loops made only of
+ *       on-call phases, a recall beyond the approaches, and a cycle length
+ *       without a TLC_PHASE_SYNC phase or the other way round.
+ */
+esp_err_t tlc_phase_validate(const tlc_plan_t *plan)
+{
+    if (plan == NULL || plan->phases == NULL || plan->count == 0 || plan->count > TLC_PLAN_MAX_PHASES ||
+        plan->approaches == 0 || plan->approaches > TLC_PLAN_MAX_APPROACHES ||
+        plan->start >= plan->count || plan->halt >= plan->count || plan->recall >> plan->approaches)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    uint8_t sync = 0;
+    for (uint8_t i = 0; i < plan->count; i++)
+    {
+        const tlc_phase_t *phase = &plan->phases[i];
+        if (phase->next >= plan->count || phase->walk_mask >> plan->approaches)
+        {
+            return ESP_ERR_INVALID_ARG;
+        }
+        if (!(phase->flags & TLC_PHASE_REST) && phase->min_ms == 0)
+        {
+            return ESP_ERR_INVALID_ARG;
+        }
+        if ((phase->flags & TLC_PHASE_REST) && phase->min_ms == 0 && phase->call_ms == 0)
+        {
+            return ESP_ERR_INVALID_ARG;
+        }
+        if ((phase->flags & TLC_PHASE_ACTUATED) && plan->density_full == 0)
+        {
+            return ESP_ERR_INVALID_ARG;
+        }
+        if ((phase->flags & TLC_PHASE_SYNC) && plan->cycle_ms == 0)
+        {
+            return ESP_ERR_INVALID_ARG;
+        }
+        sync |= phase->flags & TLC_PHASE_SYNC;
+        /* Follow next until a phase that always runs; count steps bounds the walk */
+        uint8_t j = i;
+        uint8_t steps = 0;
+        while ((plan->phases[j].flags & TLC_PHASE_ON_CALL) && steps++ < plan->count)
+        {
+            j = plan->phases[j].next;
+        }
+        if (plan->phases[j].flags & TLC_PHASE_ON_CALL)
+        {
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+    if (plan->cycle_ms && !sync)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Start a plan
+ *
+ * @param engine engine state
+ * @param plan plan to run, usually a static const table
+ * @param now current time in microseconds
+ * @return ESP_OK, or ESP_ERR_INVALID_ARG if the plan is malformed
+ */
+esp_err_t tlc_phase_init(tlc_phase_engine_t *engine, const tlc_plan_t *plan, int64_t now)
+{
+    esp_err_t err = tlc_phase_validate(plan);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+    *engine = (tlc_phase_engine_t){
+        .plan = plan,
+    };
+    tlc_phase_enter(engine, plan->start, now);
+    engine->transitions = 0;
+    return ESP_OK;
+}
+
+/**
+ * @brief Current phase
+ *
+ * @param engine engine state
+ * @return row of the plan being shown
+ */
+const tlc_phase_t *tlc_phase_current(const tlc_phase_engine_t *engine)
+{
+    return tlc_phase_preempting(engine) ? &engine->preempt_phase : &engine->plan->phases[engine->index];
+}
+
+/**
+ * @brief Aspect an approach shows
+ *
+ * @param engine engine state
+ * @param approach approach, below the plan's approaches
+ * @return the current phase's aspect; approaches left out of a staged call
+ *         keep the start phase's aspect
+ */
+state_t tlc_phase_aspect(const tlc_phase_engine_t *engine, uint8_t approach)
+{
+    const tlc_plan_t *plan = engine->plan;
+    const tlc_phase_t *phase = tlc_phase_current(engine);
+    uint8_t all = (uint8_t)((1U << plan->approaches) - 1);
+    bool staged = (phase->flags & TLC_PHASE_STAGED) && (engine->served & all) != all;
+    return !staged || (engine->served & (1U << approach)) ? phase->light[approach]
+                                                          : plan->phases[plan->start].light[approach];
+}
+
+/**
+ * @brief Register a pedestrian call
+ *
+ * @param engine engine state
+ * @param now current time in microseconds
+ * @param crosswalks crosswalks asked for, one bit per approach
+ * @param accessible call asks for accessible timing (press & hold)
+ * @return true if the deadline of the current phase changed
+ * @note A call for crosswalks being served before their walk ends is
+ *       already served; an accessible call still lengthens it once. A
+ *       crosswalk called while a walk that stops every approach is shown
+ *       joins it if at least the phase's min_ms is left, so a joined
+ *       crosswalk never gets a short walk. Any other call is latched until
+ *       the next serving phase, which serves only the crosswalks called by
+ *       then. A repeat call keeps the time of the first one.
+ */
+bool tlc_phase_call(tlc_phase_engine_t *engine, int64_t now, uint8_t crosswalks, bool accessible)
+{
+    const tlc_phase_t *phase = tlc_phase_current(engine);
+    crosswalks &= (uint8_t)((1U << engine->plan->approaches) - 1);
+    if (engine->halted || crosswalks == 0)
+    {
+        return false;
+    }
+    bool repeat = (engine->served & crosswalks) == crosswalks;
+    /* Every approach already stops for an unstaged walk, more crosswalks can join it
+       while a full walk interval is left */
+    bool join = phase->walk == WALK_ON && (phase->flags & (TLC_PHASE_SERVE | TLC_PHASE_STAGED)) == TLC_PHASE_SERVE &&
+                engine->deadline - now >= MS_TO_US(phase->min_ms);
+    if (engine->serving && phase->walk != WALK_WARNING && (repeat || join))
+    {
+        engine->served |= crosswalks;
+        engine->folded += repeat;
+        if (accessible && !engine->served_accessible)
+        {
+            engine->served_accessible = true;
+            return tlc_phase_retime(engine, now);
+        }
+        return false;
+    }
+    uint8_t fresh = crosswalks & (uint8_t)~engine->demand;
+    if (fresh == 0)
+    {
+        engine->folded++;
+    }
+    for (uint8_t d = 0; d < engine->plan->approaches; d++)
+    {
+        if (fresh & (1U << d))
+        {
+            engine->demand_at[d] = now;
+        }
+    }
+    engine->demand |= crosswalks;
+    engine->demand_accessible |= accessible ? crosswalks : 0;
+    return tlc_phase_retime(engine, now);
+}
+
+/**
+ * @brief Crosswalks the current phase shows a walk signal on
+ *
+ * @param engine engine state
+ * @return one bit per approach: the phase's walk_mask, limited to the
+ *         crosswalks being served and the plan's recall
+ */
+uint8_t tlc_phase_walking(const tlc_phase_engine_t *engine)
+{
+    const tlc_phase_t *phase = tlc_phase_current(engine);
+    if (phase->walk == WALK_OFF)
+    {
+        return 0;
+    }
+    return phase->walk_mask & (engine->served | engine->plan->recall);
+}
+
+/**
+ * @brief Update the traffic density
+ *
+ * @param engine engine state
+ * @param now current time in microseconds
+ * @param cars cars queued or approaching
+ * @return true if the deadline of the current phase changed
+ * @note Only TLC_PHASE_ACTUATED phases use the density. A deadline that the
+ *       new density would put in the past ends the phase now.
+ */
+bool tlc_phase_density(tlc_phase_engine_t *engine, int64_t now, uint16_t cars)
+{
+    engine->density = cars;
+    if (engine->halted || !(tlc_phase_current(engine)->flags & TLC_PHASE_ACTUATED))
+    {
+        return false;
+    }
+    return tlc_phase_retime(engine, now);
+}
+
+/**
+ * @brief Reference the cycle to a shared time base
+ *
+ * @param engine engine state
+ * @param now current time in microseconds
+ * @param sync_us local time at which the shared time base read zero
+ * @param offset_us offset of this intersection into the common cycle
+ * @return true if the deadline of the current phase changed
+ * @note Only plans with a cycle_ms use it. TLC_PHASE_SYNC phases end on
+ *       sync_us + offset_us + k * cycle_ms, so every controller fed the
+ *       same time base keeps its offset to the others. A new reference
+ *       takes effect at the next TLC_PHASE_SYNC deadline, within one cycle.
+ */
+bool tlc_phase_coordinate(tlc_phase_engine_t *engine, int64_t now, int64_t sync_us, int64_t offset_us)
+{
+    engine->sync_us = sync_us;
+    engine->offset_us = offset_us;
+    if (engine->halted || !(tlc_phase_current(engine)->flags & TLC_PHASE_SYNC))
+    {
+        return false;
+    }
+    return tlc_phase_retime(engine, now);
+}
+
+/**
+ * @brief Halt or resume the plan
+ *
+ * @param engine engine state
+ * @param now current time in microseconds
+ * @param halt true to hold the halt phase, false to restart from the start phase
+ * @note Pending calls are dropped either way. A preemption in progress
+ *       keeps the lights and ends on the phase chosen here.
+ */
+void tlc_phase_halt(tlc_phase_engine_t *engine, int64_t now, bool halt)
+{
+    engine->halted = halt;
+    engine->demand = 0;
+    engine->demand_accessible = 0;
+    engine->serving = false;
+    engine->served = 0;
+    engine->served_accessible = false;
+    if (tlc_phase_preempting(engine))
+    {
+        /* The preemption keeps the lights, it ends on the halt phase instead */
+        return;
+    }
+    tlc_phase_switch(engine, 0);
+    tlc_phase_enter(engine, halt ? engine->plan->halt : engine->plan->start, now);
+}
+
+/**
+ * @brief Stage a plan for the next phase boundary
+ *
+ * @param engine engine state
+ * @param now current time in microseconds
+ * @param plan plan to run from the next phase on, kept by reference
+ * @param restart true to enter the plan's start phase, false to enter the
+ *                phase the current one leads to, for a retimed copy of the
+ *                running table
+ * @return ESP_OK, or ESP_ERR_INVALID_ARG if the plan is malformed or has
+ *         fewer phases than the sequence needs
+ * @note The current phase keeps the times it started with. The plan takes
+ *       over when the phase ends or on halt and resume, whichever comes
+ *       first; on restart only a phase ending into the start phase or a
+ *       resting phase hands over, so the old plan's clearances run out. A
+ *       phase resting without a call and the halt phase time
+ *       nothing, so they switch at once: next_plan is NULL on return. A
+ *       preemption holds the staged plan until it ends. Staging again
+ *       before the switch replaces the staged plan.
+ */
+esp_err_t tlc_phase_replan(tlc_phase_engine_t *engine, int64_t now, const tlc_plan_t *plan, bool restart)
+{
+    esp_err_t err = tlc_phase_validate(plan);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+    if (!restart && plan->count != engine->plan->count)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    engine->next_plan = plan;
+    engine->next_restart = restart;
+    if (engine->deadline == TLC_PHASE_NEVER && !tlc_phase_preempting(engine))
+    {
+        uint8_t index = tlc_phase_switch(engine, engine->index);
+        if (restart)
+        {
+            tlc_phase_enter(engine, engine->halted ? engine->plan->halt : index, now);
+        }
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Follow the preemption input
+ *
+ * @param engine engine state
+ * @param now current time in microseconds
+ * @param active input asserted
+ * @param approach approach to give the green, TLC_PHASE_ALL_RED or any
+ *                 approach the plan does not drive to stop every approach
+ * @return true if the phase or its deadline changed
+ * @note On assertion approaches showing green or yellow get
+ *       TLC_PHASE_PREEMPT_YELLOW_MS of yellow, except a target already
+ *       green on its own, then every approach shows red for
+ *       TLC_PHASE_PREEMPT_RED_MS before the target's green. Walk signals go
+ *       off at once; crosswalks whose walk was cut are called again. The
+ *       dwell holds while the input is asserted and at least
+ *       TLC_PHASE_PREEMPT_DWELL_MS; the target then clears the same way and
+ *       the plan restarts from its start phase. Asserting again before that
+ *       goes back to the dwell through the clearance still owed.
+ */
+bool tlc_phase_preempt(tlc_phase_engine_t *engine, int64_t now, bool active, uint8_t approach)
+{
+    const tlc_plan_t *plan = engine->plan;
+    engine->preempt_active = active;
+    if (tlc_phase_preempting(engine))
+    {
+        /* Only the dwell waits on the input */
+        return engine->index == TLC_PHASE_PREEMPT_DWELL && tlc_phase_retime(engine, now);
+    }
+    if (!active)
+    {
+        return false;
+    }
+    engine->preempt_approach = approach < plan->approaches ? approach : TLC_PHASE_ALL_RED;
+    uint8_t target = engine->preempt_approach;
+    state_t light[TLC_PLAN_MAX_APPROACHES] = {RED, RED, RED, RED};
+    bool clear = false;
+    bool red = true;
+    for (uint8_t d = 0; d < plan->approaches; d++)
+    {
+        state_t aspect = tlc_phase_aspect(engine, d);
+        light[d] = aspect == RED ? RED : d == target && aspect == GREEN ? GREEN : YELLOW;
+        clear |= light[d] == YELLOW;
+        red &= aspect == RED;
+    }
+    /* Walks cut short are served again once the plan resumes */
+    uint8_t cut = tlc_phase_walking(engine) & (uint8_t)~engine->demand & (uint8_t)~plan->recall;
+    for (uint8_t d = 0; d < plan->approaches; d++)
+    {
+        if (cut & (1U << d))
+        {
+            engine->demand_at[d] = now;
+        }
+    }
+    engine->demand |= cut;
+    engine->serving = false;
+    engine->served = 0;
+    engine->served_accessible = false;
+    if (clear)
+    {
+        tlc_phase_preempt_enter(engine, TLC_PHASE_PREEMPT_CLEAR, light, now);
+    }
+    else if (!red || target == TLC_PHASE_ALL_RED || now - engine->started >= MS_TO_US(TLC_PHASE_PREEMPT_RED_MS))
+    {
+        /* The target is green on its own, or every approach has been red long enough */
+        tlc_phase_preempt_dwell(engine, now);
+    }
+    else
+    {
+        tlc_phase_preempt_enter(engine, TLC_PHASE_PREEMPT_RED, NULL, now);
+    }
+    return true;
+}
+
+/**
+ * @brief Preemption in progress
+ *
+ * @param engine engine state
+ * @return true while a tlc_phase_preempt_t stage is shown
+ */
+bool tlc_phase_preempting(const tlc_phase_engine_t *engine)
+{
+    return engine->index >= TLC_PHASE_PREEMPT_CLEAR;
+}
+
+/**
+ * @brief Advance past an expired deadline
+ *
+ * @param engine engine state
+ * @param now current time in microseconds
+ * @return true if the phase changed
+ * @note Moves at most one phase so every phase is shown. The next phase
+ *       starts at the old deadline unless the caller is more than
+ *       TLC_PHASE_SLIP_US late, in which case it starts now and keeps its
+ *       full length.
+ */
+bool tlc_phase_step(tlc_phase_engine_t *engine, int64_t now)
+{
+    if (engine->deadline == TLC_PHASE_NEVER || now < engine->deadline)
+    {
+        return false;
+    }
+    int64_t start = now - engine->deadline > TLC_PHASE_SLIP_US ? now : engine->deadline;
+    if (tlc_phase_preempting(engine))
+    {
+        tlc_phase_preempt_step(engine, start);
+        return true;
+    }
+    uint8_t next = tlc_phase_current(engine)->next;
+    /* A restart would cut a yellow or a walk clearance short anywhere else */
+    if (!engine->next_restart || tlc_phase_wraps(engine, next))
+    {
+        next = tlc_phase_switch(engine, next);
+    }
+    tlc_phase_enter(engine, next, start);
+    return true;
+}
@@ -0,0 +1,150 @@
+/**
+ * @file tlc_phase.h
+ * @brief Table-driven phase engine
+ * @author Jorge Minjares (https://github.com/JorgeMinjares)
+ * @brief A timing plan is a constant table of phases. The engine walks the
+ *        table against absolute deadlines; every transition is O(1) and
+ *        nothing is allocated.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef TLC_PHASE_H
+#define TLC_PHASE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "traffic_light.h"
+#include "esp_err.h"
+
+#define TLC_PLAN_MAX_APPROACHES 4   /*!< Approaches one plan can drive */
+#define TLC_PLAN_MAX_PHASES 16      /*!< Phases in one plan */
+#define TLC_PHASE_NEVER INT64_MAX   /*!< Deadline of a phase resting until called */
+#define TLC_PHASE_SLIP_US 100000    /*!< Late by more than this and the next phase starts now */
+
+/* Preemption, see tlc_phase_preempt() */
+#define TLC_PHASE_PREEMPT_YELLOW_MS 5000  /*!< Yellow of an approach cut short, the longest plan yellow */
+#define TLC_PHASE_PREEMPT_RED_MS 2000     /*!< All red before a green that was not already shown */
+#define TLC_PHASE_PREEMPT_DWELL_MS 10000  /*!< Shortest dwell, held while the input stays active */
+#define TLC_PHASE_ALL_RED 0xFF            /*!< Preemption target that stops every approach */
+
+/* Phase flags */
+#define TLC_PHASE_REST 0x01       /*!< Hold the phase until a call arrives */
+#define TLC_PHASE_ON_CALL 0x02    /*!< Skip the phase unless a call is pending or being served */
+#define TLC_PHASE_SERVE 0x04      /*!< Entering the phase serves the pending call */
+#define TLC_PHASE_ACCESSIBLE 0x08 /*!< Lengthen by accessible_ms for a press & hold call */
+#define TLC_PHASE_ACTUATED 0x10   /*!< Time follows traffic density, see passage_ms */
+#define TLC_PHASE_SYNC 0x20       /*!< Coordinated: ends on a cycle point, see tlc_plan_t.cycle_ms */
+#define TLC_PHASE_STAGED 0x40     /*!< Approaches outside the call being served keep the start phase's aspect */
+
+/**
+ * @brief Preemption stages, shown in place of a plan phase
+ * @note Their indices follow every plan index, so traces and telemetry
+ *       tell them apart from the plan's phases
+ */
+typedef enum
+{
+    TLC_PHASE_PREEMPT_CLEAR = TLC_PLAN_MAX_PHASES, /*!< Moving approaches show yellow, a target already green keeps it */
+    TLC_PHASE_PREEMPT_RED,                         /*!< Every approach red */
+    TLC_PHASE_PREEMPT_DWELL,                       /*!< Target green and the rest red, or every approach red */
+} tlc_phase_preempt_t;
+
+/******************************************************************
+ * \struct tlc_phase_t tlc_phase.h
+ * \brief One row of a timing plan
+ *
+ * ### Example
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~.c
+ * {
+ *      .name = "YELLOW",
+ *      .light = {YELLOW, YELLOW},
+ *      .walk = WALK_OFF,
+ *      .min_ms = 5000,
+ *      .next = 2,
+ * },
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *******************************************************************/
+typedef struct
+{
+    const char *name;                       /*!< Phase name for logs */
+    state_t light[TLC_PLAN_MAX_APPROACHES]; /*!< Aspect shown on each approach */
+    walk_t walk;                            /*!< Walk signal shown on walk_mask approaches */
+    uint8_t walk_mask;                      /*!< Approaches whose crosswalk is served */
+    uint8_t flags;                          /*!< TLC_PHASE_* flags */
+    uint32_t min_ms;                        /*!< Shortest time in the phase */
+    uint32_t max_ms;                        /*!< Longest time, counted from the call when resting, 0 for no limit */
+    uint32_t call_ms;                       /*!< Time still served after a call arrives */
+    uint32_t passage_ms;                    /*!< Actuated: time per car, added after a call when resting, else per car below density_full */
+    uint8_t next;                           /*!< Index of the following phase */
+} tlc_phase_t;
+
+/******************************************************************
+ * \struct tlc_plan_t tlc_phase.h
+ * \brief Timing plan
+ *******************************************************************/
+typedef struct
+{
+    const char *name;          /*!< Plan name */
+    const tlc_phase_t *phases; /*!< Phase table */
+    uint8_t count;             /*!< Phases in the table */
+    uint8_t approaches;        /*!< Approaches driven */
+    uint8_t start;             /*!< Phase entered on boot and on resume */
+    uint8_t halt;              /*!< Phase held while halted */
+    uint32_t accessible_ms;    /*!< Extension for press & hold calls */
+    uint16_t density_full;     /*!< Density at which actuated phases saturate */
+    uint32_t cycle_ms;         /*!< Coordinated: common cycle length, 0 for free running */
+    uint8_t recall;            /*!< Crosswalks served whether called or not, one bit per approach */
+} tlc_plan_t;
+
+/******************************************************************
+ * \struct tlc_phase_engine_t tlc_phase.h
+ * \brief Phase engine state
+ *******************************************************************/
+typedef struct
+{
+    const tlc_plan_t *plan;       /*!< Plan being run */
+    const tlc_plan_t *next_plan;  /*!< Plan taking over at the next phase boundary, NULL for none */
+    bool next_restart;            /*!< next_plan starts at its start phase instead of following the sequence */
+    uint8_t index;                /*!< Current phase, or a tlc_phase_preempt_t while preempted */
+    int64_t started;              /*!< Start of the current phase (us) */
+    int64_t deadline;             /*!< End of the current phase (us), TLC_PHASE_NEVER if resting */
+    uint8_t demand;               /*!< Crosswalks with a pending call, one bit per approach */
+    uint8_t demand_accessible;    /*!< Pending calls that asked for accessible timing */
+    int64_t demand_at[TLC_PLAN_MAX_APPROACHES]; /*!< First pending call of each crosswalk (us) */
+    bool serving;                 /*!< In the serving phase or the on-call phases after it */
+    uint8_t served;               /*!< Crosswalks of the call being served */
+    bool served_accessible;       /*!< Call being served asked for accessible timing */
+    uint32_t folded;              /*!< Calls on a crosswalk already called or being served */
+    bool halted;                  /*!< Holding the halt phase */
+    uint16_t density;             /*!< Last traffic density (cars) */
+    int64_t sync_us;              /*!< Local time of the shared time base's zero (us) */
+    int64_t offset_us;            /*!< Cycle points of this intersection, after sync_us (us) */
+    uint32_t transitions;         /*!< Phase changes since init */
+    bool preempt_active;          /*!< Preemption input asserted */
+    uint8_t preempt_approach;     /*!< Approach given the dwell green, TLC_PHASE_ALL_RED for none */
+    tlc_phase_t preempt_phase;    /*!< Row shown while preempted, built on entry to each stage */
+} tlc_phase_engine_t;
+
+extern const tlc_plan_t tlc_plan_pedestrian;
+extern const tlc_plan_t tlc_plan_actuated;
+extern const tlc_plan_t tlc_plan_staged;
+extern const tlc_plan_t tlc_plan_four_way;
+extern const tlc_plan_t tlc_plan_coordinated;
+
+esp_err_t tlc_phase_validate(const tlc_plan_t *plan);
+esp_err_t tlc_phase_init(tlc_phase_engine_t *engine, const tlc_plan_t *plan, int64_t now);
+const tlc_phase_t *tlc_phase_current(const tlc_phase_engine_t *engine);
+state_t tlc_phase_aspect(const tlc_phase_engine_t *engine, uint8_t approach);
+bool tlc_phase_call(tlc_phase_engine_t *engine, int64_t now, uint8_t crosswalks, bool accessible);
+uint8_t tlc_phase_walking(const tlc_phase_engine_t *engine);
+bool tlc_phase_density(tlc_phase_engine_t *engine, int64_t now, uint16_t cars);
+bool tlc_phase_coordinate(tlc_phase_engine_t *engine, int64_t now, int64_t sync_us, int64_t offset_us);
+void tlc_phase_halt(tlc_phase_engine_t *engine, int64_t now, bool halt);
+esp_err_t tlc_phase_replan(tlc_phase_engine_t *engine, int64_t now, const tlc_plan_t *plan, bool restart);
+bool tlc_phase_preempt(tlc_phase_engine_t *engine, int64_t now, bool active, uint8_t approach);
+bool tlc_phase_preempting(const tlc_phase_engine_t *engine);
+bool tlc_phase_step(tlc_phase_engine_t *engine, int64_t now);
+
+#endif
@@ -0,0 +1,368 @@
+/**
+ * @file tlc_plan.c
+ * @brief Timing plans
+ * @author Jorge Minjares (https://github.com/JorgeMinjares)
+ * @brief Every plan is a static const table, so it lives in flash and the
+ *        engine only keeps an index into it. A new intersection layout is a
+ *        new table here, not a new task.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include "tlc_phase.h"
+#include "tlc_config.h"
+#include "tlc_timing.h"
+
+#define APPROACH(n) (1U << (n)) /*!< walk_mask bit of an approach */
+
+/**
+ * @brief Pedestrian actuated crossing, both directions move together
+ * @note Rests in GREEN; a press ends GREEN 3 s later (not before 3 s of
+ *       GREEN), press & hold adds 7.5 s of WALK. The GREEN and WALK times
+ *       shown are the defaults of tlc_timing.h.
+ */
+static const tlc_phase_t pedestrian_phases[] = {
+    {
+        .name = "GREEN",
+        .light = {GREEN, GREEN},
+        .walk = WALK_OFF,
+        .flags = TLC_PHASE_REST,
+        .min_ms = PED_GREEN_MIN_MS,
+        .call_ms = PED_CALL_MS,
+        .next = 1,
+    },
+    {
+        .name = "YELLOW",
+        .light = {YELLOW, YELLOW},
+        .walk = WALK_OFF,
+        .min_ms = 5000,
+        .next = 2,
+    },
+    {
+        .name = "RED",
+        .light = {RED, RED},
+        .walk = WALK_ON,
+        .walk_mask = APPROACH(0) | APPROACH(1),
+        .flags = TLC_PHASE_ON_CALL | TLC_PHASE_SERVE | TLC_PHASE_ACCESSIBLE,
+        .min_ms = PED_WALK_MS,
+        .next = 3,
+    },
+    {
+        .name = "DON'T WALK",
+        .light = {RED, RED},
+        .walk = WALK_WARNING,
+        .walk_mask = APPROACH(0) | APPROACH(1),
+        .flags = TLC_PHASE_ON_CALL,
+        .min_ms = 5500,
+        .next = 0,
+    },
+    {
+        .name = "HALT",
+        .light = {RED, RED},
+        .walk = WALK_OFF,
+        .flags = TLC_PHASE_REST,
+        .min_ms = 1000,
+        .next = 0,
+    },
+};
+
+const tlc_plan_t tlc_plan_pedestrian = {
+    .name = "pedestrian",
+    .phases = pedestrian_phases,
+    .count = sizeof(pedestrian_phases) / sizeof(pedestrian_phases[0]),
+    .approaches = 2,
+    .start = 0,
+    .halt = 4,
+    .accessible_ms = 7500,
+};
+
+/**
+ * @brief Pedestrian crossing actuated by traffic density
+ * @note After a press GREEN holds 2 s plus 1 s per queued car, at least 3 s
+ *       of GREEN and at most 30 s from the press. WALK gets 40 ms per car
+ *       below MAX_CARS on top of its 2 s, up to 3 s; every extra second of
+ *       WALK is a second of red for the cars. The yellow and the flashing
+ *       don't walk keep their fixed clearance times; the GREEN times shown
+ *       are the defaults of tlc_timing.h.
+ */
+static const tlc_phase_t actuated_phases[] = {
+    {
+        .name = "GREEN",
+        .light = {GREEN, GREEN},
+        .walk = WALK_OFF,
+        .flags = TLC_PHASE_REST | TLC_PHASE_ACTUATED,
+        .min_ms = ACT_GREEN_MIN_MS,
+        .max_ms = ACT_GREEN_MAX_MS,
+        .call_ms = ACT_CALL_MS,
+        .passage_ms = ACT_PASSAGE_MS,
+        .next = 1,
+    },
+    {
+        .name = "YELLOW",
+        .light = {YELLOW, YELLOW},
+        .walk = WALK_OFF,
+        .min_ms = 5000,
+        .next = 2,
+    },
+    {
+        .name = "RED",
+        .light = {RED, RED},
+        .walk = WALK_ON,
+        .walk_mask = APPROACH(0) | APPROACH(1),
+        .flags = TLC_PHASE_ON_CALL | TLC_PHASE_SERVE | TLC_PHASE_ACCESSIBLE | TLC_PHASE_ACTUATED,
+        .min_ms = 2000,
+        .max_ms = 3000,
+        .passage_ms = 40,
+        .next = 3,
+    },
+    {
+        .name = "DON'T WALK",
+        .light = {RED, RED},
+        .walk = WALK_WARNING,
+        .walk_mask = APPROACH(0) | APPROACH(1),
+        .flags = TLC_PHASE_ON_CALL,
+        .min_ms = 5500,
+        .next = 0,
+    },
+    {
+        .name = "HALT",
+        .light = {RED, RED},
+        .walk = WALK_OFF,
+        .flags = TLC_PHASE_REST,
+        .min_ms = 1000,
+        .next = 0,
+    },
+};
+
+const tlc_plan_t tlc_plan_actuated = {
+    .name = "actuated",
+    .phases = actuated_phases,
+    .count = sizeof(actuated_phases) / sizeof(actuated_phases[0]),
+    .approaches = 2,
+    .start = 0,
+    .halt = 4,
+    .accessible_ms = 7500,
+    .density_full = MAX_CARS,
+};
+
+/**
+ * @brief Two-stage pedestrian crossing with a refuge between the directions
+ * @note Each crosswalk only crosses the lanes of its own approach, so a call
+ *       stops just the approaches whose crosswalk was called; the other
+ *       direction keeps its GREEN through YELLOW, RED and DON'T WALK. Calls
+ *       for both crosswalks run them together. Times as tlc_plan_pedestrian.
+ */
+static const tlc_phase_t staged_phases[] = {
+    {
+        .name = "GREEN",
+        .light = {GREEN, GREEN},
+        .walk = WALK_OFF,
+        .flags = TLC_PHASE_REST,
+        .min_ms = PED_GREEN_MIN_MS,
+        .call_ms = PED_CALL_MS,
+        .next = 1,
+    },
+    {
+        .name = "YELLOW",
+        .light = {YELLOW, YELLOW},
+        .walk = WALK_OFF,
+        .flags = TLC_PHASE_STAGED,
+        .min_ms = 5000,
+        .next = 2,
+    },
+    {
+        .name = "RED",
+        .light = {RED, RED},
+        .walk = WALK_ON,
+        .walk_mask = APPROACH(0) | APPROACH(1),
+        .flags = TLC_PHASE_ON_CALL | TLC_PHASE_SERVE | TLC_PHASE_ACCESSIBLE | TLC_PHASE_STAGED,
+        .min_ms = PED_WALK_MS,
+        .next = 3,
+    },
+    {
+        .name = "DON'T WALK",
+        .light = {RED, RED},
+        .walk = WALK_WARNING,
+        .walk_mask = APPROACH(0) | APPROACH(1),
+        .flags = TLC_PHASE_ON_CALL | TLC_PHASE_STAGED,
+        .min_ms = 5500,
+        .next = 0,
+    },
+    {
+        .name = "HALT",
+        .light = {RED, RED},
+        .walk = WALK_OFF,
+        .flags = TLC_PHASE_REST,
+        .min_ms = 1000,
+        .next = 0,
+    },
+};
+
+const tlc_plan_t tlc_plan_staged = {
+    .name = "staged",
+    .phases = staged_phases,
+    .count = sizeof(staged_phases) / sizeof(staged_phases[0]),
+    .approaches = 2,
+    .start = 0,
+    .halt = 4,
+    .accessible_ms = 7500,
+};
+
+/**
+ * @brief Four approaches (north, east, south, west) with a leading protected
+ *        left for north and an exclusive pedestrian phase on call
+ */
+static const tlc_phase_t four_way_phases[] = {
+    {
+        .name = "N LEFT",
+        .light = {GREEN, RED, RED, RED},
+        .walk = WALK_OFF,
+        .min_ms = 6000,
+        .next = 1,
+    },
+    {
+        .name = "NS GREEN",
+        .light = {GREEN, RED, GREEN, RED},
+        .walk = WALK_OFF,
+        .min_ms = 20000,
+        .next = 2,
+    },
+    {
+        .name = "NS YELLOW",
+        .light = {YELLOW, RED, YELLOW, RED},
+        .walk = WALK_OFF,
+        .min_ms = 4000,
+        .next = 3,
+    },
+    {
+        .name = "NS CLEAR",
+        .light = {RED, RED, RED, RED},
+        .walk = WALK_OFF,
+        .min_ms = 2000,
+        .next = 4,
+    },
+    {
+        .name = "EW GREEN",
+        .light = {RED, GREEN, RED, GREEN},
+        .walk = WALK_OFF,
+        .min_ms = 20000,
+        .next = 5,
+    },
+    {
+        .name = "EW YELLOW",
+        .light = {RED, YELLOW, RED, YELLOW},
+        .walk = WALK_OFF,
+        .min_ms = 4000,
+        .next = 6,
+    },
+    {
+        .name = "EW CLEAR",
+        .light = {RED, RED, RED, RED},
+        .walk = WALK_OFF,
+        .min_ms = 2000,
+        .next = 7,
+    },
+    {
+        .name = "WALK",
+        .light = {RED, RED, RED, RED},
+        .walk = WALK_ON,
+        .walk_mask = APPROACH(0) | APPROACH(1) | APPROACH(2) | APPROACH(3),
+        .flags = TLC_PHASE_ON_CALL | TLC_PHASE_SERVE | TLC_PHASE_ACCESSIBLE,
+        .min_ms = 7000,
+        .next = 8,
+    },
+    {
+        .name = "DON'T WALK",
+        .light = {RED, RED, RED, RED},
+        .walk = WALK_WARNING,
+        .walk_mask = APPROACH(0) | APPROACH(1) | APPROACH(2) | APPROACH(3),
+        .flags = TLC_PHASE_ON_CALL,
+        .min_ms = 9000,
+        .next = 0,
+    },
+    {
+        .name = "HALT",
+        .light = {RED, RED, RED, RED},
+        .walk = WALK_OFF,
+        .flags = TLC_PHASE_REST,
+        .min_ms = 1000,
+        .next = 0,
+    },
+};
+
+const tlc_plan_t tlc_plan_four_way = {
+    .name = "four-way",
+    .phases = four_way_phases,
+    .count = sizeof(four_way_phases) / sizeof(four_way_phases[0]),
+    .approaches = 4,
+    .start = 1,
+    .halt = 9,
+    .accessible_ms = 7500,
+};
+
+/**
+ * @brief Fixed time plan for a coordinated corridor
+ * @note Both approaches are the corridor; RED is the cross street's green
+ *       and walk, which both crosswalks get every cycle, called or not.
+ *       GREEN ends on the intersection's cycle point, so it takes whatever
+ *       the 60 s cycle leaves after the fixed 22.5 s of YELLOW, RED and
+ *       DON'T WALK, and never less than 20 s. With the same time base and
+ *       offsets of distance / speed, a platoon leaving one GREEN meets the
+ *       next one.
+ */
+static const tlc_phase_t coordinated_phases[] = {
+    {
+        .name = "GREEN",
+        .light = {GREEN, GREEN},
+        .walk = WALK_OFF,
+        .flags = TLC_PHASE_SYNC,
+        .min_ms = 20000,
+        .next = 1,
+    },
+    {
+        .name = "YELLOW",
+        .light = {YELLOW, YELLOW},
+        .walk = WALK_OFF,
+        .min_ms = 5000,
+        .next = 2,
+    },
+    {
+        .name = "RED",
+        .light = {RED, RED},
+        .walk = WALK_ON,
+        .walk_mask = APPROACH(0) | APPROACH(1),
+        .flags = TLC_PHASE_SERVE | TLC_PHASE_ACCESSIBLE,
+        .min_ms = 12000,
+        .next = 3,
+    },
+    {
+        .name = "DON'T WALK",
+        .light = {RED, RED},
+        .walk = WALK_WARNING,
+        .walk_mask = APPROACH(0) | APPROACH(1),
+        .min_ms = 5500,
+        .next = 0,
+    },
+    {
+        .name = "HALT",
+        .light = {RED, RED},
+        .walk = WALK_OFF,
+        .flags = TLC_PHASE_REST,
+        .min_ms = 1000,
+        .next = 0,
+    },
+};
+
+const tlc_plan_t tlc_plan_coordinated = {
+    .name = "coordinated",
+    .phases = coordinated_phases,
+    .count = sizeof(coordinated_phases) / sizeof(coordinated_phases[0]),
+    .approaches = 2,
+    .start = 0,
+    .halt = 4,
+    .accessible_ms = 7500,
+    .cycle_ms = 60000,
+    .recall = APPROACH(0) | APPROACH(1),
+};
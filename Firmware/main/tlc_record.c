@@ -0,0 +1,236 @@
+/**
+ * @file tlc_record.c
+ * @brief Input and output recorder source code
+ * @author Jorge Minjares (https://github.com/JorgeMinjares)
+ * @brief Writers encode an entry on their stack, then take the lock to
+ *        stamp it and copy it into the ring, so the times in the ring never
+ *        step back. One reader, the I/O task, moves the tail without the
+ *        lock. An entry that does not fit is dropped whole and counted; the
+ *        next one that fits is preceded by a LOST entry.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <string.h>
+#include "tlc_record.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+
+#if TLC_RECORD_BYTES & (TLC_RECORD_BYTES - 1)
+#error "TLC_RECORD_BYTES must be a power of two"
+#endif
+
+static portMUX_TYPE record_mux = portMUX_INITIALIZER_UNLOCKED; /*!< Orders the writers of every core and ISR */
+static uint8_t ring[TLC_RECORD_BYTES];  /*!< Encoded entries */
+static uint32_t head = 0;               /*!< Bytes written */
+static uint32_t tail = 0;               /*!< Bytes read */
+static int64_t last_us = 0;             /*!< Time of the last entry written */
+static uint32_t lost_run = 0;           /*!< Entries dropped since the last one written */
+static uint64_t levels = 0;             /*!< Output levels as last written, pin n at bit n */
+static bool recording = false;          /*!< tlc_record_init() called */
+static tlc_record_stats_t stats;        /*!< Counters */
+
+static size_t IRAM_ATTR put_varint(uint8_t *out, uint64_t value)
+{
+    size_t n = 0;
+    while (value >= 0x80)
+    {
+        out[n++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[n++] = (uint8_t)value;
+    return n;
+}
+
+static void IRAM_ATTR put_bytes(const uint8_t *data, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        ring[(head + i) & (TLC_RECORD_BYTES - 1)] = data[i];
+    }
+    __atomic_store_n(&head, head + (uint32_t)size, __ATOMIC_RELEASE);
+    stats.bytes += size;
+}
+
+/* Stamp and store one entry, payload is already encoded; call with the lock held */
+static void IRAM_ATTR put_entry(uint8_t type, const uint8_t *payload, size_t size)
+{
+    uint8_t entry[TLC_RECORD_ENTRY_MAX + 12];
+    int64_t now = esp_timer_get_time();
+    size_t n = 0;
+    if (lost_run)
+    {
+        /* At the time of the entry it precedes, which follows with a delta of 0 */
+        entry[n++] = TLC_RECORD_LOST;
+        n += put_varint(&entry[n], (uint64_t)(now - last_us));
+        n += put_varint(&entry[n], lost_run);
+        entry[n++] = type;
+        entry[n++] = 0;
+    }
+    else
+    {
+        entry[n++] = type;
+        n += put_varint(&entry[n], (uint64_t)(now - last_us));
+    }
+    memcpy(&entry[n], payload, size);
+    n += size;
+    if (n > TLC_RECORD_BYTES - (head - __atomic_load_n(&tail, __ATOMIC_ACQUIRE)))
+    {
+        lost_run++;
+        stats.lost++;
+        return;
+    }
+    put_bytes(entry, n);
+    last_us = now;
+    lost_run = 0;
+    stats.entries++;
+}
+
+static void IRAM_ATTR record(uint8_t type, const uint8_t *payload, size_t size)
+{
+    portENTER_CRITICAL_SAFE(&record_mux);
+    put_entry(type, payload, size);
+    portEXIT_CRITICAL_SAFE(&record_mux);
+}
+
+/**
+ * @brief Start recording
+ *
+ * @param plan name of the timing plan, replayed with the recording
+ * @note Call once, before the inputs are enabled; every entry before is
+ *       ignored
+ */
+void tlc_record_init(const char *plan)
+{
+    uint8_t payload[TLC_RECORD_ENTRY_MAX - 11];
+    size_t len = strlen(plan);
+    len = len < sizeof(payload) - 1 ? len : sizeof(payload) - 1;
+    payload[0] = (uint8_t)len;
+    memcpy(&payload[1], plan, len);
+    record(TLC_RECORD_BOOT, payload, len + 1);
+    recording = true;
+}
+
+/**
+ * @brief Record the level a button or the preemption ISR read
+ *
+ * @param pin input pin
+ * @param level level after the edge
+ * @note Safe from ISRs
+ */
+void IRAM_ATTR tlc_record_edge(uint8_t pin, uint8_t level)
+{
+    if (!recording)
+    {
+        return;
+    }
+    uint8_t payload[2] = {pin, level};
+    record(TLC_RECORD_EDGE, payload, sizeof(payload));
+}
+
+/**
+ * @brief Record an event of the I/O task as the controller takes it
+ *
+ * @param event TLC_EVENT_DENSITY or TLC_EVENT_UART
+ * @note The entry time is when the event acts, not when it was read; a
+ *       replay hands it back just before.
+ */
+void tlc_record_event(const tlc_event_t *event)
+{
+    if (!recording)
+    {
+        return;
+    }
+    uint8_t payload[1 + 10 + 10];
+    size_t n = 0;
+    payload[n++] = event->type;
+    n += put_varint(&payload[n], event->type == TLC_EVENT_DENSITY ? event->cars : event->command);
+    portENTER_CRITICAL_SAFE(&record_mux);
+    /* The stamp is taken against the entry time, so read it under the lock */
+    int64_t stamp = event->timestamp - esp_timer_get_time();
+    n += put_varint(&payload[n], ((uint64_t)stamp << 1) ^ (uint64_t)(stamp >> 63));
+    put_entry(TLC_RECORD_EVENT, payload, n);
+    portEXIT_CRITICAL_SAFE(&record_mux);
+}
+
+/**
+ * @brief Record a write of the output registers
+ *
+ * @param set pins driven high, pin n at bit n
+ * @param clr pins driven low
+ * @note Only writes that change a level make an entry
+ */
+void IRAM_ATTR tlc_record_output(uint64_t set, uint64_t clr)
+{
+    if (!recording)
+    {
+        return;
+    }
+    uint8_t payload[20];
+    portENTER_CRITICAL_SAFE(&record_mux);
+    uint64_t next = (levels & ~clr) | set;
+    uint64_t changed = next ^ levels;
+    if (changed)
+    {
+        levels = next;
+        size_t n = put_varint(payload, changed);
+        n += put_varint(&payload[n], next & changed);
+        put_entry(TLC_RECORD_OUTPUT, payload, n);
+    }
+    portEXIT_CRITICAL_SAFE(&record_mux);
+}
+
+/**
+ * @brief Record a tone gated on or off
+ *
+ * @param channel DAC channel
+ * @param on tone sounds
+ */
+void IRAM_ATTR tlc_record_tone(uint8_t channel, bool on)
+{
+    if (!recording)
+    {
+        return;
+    }
+    uint8_t payload[2] = {channel, on};
+    record(TLC_RECORD_TONE, payload, sizeof(payload));
+}
+
+/**
+ * @brief Take recorded bytes out of the ring
+ *
+ * @param out buffer
+ * @param size buffer size
+ * @param offset stream offset of the first byte returned
+ * @return size_t bytes copied, 0 when the ring is empty
+ * @note Call from one task only. Bytes are returned as they come, an entry
+ *       may be split between two reads.
+ */
+size_t tlc_record_read(uint8_t *out, size_t size, uint32_t *offset)
+{
+    uint32_t end = __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+    size_t n = end - tail;
+    n = n < size ? n : size;
+    for (size_t i = 0; i < n; i++)
+    {
+        out[i] = ring[(tail + i) & (TLC_RECORD_BYTES - 1)];
+    }
+    *offset = tail;
+    __atomic_store_n(&tail, tail + (uint32_t)n, __ATOMIC_RELEASE);
+    return n;
+}
+
+/**
+ * @brief Read the recorder counters
+ *
+ * @param out copy of the counters
+ */
+void tlc_record_get_stats(tlc_record_stats_t *out)
+{
+    portENTER_CRITICAL_SAFE(&record_mux);
+    *out = stats;
+    portEXIT_CRITICAL_SAFE(&record_mux);
+}
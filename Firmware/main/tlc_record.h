@@ -0,0 +1,76 @@
+/**
+ * @file tlc_record.h
+ * @brief Input and output recorder
+ * @author Jorge Minjares (https://github.com/JorgeMinjares)
+ * @brief Records what enters the controller and what it drives, with
+ *        timestamps, into a RAM byte ring that the I/O task streams out
+ *        with the telemetry. Entries are written whole under one lock, in
+ *        the order they happened on either core, so a host replay can feed
+ *        the inputs back at the same times and compare the outputs.
+ *
+ *        entry = type:u8 delta_us:varint payload
+ *
+ *        delta_us is the time since the previous entry, since 0 for the
+ *        first one. The stream starts with a BOOT entry; a reader that
+ *        missed its first bytes cannot rebuild the times.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef TLC_RECORD_H
+#define TLC_RECORD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "tlc_event.h"
+
+#define TLC_RECORD_BYTES 2048       /*!< Byte ring waiting for the I/O task, a power of two */
+#define TLC_RECORD_ENTRY_MAX 32     /*!< Encoded bytes of one entry at most */
+#define TLC_RECORD_RECORDS 8        /*!< RECORD telemetry records sent per ADC block at most */
+
+/**
+ * @brief Entry types
+ * @note Payloads:
+ *       BOOT   plan_len:u8 plan:char[plan_len]
+ *       EDGE   pin:u8 level:u8, read by a button or the preemption ISR
+ *       EVENT  type:u8 (tlc_event_type_t) value:varint stamp:svarint,
+ *              an I/O task event taken by the controller: value is cars
+ *              of DENSITY and the byte of UART, stamp the event timestamp
+ *              minus the entry time
+ *       OUTPUT changed:varint levels:varint, 64 bit pin masks of the
+ *              outputs that changed and their new levels
+ *       TONE   channel:u8 on:u8, DAC channel gated
+ *       LOST   entries:varint dropped to a full ring before this one
+ */
+typedef enum
+{
+    TLC_RECORD_BOOT = 1,    /*!< Recording started */
+    TLC_RECORD_EDGE = 2,    /*!< Button or preemption input level */
+    TLC_RECORD_EVENT = 3,   /*!< Density value or UART byte */
+    TLC_RECORD_OUTPUT = 4,  /*!< Light and walk pins written */
+    TLC_RECORD_TONE = 5,    /*!< Buzzer tone on or off */
+    TLC_RECORD_LOST = 6,    /*!< Entries dropped */
+} tlc_record_type_t;
+
+/**
+ * @brief Recorder counters
+ */
+typedef struct
+{
+    uint32_t entries;   /*!< Entries written */
+    uint32_t lost;      /*!< Entries dropped to a full ring */
+    uint32_t bytes;     /*!< Bytes written */
+} tlc_record_stats_t;
+
+void tlc_record_init(const char *plan);
+void tlc_record_edge(uint8_t pin, uint8_t level);
+void tlc_record_event(const tlc_event_t *event);
+void tlc_record_output(uint64_t set, uint64_t clr);
+void tlc_record_tone(uint8_t channel, bool on);
+size_t tlc_record_read(uint8_t *out, size_t size, uint32_t *offset);
+void tlc_record_get_stats(tlc_record_stats_t *stats);
+
+#endif
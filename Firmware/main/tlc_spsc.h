@@ -0,0 +1,161 @@
+/**
+ * @file tlc_spsc.h
+ * @brief Lock-free single producer, single consumer ring
+ * @author Jorge Minjares (https://github.com/JorgeMinjares)
+ * @brief Carries fixed size items between the two cores. The producer
+ *        only moves head and the consumer only moves tail, so neither ever
+ *        waits for the other: a full ring drops the new item and counts it
+ *        in overflow, an empty one returns nothing. head is stored with
+ *        release after the item is copied in and loaded with acquire before
+ *        it is copied out; tail works the same way the other direction, so
+ *        a slot is never reused while it is being read.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef TLC_SPSC_H
+#define TLC_SPSC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_attr.h"
+
+/******************************************************************
+ * \struct tlc_spsc_t tlc_spsc.h
+ * \brief Ring of size items of item_size bytes
+ *
+ * ### Example
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~.c
+ * static tlc_event_t slots[16];
+ * static tlc_spsc_t ring;
+ * tlc_spsc_init(&ring, slots, 16, sizeof(tlc_event_t));
+ * tlc_spsc_push(&ring, &event);            // producer core
+ * while (tlc_spsc_pop(&ring, &event)) {}   // consumer core
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *******************************************************************/
+typedef struct
+{
+    uint32_t head;       /*!< Items pushed, written by the producer */
+    uint32_t tail;       /*!< Items popped, written by the consumer */
+    uint32_t overflow;   /*!< Items dropped on a full ring, written by the producer */
+    uint32_t mask;       /*!< Slots - 1, slots is a power of two */
+    uint32_t item_size;  /*!< Bytes per slot */
+    uint8_t *slots;      /*!< Slot storage */
+} tlc_spsc_t;
+
+/**
+ * @brief Set up an empty ring
+ *
+ * @param ring ring
+ * @param slots storage of size * item_size bytes
+ * @param size slots, a power of two
+ * @param item_size bytes per item
+ * @note Call before either side uses the ring
+ */
+static inline void tlc_spsc_init(tlc_spsc_t *ring, void *slots, uint32_t size, uint32_t item_size)
+{
+    *ring = (tlc_spsc_t){
+        .mask = size - 1,
+        .item_size = item_size,
+        .slots = slots,
+    };
+}
+
+/**
+ * @brief Add an item
+ *
+ * @param ring ring
+ * @param item item_size bytes to copy in
+ * @return false if the ring was full; the item is dropped and counted in
+ *         overflow
+ * @note Producer only
+ */
+static inline bool IRAM_ATTR tlc_spsc_push(tlc_spsc_t *ring, const void *item)
+{
+    uint32_t head = ring->head;
+    if (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) > ring->mask)
+    {
+        __atomic_store_n(&ring->overflow, ring->overflow + 1, __ATOMIC_RELAXED);
+        return false;
+    }
+    __builtin_memcpy(&ring->slots[(head & ring->mask) * ring->item_size], item, ring->item_size);
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+/**
+ * @brief Oldest item, left in the ring
+ *
+ * @param ring ring
+ * @return item, valid until tlc_spsc_drop(), or NULL if the ring is empty
+ * @note Consumer only
+ */
+static inline void *IRAM_ATTR tlc_spsc_front(tlc_spsc_t *ring)
+{
+    uint32_t tail = ring->tail;
+    if (__atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) == tail)
+    {
+        return NULL;
+    }
+    return &ring->slots[(tail & ring->mask) * ring->item_size];
+}
+
+/**
+ * @brief Give the slot of the oldest item back to the producer
+ *
+ * @param ring ring, not empty
+ * @note Consumer only
+ */
+static inline void IRAM_ATTR tlc_spsc_drop(tlc_spsc_t *ring)
+{
+    __atomic_store_n(&ring->tail, ring->tail + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Take the oldest item
+ *
+ * @param ring ring
+ * @param item receives item_size bytes
+ * @return false if the ring is empty
+ * @note Consumer only
+ */
+static inline bool IRAM_ATTR tlc_spsc_pop(tlc_spsc_t *ring, void *item)
+{
+    const void *front = tlc_spsc_front(ring);
+    if (front == NULL)
+    {
+        return false;
+    }
+    __builtin_memcpy(item, front, ring->item_size);
+    tlc_spsc_drop(ring);
+    return true;
+}
+
+/**
+ * @brief Items waiting
+ *
+ * @param ring ring
+ * @return items pushed and not yet popped, as seen from the calling core
+ * @note Either side
+ */
+static inline uint32_t tlc_spsc_count(const tlc_spsc_t *ring)
+{
+    uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    return __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) - tail;
+}
+
+/**
+ * @brief Items dropped on a full ring
+ *
+ * @param ring ring
+ * @return overflow count since init
+ * @note Either side
+ */
+static inline uint32_t tlc_spsc_overflow(const tlc_spsc_t *ring)
+{
+    return __atomic_load_n(&ring->overflow, __ATOMIC_RELAXED);
+}
+
+#endif
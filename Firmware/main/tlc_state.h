@@ -0,0 +1,137 @@
+/**
+ * @file tlc_state.h
+ * @brief Consistent snapshot of an intersection's state
+ * @author Jorge Minjares (https://github.com/JorgeMinjares)
+ * @brief The scheduler task is the only writer of a controller's state. It
+ *        publishes a copy through a seqlock after every change, and tasks,
+ *        timer callbacks or the other core read it without a lock: the read
+ *        retries while a publish is in progress, so it never returns fields
+ *        from two different publishes. The writer masks interrupts on its
+ *        core for the few stores of a publish, so a reader that preempts it
+ *        there cannot spin forever. The copy is moved in 32-bit atomic
+ *        words with release stores and acquire loads instead of fences, so
+ *        ThreadSanitizer checks exactly the ordering the code relies on.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef TLC_STATE_H
+#define TLC_STATE_H
+
+#include <stdint.h>
+#include "tlc_phase.h"
+#include "esp_attr.h"
+#include "freertos/FreeRTOS.h"
+
+/* tlc_state_t.flags */
+#define TLC_STATE_HALTED 0x01     /*!< Holding the halt phase */
+#define TLC_STATE_CALL 0x02       /*!< A pedestrian call is waiting */
+#define TLC_STATE_SERVING 0x04    /*!< Serving a call */
+#define TLC_STATE_ACCESSIBLE 0x08 /*!< The call served asked for accessible timing */
+#define TLC_STATE_PREEMPT 0x10    /*!< Preemption input asserted */
+
+/**
+ * @brief Counters the scheduler task keeps for one intersection
+ */
+typedef struct
+{
+    int64_t latency_sum_us;   /*!< Sum of press-to-reaction latencies */
+    uint32_t latency_max_us;  /*!< Worst press-to-reaction latency */
+    uint32_t reactions;       /*!< Latency samples */
+    uint32_t button_events;   /*!< Classified button events */
+    uint32_t button_wakeups;  /*!< Debounce and hold deadlines handled */
+    uint32_t timers_lost;     /*!< Phase deadlines recovered after their timer event was lost */
+} tlc_state_counters_t;
+
+/******************************************************************
+ * \struct tlc_state_t tlc_state.h
+ * \brief State of one intersection as of one publish
+ *******************************************************************/
+typedef struct
+{
+    const tlc_plan_t *plan;  /*!< Plan being run */
+    int64_t started;         /*!< Start of the phase shown (us) */
+    int64_t deadline;        /*!< End of the phase shown (us), TLC_PHASE_NEVER if resting */
+    uint32_t transitions;    /*!< Phase changes since init */
+    uint16_t density;        /*!< Traffic density the phase is timed on (cars) */
+    uint8_t index;           /*!< Phase shown */
+    uint8_t flags;           /*!< TLC_STATE_x */
+    tlc_state_counters_t counters; /*!< Counters as of this publish */
+} tlc_state_t;
+
+#define TLC_STATE_WORDS ((sizeof(tlc_state_t) + 3) / 4) /*!< 32-bit words of a tlc_state_t */
+
+/******************************************************************
+ * \struct tlc_state_cell_t tlc_state.h
+ * \brief Seqlock holding the last published state
+ *******************************************************************/
+typedef struct
+{
+    uint32_t seq;                     /*!< Publishes begun and ended, odd while one is in progress */
+    uint32_t words[TLC_STATE_WORDS];  /*!< The tlc_state_t */
+} tlc_state_cell_t;
+
+/**
+ * @brief Publish a new state
+ *
+ * @param cell seqlock
+ * @param state state to publish
+ * @note One writer per cell. Interrupts on the writer's core are masked
+ *       for TLC_STATE_WORDS + 2 stores.
+ */
+static inline void IRAM_ATTR tlc_state_publish(tlc_state_cell_t *cell, const tlc_state_t *state)
+{
+    uint32_t words[TLC_STATE_WORDS] = {0};
+    __builtin_memcpy(words, state, sizeof(*state));
+    uint32_t seq = __atomic_load_n(&cell->seq, __ATOMIC_RELAXED);
+    portDISABLE_INTERRUPTS();
+    __atomic_store_n(&cell->seq, seq + 1, __ATOMIC_RELAXED);
+    /* Release keeps the odd seq ahead of every word */
+    for (uint32_t i = 0; i < TLC_STATE_WORDS; i++)
+    {
+        __atomic_store_n(&cell->words[i], words[i], __ATOMIC_RELEASE);
+    }
+    __atomic_store_n(&cell->seq, seq + 2, __ATOMIC_RELEASE);
+    portENABLE_INTERRUPTS();
+}
+
+/**
+ * @brief Read the last published state
+ *
+ * @param cell seqlock
+ * @param state receives the state
+ * @return times the read looped because a publish was in progress or
+ *         overlapped it
+ * @note Safe from any task, timer callback or core. Returns a zeroed state
+ *       before the first publish.
+ */
+static inline uint32_t IRAM_ATTR tlc_state_read(const tlc_state_cell_t *cell, tlc_state_t *state)
+{
+    uint32_t words[TLC_STATE_WORDS];
+    uint32_t retries = 0;
+    while (1)
+    {
+        uint32_t seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+        if (seq & 1)
+        {
+            retries++;
+            continue;
+        }
+        /* Acquire keeps every word ahead of the second seq load */
+        for (uint32_t i = 0; i < TLC_STATE_WORDS; i++)
+        {
+            words[i] = __atomic_load_n(&cell->words[i], __ATOMIC_ACQUIRE);
+        }
+        if (__atomic_load_n(&cell->seq, __ATOMIC_RELAXED) == seq)
+        {
+            break;
+        }
+        retries++;
+    }
+    __builtin_memcpy(state, words, sizeof(*state));
+    return retries;
+}
+
+#endif
@@ -0,0 +1,448 @@
+/**
+ * @file tlc_telemetry.c
+ * @brief Binary telemetry over UART0 source code
+ * @author Jorge Minjares (https://github.com/JorgeMinjares)
+ * @brief Each core queues its records in its own tlc_spsc_t ring, with
+ *        interrupts masked for the copy so the tasks of a core act as one
+ *        producer. Framing, CRC and the UART write happen in
+ *        tlc_telemetry_flush() on the consumer task, once per batch; it
+ *        merges the rings oldest first and numbers the records as it sends
+ *        them, skipping one number per record a full ring dropped.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <string.h>
+#include "tlc_telemetry.h"
+#include "tlc_spsc.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/**
+ * @brief Queued record
+ */
+typedef struct
+{
+    int64_t time_us;                        /*!< Event time */
+    uint8_t type;                           /*!< tlc_telemetry_type_t */
+    uint8_t size;                           /*!< Payload bytes */
+    uint8_t data[TLC_TELEMETRY_DATA_MAX];   /*!< Payload */
+} tlc_telemetry_entry_t;
+
+static tlc_telemetry_entry_t slots[TLC_TELEMETRY_CORES][TLC_TELEMETRY_RING]; /*!< Records waiting to be sent */
+static tlc_spsc_t rings[TLC_TELEMETRY_CORES];       /*!< Ring of each producing core */
+static uint32_t reported[TLC_TELEMETRY_CORES];      /*!< Overflow of each ring already skipped in the numbering */
+static uint32_t next_seq = 0;                       /*!< Sequence number of the next record sent */
+static uint32_t frames = 0;                         /*!< Frames sent */
+static uint32_t bytes = 0;                          /*!< Bytes sent */
+static tlc_telemetry_write_t sink = NULL;           /*!< Frame output */
+static TaskHandle_t consumer = NULL;                /*!< Task sending the frames, NULL for any caller */
+
+/* CRC-16/CCITT-FALSE, one byte per lookup */
+static const uint16_t crc_table[256] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7,
+    0x8108, 0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef,
+    0x1231, 0x0210, 0x3273, 0x2252, 0x52b5, 0x4294, 0x72f7, 0x62d6,
+    0x9339, 0x8318, 0xb37b, 0xa35a, 0xd3bd, 0xc39c, 0xf3ff, 0xe3de,
+    0x2462, 0x3443, 0x0420, 0x1401, 0x64e6, 0x74c7, 0x44a4, 0x5485,
+    0xa56a, 0xb54b, 0x8528, 0x9509, 0xe5ee, 0xf5cf, 0xc5ac, 0xd58d,
+    0x3653, 0x2672, 0x1611, 0x0630, 0x76d7, 0x66f6, 0x5695, 0x46b4,
+    0xb75b, 0xa77a, 0x9719, 0x8738, 0xf7df, 0xe7fe, 0xd79d, 0xc7bc,
+    0x48c4, 0x58e5, 0x6886, 0x78a7, 0x0840, 0x1861, 0x2802, 0x3823,
+    0xc9cc, 0xd9ed, 0xe98e, 0xf9af, 0x8948, 0x9969, 0xa90a, 0xb92b,
+    0x5af5, 0x4ad4, 0x7ab7, 0x6a96, 0x1a71, 0x0a50, 0x3a33, 0x2a12,
+    0xdbfd, 0xcbdc, 0xfbbf, 0xeb9e, 0x9b79, 0x8b58, 0xbb3b, 0xab1a,
+    0x6ca6, 0x7c87, 0x4ce4, 0x5cc5, 0x2c22, 0x3c03, 0x0c60, 0x1c41,
+    0xedae, 0xfd8f, 0xcdec, 0xddcd, 0xad2a, 0xbd0b, 0x8d68, 0x9d49,
+    0x7e97, 0x6eb6, 0x5ed5, 0x4ef4, 0x3e13, 0x2e32, 0x1e51, 0x0e70,
+    0xff9f, 0xefbe, 0xdfdd, 0xcffc, 0xbf1b, 0xaf3a, 0x9f59, 0x8f78,
+    0x9188, 0x81a9, 0xb1ca, 0xa1eb, 0xd10c, 0xc12d, 0xf14e, 0xe16f,
+    0x1080, 0x00a1, 0x30c2, 0x20e3, 0x5004, 0x4025, 0x7046, 0x6067,
+    0x83b9, 0x9398, 0xa3fb, 0xb3da, 0xc33d, 0xd31c, 0xe37f, 0xf35e,
+    0x02b1, 0x1290, 0x22f3, 0x32d2, 0x4235, 0x5214, 0x6277, 0x7256,
+    0xb5ea, 0xa5cb, 0x95a8, 0x8589, 0xf56e, 0xe54f, 0xd52c, 0xc50d,
+    0x34e2, 0x24c3, 0x14a0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
+    0xa7db, 0xb7fa, 0x8799, 0x97b8, 0xe75f, 0xf77e, 0xc71d, 0xd73c,
+    0x26d3, 0x36f2, 0x0691, 0x16b0, 0x6657, 0x7676, 0x4615, 0x5634,
+    0xd94c, 0xc96d, 0xf90e, 0xe92f, 0x99c8, 0x89e9, 0xb98a, 0xa9ab,
+    0x5844, 0x4865, 0x7806, 0x6827, 0x18c0, 0x08e1, 0x3882, 0x28a3,
+    0xcb7d, 0xdb5c, 0xeb3f, 0xfb1e, 0x8bf9, 0x9bd8, 0xabbb, 0xbb9a,
+    0x4a75, 0x5a54, 0x6a37, 0x7a16, 0x0af1, 0x1ad0, 0x2ab3, 0x3a92,
+    0xfd2e, 0xed0f, 0xdd6c, 0xcd4d, 0xbdaa, 0xad8b, 0x9de8, 0x8dc9,
+    0x7c26, 0x6c07, 0x5c64, 0x4c45, 0x3ca2, 0x2c83, 0x1ce0, 0x0cc1,
+    0xef1f, 0xff3e, 0xcf5d, 0xdf7c, 0xaf9b, 0xbfba, 0x8fd9, 0x9ff8,
+    0x6e17, 0x7e36, 0x4e55, 0x5e74, 0x2e93, 0x3eb2, 0x0ed1, 0x1ef0,
+};
+
+/**
+ * @brief CRC-16/CCITT-FALSE
+ *
+ * @param data bytes
+ * @param size number of bytes
+ * @return CRC, 0x29b1 for "123456789"
+ */
+uint16_t tlc_telemetry_crc16(const uint8_t *data, size_t size)
+{
+    uint16_t crc = 0xffff;
+    for (size_t i = 0; i < size; i++)
+    {
+        crc = (uint16_t)((crc << 8) ^ crc_table[(crc >> 8) ^ data[i]]);
+    }
+    return crc;
+}
+
+/**
+ * @brief COBS encode
+ *
+ * @param out encoded bytes, size + size / 254 + 1 long, no delimiter
+ * @param in bytes to encode
+ * @param size number of bytes
+ * @return encoded size
+ */
+size_t tlc_telemetry_cobs(uint8_t *out, const uint8_t *in, size_t size)
+{
+    size_t code_at = 0;
+    size_t o = 1;
+    uint8_t code = 1;
+    for (size_t i = 0; i < size; i++)
+    {
+        if (in[i] != 0)
+        {
+            out[o++] = in[i];
+            code++;
+        }
+        if (in[i] == 0 || code == 0xff)
+        {
+            out[code_at] = code;
+            code_at = o++;
+            code = 1;
+        }
+    }
+    out[code_at] = code;
+    return o;
+}
+
+/**
+ * @brief LEB128 encode
+ *
+ * @param out at least 10 bytes
+ * @param value value
+ * @return encoded size
+ */
+size_t tlc_telemetry_varint(uint8_t *out, uint64_t value)
+{
+    size_t n = 0;
+    while (value >= 0x80)
+    {
+        out[n++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[n++] = (uint8_t)value;
+    return n;
+}
+
+static void put_le(uint8_t *out, uint64_t value, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        out[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+/**
+ * @brief Start telemetry
+ *
+ * @param write sink for encoded frames, normally the UART
+ * @note Sends a lone delimiter so anything printed before it, like the boot
+ *       banner, is not taken as part of the first frame
+ */
+void tlc_telemetry_init(tlc_telemetry_write_t write)
+{
+    static const uint8_t delimiter = 0;
+    for (uint8_t core = 0; core < TLC_TELEMETRY_CORES; core++)
+    {
+        tlc_spsc_init(&rings[core], slots[core], TLC_TELEMETRY_RING, sizeof(tlc_telemetry_entry_t));
+        reported[core] = 0;
+    }
+    next_seq = 0;
+    frames = 0;
+    bytes = 0;
+    sink = write;
+    if (sink != NULL)
+    {
+        sink(&delimiter, 1);
+        bytes++;
+    }
+}
+
+/**
+ * @brief Send the frames from one task only
+ *
+ * @param task task that sends, NULL to let any caller of
+ *             tlc_telemetry_flush() send
+ * @note tlc_telemetry_flush() called from any other task wakes this one
+ *       with a task notification instead of writing, so a task that must
+ *       not wait on the UART never does
+ */
+void tlc_telemetry_consumer(TaskHandle_t task)
+{
+    consumer = task;
+}
+
+/**
+ * @brief Queue a record
+ *
+ * @param type record type
+ * @param time_us event time
+ * @param data payload
+ * @param size payload bytes, at most TLC_TELEMETRY_DATA_MAX
+ * @return false if the ring of the calling core was full; the record still
+ *         takes a sequence number so the reader sees the gap
+ * @note Any task on either core, never an ISR
+ */
+bool tlc_telemetry_record(tlc_telemetry_type_t type, int64_t time_us, const uint8_t *data, size_t size)
+{
+    if (size > TLC_TELEMETRY_DATA_MAX)
+    {
+        return false;
+    }
+    tlc_telemetry_entry_t e = {
+        .time_us = time_us,
+        .type = (uint8_t)type,
+        .size = (uint8_t)size,
+    };
+    memcpy(e.data, data, size);
+    /* No other task of this core can push while interrupts are masked */
+    portDISABLE_INTERRUPTS();
+    bool queued = tlc_spsc_push(&rings[xPortGetCoreID() & 1], &e);
+    portENABLE_INTERRUPTS();
+    return queued;
+}
+
+/**
+ * @brief Queue a BOOT record
+ *
+ * @param plan name of the plan
+ * @param phases phases in the plan
+ * @return false if dropped
+ */
+bool tlc_telemetry_boot(const char *plan, uint8_t phases)
+{
+    uint8_t data[TLC_TELEMETRY_DATA_MAX];
+    size_t len = strlen(plan);
+    len = len > TLC_TELEMETRY_DATA_MAX - 2 ? TLC_TELEMETRY_DATA_MAX - 2 : len;
+    data[0] = (uint8_t)len;
+    memcpy(&data[1], plan, len);
+    data[1 + len] = phases;
+    return tlc_telemetry_record(TLC_TELEMETRY_BOOT, esp_timer_get_time(), data, len + 2);
+}
+
+/**
+ * @brief Queue a PHASE record
+ *
+ * @param time_us time the phase started
+ * @param instance intersection
+ * @param index phase index in the plan
+ * @param flags TLC_TELEMETRY_PHASE_x
+ * @return false if dropped
+ */
+bool tlc_telemetry_phase(int64_t time_us, uint8_t instance, uint8_t index, uint8_t flags)
+{
+    uint8_t data[3] = {instance, index, flags};
+    return tlc_telemetry_record(TLC_TELEMETRY_PHASE, time_us, data, sizeof(data));
+}
+
+/**
+ * @brief Queue a BUTTON record
+ *
+ * @param time_us time of the event
+ * @param instance intersection
+ * @param type tlc_button_type_t
+ * @param pin button pin
+ * @param duration_us press duration, 0 for a press
+ * @return false if dropped
+ */
+bool tlc_telemetry_button(int64_t time_us, uint8_t instance, uint8_t type, uint8_t pin, int64_t duration_us)
+{
+    uint8_t data[13] = {instance, type, pin};
+    size_t size = 3 + tlc_telemetry_varint(&data[3], duration_us > 0 ? (uint64_t)duration_us : 0);
+    return tlc_telemetry_record(TLC_TELEMETRY_BUTTON, time_us, data, size);
+}
+
+/**
+ * @brief Queue a DENSITY record
+ *
+ * @param time_us time the value was published
+ * @param cars_q8 cars in Q8
+ * @param raw_q4 filtered raw counts in Q4
+ * @return false if dropped
+ */
+bool tlc_telemetry_density(int64_t time_us, uint16_t cars_q8, uint16_t raw_q4)
+{
+    uint8_t data[4];
+    put_le(&data[0], cars_q8, 2);
+    put_le(&data[2], raw_q4, 2);
+    return tlc_telemetry_record(TLC_TELEMETRY_DENSITY, time_us, data, sizeof(data));
+}
+
+/**
+ * @brief Queue a STATS record
+ *
+ * @param values counters in the order listed for TLC_TELEMETRY_STATS
+ * @param count number of counters
+ * @return false if dropped
+ */
+bool tlc_telemetry_stats(const uint32_t *values, uint8_t count)
+{
+    uint8_t data[TLC_TELEMETRY_DATA_MAX];
+    size_t size = 0;
+    for (uint8_t i = 0; i < count && size + 5 <= sizeof(data); i++)
+    {
+        size += tlc_telemetry_varint(&data[size], values[i]);
+    }
+    return tlc_telemetry_record(TLC_TELEMETRY_STATS, esp_timer_get_time(), data, size);
+}
+
+/**
+ * @brief Queue a TRACE record
+ *
+ * @param time_us time of the entry
+ * @param core core that wrote the entry
+ * @param id tlc_trace_id_t
+ * @param arg0 first argument
+ * @param arg1 second argument
+ * @return false if dropped
+ */
+bool tlc_telemetry_trace(int64_t time_us, uint8_t core, uint8_t id, uint16_t arg0, uint32_t arg1)
+{
+    uint8_t data[2 + 3 + 5] = {core, id};
+    size_t size = 2 + tlc_telemetry_varint(&data[2], arg0);
+    size += tlc_telemetry_varint(&data[size], arg1);
+    return tlc_telemetry_record(TLC_TELEMETRY_TRACE, time_us, data, size);
+}
+
+/* COBS encode a finished frame, add the CRC and delimiter and send it */
+static size_t tlc_telemetry_send(uint8_t *frame, size_t size)
+{
+    uint8_t out[TLC_TELEMETRY_FRAME_MAX + 2];
+    put_le(&frame[size], tlc_telemetry_crc16(frame, size), 2);
+    size_t n = tlc_telemetry_cobs(out, frame, size + 2);
+    out[n++] = 0;
+    sink(out, n);
+    frames++;
+    bytes += n;
+    return n;
+}
+
+/**
+ * @brief Records waiting to be sent
+ *
+ * @return records in the rings of both cores
+ */
+uint8_t tlc_telemetry_pending(void)
+{
+    uint32_t count = 0;
+    for (uint8_t core = 0; core < TLC_TELEMETRY_CORES; core++)
+    {
+        count += tlc_spsc_count(&rings[core]);
+    }
+    return (uint8_t)count;
+}
+
+/* Ring holding the oldest record, NULL if both are empty */
+static tlc_spsc_t *tlc_telemetry_oldest(void)
+{
+    tlc_spsc_t *oldest = NULL;
+    int64_t oldest_us = 0;
+    for (uint8_t core = 0; core < TLC_TELEMETRY_CORES; core++)
+    {
+        const tlc_telemetry_entry_t *e = tlc_spsc_front(&rings[core]);
+        if (e != NULL && (oldest == NULL || e->time_us < oldest_us))
+        {
+            oldest = &rings[core];
+            oldest_us = e->time_us;
+        }
+    }
+    return oldest;
+}
+
+/**
+ * @brief Send every queued record
+ *
+ * @return bytes written, 0 if the consumer task was woken to send them
+ * @note Records are packed into as few frames as fit
+ *       TLC_TELEMETRY_FRAME_MAX. Records dropped since the last flush leave
+ *       a sequence gap ahead of the first frame.
+ */
+size_t tlc_telemetry_flush(void)
+{
+    uint8_t frame[TLC_TELEMETRY_FRAME_MAX];
+    size_t size = 0;
+    size_t written = 0;
+    int64_t last_us = 0;
+    if (sink == NULL)
+    {
+        return 0;
+    }
+    if (consumer != NULL && xTaskGetCurrentTaskHandle() != consumer)
+    {
+        xTaskNotifyGive(consumer);
+        return 0;
+    }
+    for (uint8_t core = 0; core < TLC_TELEMETRY_CORES; core++)
+    {
+        uint32_t overflow = tlc_spsc_overflow(&rings[core]);
+        next_seq += overflow - reported[core];
+        reported[core] = overflow;
+    }
+    tlc_spsc_t *ring;
+    while ((ring = tlc_telemetry_oldest()) != NULL)
+    {
+        const tlc_telemetry_entry_t *e = tlc_spsc_front(ring);
+        if (size && size + 1 + 10 + e->size + 2 > TLC_TELEMETRY_FRAME_MAX)
+        {
+            written += tlc_telemetry_send(frame, size);
+            size = 0;
+        }
+        if (size == 0)
+        {
+            frame[0] = TLC_TELEMETRY_VERSION;
+            put_le(&frame[1], next_seq, 4);
+            put_le(&frame[5], (uint64_t)e->time_us, 8);
+            size = TLC_TELEMETRY_HEADER;
+            last_us = e->time_us;
+        }
+        /* Record: type, zigzag delta, payload */
+        int64_t delta = e->time_us - last_us;
+        frame[size++] = e->type;
+        size += tlc_telemetry_varint(&frame[size], ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63));
+        memcpy(&frame[size], e->data, e->size);
+        size += e->size;
+        last_us = e->time_us;
+        next_seq++;
+        tlc_spsc_drop(ring);
+    }
+    if (size)
+    {
+        written += tlc_telemetry_send(frame, size);
+    }
+    return written;
+}
+
+/**
+ * @brief Read the telemetry counters
+ *
+ * @param out copy of the counters
+ */
+void tlc_telemetry_get_stats(tlc_telemetry_stats_t *out)
+{
+    *out = (tlc_telemetry_stats_t){.frames = frames, .bytes = bytes};
+    for (uint8_t core = 0; core < TLC_TELEMETRY_CORES; core++)
+    {
+        out->records += __atomic_load_n(&rings[core].head, __ATOMIC_ACQUIRE);
+        out->dropped += tlc_spsc_overflow(&rings[core]);
+    }
+}
@@ -0,0 +1,120 @@
+/**
+ * @file tlc_telemetry.h
+ * @brief Binary telemetry over UART0
+ * @author Jorge Minjares (https://github.com/JorgeMinjares)
+ * @brief Events are queued in a ring of the core they happen on and sent
+ *        in batches by one consumer task.
+ *        Every frame is COBS encoded and ends with a 0x00 delimiter, so a
+ *        reader can join the stream at any byte:
+ *
+ *        frame   = COBS(header records crc16) 0x00
+ *        header  = version:u8 seq:u32 time_us:u64
+ *        record  = type:u8 delta_us:svarint payload
+ *        crc16   = CRC-16/CCITT-FALSE of header and records, little endian
+ *
+ *        Integers are little endian, varints are LEB128 and svarints are
+ *        zigzag encoded varints. seq numbers the first record and the
+ *        records that follow count up from it; a gap between frames means
+ *        records were dropped. time_us is the time of the first record,
+ *        delta_us the time since the previous record. It is negative when a
+ *        task queued an event it timestamped before the previous one.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef TLC_TELEMETRY_H
+#define TLC_TELEMETRY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define TLC_TELEMETRY_VERSION 2       /*!< Protocol version in every header, 2 adds the intersection */
+#define TLC_TELEMETRY_RING 32         /*!< Records waiting to be sent per core, a power of two */
+#define TLC_TELEMETRY_CORES 2         /*!< Producer rings, one per core */
+#define TLC_TELEMETRY_DATA_MAX 48     /*!< Payload bytes of one record */
+#define TLC_TELEMETRY_FRAME_MAX 254   /*!< Header, records and CRC of one frame, COBS adds one byte */
+#define TLC_TELEMETRY_HEADER 13       /*!< Header bytes */
+
+/**
+ * @brief Record types
+ * @note Payloads:
+ *       BOOT    plan_len:u8 plan:char[plan_len] phases:u8
+ *       PHASE   instance:u8 index:u8 flags:u8 (TLC_TELEMETRY_PHASE_x), index
+ *               a tlc_phase_preempt_t while preempted
+ *       BUTTON  instance:u8 type:u8 (tlc_button_type_t) pin:u8 duration_us:varint
+ *       DENSITY cars_q8:u16 raw_q4:u16
+ *       STATS   varints: button events, button latency avg us, button
+ *               latency max us, button wakeups, adc samples, adc rejected,
+ *               adc us per value, telemetry dropped, trace lost,
+ *               record lost
+ *       TRACE   core:u8 id:u8 (tlc_trace_id_t) arg0:varint arg1:varint
+ *       TASK    name_len:u8 name:char[name_len] cpu_permille:varint
+ *               stack_size:varint stack_free:varint
+ *       LATENCY path:u8 (tlc_monitor_path_t) first:u8 n:u8 max_us:varint
+ *               count:varint[n] of buckets first..first+n-1
+ *       CONSOLE text_len:u8 text:char[text_len]
+ *       HISTORY level:u8 (tlc_history_level_t) n:u8 time_s:varint
+ *               buckets[n] as encoded in tlc_history.h, n = 0 ends a scan
+ *       RECORD  offset:varint n:u8 bytes[n], recorder stream from byte
+ *               offset on, see tlc_record.h
+ *       instance names the intersection, 0 on a single intersection board.
+ */
+typedef enum
+{
+    TLC_TELEMETRY_BOOT = 1,    /*!< Controller started a plan */
+    TLC_TELEMETRY_PHASE = 2,   /*!< Phase entered */
+    TLC_TELEMETRY_BUTTON = 3,  /*!< Pedestrian button event */
+    TLC_TELEMETRY_DENSITY = 4, /*!< Filtered traffic density */
+    TLC_TELEMETRY_STATS = 5,   /*!< Counters, once a minute */
+    TLC_TELEMETRY_TRACE = 6,   /*!< Trace ring entry */
+    TLC_TELEMETRY_TASK = 7,    /*!< Watched task, on request, see tlc_monitor.h */
+    TLC_TELEMETRY_LATENCY = 8, /*!< Latency histogram buckets, on request */
+    TLC_TELEMETRY_CONSOLE = 9, /*!< Reply to a console line, see tlc_console.h */
+    TLC_TELEMETRY_HISTORY = 10, /*!< Density history buckets, on request, see tlc_history.h */
+    TLC_TELEMETRY_RECORD = 11,  /*!< Recorded inputs and outputs, see tlc_record.h */
+} tlc_telemetry_type_t;
+
+#define TLC_TELEMETRY_PHASE_HALTED 0x01     /*!< System halted */
+#define TLC_TELEMETRY_PHASE_ACCESSIBLE 0x02 /*!< Serving an accessible call */
+#define TLC_TELEMETRY_PHASE_CALL 0x04       /*!< A call is waiting */
+#define TLC_TELEMETRY_PHASE_PREEMPT 0x08    /*!< Preemption input asserted */
+
+/**
+ * @brief Telemetry counters
+ */
+typedef struct
+{
+    uint32_t records;   /*!< Records queued */
+    uint32_t dropped;   /*!< Records lost to a full ring, either core */
+    uint32_t frames;    /*!< Frames sent */
+    uint32_t bytes;     /*!< Bytes sent, delimiters included */
+} tlc_telemetry_stats_t;
+
+/**
+ * @brief Sink for encoded frames
+ */
+typedef void (*tlc_telemetry_write_t)(const uint8_t *data, size_t size);
+
+void tlc_telemetry_init(tlc_telemetry_write_t write);
+void tlc_telemetry_consumer(TaskHandle_t task);
+bool tlc_telemetry_record(tlc_telemetry_type_t type, int64_t time_us, const uint8_t *data, size_t size);
+bool tlc_telemetry_boot(const char *plan, uint8_t phases);
+bool tlc_telemetry_phase(int64_t time_us, uint8_t instance, uint8_t index, uint8_t flags);
+bool tlc_telemetry_button(int64_t time_us, uint8_t instance, uint8_t type, uint8_t pin, int64_t duration_us);
+bool tlc_telemetry_density(int64_t time_us, uint16_t cars_q8, uint16_t raw_q4);
+bool tlc_telemetry_stats(const uint32_t *values, uint8_t count);
+bool tlc_telemetry_trace(int64_t time_us, uint8_t core, uint8_t id, uint16_t arg0, uint32_t arg1);
+uint8_t tlc_telemetry_pending(void);
+size_t tlc_telemetry_flush(void);
+void tlc_telemetry_get_stats(tlc_telemetry_stats_t *stats);
+
+size_t tlc_telemetry_varint(uint8_t *out, uint64_t value);
+uint16_t tlc_telemetry_crc16(const uint8_t *data, size_t size);
+size_t tlc_telemetry_cobs(uint8_t *out, const uint8_t *in, size_t size);
+
+#endif
@@ -0,0 +1,28 @@
+/**
+ * @file tlc_timing.h
+ * @brief Tunable times of the pedestrian and actuated plans
+ * @author Jorge Minjares (https://github.com/JorgeMinjares)
+ * @brief tlc_optimize --emit rewrites this file with the timing it picked.
+ *        Yellow and flashing don't walk are clearance times and stay fixed
+ *        in tlc_plan.c.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef TLC_TIMING_H
+#define TLC_TIMING_H
+
+/* Pedestrian plan, see tlc_plan_pedestrian */
+#define PED_GREEN_MIN_MS 3000 /*!< Shortest GREEN */
+#define PED_CALL_MS 3000      /*!< GREEN still served after a press */
+#define PED_WALK_MS 2000      /*!< WALK, before any accessible extension */
+
+/* Actuated plan, see tlc_plan_actuated */
+#define ACT_GREEN_MIN_MS 3000  /*!< Shortest GREEN */
+#define ACT_GREEN_MAX_MS 30000 /*!< Longest GREEN after a press */
+#define ACT_CALL_MS 2000       /*!< GREEN still served after a press, before the per car time */
+#define ACT_PASSAGE_MS 1000    /*!< GREEN added per queued car after a press */
+
+#endif
@@ -0,0 +1,67 @@
+/**
+ * @file tlc_trace.c
+ * @brief Per-core trace ring source code
+ * @author Jorge Minjares (https://github.com/JorgeMinjares)
+ * @brief Writers live in tlc_trace.h. The reader runs in one task and only
+ *        moves its own tail; an entry changed while it was being copied is
+ *        counted as lost instead of returned torn.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include "tlc_trace.h"
+
+tlc_trace_ring_t tlc_trace_rings[TLC_TRACE_CORES]; /*!< One ring per core */
+
+/**
+ * @brief Read the oldest unread entry of a core
+ *
+ * @param core ring to read
+ * @param entry copy of the entry
+ * @return false if nothing is ready
+ * @note Call from one task only
+ */
+bool tlc_trace_read(uint8_t core, tlc_trace_entry_t *entry)
+{
+    tlc_trace_ring_t *ring = &tlc_trace_rings[core & 1];
+    while (1)
+    {
+        uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        if (ring->tail == head)
+        {
+            return false;
+        }
+        /* The writers lapped the reader, skip to the oldest entry left */
+        if (head - ring->tail > TLC_TRACE_SIZE)
+        {
+            ring->lost += head - ring->tail - TLC_TRACE_SIZE;
+            ring->tail = head - TLC_TRACE_SIZE;
+        }
+        const tlc_trace_entry_t *e = &ring->entries[ring->tail & (TLC_TRACE_SIZE - 1)];
+        uint32_t seq = __atomic_load_n(&e->seq, __ATOMIC_ACQUIRE);
+        if (seq != ring->tail + 1)
+        {
+            if (seq == 0 || (int32_t)(seq - (ring->tail + 1)) < 0)
+            {
+                /* Claimed but still being written */
+                return false;
+            }
+            ring->lost++;
+            ring->tail++;
+            continue;
+        }
+        *entry = *e;
+        /* Overwritten during the copy */
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&e->seq, __ATOMIC_RELAXED) != seq)
+        {
+            ring->lost++;
+            ring->tail++;
+            continue;
+        }
+        ring->tail++;
+        return true;
+    }
+}
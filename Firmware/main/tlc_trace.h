@@ -0,0 +1,96 @@
+/**
+ * @file tlc_trace.h
+ * @brief Per-core trace ring
+ * @author Jorge Minjares (https://github.com/JorgeMinjares)
+ * @brief Records (timestamp, event, args) from tasks, timer callbacks and
+ *        ISRs without locks or formatting: a writer claims a slot with one
+ *        atomic add on its own core's ring, fills it and publishes it with
+ *        its sequence number. The ring overwrites its oldest entries, so a
+ *        slow reader loses history but never blocks a writer.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef TLC_TRACE_H
+#define TLC_TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+
+#define TLC_TRACE_SIZE 256           /*!< Entries per core, a power of two */
+#define TLC_TRACE_CORES 2            /*!< Rings, one per core */
+
+/**
+ * @brief Trace events
+ */
+typedef enum
+{
+    TLC_TRACE_PHASE = 1,        /*!< Phase shown: arg0 index | instance << 8, arg1 planned us, 0 if it waits for a call */
+    TLC_TRACE_PHASE_TIMER = 2,  /*!< Phase deadline timer fired */
+    TLC_TRACE_EVENT = 3,        /*!< Controller event, ADC blocks excepted: arg0 tlc_event_type_t, arg1 instance */
+    TLC_TRACE_BUTTON_EDGE = 4,  /*!< Button ISR: arg0 pin, arg1 level */
+    TLC_TRACE_BUTTON = 5,       /*!< Button event: arg0 tlc_button_type_t, arg1 pin */
+    TLC_TRACE_PATTERN = 6,      /*!< Blink pattern toggled: arg0 first pin, arg1 level */
+    TLC_TRACE_DENSITY = 7,      /*!< Density published: arg0 cars */
+    TLC_TRACE_CLOCK = 8,        /*!< Shared time base received: arg1 step of its local zero in ms, signed */
+    TLC_TRACE_TONE = 9,         /*!< Tone gated: arg0 DAC channel, arg1 tlc_audio_cue_t sounding, 0 when silenced */
+    TLC_TRACE_DEADLINE = 10,    /*!< Deadline of the shown phase set again: arg0 and arg1 as TLC_TRACE_PHASE */
+    TLC_TRACE_PREEMPT = 11,     /*!< Preemption ISR: arg0 pin, arg1 level */
+    TLC_TRACE_ADC_SHORT = 12,   /*!< Low power burst cut short: arg0 samples missing */
+} tlc_trace_id_t;
+
+/**
+ * @brief Trace entry
+ */
+typedef struct
+{
+    uint32_t seq;        /*!< Slot number + 1 once written, 0 while being written */
+    uint32_t time_us;    /*!< esp_timer time, low 32 bits */
+    uint16_t id;         /*!< tlc_trace_id_t */
+    uint16_t arg0;       /*!< First argument */
+    uint32_t arg1;       /*!< Second argument */
+} tlc_trace_entry_t;
+
+/**
+ * @brief Ring of one core
+ */
+typedef struct
+{
+    uint32_t head;                              /*!< Slots claimed */
+    uint32_t tail;                              /*!< Next slot to read */
+    uint32_t lost;                              /*!< Entries overwritten before they were read */
+    tlc_trace_entry_t entries[TLC_TRACE_SIZE];  /*!< Entries */
+} tlc_trace_ring_t;
+
+extern tlc_trace_ring_t tlc_trace_rings[TLC_TRACE_CORES];
+
+/**
+ * @brief Record an event
+ *
+ * @param id tlc_trace_id_t
+ * @param arg0 first argument
+ * @param arg1 second argument
+ * @note Safe from tasks, esp_timer callbacks and ISRs
+ */
+static inline void IRAM_ATTR tlc_trace(uint16_t id, uint16_t arg0, uint32_t arg1)
+{
+    tlc_trace_ring_t *ring = &tlc_trace_rings[xPortGetCoreID() & 1];
+    uint32_t slot = __atomic_fetch_add(&ring->head, 1, __ATOMIC_RELAXED);
+    tlc_trace_entry_t *e = &ring->entries[slot & (TLC_TRACE_SIZE - 1)];
+    __atomic_store_n(&e->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    e->time_us = (uint32_t)esp_timer_get_time();
+    e->id = id;
+    e->arg0 = arg0;
+    e->arg1 = arg1;
+    __atomic_store_n(&e->seq, slot + 1, __ATOMIC_RELEASE);
+}
+
+bool tlc_trace_read(uint8_t core, tlc_trace_entry_t *entry);
+
+#endif
@@ -82,4 +82,24 @@ typedef enum
     RED = 0x02, /*!< Red state */
 } state_t;
 
+/******************************************************************
+ * \enum walk_t traffic_light.h
+ * \brief Walk signal enumeration
+ *
+ * ### Example
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~.c
+ * typedef enum{
+ *      WALK_OFF,
+ *      WALK_ON,
+ *      WALK_WARNING,
+ * }walk_t;
+ * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *******************************************************************/
+typedef enum
+{
+    WALK_OFF = 0x00,     /*!< Walk signal off */
+    WALK_ON = 0x01,      /*!< Walk signal on */
+    WALK_WARNING = 0x02, /*!< Walk signal blinking */
+} walk_t;
+
 #endif
\ No newline at end of file